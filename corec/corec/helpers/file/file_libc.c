@@ -38,6 +38,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <errno.h>
 #if defined(TARGET_OSX)
@@ -148,6 +149,65 @@ static err_t Write(filestream* p,const void* Data,size_t Size,size_t* Written)
     return Err;
 }
 
+#define FILE_WRITEV_MAX 64
+
+static err_t WriteV(filestream* p,const streamvec* Vec,size_t Count,size_t* Written)
+{
+    struct iovec IoVec[FILE_WRITEV_MAX];
+    size_t Pos = 0;
+    size_t Skip = 0; // bytes of Vec[0] already written
+    size_t i,n,Round;
+    ssize_t Done;
+
+    while (Count)
+    {
+        for (n=0;n<Count && n<FILE_WRITEV_MAX;++n)
+        {
+            IoVec[n].iov_base = (uint8_t*)Vec[n].Data;
+            IoVec[n].iov_len = Vec[n].Size;
+        }
+        IoVec[0].iov_base = (uint8_t*)IoVec[0].iov_base + Skip;
+        IoVec[0].iov_len -= Skip;
+
+        Done = writev(p->fd, IoVec, (int)n);
+        if (Done<0)
+            break;
+        Pos += Done;
+
+        // skip the buffers fully written
+        Round = Skip + (size_t)Done;
+        for (i=0;i<n && Round>=Vec[i].Size;++i)
+            Round -= Vec[i].Size;
+        Vec += i;
+        Count -= i;
+        if (!i && !Done)
+            break; // no progress
+        Skip = Round;
+    }
+
+    if (Written)
+        *Written = Pos;
+    return Count ? ERR_WRITE : ERR_NONE;
+}
+
+#define FILE_ZEROS_EXTEND 65536 // smaller amounts are simply written
+
+static err_t WriteZeros(filestream* p,filepos_t Size,filepos_t* Written)
+{
+    // at the end of a regular file the zeros are added by extending it, without writing them
+    struct stat file_stats;
+    off_t Pos = Size>=FILE_ZEROS_EXTEND ? lseek(p->fd, 0, SEEK_CUR) : -1;
+
+    if (Pos>=0 && fstat(p->fd, &file_stats)==0 && S_ISREG(file_stats.st_mode) && Pos>=file_stats.st_size &&
+        ftruncate(p->fd, Pos+Size)==0 && lseek(p->fd, Pos+Size, SEEK_SET)==Pos+Size)
+    {
+        if (Written)
+            *Written = Size;
+        return ERR_NONE;
+    }
+    return INHERITED(p,stream_vmt,FILE_CLASS)->WriteZeros(p,Size,Written);
+}
+
 static filepos_t Seek(filestream* p,filepos_t Pos,int SeekMode)
 {
 	off_t NewPos = lseek(p->fd, Pos, SeekMode);
@@ -260,6 +320,8 @@ META_VMT(TYPE_FUNC,stream_vmt,Open,Open)
 META_VMT(TYPE_FUNC,stream_vmt,Read,Read)
 META_VMT(TYPE_FUNC,stream_vmt,ReadBlock,ReadBlock)
 META_VMT(TYPE_FUNC,stream_vmt,Write,Write)
+META_VMT(TYPE_FUNC,stream_vmt,WriteV,WriteV)
+META_VMT(TYPE_FUNC,stream_vmt,WriteZeros,WriteZeros)
 META_VMT(TYPE_FUNC,stream_vmt,Seek,Seek)
 META_VMT(TYPE_FUNC,stream_vmt,OpenDir,OpenDir)
 META_VMT(TYPE_FUNC,stream_vmt,EnumDir,EnumDir)
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ *
+ * Copyright (c) 2008-2010, CoreCodec, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of CoreCodec, Inc. nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CoreCodec, Inc. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL CoreCodec, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "file.h"
+
+#ifdef CONFIG_FILEPOS_64
+#define __USE_FILE_OFFSET64
+#endif
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// read-only memstream over a file mapped in memory, the data remain valid until the stream is deleted
+typedef struct mmapstream
+{
+	memstream Base;
+	int fd;
+	void *Map;
+	size_t MapSize;
+	tchar_t URL[MAXPATH];
+
+} mmapstream;
+
+static void Unmap(mmapstream* p)
+{
+	if (p->Map)
+	{
+		munmap(p->Map,p->MapSize);
+		p->Map = NULL;
+		p->MapSize = 0;
+	}
+	if (p->fd != -1)
+	{
+		close(p->fd);
+		p->fd = -1;
+	}
+	p->Base.Ptr = NULL;
+	p->Base.Size = 0;
+	p->Base.Pos = 0;
+	p->URL[0] = 0;
+}
+
+static err_t Open(mmapstream* p, const tchar_t* URL, int Flags)
+{
+	struct stat file_stats;
+
+	Unmap(p);
+
+	if (!URL || !URL[0])
+		return ERR_NONE;
+
+	if (Flags & (SFLAG_WRONLY|SFLAG_CREATE))
+		return ERR_NOT_SUPPORTED;
+
+	p->fd = open(URL, O_RDONLY);
+	if (p->fd == -1)
+	{
+		if ((Flags & (SFLAG_REOPEN|SFLAG_SILENT))==0)
+			NodeReportError(p,NULL,ERR_ID,ERR_FILE_NOT_FOUND,URL);
+		return ERR_FILE_NOT_FOUND;
+	}
+
+	// pipes and devices can't be mapped, the caller has to use a regular stream
+	if (fstat(p->fd, &file_stats)!=0 || !S_ISREG(file_stats.st_mode) || file_stats.st_size<=0 ||
+		(uint64_t)file_stats.st_size > (uint64_t)(size_t)-1)
+	{
+		Unmap(p);
+		return ERR_NOT_SUPPORTED;
+	}
+
+	p->MapSize = (size_t)file_stats.st_size;
+	p->Map = mmap(NULL, p->MapSize, PROT_READ, MAP_PRIVATE, p->fd, 0);
+	if (p->Map == MAP_FAILED)
+	{
+		p->Map = NULL;
+		Unmap(p);
+		return ERR_NOT_SUPPORTED;
+	}
+#if defined(MADV_SEQUENTIAL)
+	madvise(p->Map, p->MapSize, MADV_SEQUENTIAL);
+#endif
+
+	p->Base.Ptr = (const uint8_t*)p->Map;
+	p->Base.Size = p->MapSize;
+	p->Base.Pos = 0;
+	tcscpy_s(p->URL,TSIZEOF(p->URL),URL);
+	return ERR_NONE;
+}
+
+static filepos_t Seek(mmapstream* p,filepos_t Pos,int SeekMode)
+{
+	switch (SeekMode)
+	{
+	default:
+	case SEEK_SET: break;
+	case SEEK_CUR: Pos += p->Base.Pos; break;
+	case SEEK_END: Pos += p->Base.Size; break;
+	}
+
+	if (Pos<0)
+		return INVALID_FILEPOS_T;
+	// seeking past the end of a damaged file stops at the end of the mapping
+	if (Pos>(filepos_t)p->Base.Size)
+		Pos = p->Base.Size;
+	p->Base.Pos = (size_t)Pos;
+	return Pos;
+}
+
+static err_t Write(mmapstream* UNUSED_PARAM(p), const void* UNUSED_PARAM(Data), size_t UNUSED_PARAM(Size), size_t* Written)
+{
+	if (Written)
+		*Written = 0;
+	return ERR_NOT_SUPPORTED;
+}
+
+static void Delete(mmapstream* p)
+{
+	Unmap(p);
+}
+
+META_START(MmapStream_Class,MMAPSTREAM_CLASS)
+META_CLASS(SIZE,sizeof(mmapstream))
+META_CLASS(DELETE,Delete)
+META_VMT(TYPE_FUNC,stream_vmt,Open,Open)
+META_VMT(TYPE_FUNC,stream_vmt,Write,Write)
+META_VMT(TYPE_FUNC,stream_vmt,Seek,Seek)
+META_CONST(TYPE_INT,mmapstream,fd,-1)
+META_DATA_RDONLY(TYPE_STRING,STREAM_URL,mmapstream,URL)
+META_END(MEMSTREAM_CLASS)
@@ -0,0 +1,204 @@
+/*****************************************************************************
+ * 
+ * Copyright (c) 2008-2010, CoreCodec, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of CoreCodec, Inc. nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY CoreCodec, Inc. ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL CoreCodec, Inc. BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "file.h"
+
+#define GATHERSTREAM_SCRATCH    65536 // copied bytes kept before flushing
+#define GATHERSTREAM_VEC        1024  // buffers kept before flushing
+
+typedef struct gatherstream
+{
+	stream Base;
+	stream* Stream;
+    filepos_t Pos; // position in Stream of the first pending byte
+    size_t Pending;
+    array Vec; // streamvec, NULL Data for the next bytes of Scratch
+    array Scratch; // copy of the small writes
+
+} gatherstream;
+
+static NOINLINE err_t GatherFlush(gatherstream* p)
+{
+    err_t Err = ERR_NONE;
+    streamvec *i;
+    const uint8_t *Scratch;
+    size_t Written;
+
+    if (p->Stream && p->Pending)
+    {
+        Scratch = ARRAYBEGIN(p->Scratch,const uint8_t);
+        for (i=ARRAYBEGIN(p->Vec,streamvec);i!=ARRAYEND(p->Vec,streamvec);++i)
+            if (!i->Data)
+            {
+                i->Data = Scratch;
+                Scratch += i->Size;
+            }
+
+        Written = 0;
+        Err = Stream_WriteV(p->Stream,ARRAYBEGIN(p->Vec,streamvec),ARRAYCOUNT(p->Vec,streamvec),&Written);
+        p->Pos += Written;
+    }
+    p->Pending = 0;
+    ArrayDrop(&p->Vec);
+    ArrayDrop(&p->Scratch);
+    return Err;
+}
+
+static err_t GatherStream(gatherstream* p,dataid UNUSED_PARAM(Id),stream** Data,size_t UNUSED_PARAM(Size))
+{
+    GatherFlush(p);
+    p->Stream = Data?*Data:NULL;
+    p->Pos = p->Stream ? Stream_Seek(p->Stream,0,SEEK_CUR) : 0;
+    return ERR_NONE;
+}
+
+static void GatherDelete(gatherstream* p)
+{
+    GatherFlush(p);
+    ArrayClear(&p->Vec);
+    ArrayClear(&p->Scratch);
+}
+
+static bool_t AddVec(gatherstream* p,const void* Data,size_t Size)
+{
+    streamvec Vec;
+    if (!Data && !ARRAYEMPTY(p->Vec) && !ARRAYEND(p->Vec,streamvec)[-1].Data)
+    {
+        // grow the previous copied buffer
+        ARRAYEND(p->Vec,streamvec)[-1].Size += Size;
+        return 1;
+    }
+    Vec.Data = Data;
+    Vec.Size = Size;
+    return ArrayAppend(&p->Vec,&Vec,sizeof(Vec),256);
+}
+
+static err_t GatherWrite(gatherstream* p,const void* Data,size_t Size,size_t* Written)
+{
+    err_t Err = ERR_NONE;
+
+    if (Written)
+        *Written = 0;
+    if (!p->Stream)
+        return ERR_INVALID_PARAM;
+
+    if ((ARRAYCOUNT(p->Scratch,uint8_t) + Size > GATHERSTREAM_SCRATCH || ARRAYCOUNT(p->Vec,streamvec) >= GATHERSTREAM_VEC) &&
+        (Err = GatherFlush(p)) != ERR_NONE)
+        return Err;
+
+    if (Size > GATHERSTREAM_SCRATCH)
+    {
+        // too big to be worth copying
+        size_t Done = 0;
+        Err = Stream_Write(p->Stream,Data,Size,&Done);
+        p->Pos += Done;
+        if (Written)
+            *Written = Done;
+        return Err;
+    }
+
+    if (!ArrayAppend(&p->Scratch,Data,Size,4096) || !AddVec(p,NULL,Size))
+        return ERR_OUT_OF_MEMORY;
+    p->Pending += Size;
+    if (Written)
+        *Written = Size;
+    return Err;
+}
+
+static err_t GatherWriteV(gatherstream* p,const streamvec* Vec,size_t Count,size_t* Written)
+{
+    err_t Err = ERR_NONE;
+    size_t Pos = 0;
+
+    if (!p->Stream)
+        Err = ERR_INVALID_PARAM;
+
+    for (;Count && Err == ERR_NONE;++Vec,--Count)
+    {
+        if (!Vec->Size)
+            continue;
+        if (ARRAYCOUNT(p->Vec,streamvec) >= GATHERSTREAM_VEC)
+            Err = GatherFlush(p);
+        if (Err == ERR_NONE && !AddVec(p,Vec->Data,Vec->Size))
+            Err = ERR_OUT_OF_MEMORY;
+        if (Err == ERR_NONE)
+        {
+            p->Pending += Vec->Size;
+            Pos += Vec->Size;
+        }
+    }
+
+    if (Written)
+        *Written = Pos;
+    return Err;
+}
+
+static err_t GatherWriteZeros(gatherstream* p,filepos_t Size,filepos_t* Written)
+{
+    // the stream may have a faster way to add zeros than writing them
+    filepos_t Done = 0;
+    err_t Err = GatherFlush(p);
+
+    if (!p->Stream)
+        Err = ERR_INVALID_PARAM;
+    if (Err == ERR_NONE)
+    {
+        Err = Stream_WriteZeros(p->Stream,Size,&Done);
+        p->Pos += Done;
+    }
+    if (Written)
+        *Written = Done;
+    return Err;
+}
+
+static filepos_t GatherSeek(gatherstream* p,filepos_t Pos,int SeekMode)
+{
+    if (!p->Stream)
+        return INVALID_FILEPOS_T;
+    if (SeekMode == SEEK_CUR && Pos == 0)
+        return p->Pos + p->Pending;
+
+    if (GatherFlush(p) != ERR_NONE)
+        return INVALID_FILEPOS_T;
+    Pos = Stream_Seek(p->Stream,Pos,SeekMode);
+    if (Pos != INVALID_FILEPOS_T)
+        p->Pos = Pos;
+    return Pos;
+}
+
+META_START(GatherStream_Class,GATHERSTREAM_CLASS)
+META_CLASS(SIZE,sizeof(gatherstream))
+META_CLASS(DELETE,GatherDelete)
+META_VMT(TYPE_FUNC,stream_vmt,Write,GatherWrite)
+META_VMT(TYPE_FUNC,stream_vmt,WriteV,GatherWriteV)
+META_VMT(TYPE_FUNC,stream_vmt,WriteZeros,GatherWriteZeros)
+META_VMT(TYPE_FUNC,stream_vmt,Seek,GatherSeek)
+META_VMT(TYPE_FUNC,stream_vmt,Flush,GatherFlush)
+META_PARAM(SET,GATHERSTREAM_STREAM,GatherStream)
+META_END(STREAM_CLASS)
@@ -114,3 +114,15 @@ META_PARAM(SET,MEMSTREAM_DATA,MemData)
 META_DATA(TYPE_FILEPOS,MEMSTREAM_OFFSET,memstream,VirtualOffset)
 META_DATA_RDONLY(TYPE_PTR,MEMSTREAM_PTR,memstream,Ptr)
 META_END(STREAM_CLASS)
+
+const uint8_t* MemStreamData(stream* p, filepos_t Pos, size_t* Size)
+{
+    memstream* Mem = (memstream*)p;
+    if (!Node_IsPartOf(p,MEMSTREAM_CLASS) || !Mem->Ptr)
+        return NULL;
+    Pos -= Mem->VirtualOffset;
+    if (Pos < 0 || Pos > (filepos_t)Mem->Size)
+        return NULL;
+    *Size = Mem->Size - (size_t)Pos;
+    return Mem->Ptr + (size_t)Pos;
+}
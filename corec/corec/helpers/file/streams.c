@@ -155,6 +155,47 @@ static err_t DummyResetReadTimeout(void* UNUSED_PARAM(p))
     return ERR_NOT_SUPPORTED;
 }
 
+static err_t DummyWriteV(stream* p,const streamvec* Vec,size_t Count,size_t* Written)
+{
+    err_t Err = ERR_NONE;
+    size_t Pos = 0;
+    size_t Done;
+
+    for (;Count && Err == ERR_NONE;++Vec,--Count)
+    {
+        Done = 0;
+        Err = Stream_Write(p,Vec->Data,Vec->Size,&Done);
+        Pos += Done;
+    }
+
+    if (Written)
+        *Written = Pos;
+    return Err;
+}
+
+#define STREAM_ZEROS_CHUNK  (1024*1024)
+
+static err_t DummyWriteZeros(stream* p,filepos_t Size,filepos_t* Written)
+{
+    static uint8_t Zeros[STREAM_ZEROS_CHUNK]; // shared by all streams, never modified
+    err_t Err = ERR_NONE;
+    filepos_t Pos = 0;
+    size_t Done;
+
+    while (Pos < Size && Err == ERR_NONE)
+    {
+        Done = 0;
+        Err = Stream_Write(p,Zeros,(size_t)min(Size-Pos,(filepos_t)sizeof(Zeros)),&Done);
+        if (!Done)
+            break;
+        Pos += Done;
+    }
+
+    if (Written)
+        *Written = Pos;
+    return Err;
+}
+
 static err_t ProcessBlocking(void* p,bool_t State)
 { 
     stream* Input;
@@ -230,6 +271,8 @@ META_VMT(TYPE_FUNC,stream_vmt,Wait,DummyWait)
 META_VMT(TYPE_FUNC,stream_vmt,Skip,DummySkip)
 META_VMT(TYPE_FUNC,stream_vmt,Flush,DummyFlush)
 META_VMT(TYPE_FUNC,stream_vmt,ResetReadTimeout,DummyResetReadTimeout)
+META_VMT(TYPE_FUNC,stream_vmt,WriteV,DummyWriteV)
+META_VMT(TYPE_FUNC,stream_vmt,WriteZeros,DummyWriteZeros)
 META_END_CONTINUE(MEDIA_CLASS) // STREAMPROCESS_CLASS can have NODE_EXTS
 
 META_START_CONTINUE(STREAMPROCESS_CLASS)
@@ -243,7 +286,15 @@ META_END(STREAM_CLASS)
 
 stream* StreamOpen(anynode *AnyNode, const tchar_t* Path, int Flags)
 {
-	stream* File = GetStream(AnyNode,Path,Flags);
+	stream* File;
+	if ((Flags & SFLAG_MAPPED) && !(Flags & (SFLAG_WRONLY|SFLAG_CREATE)) && (File = (stream*)NodeCreate(AnyNode,MMAPSTREAM_CLASS)) != NULL)
+	{
+		if (Stream_Open(File,Path,Flags|SFLAG_SILENT) == ERR_NONE)
+			return File;
+		NodeDelete((node*)File); // pipes and special files are read with a regular stream
+	}
+
+	File = GetStream(AnyNode,Path,Flags);
 	if (File)
 	{
 		err_t Err = Stream_Open(File,Path,Flags);
@@ -85,6 +85,7 @@
 #define SFLAG_FORCE_CACHING     0x4000
 #define SFLAG_LONGTERM_CACHING  0x8000
 #define SFLAG_RECONNECT        0x10000
+#define SFLAG_MAPPED           0x20000   // used only by StreamOpen helper function
 
 #define MAX_NETWORK_PACKET      2048
 
@@ -133,6 +134,14 @@ typedef struct streamdir
 
 } streamdir;
 
+// one buffer of a vectored write
+typedef struct streamvec
+{
+    const void* Data;
+    size_t Size;
+
+} streamvec;
+
 typedef struct streamselect streamselect;
 struct streamselect
 {
@@ -166,6 +175,8 @@ typedef struct stream_vmt
     err_t (*Skip)(thisnode,intptr_t* Skip);
     err_t (*Flush)(thisnode);
     err_t (*ResetReadTimeout)(thisnode,int Secs);
+    err_t (*WriteV)(thisnode,const streamvec* Vec,size_t Count,size_t* Written);
+    err_t (*WriteZeros)(thisnode,filepos_t Size,filepos_t* Written);
 
 } stream_vmt;
 
@@ -183,6 +194,8 @@ typedef struct stream_vmt
 #define Stream_Skip(p,a)                VMT_FUNC(p,stream_vmt)->Skip(p,a)
 #define Stream_Flush(p)                 VMT_FUNC(p,stream_vmt)->Flush(p)
 #define Stream_ResetReadTimeout(p,a)    VMT_FUNC(p,stream_vmt)->ResetReadTimeout(p,a)
+#define Stream_WriteV(p,a,b,c)          VMT_FUNC(p,stream_vmt)->WriteV(p,a,b,c)
+#define Stream_WriteZeros(p,a,b)        VMT_FUNC(p,stream_vmt)->WriteZeros(p,a,b)
 
 //--------------------------------------------------------------------------
  
@@ -198,6 +211,9 @@ typedef struct stream_vmt
 #define MEMSTREAM_PTR		0x101
 #define MEMSTREAM_OFFSET    0x102
 
+// read-only memstream of a whole file mapped in memory, pointers in the data stay valid until the stream is deleted
+#define MMAPSTREAM_CLASS	FOURCC('M','M','A','P')
+
 //---------------------------------------------------------------------------
 
 #define BUFSTREAM_CLASS		FOURCC('B','U','F','S')
@@ -205,6 +221,13 @@ typedef struct stream_vmt
 
 //---------------------------------------------------------------------------
 
+// write-only stream that gathers the writes to another stream and submits them with a single Stream_WriteV()
+// the buffers given to Stream_WriteV() are not copied, they must stay valid until the stream is flushed or deleted
+#define GATHERSTREAM_CLASS	FOURCC('G','A','T','H')
+#define GATHERSTREAM_STREAM	0x100
+
+//---------------------------------------------------------------------------
+
 #define RESOURCEDATA_ID		FOURCC('R','E','S','F')
 #define RESOURCEDATA_SIZE   0x100
 #define RESOURCEDATA_PTR    0x101
@@ -217,5 +240,6 @@ FILE_DLL void StreamClose(stream*);
 FILE_DLL bool_t StreamGenExts(anynode*,array* Exts, fourcc_t ClassFilter, const tchar_t* TypeFilter);
 FILE_DLL char StreamExtType(anynode*, fourcc_t ClassFilter, const tchar_t *Ext);
 FILE_DLL int StreamProtocolPriority(anynode*, const tchar_t* URL);
+FILE_DLL const uint8_t* MemStreamData(stream*, filepos_t Pos, size_t* Size); // NULL if the stream is not in memory
 
 #endif
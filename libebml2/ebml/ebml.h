@@ -49,6 +49,8 @@ extern "C" {
 #define SCOPE_PARTIAL_DATA  0  // read all data, except inside some binary elements (useful for binary data with a (internal) header)
 #define SCOPE_ALL_DATA      1
 #define SCOPE_NO_DATA       2
+#define SCOPE_SKELETON      3  // like SCOPE_PARTIAL_DATA but masters only record the position of their children, they are read when accessed (the stream must remain open), see EBML_MasterMaterialize()
+#define SCOPE_PACKED_LEAVES 4  // like SCOPE_PARTIAL_DATA but the integer, float and date children are packed in their master, their element is created when accessed, see EBML_MasterMaterialize()
 
 // base classes
 #define EBML_ELEMENT_CLASS   FOURCC('E','B','E','L')
@@ -92,6 +94,7 @@ typedef struct ebml_binary ebml_binary;
 typedef struct ebml_integer ebml_date;
 typedef struct ebml_float ebml_float;
 typedef struct ebml_dummy ebml_dummy;
+typedef struct ebml_arena ebml_arena;
 
 struct ebml_semantic
 {
@@ -141,6 +144,18 @@ typedef struct ebml_element_vmt
 EBML_DLL err_t EBML_Init(nodecontext *p);
 EBML_DLL err_t EBML_Done(nodecontext *p);
 
+// node heap able to allocate the children of a master from a single arena, to pass to NodeContext_Init()
+// the heap is not thread safe and must remain valid until the context is done
+typedef struct ebml_memheap
+{
+    cc_memheap Base;
+    const cc_memheap *Heap;
+    ebml_arena *Arena; // arena receiving the allocations, NULL to allocate from Heap
+
+} ebml_memheap;
+
+EBML_DLL void EBML_MemHeapInit(ebml_memheap *p, const cc_memheap *Heap); // NULL Heap to use malloc()
+
 EBML_DLL ebml_element *EBML_ElementCreate(anynode *Any, const ebml_context *Context, bool_t SetDefault, const void *Cookie);
 
 EBML_DLL ebml_element *EBML_FindNextId(stream *Input, const ebml_context *Context, size_t MaxDataSize);
@@ -172,6 +187,7 @@ EBML_DLL void EBML_ElementForcePosition(ebml_element *Element, filepos_t Pos);
 EBML_DLL filepos_t EBML_ElementFullSize(const ebml_element *Element, bool_t bWithDefault);
 EBML_DLL filepos_t EBML_ElementDataSize(const ebml_element *Element, bool_t bWithDefault);
 EBML_DLL void EBML_ElementForceDataSize(ebml_element *Element, filepos_t Size);
+EBML_DLL void EBML_ElementDataSizeChanged(ebml_element *Element); // the DataSize of the element and of its parents has to be computed again
 EBML_DLL uint8_t EBML_ElementSizeLength(const ebml_element *Element);
 EBML_DLL void EBML_ElementSetSizeLength(ebml_element *Element, uint8_t SizeLength); /// 0 (for auto) to EBML_MAX_SIZE
 
@@ -181,6 +197,7 @@ EBML_DLL bool_t EBML_ElementIsType(const ebml_element *Element, const ebml_conte
 // TODO: replace the list of bools by flags ?
 EBML_DLL err_t EBML_ElementRender(ebml_element *Element, stream *Output, bool_t bWithDefault, bool_t bKeepPosition, bool_t bForceWithoutMandatory, filepos_t *Rendered);
 EBML_DLL err_t EBML_ElementRenderHead(ebml_element *Element, stream *Output, bool_t bKeepPosition, filepos_t *Rendered);
+EBML_DLL err_t EBML_ElementRenderGathered(ebml_element *Element, stream *Output, bool_t bWithDefault, bool_t bKeepPosition, bool_t bForceWithoutMandatory, filepos_t *Rendered); // the heads are copied, the frames are written from their buffers with a single Stream_WriteV()
 #endif
 
 // type specific routines
@@ -190,18 +207,30 @@ EBML_DLL err_t EBML_MasterRemove(ebml_master *Element, ebml_element *Remove);
 EBML_DLL ebml_element *EBML_MasterFindNextElt(ebml_master *Element, const ebml_element *Current, bool_t bCreateIfNull, bool_t SetDefault);
 EBML_DLL ebml_element *EBML_MasterAddElt(ebml_master *Element, const ebml_context *Context, bool_t SetDefault);
 EBML_DLL size_t EBML_MasterCount(const ebml_master *Element);
-EBML_DLL void EBML_MasterClear(ebml_master *Element); // clear the list (the children and not freed)
+// create the children left by SCOPE_SKELETON or SCOPE_PACKED_LEAVES, the accessors below don't change the master afterwards
+EBML_DLL void EBML_MasterMaterialize(ebml_master *Element, bool_t Recursive);
+// the children left by SCOPE_SKELETON or SCOPE_PACKED_LEAVES are created as they are reached, reading them from the stream:
+// these accessors and the macros using them change a const master and can't be used on a master shared between threads
+// until EBML_MasterMaterialize() was called on it
+EBML_DLL ebml_element *EBML_MasterFirstChild(const ebml_element *Element);
+EBML_DLL ebml_element *EBML_MasterNextSibling(const ebml_element *Element); // same as EBML_MasterFirstChild() for the next siblings
+EBML_DLL bool_t EBML_MasterIntegerValue(const ebml_master *Element, const ebml_context *Context, int64_t *Value); // value of the first child with this Context, packed leaves are not turned into elements
+EBML_DLL bool_t EBML_MasterFloatValue(const ebml_master *Element, const ebml_context *Context, double *Value);
+EBML_DLL void EBML_MasterClear(ebml_master *Element); // clear the list (the children and not freed, the unread ones are dropped)
 EBML_DLL void EBML_MasterErase(ebml_master *Element);
 EBML_DLL void EBML_MasterAddMandatory(ebml_master *Element, bool_t SetDefault); // add the mandatory elements
 EBML_DLL bool_t EBML_MasterCheckMandatory(const ebml_master *Element, bool_t bWithDefault);
 EBML_DLL void EBML_MasterSort(ebml_master *Element, arraycmp Cmp, const void* CmpParam);
 EBML_DLL bool_t EBML_MasterUseChecksum(ebml_master *Element, bool_t Use);
 EBML_DLL bool_t EBML_MasterIsChecksumValid(const ebml_master *Element);
+EBML_DLL bool_t EBML_MasterUseArena(ebml_master *Element, bool_t Use); // the children read or created in the master come from its arena, only when the context uses an ebml_memheap
+EBML_DLL ebml_arena *EBML_MasterEnterArena(ebml_master *Element); // allocate from the master arena until EBML_LeaveArena() is called, returns the arena to restore
+EBML_DLL void EBML_LeaveArena(anynode *Any, ebml_arena *Previous);
 #define EBML_MasterGetChild(e,c)   EBML_MasterFindFirstElt(e,c,1,1)
 #define EBML_MasterFindChild(e,c)  EBML_MasterFindFirstElt((ebml_master*)e,c,0,0)
 #define EBML_MasterNextChild(e,c)  EBML_MasterFindNextElt((ebml_master*)e,(ebml_element*)c,0,0)
-#define EBML_MasterChildren(p)     ((ebml_element*)NodeTree_Children(p))
-#define EBML_MasterNext(p)         ((ebml_element*)NodeTree_Next(p))
+#define EBML_MasterChildren(p)     EBML_MasterFirstChild((const ebml_element*)(p))
+#define EBML_MasterNext(p)         EBML_MasterNextSibling((const ebml_element*)(p))
 #define EBML_ElementParent(p)      ((ebml_element*)NodeTree_Parent(p))
 
 EBML_DLL int64_t EBML_IntegerValue(const ebml_integer *Element);
@@ -237,6 +266,51 @@ EBML_DLL fourcc_t EBML_BufferToID(const uint8_t *Buffer);
 typedef bool_t (*ContextCallback)(void *cookie, int type, const tchar_t *ClassName, const ebml_element*);
 EBML_DLL void EBML_MasterCheckContext(ebml_master *Element, int ProfileMask, ContextCallback callback, void *cookie);
 
+// streaming reader, the elements are reported to callbacks without creating any ebml_element
+#define EBML_READER_CONTINUE  0
+#define EBML_READER_SKIP      1 // don't report the children of the master just started
+#define EBML_READER_STOP      2
+
+#define EBML_READER_MASTER    0
+#define EBML_READER_INTEGER   1
+#define EBML_READER_SINTEGER  2
+#define EBML_READER_FLOAT     3
+#define EBML_READER_DATE      4
+#define EBML_READER_STRING    5
+#define EBML_READER_BINARY    6 // also Void, CRC-32 and unknown elements
+
+typedef struct ebml_reader_element
+{
+    const ebml_context *Context; // NULL for an unknown ID
+    const char *Name;
+    fourcc_t Id;
+    int Type; // EBML_READER_xxx
+    int Level; // 0 for the elements of the context given to EBML_ReaderParse()
+    filepos_t ElementPosition;
+    filepos_t DataPosition;
+    filepos_t DataSize; // INVALID_FILEPOS_T for a master with an unknown size
+    filepos_t EndPosition; // for a master with an unknown size it's only known in the End callback
+
+    // value of a leaf element, only in the Value callback
+    err_t ValueResult; // the value could not be read when not ERR_NONE
+    int64_t Integer; // integers, signed integers and dates (nanoseconds)
+    double Float;
+    const uint8_t *Data; // strings and binaries, NULL for binaries larger than MaxDataSize, their data can still be read from the stream at DataPosition
+
+} ebml_reader_element;
+
+typedef struct ebml_reader
+{
+    int (*Start)(void *Cookie, const ebml_reader_element *Element); // a master starts, EBML_READER_SKIP to jump over its children
+    int (*Value)(void *Cookie, const ebml_reader_element *Element); // a leaf element
+    int (*End)(void *Cookie, const ebml_reader_element *Element); // a master ends, also when it was skipped
+    void *Cookie;
+    size_t MaxDataSize; // largest binary loaded for the Value callback
+
+} ebml_reader;
+
+EBML_DLL err_t EBML_ReaderParse(const ebml_reader *Reader, stream *Input, const ebml_parser_context *Context); // reads from the current position of Input until Context->EndPosition or the end of the stream
+
 #if defined(EBML_LEGACY_API)
 #define CONTEXT_CONST
 #else
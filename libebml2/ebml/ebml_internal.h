@@ -40,6 +40,19 @@ extern "C" {
 #endif
 
 INTERNAL_C_API size_t GetIdLength(fourcc_t Id);
+INTERNAL_C_API const ebml_context *EBML_FindSemanticContext(const ebml_context *Context, fourcc_t Id); // only in the Semantic table of the Context
+INTERNAL_C_API err_t EBML_ReadElementHead(stream *Input, filepos_t Pos, fourcc_t *Id, filepos_t *DataSize, size_t *HeadSize); // INVALID_FILEPOS_T DataSize for an unknown size
+
+// collision free hash of the IDs in a Semantic table, generated with the semantic
+typedef struct ebml_semantic_index
+{
+    uint32_t Multiplier;
+    uint8_t Shift; // the table has 1<<(32-Shift) slots
+    const uint8_t *Slots; // 1 + position in the Semantic table, 0 for unused slots
+
+} ebml_semantic_index;
+
+#define EBML_SemanticIndexSlot(i,id)  (((uint32_t)(id) * (i)->Multiplier) >> (i)->Shift)
 
 struct ebml_context
 {
@@ -52,6 +65,7 @@ struct ebml_context
     const ebml_semantic *Semantic; // table with last element class set to NULL
     const ebml_semantic *GlobalContext; // table with last element class set to NULL
     void (*PostCreate)(ebml_element *p, const void *Cookie);
+    const ebml_semantic_index *SemanticIndex; // NULL to search the Semantic table linearly
 };
 
 struct ebml_element
@@ -65,16 +79,66 @@ struct ebml_element
     int DefaultSize;
     int8_t SizeLength;
     boolmem_t bValueIsSet;
-    boolmem_t bNeedDataSizeUpdate;
+    boolmem_t bNeedDataSizeUpdate; // also set on all the parents, see EBML_ElementDataSizeChanged()
+    boolmem_t bSkeleton; // some children of the master are not created yet (SCOPE_SKELETON or SCOPE_PACKED_LEAVES)
 };
 
 struct ebml_master
 {
     ebml_element Base;
     int CheckSumStatus; // 0: not set, 1: requested/invalid, 2: verified
+    ebml_arena *Arena; // NULL when the children are allocated one by one
+    ebml_element *LastChild;
+    size_t ChildCount;
+    array ChildIndex; // ebml_childindex for each child ID, only used once there are many children
+    struct ebml_skeletonstate *Skeleton; // NULL once all the children read with SCOPE_SKELETON are created
+    array Packed; // ebml_packedleaf of the children read with SCOPE_PACKED_LEAVES
+    boolmem_t bSizeWithDefault; // bWithDefault used to compute the DataSize
 
 };
 
+// first and last children of a master with the same ID
+typedef struct ebml_childindex
+{
+    fourcc_t Id;
+    ebml_element *First;
+    ebml_element *Last;
+
+} ebml_childindex;
+
+// child of a master read with SCOPE_SKELETON
+typedef struct ebml_skeleton
+{
+    filepos_t ElementPosition;
+    filepos_t DataSize;
+    fourcc_t Id;
+
+} ebml_skeleton;
+
+// children of a master read with SCOPE_SKELETON, only allocated while some are not created
+typedef struct ebml_skeletonstate
+{
+    array Children; // ebml_skeleton
+    size_t Read; // number of entries already turned into children
+    stream *Input;
+    int Profile;
+    bool_t AllowDummy;
+
+} ebml_skeletonstate;
+
+// integer, float or date child of a master read with SCOPE_PACKED_LEAVES
+typedef struct ebml_packedleaf
+{
+    const ebml_context *Context;
+    union { int64_t Integer; double Float; } Value;
+    uint32_t Offset; // position of the element from the start of the master data
+    int8_t DataSize;
+    int8_t SizeLength;
+
+} ebml_packedleaf;
+
+#define EBML_MASTER_INDEX_MIN  32 // number of children from which the ebml_childindex is used
+
 struct ebml_string
 {
     ebml_element Base;
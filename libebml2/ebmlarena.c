@@ -0,0 +1,230 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska (non-profit organisation)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ebml/ebml.h"
+#include "ebml/ebml_internal.h"
+
+MEMHEAP_DEFAULT
+
+#define ARENA_CHUNK_SIZE  65536
+#define ARENA_MAX_ALLOC   (ARENA_CHUNK_SIZE/8) // bigger blocks are always allocated from the heap
+
+// every block starts with the arena it comes from, NULL for blocks allocated from the heap
+typedef union arenahead
+{
+    ebml_arena *Arena;
+    int64_t Align;
+    double AlignFloat;
+
+} arenahead;
+
+typedef union arenachunk
+{
+    union arenachunk *Next;
+    arenahead Align;
+
+} arenachunk;
+
+struct ebml_arena
+{
+    ebml_memheap *Heap;
+    arenachunk *Chunks; // the chunk in use followed by the full ones
+    size_t Used; // bytes used in the chunk in use
+    size_t Live; // blocks not freed yet
+    bool_t Released; // the owner doesn't use the arena anymore
+
+};
+
+static void FreeChunks(ebml_arena *p, arenachunk *Chunk)
+{
+    arenachunk *Next;
+    for (;Chunk;Chunk=Next)
+    {
+        Next = Chunk->Next;
+        MemHeap_Free(p->Heap->Heap,Chunk,ARENA_CHUNK_SIZE);
+    }
+}
+
+static void ArenaUnused(ebml_arena *p)
+{
+    if (p->Released)
+    {
+        FreeChunks(p,p->Chunks);
+        MemHeap_Free(p->Heap->Heap,p,sizeof(ebml_arena));
+    }
+    else if (p->Chunks)
+    {
+        // start over in the chunk in use
+        FreeChunks(p,p->Chunks->Next);
+        p->Chunks->Next = NULL;
+        p->Used = sizeof(arenachunk);
+    }
+}
+
+static void *ArenaAlloc(ebml_arena *p, size_t Size)
+{
+    arenahead *Head;
+    Size = (sizeof(arenahead) + Size + sizeof(arenahead) - 1) & ~(sizeof(arenahead) - 1);
+    if (!p->Chunks || p->Used + Size > ARENA_CHUNK_SIZE)
+    {
+        arenachunk *Chunk = MemHeap_Alloc(p->Heap->Heap,ARENA_CHUNK_SIZE,0);
+        if (!Chunk)
+            return NULL;
+        Chunk->Next = p->Chunks;
+        p->Chunks = Chunk;
+        p->Used = sizeof(arenachunk);
+    }
+    Head = (arenahead*)((uint8_t*)p->Chunks + p->Used);
+    p->Used += Size;
+    ++p->Live;
+    Head->Arena = p;
+    return Head+1;
+}
+
+static void *HeapAlloc(ebml_memheap *p, size_t Size, int Flags)
+{
+    arenahead *Head;
+    if (p->Arena && Size <= ARENA_MAX_ALLOC)
+    {
+        void *Ptr = ArenaAlloc(p->Arena,Size);
+        if (Ptr)
+            return Ptr;
+    }
+    Head = MemHeap_Alloc(p->Heap,sizeof(arenahead) + Size,Flags);
+    if (!Head)
+        return NULL;
+    Head->Arena = NULL;
+    return Head+1;
+}
+
+static void HeapFree(ebml_memheap *p, void *Ptr, size_t Size)
+{
+    arenahead *Head;
+    if (!Ptr)
+        return;
+    Head = (arenahead*)Ptr - 1;
+    if (!Head->Arena)
+        MemHeap_Free(p->Heap,Head,sizeof(arenahead) + Size);
+    else if (--Head->Arena->Live == 0)
+        ArenaUnused(Head->Arena);
+}
+
+static void *HeapReAlloc(ebml_memheap *p, void *Ptr, size_t OldSize, size_t Size)
+{
+    arenahead *Head;
+    if (!Ptr)
+        return HeapAlloc(p,Size,0);
+    Head = (arenahead*)Ptr - 1;
+    if (!Head->Arena)
+    {
+        Head = MemHeap_ReAlloc(p->Heap,Head,sizeof(arenahead) + OldSize,sizeof(arenahead) + Size);
+        return Head ? Head+1 : NULL;
+    }
+
+    // a growing block leaves the arena
+    Head = MemHeap_Alloc(p->Heap,sizeof(arenahead) + Size,0);
+    if (!Head)
+        return NULL;
+    Head->Arena = NULL;
+    memcpy(Head+1,Ptr,min(OldSize,Size));
+    HeapFree(p,Ptr,OldSize);
+    return Head+1;
+}
+
+static void HeapWrite(ebml_memheap *UNUSED_PARAM(p), void *Ptr, const void *Src, size_t Pos, size_t Size)
+{
+    memcpy((uint8_t*)Ptr+Pos,Src,Size);
+}
+
+static ebml_memheap *ContextArenaHeap(const void *Any)
+{
+    const cc_memheap *Heap = Node_Context(Any)->NodeHeap;
+    if (Heap->Alloc != (memheap_alloc)HeapAlloc)
+        return NULL;
+    return (ebml_memheap*)Heap;
+}
+
+void EBML_MemHeapInit(ebml_memheap *p, const cc_memheap *Heap)
+{
+    memset(p,0,sizeof(ebml_memheap));
+    p->Base.Alloc = (memheap_alloc)HeapAlloc;
+    p->Base.Free = (memheap_free)HeapFree;
+    p->Base.ReAlloc = (memheap_realloc)HeapReAlloc;
+    p->Base.Write = (memheap_write)HeapWrite;
+    p->Base.Null.Heap = &p->Base;
+    p->Base.Null.Size = DATA_FLAG_MEMHEAP;
+    p->Heap = Heap ? Heap : &MemHeap_Default;
+}
+
+bool_t EBML_MasterUseArena(ebml_master *Element, bool_t Use)
+{
+    ebml_arena *Arena = Element->Arena;
+    if (Use && !Arena)
+    {
+        ebml_memheap *Heap = ContextArenaHeap(Element);
+        if (!Heap)
+            return 0;
+        Arena = MemHeap_Alloc(Heap->Heap,sizeof(ebml_arena),0);
+        if (!Arena)
+            return 0;
+        memset(Arena,0,sizeof(ebml_arena));
+        Arena->Heap = Heap;
+        Element->Arena = Arena;
+        return 1;
+    }
+    if (!Use && Arena)
+    {
+        // the memory is given back once the last block is freed
+        Element->Arena = NULL;
+        if (Arena->Heap->Arena == Arena)
+            Arena->Heap->Arena = NULL;
+        Arena->Released = 1;
+        if (Arena->Live == 0)
+            ArenaUnused(Arena);
+        return 1;
+    }
+    return 0;
+}
+
+ebml_arena *EBML_MasterEnterArena(ebml_master *Element)
+{
+    ebml_memheap *Heap = ContextArenaHeap(Element);
+    ebml_arena *Previous;
+    if (!Heap)
+        return NULL;
+    Previous = Heap->Arena;
+    if (Element->Arena)
+        Heap->Arena = Element->Arena;
+    return Previous;
+}
+
+void EBML_LeaveArena(anynode *Any, ebml_arena *Previous)
+{
+    ebml_memheap *Heap = ContextArenaHeap(Any);
+    if (Heap)
+        Heap->Arena = Previous;
+}
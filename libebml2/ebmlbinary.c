@@ -125,6 +125,7 @@ err_t EBML_BinarySetData(ebml_binary *Element, const uint8_t *Data, size_t DataS
     if (!ArrayResize(&Element->Data,DataSize,0))
         return ERR_OUT_OF_MEMORY;
     memcpy(ARRAYBEGIN(Element->Data,void),Data,DataSize);
+    EBML_ElementDataSizeChanged((ebml_element*)Element);
     Element->Base.DataSize = DataSize;
     Element->Base.bNeedDataSizeUpdate = 0;
     Element->Base.bValueIsSet = 1;
@@ -33,4 +33,19 @@ extern bool_t EBML_CRCMatches(ebml_crc *CRC, const uint8_t *Buf, size_t Size);
 extern void EBML_CRCAddBuffer(ebml_crc *CRC, const uint8_t *Buf, size_t Size);
 extern void EBML_CRCFinalize(ebml_crc *CRC);
 
+#define EBML_CRCSTREAM_CLASS FOURCC('E','B','C','S')
+
+// reads from Input and adds the data from the current position up to End to the CRC, the skipped data included
+// it's closed once its master is read, the children that read more later use EBML_CRCStreamInput()
+extern stream *EBML_CRCStreamCreate(anynode *Any, stream *Input, filepos_t End);
+extern bool_t EBML_CRCStreamMatches(stream *CRCStream, ebml_crc *CRC);
+// the stream read by a CRC stream, or Stream itself when it's not one
+extern stream *EBML_CRCStreamInput(stream *Stream);
+
+// update a running CRC register (0xFFFFFFFF at start) without the final inversion
+EBML_DLL uint32_t EBML_CRCUpdate(uint32_t CRC, const uint8_t *Buf, size_t Size); // fastest code for the CPU
+EBML_DLL uint32_t EBML_CRCUpdateTable(uint32_t CRC, const uint8_t *Buf, size_t Size); // portable slicing-by-8
+EBML_DLL const tchar_t *EBML_CRCUpdateName(void);
+extern void EBML_CRCSelect(void); // pick the EBML_CRCUpdate() code for the CPU, done by EBML_Init()
+
 #endif /* __LIBEBML_CRC_H */
\ No newline at end of file
@@ -149,6 +149,14 @@ void EBML_ElementForceDataSize(ebml_element *Element, filepos_t Size)
     Element->DataSize = Size;
 }
 
+void EBML_ElementDataSizeChanged(ebml_element *Element)
+{
+    Element->bNeedDataSizeUpdate = 1;
+    // a parent that needs an update already has its own parents marked
+    for (Element=EBML_ElementParent(Element);Element && !Element->bNeedDataSizeUpdate;Element=EBML_ElementParent(Element))
+        Element->bNeedDataSizeUpdate = 1;
+}
+
 uint8_t EBML_ElementSizeLength(const ebml_element *Element)
 {
     return Element->SizeLength;
@@ -314,6 +322,20 @@ err_t EBML_ElementRender(ebml_element *Element, stream *Output, bool_t bWithDefa
     return Result;
 }
 
+err_t EBML_ElementRenderGathered(ebml_element *Element, stream *Output, bool_t bWithDefault, bool_t bKeepPosition, bool_t bForceWithoutMandatory, filepos_t *Rendered)
+{
+    err_t Err,FlushErr;
+    stream *Gather = (stream*)NodeCreate(Element,GATHERSTREAM_CLASS);
+    if (!Gather)
+        return EBML_ElementRender(Element,Output,bWithDefault,bKeepPosition,bForceWithoutMandatory,Rendered);
+
+    Node_SET(Gather,GATHERSTREAM_STREAM,&Output);
+    Err = EBML_ElementRender(Element,Gather,bWithDefault,bKeepPosition,bForceWithoutMandatory,Rendered);
+    FlushErr = Stream_Flush(Gather);
+    NodeDelete((node*)Gather);
+    return Err!=ERR_NONE ? Err : FlushErr;
+}
+
 err_t EBML_ElementRenderHead(ebml_element *Element, stream *Output, bool_t bKeepPosition, filepos_t *Rendered)
 {
     err_t Err;
@@ -27,6 +27,7 @@
  */
 #include "ebml/ebml.h"
 #include "ebml/ebml_internal.h"
+#include "ebmlcrc.h"
 #if defined(EBML_LIBRARY)
 # if defined(EBML_LEGACY_API)
 #  include "ebml2_legacy_project.h"
@@ -36,6 +37,7 @@
 #endif
 
 extern const nodemeta BufStream_Class[];
+extern const nodemeta GatherStream_Class[];
 extern const nodemeta MemStream_Class[];
 extern const nodemeta Streams_Class[];
 #if defined(CONFIG_EBML_UNICODE)
@@ -52,6 +54,7 @@ extern const nodemeta EBMLBinary_Class[];
 extern const nodemeta EBMLString_Class[];
 extern const nodemeta EBMLInteger_Class[];
 extern const nodemeta EBMLCRC_Class[];
+extern const nodemeta EBMLCRCStream_Class[];
 extern const nodemeta EBMLDate_Class[];
 extern const nodemeta EBMLVoid_Class[];
 
@@ -65,6 +68,7 @@ err_t EBML_Init(nodecontext *p)
 #endif
 
     NodeRegisterClassEx((nodemodule*)p,BufStream_Class);
+	NodeRegisterClassEx((nodemodule*)p,GatherStream_Class);
 	NodeRegisterClassEx((nodemodule*)p,MemStream_Class);
 	NodeRegisterClassEx((nodemodule*)p,Streams_Class);
 #if defined(CONFIG_EBML_UNICODE)
@@ -82,8 +86,11 @@ err_t EBML_Init(nodecontext *p)
 	NodeRegisterClassEx((nodemodule*)p,EBMLInteger_Class);
 	NodeRegisterClassEx((nodemodule*)p,EBMLDate_Class);
 	NodeRegisterClassEx((nodemodule*)p,EBMLCRC_Class);
+	NodeRegisterClassEx((nodemodule*)p,EBMLCRCStream_Class);
 	NodeRegisterClassEx((nodemodule*)p,EBMLVoid_Class);
 
+	EBML_CRCSelect();
+
     return ERR_NONE;
 }
 
@@ -126,71 +133,79 @@ const ebml_semantic EBML_SemanticGlobals[] = {
 
 static const ebml_context EBML_ContextGlobals = {0, 0, 0, 0, "GlobalContext", EBML_SemanticGlobals, EBML_SemanticGlobals};
 
+// number of leading zero bits in an octet, 8 when it's 0
+#if defined(__GNUC__)
+#define EBML_CLZ8(b)  (__builtin_clz(((unsigned int)(b) << 24) | 0x800000))
+#define EBML_CLZ64(v) __builtin_clzll(v) // v must not be 0
+#else
+static INLINE size_t EBML_CLZ8(uint8_t b)
+{
+    size_t n = 0;
+    if (!(b & 0xF0)) { n += 4; b <<= 4; }
+    if (!(b & 0xC0)) { n += 2; b <<= 2; }
+    if (!(b & 0x80)) { n += 1; b <<= 1; }
+    return n + !(b & 0x80);
+}
+static INLINE size_t EBML_CLZ64(uint64_t v)
+{
+    size_t n = 0;
+    if (!(v >> 32)) { n += 32; v <<= 32; }
+    if (!(v >> 48)) { n += 16; v <<= 16; }
+    if (!(v >> 56)) { n +=  8; v <<=  8; }
+    return n + EBML_CLZ8((uint8_t)(v >> 56));
+}
+#endif
+
+static INLINE uint64_t LoadBE64(const uint8_t *InBuffer)
+{
+    uint64_t Value;
+    memcpy(&Value,InBuffer,sizeof(Value)); // unaligned safe, a single load on most CPUs
+    return INT64BE(Value);
+}
+
 filepos_t EBML_ReadCodedSizeValue(const uint8_t *InBuffer, size_t *BufferSize, filepos_t *SizeUnknown)
 {
-	uint8_t SizeBitMask = 1 << 7;
-	filepos_t Result = 0x7F;
-	unsigned int SizeIdx, PossibleSizeLength = 0;
-	uint8_t PossibleSize[8];
-    unsigned int i;
-
-	*SizeUnknown = 0x7F; // the last bit is discarded when computing the size
-	for (SizeIdx = 0; SizeIdx < *BufferSize && SizeIdx < 8; SizeIdx++) {
-		if (InBuffer[0] & (SizeBitMask >> SizeIdx)) {
-			// ID found
-			PossibleSizeLength = SizeIdx + 1;
-			SizeBitMask >>= SizeIdx;
-			for (SizeIdx = 0; SizeIdx < PossibleSizeLength; SizeIdx++) {
-				PossibleSize[SizeIdx] = InBuffer[SizeIdx];
-			}
-			for (SizeIdx = 0; SizeIdx < PossibleSizeLength - 1; SizeIdx++) {
-				Result <<= 7;
-				Result |= 0xFF;
-			}
+    size_t SizeLength;
+    uint64_t Value;
 
-			Result = 0;
-			Result |= PossibleSize[0] & ~SizeBitMask;
-			for (i = 1; i<PossibleSizeLength; i++) {
-				Result <<= 8;
-				Result |= PossibleSize[i];
-			}
+    if (*BufferSize == 0)
+    {
+        *SizeUnknown = 0x7F;
+        return 0;
+    }
 
-			*BufferSize = PossibleSizeLength;
+    SizeLength = EBML_CLZ8(InBuffer[0]) + 1;
+    if (SizeLength > *BufferSize || SizeLength > 8)
+    {
+        // the last bit is discarded when computing the size
+        SizeLength = min(*BufferSize,8);
+        *SizeUnknown = (filepos_t)(((uint64_t)1 << (7*SizeLength+7)) - 1);
+        *BufferSize = 0;
+        return 0;
+    }
 
-			return Result;
-		}
-		*SizeUnknown <<= 7;
-		*SizeUnknown |= 0xFF;
-	}
+    // all value bits set is the unknown size, it also masks the length marker
+    *SizeUnknown = (filepos_t)(((uint64_t)1 << (7*SizeLength)) - 1);
+    if (*BufferSize >= 8)
+        Value = LoadBE64(InBuffer) >> (64 - 8*SizeLength);
+    else
+    {
+        size_t i;
+        Value = InBuffer[0];
+        for (i=1; i<SizeLength; ++i)
+            Value = (Value << 8) | InBuffer[i];
+    }
 
-	*BufferSize = 0;
-	return 0;
+    *BufferSize = SizeLength;
+    return (filepos_t)(Value & (uint64_t)*SizeUnknown);
 }
 
 filepos_t EBML_ReadCodedSizeSignedValue(const uint8_t *InBuffer, size_t *BufferSize, filepos_t *SizeUnknown)
 {
+    // only the lengths up to 4 octets are stored with a bias
+    static const filepos_t SignedBias[9] = { 0, 63, 8191, 1048575L, 134217727L, 0, 0, 0, 0 };
 	filepos_t Result = EBML_ReadCodedSizeValue(InBuffer, BufferSize, SizeUnknown);
-
-	if (*BufferSize != 0)
-	{
-		switch (*BufferSize)
-		{
-		case 1:
-			Result -= 63;
-			break;
-		case 2:
-			Result -= 8191;
-			break;
-		case 3:
-			Result -= 1048575L;
-			break;
-		case 4:
-			Result -= 134217727L;
-			break;
-		}
-	}
-
-	return Result;
+	return Result - SignedBias[*BufferSize];
 }
 
 static fourcc_t EBML_IdFromBuffer(const uint8_t *PossibleId, int8_t IdLength)
@@ -212,7 +227,15 @@ static bool_t EBML_IdMatch(const uint8_t *PossibleId, int8_t IdLength, fourcc_t
 ebml_element *EBML_ElementCreate(anynode *Any, const ebml_context *Context, bool_t SetDefault, const void *Cookie)
 {
     ebml_element *Result;
-    Result = (ebml_element*)NodeCreate(Any,Context->Class);
+    if (Node_IsPartOf(Any,EBML_MASTER_CLASS) && ((ebml_master*)Any)->Arena)
+    {
+        // the children of a master using an arena come from that arena
+        ebml_arena *PrevArena = EBML_MasterEnterArena((ebml_master*)Any);
+        Result = (ebml_element*)NodeCreate(Any,Context->Class);
+        EBML_LeaveArena(Any,PrevArena);
+    }
+    else
+        Result = (ebml_element*)NodeCreate(Any,Context->Class);
     if (Result!=NULL)
     {
         Result->Context = Context;
@@ -254,26 +277,39 @@ static ebml_element *CreateElement(anynode *Any, const uint8_t *PossibleId, int8
     return Result;
 }
 
+const ebml_context *EBML_FindSemanticContext(const ebml_context *Context, fourcc_t Id)
+{
+    const ebml_semantic *Semantic;
+    if (Context->SemanticIndex)
+    {
+        uint8_t Slot = Context->SemanticIndex->Slots[EBML_SemanticIndexSlot(Context->SemanticIndex,Id)];
+        if (Slot && Context->Semantic[Slot-1].eClass->Id == Id)
+            return Context->Semantic[Slot-1].eClass;
+        return NULL;
+    }
+    for (Semantic=Context->Semantic;Semantic->eClass;Semantic++)
+    {
+        if (Semantic->eClass->Id == Id) // && (bAllowDummy || bAllowOutOfProfile || !(Context->Profile & Semantic->DisabledProfile)))
+            return Semantic->eClass;
+    }
+    return NULL;
+}
+
 static ebml_element *EBML_ElementCreateUsingContext(void *AnyNode, const uint8_t *PossibleId, int8_t IdLength, const ebml_parser_context *Context,
                                                     int *LowLevel, bool_t IsGlobalContext, bool_t bAllowDummy)
 {
     int MaxLowerLevel=1; //TODO: remove ?
 //	unsigned int ContextIndex;
 	ebml_element *Result = NULL;
-    const ebml_semantic *Semantic;
+    const ebml_context *EltContext;
 
     if (!Context || !Context->Context || !Context->Context->Semantic)
         return NULL;
 
 	// elements at the current level
-    for (Semantic=Context->Context->Semantic;Semantic->eClass;Semantic++)
-    {
-        if (EBML_IdMatch(PossibleId, IdLength, Semantic->eClass->Id)) // && (bAllowDummy || bAllowOutOfProfile || !(Context->Profile & Semantic->DisabledProfile)))
-        {
-            Result = EBML_ElementCreate(AnyNode,Semantic->eClass,0,NULL);
-			return Result;
-		}
-	}
+    EltContext = EBML_FindSemanticContext(Context->Context, EBML_IdFromBuffer(PossibleId,IdLength));
+    if (EltContext)
+        return EBML_ElementCreate(AnyNode,EltContext,0,NULL);
 
 	// global elements
 	assert(Context->Context->GlobalContext != NULL); // global should always exist, at least the EBML ones
@@ -286,6 +322,7 @@ static ebml_element *EBML_ElementCreateUsingContext(void *AnyNode, const uint8_t
 
         ContextGlobals.Semantic = Context->Context->GlobalContext;
         ContextGlobals.GlobalContext = Context->Context->GlobalContext;
+        ContextGlobals.SemanticIndex = NULL;
 
         GlobalContext.Context = &ContextGlobals;
         GlobalContext.UpContext = Context;
@@ -325,57 +362,133 @@ static ebml_element *EBML_ElementCreateUsingContext(void *AnyNode, const uint8_t
 	return Result;
 }
 
+// window over the stream to decode element heads without a stream call per octet
+typedef struct ebml_head_reader
+{
+    stream *Input;
+    const uint8_t *Window;
+    size_t WindowSize;
+    size_t WindowPos;
+    filepos_t WindowEnd; // file position following the last octet of the window
+    bool_t InMemory;
+    uint8_t Buffer[16];
+
+} ebml_head_reader;
+
+static void HeadReaderInit(ebml_head_reader *p, stream *Input, filepos_t Pos)
+{
+    p->Input = Input;
+    p->Window = MemStreamData(Input,Pos,&p->WindowSize);
+    p->InMemory = p->Window != NULL;
+    if (!p->InMemory)
+        p->WindowSize = 0;
+    p->WindowPos = 0;
+    p->WindowEnd = Pos + p->WindowSize;
+}
+
+static err_t HeadReaderByte(ebml_head_reader *p, uint8_t *Out)
+{
+    if (p->WindowPos == p->WindowSize)
+    {
+        if (p->InMemory)
+            return ERR_END_OF_FILE;
+        // the stream position always follows the window, read the next chunk from there
+        p->Window = p->Buffer;
+        p->WindowPos = 0;
+        Stream_Read(p->Input,p->Buffer,sizeof(p->Buffer),&p->WindowSize);
+        if (!p->WindowSize)
+            return ERR_END_OF_FILE;
+        p->WindowEnd += p->WindowSize;
+    }
+    *Out = p->Window[p->WindowPos++];
+    return ERR_NONE;
+}
+
+err_t EBML_ReadElementHead(stream *Input, filepos_t Pos, fourcc_t *Id, filepos_t *DataSize, size_t *HeadSize)
+{
+    uint8_t Head[EBML_MAX_ID+EBML_MAX_SIZE];
+    size_t IdLength, SizeLength, i;
+    filepos_t SizeUnknown;
+    ebml_head_reader Reader;
+
+    if (Stream_Seek(Input,Pos,SEEK_SET)!=Pos)
+        return ERR_END_OF_FILE;
+    HeadReaderInit(&Reader,Input,Pos);
+
+    if (HeadReaderByte(&Reader,&Head[0])!=ERR_NONE)
+        return ERR_END_OF_FILE;
+    IdLength = EBML_CLZ8(Head[0]) + 1;
+    if (IdLength > EBML_MAX_ID)
+        return ERR_INVALID_DATA;
+    for (i=1;i<IdLength;++i)
+        if (HeadReaderByte(&Reader,&Head[i])!=ERR_NONE)
+            return ERR_END_OF_FILE;
+
+    if (HeadReaderByte(&Reader,&Head[IdLength])!=ERR_NONE)
+        return ERR_END_OF_FILE;
+    SizeLength = EBML_CLZ8(Head[IdLength]) + 1;
+    if (SizeLength > EBML_MAX_SIZE)
+        return ERR_INVALID_DATA;
+    for (i=1;i<SizeLength;++i)
+        if (HeadReaderByte(&Reader,&Head[IdLength+i])!=ERR_NONE)
+            return ERR_END_OF_FILE;
+
+    *Id = EBML_IdFromBuffer(Head,(int8_t)IdLength);
+    *DataSize = EBML_ReadCodedSizeValue(&Head[IdLength],&SizeLength,&SizeUnknown);
+    if (*DataSize == SizeUnknown)
+        *DataSize = INVALID_FILEPOS_T;
+    *HeadSize = IdLength + SizeLength;
+    return ERR_NONE;
+}
+
 ebml_element *EBML_FindNextId(stream *Input, const ebml_context *Context, size_t MaxDataSize)
 {
     filepos_t aElementPosition, aSizePosition;
     filepos_t SizeFound=0, SizeUnknown;
-    int ReadSize;
     uint8_t BitMask;
     uint8_t PossibleId[4];
-    uint8_t PossibleSize[8]; // we don't support size stored in more than 64 bits
-    bool_t bElementFound = 0;
+    uint8_t PossibleSize[8] = {0}; // we don't support size stored in more than 64 bits
     int8_t PossibleID_Length = 0;
     size_t _SizeLength;
     uint8_t PossibleSizeLength = 0;
     ebml_element *Result = NULL;
+    ebml_head_reader Head;
 
-    while (!bElementFound)
-    {
-        aElementPosition = Stream_Seek(Input,0,SEEK_CUR);
-        ReadSize = 0;
-        BitMask = 1 << 7;
-        for (;;)
-        {
-            if (Stream_ReadOneOrMore(Input,&PossibleId[PossibleID_Length], 1, NULL)!=ERR_NONE)
-                break;
-            ReadSize++;
-            if (ReadSize == PossibleID_Length)
-                return NULL; // No more data ?
-			if (++PossibleID_Length > 4)
-				return NULL; // we don't support element IDs over class D
-            if (PossibleId[0] & BitMask)
-            {
-                bElementFound = 1;
-                break;
-            }
-            BitMask >>= 1;
-        }
+    aElementPosition = Stream_Seek(Input,0,SEEK_CUR);
+    if (aElementPosition == INVALID_FILEPOS_T)
+        return NULL;
+    HeadReaderInit(&Head,Input,aElementPosition);
 
-	    // read the data size
-	    aSizePosition = Stream_Seek(Input,0,SEEK_CUR);
-	    do {
-		    if (PossibleSizeLength >= 8)
-			    // Size is larger than 8 bytes
-			    return NULL;
-
-            if (Stream_ReadOneOrMore(Input,&PossibleSize[PossibleSizeLength++], 1, NULL)!=ERR_NONE)
-                break;
-		    ReadSize++;
-		    _SizeLength = PossibleSizeLength;
-		    SizeFound = EBML_ReadCodedSizeValue(&PossibleSize[0], &_SizeLength, &SizeUnknown);
-	    } while (_SizeLength == 0);
+    BitMask = 1 << 7;
+    for (;;)
+    {
+        if (HeadReaderByte(&Head,&PossibleId[PossibleID_Length])!=ERR_NONE)
+            goto failed; // No more data ?
+        ++PossibleID_Length;
+        if (PossibleId[0] & BitMask)
+            break;
+        if (PossibleID_Length == 4)
+            goto failed; // we don't support element IDs over class D
+        BitMask >>= 1;
     }
 
+    // read the data size, its length is given by the first octet
+    aSizePosition = aElementPosition + PossibleID_Length;
+    if (HeadReaderByte(&Head,&PossibleSize[0])!=ERR_NONE)
+        goto failed;
+    _SizeLength = EBML_CLZ8(PossibleSize[0]) + 1;
+    if (_SizeLength > 8)
+        goto failed; // Size is larger than 8 bytes
+    for (PossibleSizeLength=1; PossibleSizeLength<_SizeLength; ++PossibleSizeLength)
+        if (HeadReaderByte(&Head,&PossibleSize[PossibleSizeLength])!=ERR_NONE)
+            goto failed;
+    // decoded once from the 8 octets, the unused ones are zero
+    _SizeLength = sizeof(PossibleSize);
+    SizeFound = EBML_ReadCodedSizeValue(&PossibleSize[0], &_SizeLength, &SizeUnknown);
+
+    // place the file at the beginning of the data
+    Stream_Seek(Input,aSizePosition + _SizeLength,SEEK_SET);
+
     // look for the ID in the provided context
     Result = CreateElement(Input, PossibleId, PossibleID_Length, Context,NULL);
     assert(Result != NULL);
@@ -401,26 +514,23 @@ printf("Elt: size %d id %d %02X\n",SizeFound,PossibleID_Length,PossibleId[0]);
     Result->EndPosition = aSizePosition + _SizeLength + SizeFound;
 
     return Result;
+
+failed:
+    Stream_Seek(Input,aElementPosition + PossibleID_Length + PossibleSizeLength,SEEK_SET);
+    return NULL;
 }
 
 uint8_t EBML_CodedSizeLength(filepos_t Length, uint8_t SizeLength, bool_t bSizeIsFinite)
 {
-	int CodedSize;
-	if (!bSizeIsFinite)
+	size_t CodedSize;
+	if (!bSizeIsFinite || Length < 0)
 		CodedSize = 1;
 	else
     {
-		// prepare the head of the size (000...01xxxxxx)
-		// optimal size
-		if (Length < 127) // 2^7 - 1
-			CodedSize = 1;
-		else if (Length < 16383) // 2^14 - 1
-			CodedSize = 2;
-		else if (Length < 2097151) // 2^21 - 1
-			CodedSize = 3;
-		else if (Length < 268435455) // 2^28 - 1
-			CodedSize = 4;
-		else CodedSize = 5;
+		// optimal size, a value with all bits set is reserved (000...01111111)
+		CodedSize = (64 - EBML_CLZ64(((uint64_t)Length + 1) | 1) + 6) / 7;
+		if (CodedSize > 5)
+			CodedSize = 5;
 	}
 
 	if (SizeLength && CodedSize < SizeLength)
@@ -455,27 +565,18 @@ uint8_t EBML_CodedSizeLengthSigned(filepos_t Length, uint8_t SizeLength)
 
 uint8_t EBML_CodedValueLength(filepos_t Length, size_t CodedSize, uint8_t *OutBuffer, bool_t bSizeIsFinite)
 {
-	int _SizeMask = 0xFF;
+    uint64_t Value;
     size_t i;
-#if 0
-if (CodedSize==3)
-printf("%08X ",(int)Length);
-#endif
+    assert(CodedSize >= 1 && CodedSize <= 8);
     if (!bSizeIsFinite)
         Length=MAX_FILEPOS;
-	OutBuffer[0] = (uint8_t)(1 << (8 - CodedSize));
-	for (i=1; i<CodedSize; ++i)
+    // keep the value bits and set the length marker (000...01xxxxxx)
+    Value = ((uint64_t)Length & (((uint64_t)2 << (7*CodedSize)) - 1)) | ((uint64_t)1 << (7*CodedSize));
+    for (i=CodedSize; i>0; --i)
     {
-		OutBuffer[CodedSize-i] = (uint8_t)(Length & 0xFF);
-		Length >>= 8;
-		_SizeMask >>= 1;
-	}
-	// first one use a OR with the "EBML size head"
-	OutBuffer[0] |= Length & 0xFF & _SizeMask;
-#if 0
-if (CodedSize==3)
-printf("%02X%02X%02X\n",OutBuffer[0],OutBuffer[1],OutBuffer[2]);
-#endif
+        OutBuffer[i-1] = (uint8_t)Value;
+        Value >>= 8;
+    }
 	return (uint8_t)CodedSize;
 }
 
@@ -509,9 +610,11 @@ ebml_element *EBML_FindNextElement(stream *Input, const ebml_parser_context *pCo
     filepos_t StartPos = Stream_Seek(Input,0,SEEK_CUR);
 	ebml_parser_context OrigContext;
 	const ebml_parser_context *Context = &OrigContext;
+    ebml_head_reader Head;
 
 	if (StartPos == INVALID_FILEPOS_T)
 		return NULL;
+    HeadReaderInit(&Head,Input,StartPos);
 
     assert(Context != NULL);
 	OrigContext = *pContext;
@@ -555,8 +658,8 @@ ebml_element *EBML_FindNextElement(stream *Input, const ebml_parser_context *pCo
 				memmove(&PossibleIdNSize[0],&PossibleIdNSize[1], --ReadIndex);
 			}
 
-            if (Stream_ReadOneOrMore(Input,&PossibleIdNSize[ReadIndex++], 1, NULL)!=ERR_NONE)
-				return NULL; // no more data ?
+            if (HeadReaderByte(&Head,&PossibleIdNSize[ReadIndex++])!=ERR_NONE)
+				goto failed; // no more data ?
 			ReadSize++;
 
         } while (!bFound);
@@ -581,13 +684,13 @@ ebml_element *EBML_FindNextElement(stream *Input, const ebml_parser_context *pCo
                 break; // invalid all zero size
             if (Context->EndPosition == StartPos+ReadSize)
                 break; // we should not read further than our limit
-            if (Stream_ReadOneOrMore(Input,&PossibleIdNSize[SizeIdx++], 1, NULL)!=ERR_NONE)
-                return NULL;
+            if (HeadReaderByte(&Head,&PossibleIdNSize[SizeIdx++])!=ERR_NONE)
+                goto failed;
 			ReadSize++;
 			PossibleSizeLength++;
 		}
 
-        CurrentPos = Stream_Seek(Input,0,SEEK_CUR);
+        CurrentPos = StartPos + ReadSize;
 		if (bFound)
         {
             // make sure the element we found is contained in the Context
@@ -688,5 +791,8 @@ ebml_element *EBML_FindNextElement(stream *Input, const ebml_parser_context *pCo
 		Context = &OrigContext;
     } while (Context->EndPosition==INVALID_FILEPOS_T || (Context->EndPosition > CurrentPos - SizeIdx + PossibleID_Length));
 
+failed:
+    // the window may have read ahead, leave the stream after the octets actually used
+    Stream_Seek(Input,StartPos + ReadSize,SEEK_SET);
 	return NULL;
 }
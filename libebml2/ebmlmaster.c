@@ -29,6 +29,8 @@
 #include "ebml/ebml_internal.h"
 #include "ebmlcrc.h"
 
+MEMHEAP_DEFAULT
+
 ebml_element *EBML_MasterAddElt(ebml_master *Element, const ebml_context *Context, bool_t SetDefault)
 {
     ebml_element *i;
@@ -68,13 +70,294 @@ ebml_element *EBML_MasterAddElt(ebml_master *Element, const ebml_context *Contex
     return i;
 }
 
-ebml_element *EBML_MasterFindFirstElt(ebml_master *Element, const ebml_context *Context, bool_t bCreateIfNull, bool_t SetDefault)
+static ebml_childindex *FindChildIndex(const ebml_master *Element, fourcc_t Id)
+{
+    ebml_childindex *i;
+    for (i=ARRAYBEGIN(Element->ChildIndex,ebml_childindex);i!=ARRAYEND(Element->ChildIndex,ebml_childindex);++i)
+        if (i->Id == Id)
+            return i;
+    return NULL;
+}
+
+static void AddChildIndex(ebml_master *Element, ebml_element *Child)
+{
+    // the Child is the last one of the master
+    ebml_childindex *Index = FindChildIndex(Element,Child->Context->Id);
+    if (Index)
+        Index->Last = Child;
+    else
+    {
+        ebml_childindex New;
+        New.Id = Child->Context->Id;
+        New.First = New.Last = Child;
+        if (!ArrayAppend(&Element->ChildIndex,&New,sizeof(New),64))
+            ArrayClear(&Element->ChildIndex); // the index can't be trusted anymore
+    }
+}
+
+static bool_t UseChildIndex(ebml_master *Element)
 {
     ebml_element *i;
-    for (i=EBML_MasterChildren(Element);i;i=EBML_MasterNext(i))
+    if (!ARRAYEMPTY(Element->ChildIndex))
+        return 1;
+    if (Element->ChildCount < EBML_MASTER_INDEX_MIN)
+        return 0;
+
+    for (i=(ebml_element*)NodeTree_Children(Element);i;i=(ebml_element*)NodeTree_Next(i))
+    {
+        AddChildIndex(Element,i);
+        if (ARRAYEMPTY(Element->ChildIndex))
+            return 0;
+    }
+    return 1;
+}
+
+static void ClearSkeleton(ebml_master *Element)
+{
+    if (Element->Skeleton)
+    {
+        ArrayClear(&Element->Skeleton->Children);
+        MemHeap_Free(&MemHeap_Default,Element->Skeleton,sizeof(ebml_skeletonstate));
+        Element->Skeleton = NULL;
+    }
+    Element->Base.bSkeleton = !ARRAYEMPTY(Element->Packed);
+}
+
+static bool_t IsPackedClass(const ebml_context *Context)
+{
+    return Context->Class==EBML_INTEGER_CLASS || Context->Class==EBML_SINTEGER_CLASS || Context->Class==EBML_BOOLEAN_CLASS ||
+           Context->Class==EBML_DATE_CLASS || Context->Class==EBML_FLOAT_CLASS;
+}
+
+// keep the value of a leaf read with SCOPE_PACKED_LEAVES in its master, fails when it needs to remain an element
+static bool_t PackLeaf(ebml_master *Element, const ebml_element *Child)
+{
+    ebml_packedleaf Leaf;
+    filepos_t Offset = Child->ElementPosition - EBML_ElementPositionData((ebml_element*)Element);
+
+    if (!IsPackedClass(Child->Context) || !Child->bValueIsSet || !EBML_ElementIsFiniteSize(Child) ||
+        Child->DataSize > 8 || Child->SizeLength > EBML_MAX_SIZE || Offset < 0 || Offset > 0xFFFFFFFF)
+        return 0;
+
+    Leaf.Context = Child->Context;
+    if (Child->Context->Class == EBML_FLOAT_CLASS)
+        Leaf.Value.Float = ((const ebml_float*)Child)->Value;
+    else
+        Leaf.Value.Integer = ((const ebml_integer*)Child)->Value;
+    Leaf.Offset = (uint32_t)Offset;
+    Leaf.DataSize = (int8_t)Child->DataSize;
+    Leaf.SizeLength = Child->SizeLength;
+    return ArrayAppend(&Element->Packed,&Leaf,sizeof(Leaf),0); // kept as small as possible
+}
+
+// create the elements of the packed leaves, in file order with the other children
+static void UnpackLeaves(ebml_master *Element)
+{
+    array Packed = Element->Packed;
+    const ebml_packedleaf *i;
+    ebml_element *Leaf;
+    ebml_element *Next = (ebml_element*)NodeTree_Children(Element);
+    filepos_t DataPos = EBML_ElementPositionData((ebml_element*)Element);
+
+    ArrayInit(&Element->Packed);
+    Element->Base.bSkeleton = 0; // the leaves are inserted between the existing children
+    for (i=ARRAYBEGIN(Packed,ebml_packedleaf);i!=ARRAYEND(Packed,ebml_packedleaf);++i)
     {
+        Leaf = EBML_ElementCreate(Element,i->Context,0,NULL);
+        if (!Leaf)
+            continue;
+        Leaf->ElementPosition = DataPos + i->Offset;
+        Leaf->SizePosition = Leaf->ElementPosition + GetIdLength(i->Context->Id);
+        Leaf->SizeLength = i->SizeLength;
+        Leaf->DataSize = i->DataSize;
+        Leaf->EndPosition = Leaf->SizePosition + Leaf->SizeLength + Leaf->DataSize;
+        if (i->Context->Class == EBML_FLOAT_CLASS)
+            ((ebml_float*)Leaf)->Value = i->Value.Float;
+        else
+            ((ebml_integer*)Leaf)->Value = i->Value.Integer;
+        Leaf->bValueIsSet = 1;
+
+        // the master value doesn't change, not added with EBML_MasterAppend()
+        while (Next && Next->ElementPosition < Leaf->ElementPosition)
+            Next = (ebml_element*)NodeTree_Next(Next);
+        if (NodeTree_SetParent(Leaf,Element,Next)!=ERR_NONE)
+            NodeDelete((node*)Leaf);
+    }
+    Element->Base.bSkeleton = Element->Skeleton!=NULL;
+    ArrayClear(&Packed);
+}
+
+// the first child with this Context, packed or not
+static const ebml_element *FindLeaf(const ebml_master *Element, const ebml_context *Context, const ebml_packedleaf **Packed)
+{
+    const ebml_packedleaf *i;
+    const ebml_element *Child;
+
+    *Packed = NULL;
+    if (ARRAYEMPTY(Element->Packed))
+        return EBML_MasterFindChild(Element,Context);
+
+    for (i=ARRAYBEGIN(Element->Packed,ebml_packedleaf);i!=ARRAYEND(Element->Packed,ebml_packedleaf);++i)
         if (i->Context->Id == Context->Id)
+        {
+            *Packed = i;
+            break;
+        }
+    // some leaves may not have been packed
+    for (Child=(const ebml_element*)NodeTree_Children(Element);Child;Child=(const ebml_element*)NodeTree_Next(Child))
+        if (Child->Context->Id == Context->Id)
             break;
+    if (Child && *Packed && Child->ElementPosition > EBML_ElementPositionData((const ebml_element*)Element) + (*Packed)->Offset)
+        Child = NULL;
+    if (Child)
+        *Packed = NULL;
+    return Child;
+}
+
+bool_t EBML_MasterIntegerValue(const ebml_master *Element, const ebml_context *Context, int64_t *Value)
+{
+    const ebml_packedleaf *Packed;
+    const ebml_element *Child = FindLeaf(Element,Context,&Packed);
+    if (Packed && Packed->Context->Class != EBML_FLOAT_CLASS)
+        *Value = Packed->Value.Integer;
+    else if (Child && (Node_IsPartOf(Child,EBML_INTEGER_CLASS) || Node_IsPartOf(Child,EBML_SINTEGER_CLASS)))
+        *Value = EBML_IntegerValue((const ebml_integer*)Child);
+    else
+        return 0;
+    return 1;
+}
+
+bool_t EBML_MasterFloatValue(const ebml_master *Element, const ebml_context *Context, double *Value)
+{
+    const ebml_packedleaf *Packed;
+    const ebml_element *Child = FindLeaf(Element,Context,&Packed);
+    if (Packed && Packed->Context->Class == EBML_FLOAT_CLASS)
+        *Value = Packed->Value.Float;
+    else if (Child && Node_IsPartOf(Child,EBML_FLOAT_CLASS))
+        *Value = EBML_FloatValue((const ebml_float*)Child);
+    else
+        return 0;
+    return 1;
+}
+
+// create and read the children recorded with SCOPE_SKELETON until Count of them are read
+static void Materialize(ebml_master *Element, size_t Count)
+{
+    ebml_parser_context Context;
+    ebml_skeletonstate *Skeleton = Element->Skeleton;
+    ebml_skeleton *i;
+    ebml_element *SubElement;
+    ebml_arena *PrevArena;
+    stream *Input = Skeleton->Input;
+    bool_t AllowDummyElt = Skeleton->AllowDummy;
+    filepos_t SavedPos;
+    int UpperEltFound;
+
+    if (Count > ARRAYCOUNT(Skeleton->Children,ebml_skeleton))
+        Count = ARRAYCOUNT(Skeleton->Children,ebml_skeleton);
+
+    Element->Base.bSkeleton = 0; // the children are appended normally
+    SavedPos = Stream_Seek(Input,0,SEEK_CUR);
+    Context.UpContext = NULL;
+    Context.Context = Element->Base.Context;
+    Context.EndPosition = EBML_ElementPositionEnd((ebml_element*)Element);
+    Context.Profile = Skeleton->Profile;
+    PrevArena = EBML_MasterEnterArena(Element);
+    for (;Skeleton->Read < Count;++Skeleton->Read)
+    {
+        i = ARRAYBEGIN(Skeleton->Children,ebml_skeleton) + Skeleton->Read;
+        if (Stream_Seek(Input,i->ElementPosition,SEEK_SET)!=i->ElementPosition)
+            continue;
+        UpperEltFound = 0;
+        SubElement = EBML_FindNextElement(Input,&Context,&UpperEltFound,AllowDummyElt);
+        if (!SubElement)
+            continue;
+        // same checks as a regular read, without the upper context the unknown IDs are dummies
+        if (SubElement->ElementPosition!=i->ElementPosition || UpperEltFound!=0 || (!AllowDummyElt && EBML_ElementIsDummy(SubElement)) ||
+            EBML_ElementReadData(SubElement,Input,&Context,AllowDummyElt,SCOPE_SKELETON,0)!=ERR_NONE)
+            NodeDelete((node*)SubElement);
+        else
+            EBML_MasterAppend(Element,SubElement);
+    }
+    EBML_LeaveArena(Element,PrevArena);
+    if (SavedPos!=INVALID_FILEPOS_T)
+        Stream_Seek(Input,SavedPos,SEEK_SET);
+
+    if (Skeleton->Read == ARRAYCOUNT(Skeleton->Children,ebml_skeleton))
+        ClearSkeleton(Element);
+    else
+        Element->Base.bSkeleton = 1;
+}
+
+// read the children until one more is added or there are no more to read
+static void MaterializeNext(ebml_master *Element)
+{
+    size_t Count = Element->ChildCount;
+    while (Element->Skeleton && Element->ChildCount == Count)
+        Materialize(Element,Element->Skeleton->Read+1);
+}
+
+static size_t FindSkeletonId(const ebml_master *Element, fourcc_t Id)
+{
+    const ebml_skeleton *i;
+    if (!Element->Skeleton)
+        return (size_t)-1;
+    for (i=ARRAYBEGIN(Element->Skeleton->Children,ebml_skeleton)+Element->Skeleton->Read;i!=ARRAYEND(Element->Skeleton->Children,ebml_skeleton);++i)
+        if (i->Id == Id)
+            return i - ARRAYBEGIN(Element->Skeleton->Children,ebml_skeleton);
+    return (size_t)-1;
+}
+
+ebml_element *EBML_MasterFirstChild(const ebml_element *Element)
+{
+    if (Element->bSkeleton)
+    {
+        // the children are part of the logical value
+        if (!ARRAYEMPTY(((const ebml_master*)Element)->Packed))
+            UnpackLeaves((ebml_master*)Element);
+        if (!Element->Base.Children)
+            MaterializeNext((ebml_master*)Element);
+    }
+    return (ebml_element*)NodeTree_Children(Element);
+}
+
+ebml_element *EBML_MasterNextSibling(const ebml_element *Element)
+{
+    ebml_element *Parent = EBML_ElementParent(Element);
+    if (Parent && Parent->bSkeleton && Node_IsPartOf(Parent,EBML_MASTER_CLASS))
+    {
+        if (!ARRAYEMPTY(((ebml_master*)Parent)->Packed))
+            UnpackLeaves((ebml_master*)Parent); // the next sibling may be a packed leaf
+        if (!Element->Base.Next)
+            MaterializeNext((ebml_master*)Parent);
+    }
+    return (ebml_element*)NodeTree_Next(Element);
+}
+
+ebml_element *EBML_MasterFindFirstElt(ebml_master *Element, const ebml_context *Context, bool_t bCreateIfNull, bool_t SetDefault)
+{
+    ebml_element *i;
+    size_t Pending;
+    if (!ARRAYEMPTY(Element->Packed) && IsPackedClass(Context))
+        UnpackLeaves(Element);
+    for (;;)
+    {
+        if (UseChildIndex(Element))
+        {
+            ebml_childindex *Index = FindChildIndex(Element,Context->Id);
+            i = Index ? Index->First : NULL;
+        }
+        else
+        for (i=(ebml_element*)NodeTree_Children(Element);i;i=(ebml_element*)NodeTree_Next(i))
+        {
+            if (i->Context->Id == Context->Id)
+                break;
+        }
+
+        // the children not read yet come after the ones already read
+        if (i || !Element->Base.bSkeleton || (Pending = FindSkeletonId(Element,Context->Id))==(size_t)-1)
+            break;
+        Materialize(Element,Pending+1);
     }
 
     if (!i && bCreateIfNull)
@@ -86,13 +369,28 @@ ebml_element *EBML_MasterFindFirstElt(ebml_master *Element, const ebml_context *
 ebml_element *EBML_MasterFindNextElt(ebml_master *Element, const ebml_element *Current, bool_t bCreateIfNull, bool_t SetDefault)
 {
     ebml_element *i;
+    size_t Pending;
     if (!Current)
         return NULL;
 
-    for (i=EBML_MasterNext(Current);i;i=EBML_MasterNext(i))
+    if (!ARRAYEMPTY(Element->Packed) && IsPackedClass(Current->Context))
+        UnpackLeaves(Element);
+    for (;;)
     {
-        if (i->Context->Id == Current->Context->Id)
+        if (EBML_ElementParent(Current)==(ebml_element*)Element && UseChildIndex(Element) &&
+            FindChildIndex(Element,Current->Context->Id)->Last == Current)
+            i = NULL; // no need to look at the other children
+        else
+        for (i=(ebml_element*)NodeTree_Next(Current);i;i=(ebml_element*)NodeTree_Next(i))
+        {
+            if (i->Context->Id == Current->Context->Id)
+                break;
+        }
+
+        if (i || !Element->Base.bSkeleton || EBML_ElementParent(Current)!=(ebml_element*)Element ||
+            (Pending = FindSkeletonId(Element,Current->Context->Id))==(size_t)-1)
             break;
+        Materialize(Element,Pending+1);
     }
 
     if (!i && bCreateIfNull)
@@ -108,7 +406,7 @@ err_t EBML_MasterAppend(ebml_master *Element, ebml_element *Append)
     Result = NodeTree_SetParent(Append,Element,NULL);
     if (Result==ERR_NONE)
     {
-        Element->Base.bNeedDataSizeUpdate = 1;
+        EBML_ElementDataSizeChanged((ebml_element*)Element);
         Element->Base.bValueIsSet = 1;
     }
     return Result;
@@ -120,13 +418,25 @@ err_t EBML_MasterRemove(ebml_master *Element, ebml_element *Append)
     return Result;
 }
 
-size_t EBML_MasterCount(const ebml_master *Element)
+void EBML_MasterMaterialize(ebml_master *Element, bool_t Recursive)
 {
-    size_t Result = 0;
     ebml_element *i;
-    for (i=EBML_MasterChildren(Element);i;i=EBML_MasterNext(i))
-        ++Result;
-    return Result;
+	assert(Node_IsPartOf(Element,EBML_MASTER_CLASS));
+    if (!ARRAYEMPTY(Element->Packed))
+        UnpackLeaves(Element);
+    if (Element->Skeleton)
+        Materialize(Element,(size_t)-1);
+    if (Recursive)
+        for (i=(ebml_element*)NodeTree_Children(Element);i;i=(ebml_element*)NodeTree_Next(i))
+            if (Node_IsPartOf(i,EBML_MASTER_CLASS))
+                EBML_MasterMaterialize((ebml_master*)i,1);
+}
+
+size_t EBML_MasterCount(const ebml_master *Element)
+{
+    if (Element->Skeleton)
+        Materialize((ebml_master*)Element,(size_t)-1);
+    return Element->ChildCount + ARRAYCOUNT(Element->Packed,ebml_packedleaf);
 }
 
 static int EbmlCmp(const ebml_element* Element, const ebml_element** a,const ebml_element** b)
@@ -161,16 +471,17 @@ void EBML_MasterSort(ebml_master *Element, arraycmp Cmp, const void* CmpParam)
 
 void EBML_MasterClear(ebml_master *Element)
 {
-    ebml_element *i = EBML_MasterChildren(Element);
-    while (i)
-    {
-        NodeTree_SetParent(i,NULL,NULL);
-        i = EBML_MasterChildren(Element);
-    }
+    // the children not read yet were never given to the caller
+    ArrayClear(&Element->Packed);
+    ClearSkeleton(Element);
+    while (Element->Base.Base.Children)
+        NodeTree_SetParent(Element->Base.Base.Children,NULL,NULL);
 }
 
 void EBML_MasterErase(ebml_master *Element)
 {
+    ArrayClear(&Element->Packed);
+    ClearSkeleton(Element);
 	while (Element->Base.Base.Children)
     	NodeTree_DetachAndRelease(Element->Base.Base.Children);
 }
@@ -219,16 +530,10 @@ bool_t EBML_MasterCheckMandatory(const ebml_master *Element, bool_t bWithDefault
 
 static bool_t NeedsDataSizeUpdate(ebml_element *Element, bool_t bWithDefault)
 {
-    ebml_element *i;
-    if (INHERITED(Element,ebml_element_vmt,EBML_MASTER_CLASS)->NeedsDataSizeUpdate(Element, bWithDefault))
+    // the children that change mark their parents, no need to look at them
+    if (((ebml_master*)Element)->bSizeWithDefault != bWithDefault)
         return 1;
-
-    for (i=EBML_MasterChildren(Element);i;i=EBML_MasterNext(i))
-    {
-        if (EBML_ElementNeedsDataSizeUpdate(i,bWithDefault))
-            return 1;
-    }
-    return 0;
+    return INHERITED(Element,ebml_element_vmt,EBML_MASTER_CLASS)->NeedsDataSizeUpdate(Element, bWithDefault);
 }
 
 static filepos_t UpdateDataSize(ebml_master *Element, bool_t bWithDefault, bool_t bForceWithoutMandatory)
@@ -264,6 +569,7 @@ static filepos_t UpdateDataSize(ebml_master *Element, bool_t bWithDefault, bool_
 		    Element->DataSize += EBML_ElementFullSize(Element->Checksum,bWithDefault);
 	    }
 #endif
+        Element->bSizeWithDefault = (boolmem_t)(bWithDefault!=0);
     }
 
     return INHERITED(Element,ebml_element_vmt,EBML_MASTER_CLASS)->UpdateDataSize(Element, bWithDefault, bForceWithoutMandatory);
@@ -289,28 +595,85 @@ static void PostCreate(ebml_master *Element, bool_t SetDefault)
     }
 }
 
+// only record the position of the children, fails when the master can't be read that way
+static bool_t ReadSkeleton(ebml_master *Element, stream *Input, const ebml_parser_context *ParserContext, bool_t AllowDummyElt, size_t DepthCheckCRC)
+{
+    ebml_skeleton Child;
+    array Children;
+    filepos_t Pos = EBML_ElementPositionData((ebml_element*)Element);
+    filepos_t End = EBML_ElementPositionEnd((ebml_element*)Element);
+    size_t HeadSize;
+
+    if (!EBML_ElementIsFiniteSize((ebml_element*)Element))
+        return 0;
+
+    ArrayInit(&Children);
+    while (Pos < End)
+    {
+        if (EBML_ReadElementHead(Input,Pos,&Child.Id,&Child.DataSize,&HeadSize)!=ERR_NONE || Child.DataSize==INVALID_FILEPOS_T ||
+            Pos + (filepos_t)HeadSize + Child.DataSize > End ||
+            (DepthCheckCRC && ARRAYEMPTY(Children) && Child.Id==EBML_ContextEbmlCrc32.Id)) // the CRC is checked on a regular read
+            goto failed;
+        Child.ElementPosition = Pos;
+        if (!ArrayAppend(&Children,&Child,sizeof(Child),256))
+            goto failed;
+        Pos += HeadSize + Child.DataSize;
+    }
+
+    if (!ARRAYEMPTY(Children))
+    {
+        Element->Skeleton = MemHeap_Alloc(&MemHeap_Default,sizeof(ebml_skeletonstate),0);
+        if (!Element->Skeleton)
+            goto failed;
+        Element->Skeleton->Children = Children;
+        Element->Skeleton->Read = 0;
+        Element->Skeleton->Input = EBML_CRCStreamInput(Input); // a CRC stream is gone when the children are read
+        Element->Skeleton->Profile = ParserContext->Profile;
+        Element->Skeleton->AllowDummy = AllowDummyElt;
+        Element->Base.bSkeleton = 1;
+    }
+    Element->Base.bValueIsSet = 1;
+    Stream_Seek(Input,End,SEEK_SET);
+    return 1;
+
+failed:
+    ArrayClear(&Children);
+    return 0;
+}
+
 static err_t ReadData(ebml_master *Element, stream *Input, const ebml_parser_context *ParserContext, bool_t AllowDummyElt, int Scope, size_t DepthCheckCRC)
 {
     int UpperEltFound = 0;
     bool_t bFirst = 1;
+    bool_t bPacked = 0;
     ebml_element *SubElement;
     ebml_crc *CRCElement = NULL;
     stream *ReadStream = Input;
-    array CrcBuffer;
     uint8_t *CRCData = NULL;
     size_t CRCDataSize;
+    ebml_arena *PrevArena;
 
     // remove all existing elements, including the mandatory ones...
     NodeTree_Clear((nodetree*)Element);
+    ArrayClear(&Element->Packed);
+    ClearSkeleton(Element);
     Element->Base.bValueIsSet = 0;
 
+    if (Scope==SCOPE_SKELETON && ReadSkeleton(Element,Input,ParserContext,AllowDummyElt,DepthCheckCRC))
+        return ERR_NONE;
+
+    PrevArena = EBML_MasterEnterArena(Element);
+
 	// read blocks and discard the ones we don't care about
 	if (Element->Base.DataSize > 0 || !EBML_ElementIsFiniteSize((ebml_element*)Element)) {
         ebml_parser_context Context;
         filepos_t MaxSizeToRead;
 
         if (Stream_Seek(Input,EBML_ElementPositionData((ebml_element*)Element),SEEK_SET)==INVALID_FILEPOS_T)
+        {
+            EBML_LeaveArena(Element,PrevArena);
             return ERR_END_OF_FILE;
+        }
 
         MaxSizeToRead = Element->Base.DataSize;
         Context.UpContext = ParserContext;
@@ -342,42 +705,27 @@ static err_t ReadData(ebml_master *Element, stream *Input, const ebml_parser_con
                                 Node_GET(Input,MEMSTREAM_PTR,&CRCData);
                                 CRCData += (DataPos - OffSet);
                                 CRCDataSize = (size_t)(EBML_ElementDataSize((ebml_element*)Element,1) - EBML_ElementFullSize(SubElement,1));
-                                Stream_Read(Input, CRCData, CRCDataSize, NULL);
+                                // the data are checked in place, the memory may be read-only
                             }
                             else
                             {
-                                // read the rest of the element in memory to avoid reading it a second time later
-                                ArrayInit(&CrcBuffer);
-                                if (ArrayResize(&CrcBuffer, (size_t)(EBML_ElementPositionEnd((ebml_element*)Element) - EBML_ElementPositionEnd(SubElement)), 0))
-                                {
-                                    CRCData = ARRAYBEGIN(CrcBuffer,uint8_t);
-                                    CRCDataSize = ARRAYCOUNT(CrcBuffer,uint8_t);
-                                    ReadStream = (stream*)NodeCreate(Element, MEMSTREAM_CLASS);
-                                    if (ReadStream==NULL)
-                                    {
-                                        ReadStream=Input; // revert back to normal reading
-                                        ArrayClear(&CrcBuffer);
-                                    }
-                                    else
-                                    {
-                                        filepos_t Offset = EBML_ElementPositionEnd(SubElement);
-                                        Node_Set(ReadStream, MEMSTREAM_DATA, CRCData, CRCDataSize);
-                                        Node_SET(ReadStream, MEMSTREAM_OFFSET, &Offset);
-                                        Stream_Seek(Input,EBML_ElementPositionEnd(SubElement),SEEK_SET);
-                                        if (Stream_Read(Input, CRCData, CRCDataSize, NULL)!=ERR_NONE)
-                                        {
-                                            ReadStream=Input; // revert back to normal reading
-                                            ArrayClear(&CrcBuffer);
-                                        }
-                                    }
-                                }
+                                // check the data while they are read, without a copy of the element in memory
+                                Stream_Seek(Input,EBML_ElementPositionEnd(SubElement),SEEK_SET);
+                                ReadStream = EBML_CRCStreamCreate(Element, Input, EBML_ElementPositionEnd((ebml_element*)Element));
+                                if (ReadStream==NULL)
+                                    ReadStream=Input; // revert back to normal reading
                             }
                             CRCElement = (ebml_crc*)SubElement;
                         }
                         bFirst = 0;
                     }
                     if (CRCElement != (ebml_crc*)SubElement)
-                        EBML_MasterAppend(Element,SubElement);
+                    {
+                        if (Scope==SCOPE_PACKED_LEAVES && PackLeaf(Element,SubElement))
+                            bPacked = 1; // the element is deleted once it's not needed
+                        else
+                            EBML_MasterAppend(Element,SubElement);
+                    }
 			        // just in case
                     EBML_ElementSkipData(SubElement,ReadStream,&Context,NULL,AllowDummyElt);
                 }
@@ -389,6 +737,12 @@ static err_t ReadData(ebml_master *Element, stream *Input, const ebml_parser_con
 			}
             if (SubElement)
 			    MaxSizeToRead = EBML_ElementPositionEnd((ebml_element*)Element) - EBML_ElementPositionEnd(SubElement); // even if it's the default value
+            if (bPacked)
+            {
+                NodeDelete((node*)SubElement);
+                SubElement = NULL;
+                bPacked = 0;
+            }
 
 			if (UpperEltFound > 0) {
 				UpperEltFound--;
@@ -411,17 +765,19 @@ static err_t ReadData(ebml_master *Element, stream *Input, const ebml_parser_con
 		}
 	}
 processCrc:
+    EBML_LeaveArena(Element,PrevArena);
     if (CRCData!=NULL)
-    {
         Element->CheckSumStatus = EBML_CRCMatches(CRCElement, CRCData, CRCDataSize)?2:1;
-        if (CRCData == ARRAYBEGIN(CrcBuffer,uint8_t))
-        {
-            StreamClose(ReadStream);
-            ArrayClear(&CrcBuffer);
-        }
+    else if (ReadStream!=Input)
+    {
+        Element->CheckSumStatus = EBML_CRCStreamMatches(ReadStream, CRCElement)?2:1;
+        StreamClose(ReadStream);
     }
+    if (CRCElement)
+        NodeDelete((node*)CRCElement); // not kept as a child, a new one is created when rendering
 
     Element->Base.bValueIsSet = 1;
+    Element->Base.bSkeleton = !ARRAYEMPTY(Element->Packed); // set once all the children are read
     if (UpperEltFound>0) // move back to the upper element beginning so that the next loop can find it
     {
         assert(SubElement!=NULL);
@@ -434,13 +790,13 @@ bool_t EBML_MasterUseChecksum(ebml_master *Element, bool_t Use)
 {
     if (Use && Element->CheckSumStatus==0)
     {
-        Element->Base.bNeedDataSizeUpdate = 1;
+        EBML_ElementDataSizeChanged((ebml_element*)Element);
         Element->CheckSumStatus = 1;
         return 1;
     }
     if (!Use && Element->CheckSumStatus)
     {
-        Element->Base.bNeedDataSizeUpdate = 1;
+        EBML_ElementDataSizeChanged((ebml_element*)Element);
         Element->CheckSumStatus = 0;
         return 1;
     }
@@ -571,6 +927,7 @@ static ebml_element *Copy(const ebml_master *Element, const void *Cookie)
         Result->Base.SizePosition = Element->Base.SizePosition;
         Result->Base.EndPosition = Element->Base.EndPosition;
         Result->Base.bNeedDataSizeUpdate = Element->Base.bNeedDataSizeUpdate;
+        Result->bSizeWithDefault = Element->bSizeWithDefault;
         Result->CheckSumStatus = Element->CheckSumStatus;
         for (i=EBML_MasterChildren(Element);i;i=EBML_MasterNext(i))
         {
@@ -588,14 +945,88 @@ static ebml_element *Copy(const ebml_master *Element, const void *Cookie)
 
 static void RemoveChild(ebml_master* p,ebml_element* Child)
 {
-    p->Base.bNeedDataSizeUpdate = 1;
-    INHERITED(p,nodetree_vmt,EBML_MASTER_CLASS)->RemoveChild(p,Child);
+    ebml_element *i,*Prev = NULL,*PrevSame = NULL;
+    ebml_childindex *Index = NULL;
+
+    EBML_ElementDataSizeChanged((ebml_element*)p);
+    if (!ARRAYEMPTY(p->ChildIndex))
+        Index = FindChildIndex(p,Child->Context->Id);
+
+	LockEnter(Node_Context(p)->NodeLock);
+    for (i=(ebml_element*)NodeTree_Children(p);i && i!=Child;i=(ebml_element*)NodeTree_Next(i))
+    {
+        if (Index && i->Context->Id == Index->Id)
+            PrevSame = i;
+        Prev = i;
+    }
+    if (i)
+    {
+        if (Prev)
+            Prev->Base.Next = Child->Base.Next;
+        else
+            p->Base.Base.Children = Child->Base.Next;
+        if (p->LastChild == Child)
+            p->LastChild = Prev;
+        --p->ChildCount;
+
+        if (Index)
+        {
+            if (Index->Last == Child)
+            {
+                if (Index->First == Child)
+                    ArrayDelete(&p->ChildIndex,(uint8_t*)Index - ARRAYBEGIN(p->ChildIndex,uint8_t),sizeof(ebml_childindex));
+                else
+                    Index->Last = PrevSame;
+            }
+            else if (Index->First == Child)
+            {
+                // there is another one before the Last
+                for (i=(ebml_element*)NodeTree_Next(Child);i->Context->Id != Index->Id;i=(ebml_element*)NodeTree_Next(i)) {}
+                Index->First = i;
+            }
+        }
+    }
+	Child->Base.Next = NULL;
+    Child->Base.Parent = NULL;
+    LockLeave(Node_Context(p)->NodeLock);
 }
 
-static void AddChild(ebml_master* p,ebml_element* Child,ebml_element* Before)
+static err_t AddChild(ebml_master* p,ebml_element* Child,ebml_element* Before)
 {
-    p->Base.bNeedDataSizeUpdate = 1;
-    INHERITED(p,nodetree_vmt,EBML_MASTER_CLASS)->AddChild(p,Child,Before);
+    err_t Result = ERR_NONE;
+    if (p->Base.bSkeleton)
+    {
+        // the new child goes after the ones not created yet
+        if (!ARRAYEMPTY(p->Packed))
+            UnpackLeaves(p);
+        if (p->Skeleton)
+            Materialize(p,(size_t)-1);
+    }
+    EBML_ElementDataSizeChanged((ebml_element*)p);
+    if (!Before && p->LastChild)
+    {
+        // append without going through all the children
+	    LockEnter(Node_Context(p)->NodeLock);
+        Child->Base.Parent = (nodetree*)p;
+        Child->Base.Next = NULL;
+        p->LastChild->Base.Next = (nodetree*)Child;
+        LockLeave(Node_Context(p)->NodeLock);
+    }
+    else
+        Result = INHERITED(p,nodetree_vmt,EBML_MASTER_CLASS)->AddChild(p,Child,Before);
+    if (Result!=ERR_NONE)
+        return Result;
+
+    ++p->ChildCount;
+    if (!Before)
+    {
+        p->LastChild = Child;
+        if (!ARRAYEMPTY(p->ChildIndex))
+            AddChildIndex(p,Child);
+    }
+    else
+        ArrayClear(&p->ChildIndex); // rebuilt on the next search
+    return ERR_NONE;
 }
 
 static bool_t ValidateSize(const ebml_element *p)
@@ -603,8 +1034,17 @@ static bool_t ValidateSize(const ebml_element *p)
     return 1;
 }
 
+static void Delete(ebml_master *p)
+{
+    ArrayClear(&p->Packed);
+    ClearSkeleton(p);
+    ArrayClear(&p->ChildIndex);
+    EBML_MasterUseArena(p,0);
+}
+
 META_START(EBMLMaster_Class,EBML_MASTER_CLASS)
 META_CLASS(SIZE,sizeof(ebml_master))
+META_CLASS(DELETE,Delete)
 META_VMT(TYPE_FUNC,nodetree_vmt,AddChild,AddChild)
 META_VMT(TYPE_FUNC,nodetree_vmt,RemoveChild,RemoveChild)
 META_VMT(TYPE_FUNC,ebml_element_vmt,PostCreate,PostCreate)
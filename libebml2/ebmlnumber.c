@@ -419,9 +419,11 @@ META_END(EBML_ELEMENT_CLASS)
 
 void EBML_IntegerSetValue(ebml_integer *Element, int64_t Value)
 {
+    if (Element->Base.bValueIsSet && Element->Value == Value && !Element->Base.bNeedDataSizeUpdate)
+        return; // the size computed for this value is still valid
     Element->Value = Value;
     Element->Base.bValueIsSet = 1;
-    Element->Base.bNeedDataSizeUpdate = 1;
+    EBML_ElementDataSizeChanged((ebml_element*)Element);
 }
 
 int64_t EBML_IntegerValue(const ebml_integer *Element)
@@ -443,7 +445,9 @@ double EBML_FloatValue(const ebml_float *Element)
 
 void EBML_FloatSetValue(ebml_float *Element, double Value)
 {
+    if (Element->Base.bValueIsSet && Element->Value == Value && !Element->Base.bNeedDataSizeUpdate)
+        return; // the size computed for this value is still valid
     Element->Value = Value;
     Element->Base.bValueIsSet = 1;
-    Element->Base.bNeedDataSizeUpdate = 1;
+    EBML_ElementDataSizeChanged((ebml_element*)Element);
 }
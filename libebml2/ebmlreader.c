@@ -0,0 +1,323 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska (non-profit organisation)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "ebml/ebml.h"
+#include "ebml/ebml_internal.h"
+
+#define READER_MAX_DEPTH   64
+#define READER_TYPE_CACHE  64
+
+typedef struct readerlevel
+{
+    ebml_reader_element Element;
+    bool_t Quiet; // the master or one of its parents was skipped
+
+} readerlevel;
+
+typedef struct readerstate
+{
+    const ebml_reader *Reader;
+    stream *Input;
+    array Buffer; // data read for the leaf values when the stream is not in memory
+    // element type of the recently used contexts, to avoid a class lookup for each element
+    const ebml_context *CacheContext[READER_TYPE_CACHE];
+    uint8_t CacheType[READER_TYPE_CACHE];
+
+} readerstate;
+
+static int ElementType(readerstate *p, const ebml_context *Context)
+{
+    size_t Slot = ((uintptr_t)Context / sizeof(void*)) % READER_TYPE_CACHE;
+    int Type;
+
+    if (!Context)
+        return EBML_READER_BINARY;
+    if (p->CacheContext[Slot] == Context)
+        return p->CacheType[Slot];
+
+    if (NodeIsClass(p->Input,Context->Class,EBML_MASTER_CLASS))
+        Type = EBML_READER_MASTER;
+    else if (NodeIsClass(p->Input,Context->Class,EBML_DATE_CLASS))
+        Type = EBML_READER_DATE;
+    else if (NodeIsClass(p->Input,Context->Class,EBML_SINTEGER_CLASS))
+        Type = EBML_READER_SINTEGER;
+    else if (NodeIsClass(p->Input,Context->Class,EBML_INTEGER_CLASS))
+        Type = EBML_READER_INTEGER;
+    else if (NodeIsClass(p->Input,Context->Class,EBML_FLOAT_CLASS))
+        Type = EBML_READER_FLOAT;
+    else if (NodeIsClass(p->Input,Context->Class,EBML_STRING_CLASS) || NodeIsClass(p->Input,Context->Class,EBML_UNISTRING_CLASS))
+        Type = EBML_READER_STRING;
+    else
+        Type = EBML_READER_BINARY;
+
+    p->CacheContext[Slot] = Context;
+    p->CacheType[Slot] = (uint8_t)Type;
+    return Type;
+}
+
+// find the context of Id and how many levels up it belongs, the same way EBML_FindNextElement() does
+static const ebml_context *FindContext(const ebml_parser_context *Top, const readerlevel *Levels, size_t Depth, fourcc_t Id, size_t *UpperLevels)
+{
+    const ebml_context *Context;
+    const ebml_semantic *Global;
+    size_t Level = Depth;
+
+    for (;;)
+    {
+        Context = Level ? Levels[Level-1].Element.Context : Top->Context;
+        if ((Context = EBML_FindSemanticContext(Context,Id))!=NULL)
+            break;
+        if (Level == Depth)
+        {
+            // global elements are only looked for in the current level
+            Context = Level ? Levels[Level-1].Element.Context : Top->Context;
+            for (Global=Context->GlobalContext;Global && Global->eClass;++Global)
+                if (Global->eClass->Id == Id)
+                    break;
+            if (Global && Global->eClass)
+            {
+                Context = Global->eClass;
+                break;
+            }
+        }
+        if (!Level)
+        {
+            // unknown element in the current level
+            Level = Depth;
+            Context = NULL;
+            break;
+        }
+        --Level;
+    }
+    *UpperLevels = Depth - Level;
+    return Context;
+}
+
+static void ReadValue(readerstate *p, ebml_reader_element *Element)
+{
+    const uint8_t *Data = NULL;
+    size_t Size = (size_t)Element->DataSize, Avail, i;
+
+    Element->ValueResult = ERR_NONE;
+    Element->Integer = 0;
+    Element->Float = 0;
+    Element->Data = NULL;
+
+    if (Element->Type==EBML_READER_BINARY)
+    {
+        if (Element->DataSize > (filepos_t)p->Reader->MaxDataSize)
+            return;
+    }
+    else if (Element->Type==EBML_READER_STRING)
+    {
+        if ((uint64_t)Element->DataSize > (uint64_t)(size_t)-1)
+        {
+            Element->ValueResult = ERR_OUT_OF_MEMORY;
+            return;
+        }
+    }
+    else if (Element->DataSize > 8)
+    {
+        Element->ValueResult = ERR_INVALID_DATA;
+        return;
+    }
+    if (!Size)
+        return;
+
+    Data = MemStreamData(p->Input,Element->DataPosition,&Avail);
+    if (!Data || Avail < Size)
+    {
+        if (!ArrayResize(&p->Buffer,Size,0))
+        {
+            Element->ValueResult = ERR_OUT_OF_MEMORY;
+            return;
+        }
+        Data = ARRAYBEGIN(p->Buffer,uint8_t);
+        if (Stream_Seek(p->Input,Element->DataPosition,SEEK_SET)!=Element->DataPosition)
+            Element->ValueResult = ERR_READ;
+        else
+            Element->ValueResult = Stream_Read(p->Input,ARRAYBEGIN(p->Buffer,uint8_t),Size,NULL);
+        if (Element->ValueResult != ERR_NONE)
+            return;
+    }
+
+    if (Element->Type==EBML_READER_STRING || Element->Type==EBML_READER_BINARY)
+    {
+        Element->Data = Data;
+        return;
+    }
+
+    for (i=0;i<Size;++i)
+        Element->Integer = (Element->Integer << 8) | Data[i];
+    if (Element->Type==EBML_READER_FLOAT)
+    {
+        if (Size==4)
+        {
+            union { uint32_t i; float f; } Value;
+            Value.i = (uint32_t)Element->Integer;
+            Element->Float = Value.f;
+        }
+        else if (Size==8)
+        {
+            union { int64_t i; double f; } Value;
+            Value.i = Element->Integer;
+            Element->Float = Value.f;
+        }
+        else
+            Element->ValueResult = ERR_INVALID_DATA;
+        Element->Integer = 0;
+    }
+    else if (Element->Type!=EBML_READER_INTEGER && Size<8 && (Data[0] & 0x80))
+        Element->Integer -= (int64_t)1 << (8*Size); // sign extension
+}
+
+err_t EBML_ReaderParse(const ebml_reader *Reader, stream *Input, const ebml_parser_context *Context)
+{
+    readerstate p;
+    readerlevel Levels[READER_MAX_DEPTH];
+    readerlevel *Parent;
+    ebml_reader_element Element;
+    size_t Depth = 0, HeadSize, Up;
+    filepos_t Pos, End;
+    int Action = EBML_READER_CONTINUE;
+
+    memset(&p,0,sizeof(p));
+    p.Reader = Reader;
+    p.Input = Input;
+    ArrayInit(&p.Buffer);
+
+    Pos = Stream_Seek(Input,0,SEEK_CUR);
+    if (Pos == INVALID_FILEPOS_T)
+        return ERR_READ;
+
+    while (Action != EBML_READER_STOP)
+    {
+        Parent = Depth ? &Levels[Depth-1] : NULL;
+        End = Parent ? Parent->Element.EndPosition : Context->EndPosition;
+        if (End != INVALID_FILEPOS_T && Pos >= End)
+        {
+            if (!Parent)
+                break;
+            goto endmaster;
+        }
+
+        memset(&Element,0,sizeof(Element));
+        if (EBML_ReadElementHead(Input,Pos,&Element.Id,&Element.DataSize,&HeadSize)!=ERR_NONE)
+        {
+            // damaged or missing data, a master with an unknown size ends here, the others resume after their end
+            if (!Parent)
+                break;
+            if (End == INVALID_FILEPOS_T)
+                goto endmaster;
+            Pos = End;
+            continue;
+        }
+
+        Element.Context = FindContext(Context,Levels,Depth,Element.Id,&Up);
+        if (Up)
+            goto endmaster; // this element belongs to a parent
+
+        Element.Name = Element.Context ? Element.Context->ElementName : EBML_ContextDummy.ElementName;
+        Element.Type = ElementType(&p,Element.Context);
+        Element.Level = (int)Depth;
+        Element.ElementPosition = Pos;
+        Element.DataPosition = Pos + HeadSize;
+        if (Element.DataSize == INVALID_FILEPOS_T)
+        {
+            if (Element.Type != EBML_READER_MASTER)
+                break; // only masters can have an unknown size
+            Element.EndPosition = INVALID_FILEPOS_T;
+        }
+        else
+        {
+            Element.EndPosition = Element.DataPosition + Element.DataSize;
+            if (End != INVALID_FILEPOS_T && Element.EndPosition > End)
+            {
+                Pos = End; // the element overflows its parent
+                continue;
+            }
+        }
+
+        if (Element.Type == EBML_READER_MASTER)
+        {
+            bool_t Quiet = Parent && Parent->Quiet;
+            if (Depth == READER_MAX_DEPTH)
+            {
+                if (Element.EndPosition == INVALID_FILEPOS_T)
+                    break;
+                Pos = Element.EndPosition;
+                continue;
+            }
+            Action = EBML_READER_CONTINUE; // EBML_READER_SKIP only applies to the Start callback
+            if (!Quiet && Reader->Start)
+                Action = Reader->Start(Reader->Cookie,&Element);
+            Pos = Element.DataPosition;
+            if (Action == EBML_READER_SKIP)
+            {
+                Action = EBML_READER_CONTINUE;
+                if (Element.EndPosition != INVALID_FILEPOS_T)
+                    Pos = Element.EndPosition; // ends right away
+                else
+                    Quiet = 1; // the children have to be read to find the end
+            }
+            Levels[Depth].Element = Element;
+            Levels[Depth].Quiet = Quiet;
+            ++Depth;
+        }
+        else
+        {
+            if (!(Parent && Parent->Quiet) && Reader->Value)
+            {
+                ReadValue(&p,&Element);
+                Action = Reader->Value(Reader->Cookie,&Element);
+            }
+            Pos = Element.EndPosition;
+        }
+        continue;
+
+endmaster:
+        --Depth;
+        if (Levels[Depth].Element.EndPosition == INVALID_FILEPOS_T)
+            Levels[Depth].Element.EndPosition = Pos;
+        if (!(Depth && Levels[Depth-1].Quiet) && Reader->End)
+            Action = Reader->End(Reader->Cookie,&Levels[Depth].Element);
+    }
+
+    // the masters still open end with the stream
+    while (Depth && Action != EBML_READER_STOP)
+    {
+        --Depth;
+        if (Levels[Depth].Element.EndPosition == INVALID_FILEPOS_T)
+            Levels[Depth].Element.EndPosition = Pos;
+        if (!(Depth && Levels[Depth-1].Quiet) && Reader->End)
+            Action = Reader->End(Reader->Cookie,&Levels[Depth].Element);
+    }
+
+    ArrayClear(&p.Buffer);
+    Stream_Seek(Input,Pos,SEEK_SET);
+    return ERR_NONE;
+}
@@ -46,6 +46,7 @@ err_t EBML_StringSetValue(ebml_string *Element,const char *Value)
         free((char*)Element->Buffer);
     Element->Buffer = strdup(Value);
     Element->Base.bValueIsSet = 1;
+    EBML_ElementDataSizeChanged((ebml_element*)Element);
     Element->Base.DataSize = strlen(Element->Buffer);
     Element->Base.bNeedDataSizeUpdate = 0;
     return ERR_NONE;
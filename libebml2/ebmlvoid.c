@@ -42,18 +42,10 @@ static err_t ReadData(ebml_element *Element, stream *Input, const ebml_parser_co
 #if defined(CONFIG_EBML_WRITING)
 static err_t RenderData(ebml_element *Element, stream *Output, bool_t bForceWithoutMandatory, bool_t bWithDefault, filepos_t *Rendered)
 {
-    size_t Written, Left = (size_t)Element->DataSize;
-    err_t Err = ERR_NONE;
-    uint8_t Buf[2*1024]; // write 2 KB chunks at a time
-    memset(Buf,0,sizeof(Buf));
-    while (Err==ERR_NONE && Left)
-    {
-        Err = Stream_Write(Output,Buf,min(Left,sizeof(Buf)),&Written);
-        if (Err == ERR_NONE)
-            Left -= min(Left,sizeof(Buf));
-    }
+    filepos_t Written = 0;
+    err_t Err = Stream_WriteZeros(Output,Element->DataSize,&Written);
     if (Rendered)
-        *Rendered = Element->DataSize - Left;
+        *Rendered = Written;
     return Err;
 }
 #endif
@@ -0,0 +1,153 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+
+#include "ebml/ebml.h"
+#include "ebmlcrc.h"
+#include "crcbench_stdafx.h"
+
+// checks the CRC-32 code against the original byte table and measures their speed
+
+static uint32_t Ref_Table[256];
+
+static void Ref_Init(void)
+{
+    uint32_t i, j, c;
+    for (i=0;i<256;++i)
+    {
+        for (c=i,j=0;j<8;++j)
+            c = (c >> 1) ^ ((c & 1) ? 0xEDB88320 : 0);
+        Ref_Table[i] = c;
+    }
+}
+
+// the loop used before the slicing tables
+static uint32_t Ref_CRCUpdate(uint32_t CRC, const uint8_t *Buf, size_t Size)
+{
+	while (Size >= 4)
+	{
+		CRC ^= LOAD32LE(Buf);
+		CRC = Ref_Table[CRC & 0xff] ^ (CRC >> 8);
+		CRC = Ref_Table[CRC & 0xff] ^ (CRC >> 8);
+		CRC = Ref_Table[CRC & 0xff] ^ (CRC >> 8);
+		CRC = Ref_Table[CRC & 0xff] ^ (CRC >> 8);
+		Size -= 4;
+		Buf += 4;
+	}
+	while (Size--)
+		CRC = Ref_Table[(CRC ^ *Buf++) & 0xff] ^ (CRC >> 8);
+	return CRC;
+}
+
+static uint32_t Random = 0x12345678;
+
+static uint32_t NextRandom(void)
+{
+    Random = Random * 1664525 + 1013904223;
+    return Random;
+}
+
+#define BENCH_SIZE   (16*1024*1024)
+#define BENCH_LOOPS  16
+
+static void Bench(const tchar_t *Name, uint32_t (*Update)(uint32_t, const uint8_t*, size_t), const uint8_t *Buffer)
+{
+    systick_t Start, Duration;
+    uint32_t CRC = 0xFFFFFFFF;
+    int Loop;
+
+    Start = GetTimeTick();
+    for (Loop=0;Loop<BENCH_LOOPS;++Loop)
+        CRC = Update(CRC, Buffer, BENCH_SIZE);
+    Duration = GetTimeTick() - Start;
+    if (Duration <= 0)
+        Duration = 1;
+    fprintf(stdout,"%-14s %d MB in %d ms, %.2f GB/s (CRC %08X)\r\n",Name,BENCH_LOOPS*BENCH_SIZE/(1024*1024),(int)Duration,
+        (double)BENCH_LOOPS * BENCH_SIZE * GetTimeFreq() / Duration / (1024*1024*1024),CRC ^ 0xFFFFFFFF);
+}
+
+int main(void)
+{
+    static const uint8_t Check[] = "123456789";
+    uint8_t *Buffer;
+    size_t i, Size, Offset;
+    int Errors = 0;
+
+    Ref_Init();
+    EBML_CRCSelect(); // done by EBML_Init() in a normal program
+    Buffer = malloc(BENCH_SIZE);
+    if (!Buffer)
+        return 1;
+    for (i=0;i<BENCH_SIZE;++i)
+        Buffer[i] = (uint8_t)(NextRandom() >> 24);
+
+    if ((EBML_CRCUpdate(0xFFFFFFFF, Check, 9) ^ 0xFFFFFFFF) != 0xCBF43926 || (EBML_CRCUpdateTable(0xFFFFFFFF, Check, 9) ^ 0xFFFFFFFF) != 0xCBF43926)
+    {
+        fprintf(stderr,"wrong CRC of the check string\r\n");
+        ++Errors;
+    }
+
+    // every small size on every alignment, then random chunks with a running CRC
+    for (Size=0;Size<300;++Size)
+        for (Offset=0;Offset<16;++Offset)
+        {
+            uint32_t Ref = Ref_CRCUpdate(0xFFFFFFFF, Buffer+Offset, Size);
+            if (EBML_CRCUpdate(0xFFFFFFFF, Buffer+Offset, Size) != Ref || EBML_CRCUpdateTable(0xFFFFFFFF, Buffer+Offset, Size) != Ref)
+            {
+                if (++Errors < 10)
+                    fprintf(stderr,"CRC mismatch on %d bytes at offset %d\r\n",(int)Size,(int)Offset);
+            }
+        }
+    for (i=0;i<1000;++i)
+    {
+        uint32_t Ref = 0xFFFFFFFF, CRC = 0xFFFFFFFF, CRCTable = 0xFFFFFFFF;
+        Offset = NextRandom() % 1024;
+        while (Offset < BENCH_SIZE/16)
+        {
+            Size = min(NextRandom() % 5000, BENCH_SIZE/16 - Offset);
+            Ref = Ref_CRCUpdate(Ref, Buffer+Offset, Size);
+            CRC = EBML_CRCUpdate(CRC, Buffer+Offset, Size);
+            CRCTable = EBML_CRCUpdateTable(CRCTable, Buffer+Offset, Size);
+            Offset += Size + 1;
+        }
+        if (CRC != Ref || CRCTable != Ref)
+        {
+            if (++Errors < 10)
+                fprintf(stderr,"running CRC mismatch in pass %d\r\n",(int)i);
+        }
+    }
+    fprintf(stdout,"%d error(s)\r\n",Errors);
+
+    Bench(T("original"),Ref_CRCUpdate,Buffer);
+    Bench(T("slicing-by-8"),EBML_CRCUpdateTable,Buffer);
+    Bench(EBML_CRCUpdateName(),EBML_CRCUpdate,Buffer);
+    free(Buffer);
+
+    return Errors!=0;
+}
@@ -0,0 +1,676 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+
+#include "ebml/ebml.h"
+#include "ebml/ebml_internal.h"
+#include "ebmlcrc.h"
+#include "mastertest_stdafx.h"
+
+// checks the child lookups of a master with many children against a walk of the list and measures them
+// checks the children read with SCOPE_SKELETON and SCOPE_PACKED_LEAVES against a regular read
+// checks the writes gathered by a GATHERSTREAM_CLASS stream
+// checks the sizes of the masters are computed again only when a child changes
+// checks the CRC of the data read and skipped through an EBML_CRCSTREAM_CLASS stream
+// checks the skeleton children of a master with a CRC-32 are read after the CRC is checked
+// checks a Void bigger than the chunks of zeros written at once
+
+#define CHILD_CONTEXTS  4
+
+static const ebml_context *Contexts[CHILD_CONTEXTS] = {
+    &EBML_ContextVersion,
+    &EBML_ContextReadVersion,
+    &EBML_ContextDocType,
+    &EBML_ContextEbmlVoid,
+};
+
+static uint32_t Random = 0x12345678;
+
+static uint32_t NextRandom(void)
+{
+    Random = Random * 1664525 + 1013904223;
+    return Random >> 8;
+}
+
+static int Errors = 0;
+
+static void Check(ebml_master *Master, const char *Step)
+{
+    size_t Count = 0, c;
+    ebml_element *i, *Found, *Ref;
+
+    for (i=EBML_MasterChildren(Master);i;i=EBML_MasterNext(i))
+        ++Count;
+    if (Count != EBML_MasterCount(Master))
+    {
+        if (++Errors < 10)
+            fprintf(stderr,"%s: %d children counted instead of %d\r\n",Step,(int)EBML_MasterCount(Master),(int)Count);
+    }
+
+    for (c=0;c<CHILD_CONTEXTS;++c)
+    {
+        for (Ref=EBML_MasterChildren(Master);Ref && !EBML_ElementIsType(Ref,Contexts[c]);Ref=EBML_MasterNext(Ref)) {}
+        Found = EBML_MasterFindChild(Master,Contexts[c]);
+        while (Found || Ref)
+        {
+            if (Found != Ref)
+            {
+                if (++Errors < 10)
+                    fprintf(stderr,"%s: wrong child #%d found\r\n",Step,(int)c);
+                break;
+            }
+            for (Ref=EBML_MasterNext(Ref);Ref && !EBML_ElementIsType(Ref,Contexts[c]);Ref=EBML_MasterNext(Ref)) {}
+            Found = EBML_MasterNextChild(Master,Found);
+        }
+    }
+}
+
+static ebml_element *NthChild(ebml_master *Master, size_t n)
+{
+    ebml_element *i;
+    for (i=EBML_MasterChildren(Master);i && n;i=EBML_MasterNext(i))
+        --n;
+    return i;
+}
+
+static int CmpReverse(const void *Param, const ebml_element **a, const ebml_element **b)
+{
+    if (*a == *b)
+        return 0;
+    return (*a < *b) ? 1 : -1;
+}
+
+static void Stress(parsercontext *p)
+{
+    ebml_master *Master = (ebml_master*)EBML_ElementCreate(p,&EBML_ContextHead,0,NULL);
+    ebml_element *Child;
+    size_t Loop;
+
+    for (Loop=0;Loop<4000;++Loop)
+    {
+        size_t Count = EBML_MasterCount(Master);
+        switch (NextRandom() % 8)
+        {
+        case 0: // insert in the middle
+            Child = EBML_ElementCreate(p,Contexts[NextRandom() % CHILD_CONTEXTS],0,NULL);
+            NodeTree_SetParent(Child,Master,Count ? NthChild(Master,NextRandom() % Count) : NULL);
+            break;
+        case 1: // delete one
+        case 2:
+            if (Count)
+                NodeDelete((node*)NthChild(Master,NextRandom() % Count));
+            break;
+        case 3: // delete the last one
+            if (Count)
+                NodeDelete((node*)NthChild(Master,Count-1));
+            break;
+        case 4:
+            if (NextRandom() % 16 == 0)
+                EBML_MasterSort(Master,(arraycmp)CmpReverse,NULL);
+            break;
+        default:
+            EBML_MasterAppend(Master,EBML_ElementCreate(p,Contexts[NextRandom() % (CHILD_CONTEXTS-1)],0,NULL));
+            break;
+        }
+        Check(Master,"stress");
+    }
+    NodeDelete((node*)Master);
+}
+
+#define BENCH_CHILDREN  100000
+
+static void Bench(parsercontext *p)
+{
+    ebml_master *Master = (ebml_master*)EBML_ElementCreate(p,&EBML_ContextHead,0,NULL);
+    ebml_element *Found = NULL;
+    systick_t Start, Duration;
+    size_t i, Lookups = 0;
+
+    Start = GetTimeTick();
+    for (i=0;i<BENCH_CHILDREN;++i)
+        EBML_MasterAppend(Master,EBML_ElementCreate(p,&EBML_ContextVersion,0,NULL));
+    EBML_MasterAppend(Master,EBML_ElementCreate(p,&EBML_ContextDocType,0,NULL));
+    Duration = GetTimeTick() - Start;
+    fprintf(stdout,"%d appends in %d ms\r\n",BENCH_CHILDREN,(int)Duration);
+
+    Start = GetTimeTick();
+    do
+    {
+        for (i=0;i<1000;++i)
+        {
+            Found = EBML_MasterFindChild(Master,&EBML_ContextDocType);
+            Lookups += EBML_MasterCount(Master) ? 1 : 0;
+        }
+        Duration = GetTimeTick() - Start;
+    } while (Duration < 200);
+    fprintf(stdout,"%.0f lookups/s of the last child among %d\r\n",(double)Lookups * GetTimeFreq() / (Duration ? Duration : 1),BENCH_CHILDREN);
+    if (!Found)
+        ++Errors;
+
+    NodeDelete((node*)Master);
+}
+
+#define SKELETON_CHILDREN  1000
+
+static const uint8_t SkeletonChildren[CHILD_CONTEXTS][7] = {
+    {0x42,0x86,0x81,0x01}, // EBMLVersion, the value is changed for each child
+    {0x42,0xF7,0x81,0x01}, // EBMLReadVersion
+    {0x42,0x82,0x84,'w','e','b','m'}, // DocType
+    {0xEC,0x82,0x00,0x00}, // Void
+};
+static const size_t SkeletonChildSize[CHILD_CONTEXTS] = { 4, 4, 7, 4 };
+
+static ebml_master *ReadHead(stream *Input, int Scope)
+{
+    ebml_parser_context Context;
+    ebml_master *Head;
+
+    Context.Context = &EBML_ContextHead;
+    Context.UpContext = NULL;
+    Context.EndPosition = INVALID_FILEPOS_T;
+    Context.Profile = 0;
+    Stream_Seek(Input,0,SEEK_SET);
+    Head = (ebml_master*)EBML_FindNextId(Input,&EBML_ContextHead,(size_t)-1);
+    if (Head && EBML_ElementReadData(Head,Input,&Context,0,Scope,0)!=ERR_NONE)
+    {
+        NodeDelete((node*)Head);
+        Head = NULL;
+    }
+    if (!Head)
+        ++Errors;
+    return Head;
+}
+
+static void CheckSame(const ebml_master *Ref, ebml_master *Master, const char *Step)
+{
+    ebml_element *i, *j;
+    for (i=EBML_MasterChildren(Ref),j=EBML_MasterChildren(Master);i && j;i=EBML_MasterNext(i),j=EBML_MasterNext(j))
+    {
+        if (EBML_ElementPosition(i)!=EBML_ElementPosition(j) || !EBML_ElementIsType(j,EBML_ElementContext(i)) ||
+            (EBML_ElementIsType(i,&EBML_ContextVersion) && EBML_IntegerValue((ebml_integer*)i)!=EBML_IntegerValue((ebml_integer*)j)))
+            break;
+    }
+    if (i || j || EBML_MasterCount(Ref)!=EBML_MasterCount(Master))
+    {
+        if (++Errors < 10)
+            fprintf(stderr,"%s: the skeleton children differ from the regular ones\r\n",Step);
+    }
+}
+
+static void Skeleton(parsercontext *p)
+{
+    static uint8_t Buffer[12 + SKELETON_CHILDREN*7];
+    size_t Size = 12, i;
+    stream *Input, *Input2;
+    ebml_master *Ref, *Master;
+    filepos_t Pos;
+    uint8_t *Copy;
+
+    for (i=0;i<SKELETON_CHILDREN;++i)
+    {
+        memcpy(Buffer+Size,SkeletonChildren[i % CHILD_CONTEXTS],SkeletonChildSize[i % CHILD_CONTEXTS]);
+        if (i % CHILD_CONTEXTS == 0)
+            Buffer[Size+3] = (uint8_t)(i & 0x7F);
+        Size += SkeletonChildSize[i % CHILD_CONTEXTS];
+    }
+    // EBML head with a size coded on 8 octets
+    Buffer[0] = 0x1A; Buffer[1] = 0x45; Buffer[2] = 0xDF; Buffer[3] = 0xA3;
+    Buffer[4] = 0x01;
+    for (i=0;i<7;++i)
+        Buffer[5+i] = (uint8_t)((Size-12) >> (8*(6-i)));
+
+    Input = (stream*)NodeCreate(p,MEMSTREAM_CLASS);
+    if (!Input)
+    {
+        ++Errors;
+        return;
+    }
+    Node_Set(Input,MEMSTREAM_DATA,Buffer,Size);
+
+    Ref = ReadHead(Input,SCOPE_ALL_DATA);
+    if (Ref)
+    {
+        if (EBML_MasterCount(Ref)!=SKELETON_CHILDREN)
+            ++Errors;
+
+        // a missing child is found without reading the children
+        Master = ReadHead(Input,SCOPE_SKELETON);
+        if (Master)
+        {
+            Pos = Stream_Seek(Input,0,SEEK_CUR);
+            if (Pos!=(filepos_t)Size || EBML_MasterFindChild(Master,&EBML_ContextDocTypeVersion)!=NULL)
+                ++Errors;
+            if (!EBML_MasterFindChild(Master,&EBML_ContextDocType) || Stream_Seek(Input,0,SEEK_CUR)!=Pos)
+                ++Errors;
+            CheckSame(Ref,Master,"skeleton lookup");
+            NodeDelete((node*)Master);
+        }
+
+        Master = ReadHead(Input,SCOPE_SKELETON);
+        if (Master)
+        {
+            EBML_MasterAppend(Master,EBML_ElementCreate(p,&EBML_ContextDocTypeVersion,0,NULL));
+            if (EBML_MasterCount(Master)!=SKELETON_CHILDREN+1 || !EBML_ElementIsType((ebml_element*)NodeTree_Children(Master),&EBML_ContextVersion))
+                ++Errors;
+            NodeDelete((node*)Master);
+        }
+
+        Master = ReadHead(Input,SCOPE_SKELETON);
+        if (Master)
+        {
+            ebml_element *Found = EBML_MasterFindChild(Master,&EBML_ContextVersion);
+            ebml_element *RefFound = EBML_MasterFindChild(Ref,&EBML_ContextVersion);
+            while (Found && RefFound && EBML_ElementPosition(Found)==EBML_ElementPosition(RefFound))
+            {
+                Found = EBML_MasterNextChild(Master,Found);
+                RefFound = EBML_MasterNextChild(Ref,RefFound);
+            }
+            if (Found || RefFound)
+            {
+                if (++Errors < 10)
+                    fprintf(stderr,"skeleton next: the skeleton children differ from the regular ones\r\n");
+            }
+            CheckSame(Ref,Master,"skeleton next");
+            NodeDelete((node*)Master);
+        }
+
+        Master = ReadHead(Input,SCOPE_SKELETON);
+        if (Master)
+        {
+            CheckSame(Ref,Master,"skeleton walk");
+            NodeDelete((node*)Master);
+        }
+
+        // all the children are created up front, the accessors don't change the masters anymore
+        for (i=SCOPE_SKELETON;i<=SCOPE_PACKED_LEAVES;++i)
+        {
+            Master = ReadHead(Input,(int)i);
+            if (Master)
+            {
+                EBML_MasterMaterialize(Master,1);
+                if (Master->Base.bSkeleton || Master->Skeleton || !ARRAYEMPTY(Master->Packed) || EBML_MasterCount(Master)!=SKELETON_CHILDREN)
+                    ++Errors;
+                CheckSame(Ref,Master,"materialize");
+                Check(Master,"materialize");
+                NodeDelete((node*)Master);
+            }
+        }
+
+        // deleted before being read
+        Master = ReadHead(Input,SCOPE_SKELETON);
+        if (Master)
+            NodeDelete((node*)Master);
+
+        // cleared with only its first child read, the others are dropped without reading them
+        Master = NULL;
+        Input2 = (stream*)NodeCreate(p,MEMSTREAM_CLASS);
+        Copy = malloc(Size);
+        if (Input2 && Copy)
+        {
+            memcpy(Copy,Buffer,Size);
+            Node_Set(Input2,MEMSTREAM_DATA,Copy,Size);
+            Master = ReadHead(Input2,SCOPE_SKELETON);
+        }
+        if (Master)
+        {
+            ebml_element *First = EBML_MasterChildren(Master);
+            free(Copy); // reading another child would use freed memory
+            Copy = NULL;
+            EBML_MasterClear(Master);
+            if (!First || EBML_ElementParent(First)!=NULL || EBML_MasterCount(Master)!=0 || EBML_MasterChildren(Master)!=NULL)
+                ++Errors;
+            if (First)
+                NodeDelete((node*)First);
+            NodeDelete((node*)Master);
+        }
+        free(Copy);
+        if (Input2)
+            StreamClose(Input2);
+
+        // the integers remain packed until they are reached
+        Master = ReadHead(Input,SCOPE_PACKED_LEAVES);
+        if (Master)
+        {
+            int64_t Value;
+            if (EBML_MasterCount(Master)!=SKELETON_CHILDREN || !EBML_MasterIntegerValue(Master,&EBML_ContextReadVersion,&Value) || Value!=1 ||
+                !EBML_MasterIntegerValue(Master,&EBML_ContextVersion,&Value) || Value!=0 || EBML_MasterIntegerValue(Master,&EBML_ContextDocTypeVersion,&Value))
+                ++Errors;
+            CheckSame(Ref,Master,"packed walk");
+            Check(Master,"packed walk");
+            NodeDelete((node*)Master);
+        }
+
+        Master = ReadHead(Input,SCOPE_PACKED_LEAVES);
+        if (Master)
+        {
+            // walk from a child that was never packed
+            ebml_element *Found = EBML_MasterFindChild(Master,&EBML_ContextDocType);
+            ebml_element *RefFound = EBML_MasterFindChild(Ref,&EBML_ContextDocType);
+            while (Found && RefFound && EBML_ElementPosition(Found)==EBML_ElementPosition(RefFound))
+            {
+                Found = EBML_MasterNext(Found);
+                RefFound = EBML_MasterNext(RefFound);
+            }
+            if (Found || RefFound)
+            {
+                if (++Errors < 10)
+                    fprintf(stderr,"packed next: the packed children differ from the regular ones\r\n");
+            }
+            NodeDelete((node*)Master);
+        }
+
+        Master = ReadHead(Input,SCOPE_PACKED_LEAVES);
+        if (Master)
+        {
+            EBML_MasterAppend(Master,EBML_ElementCreate(p,&EBML_ContextDocTypeVersion,0,NULL));
+            if (EBML_MasterCount(Master)!=SKELETON_CHILDREN+1 || !EBML_ElementIsType(EBML_MasterChildren(Master),&EBML_ContextVersion) ||
+                !EBML_ElementIsType(EBML_MasterFindChild(Master,&EBML_ContextReadVersion),&EBML_ContextReadVersion))
+                ++Errors;
+            Check(Master,"packed append"); // the count and index of the leaves unpacked by the append
+            NodeDelete((node*)Master);
+        }
+
+        NodeDelete((node*)Ref);
+    }
+    StreamClose(Input);
+}
+
+static void Gather(parsercontext *p)
+{
+    static uint8_t Out[512];
+    uint8_t Frame[300];
+    streamvec Vec;
+    stream *Output, *Gather;
+    size_t i;
+
+    for (i=0;i<sizeof(Frame);++i)
+        Frame[i] = (uint8_t)i;
+    Output = (stream*)NodeCreate(p,MEMSTREAM_CLASS);
+    Gather = (stream*)NodeCreate(p,GATHERSTREAM_CLASS);
+    if (!Output || !Gather)
+    {
+        ++Errors;
+        if (Output)
+            StreamClose(Output);
+        return;
+    }
+    Node_Set(Output,MEMSTREAM_DATA,Out,sizeof(Out));
+    Node_SET(Gather,GATHERSTREAM_STREAM,&Output);
+
+    // nothing is written until the flush
+    Vec.Data = Frame;
+    Vec.Size = sizeof(Frame);
+    if (Stream_Write(Gather,"head",4,NULL)!=ERR_NONE || Stream_WriteV(Gather,&Vec,1,NULL)!=ERR_NONE || Stream_Write(Gather,"tail",4,NULL)!=ERR_NONE)
+        ++Errors;
+    if (Stream_Seek(Gather,0,SEEK_CUR)!=4+sizeof(Frame)+4 || Stream_Seek(Output,0,SEEK_CUR)!=0)
+        ++Errors;
+    if (Stream_Flush(Gather)!=ERR_NONE || Stream_Seek(Output,0,SEEK_CUR)!=4+sizeof(Frame)+4)
+        ++Errors;
+    if (memcmp(Out,"head",4)!=0 || memcmp(Out+4,Frame,sizeof(Frame))!=0 || memcmp(Out+4+sizeof(Frame),"tail",4)!=0)
+        ++Errors;
+
+    // a seek writes the pending data first, the deletion too
+    Stream_Write(Gather,"more",4,NULL);
+    if (Stream_Seek(Gather,0,SEEK_SET)!=0 || memcmp(Out+8+sizeof(Frame),"more",4)!=0)
+        ++Errors;
+    Stream_Write(Gather,"HEAD",4,NULL);
+    NodeDelete((node*)Gather);
+    if (memcmp(Out,"HEAD",4)!=0)
+        ++Errors;
+    StreamClose(Output);
+}
+
+static void Sizes(parsercontext *p)
+{
+    ebml_master *Top = (ebml_master*)EBML_ElementCreate(p,&EBML_ContextHead,0,NULL);
+    ebml_master *Sub = (ebml_master*)EBML_ElementCreate(p,&EBML_ContextHead,0,NULL);
+    ebml_integer *Version = (ebml_integer*)EBML_ElementCreate(p,&EBML_ContextVersion,0,NULL);
+
+    if (!Top || !Sub || !Version)
+    {
+        ++Errors;
+        return;
+    }
+    EBML_IntegerSetValue(Version,1);
+    EBML_MasterAppend(Sub,(ebml_element*)Version);
+    EBML_MasterAppend(Top,(ebml_element*)Sub);
+    if (EBML_ElementUpdateSize(Top,1,1)!=9 || EBML_ElementNeedsDataSizeUpdate(Top,1))
+        ++Errors;
+
+    // the same value doesn't need a new size, a longer one marks all the parents
+    EBML_IntegerSetValue(Version,1);
+    if (EBML_ElementNeedsDataSizeUpdate(Top,1) || EBML_ElementNeedsDataSizeUpdate(Sub,1))
+        ++Errors;
+    EBML_IntegerSetValue(Version,0x1234);
+    if (!EBML_ElementNeedsDataSizeUpdate(Top,1) || !EBML_ElementNeedsDataSizeUpdate(Sub,1))
+        ++Errors;
+    if (EBML_ElementUpdateSize(Top,1,1)!=10 || EBML_ElementDataSize((ebml_element*)Sub,1)!=5)
+        ++Errors;
+
+    // the size computed with the default values is not used without them
+    EBML_IntegerSetValue(Version,1);
+    if (EBML_ElementUpdateSize(Top,1,1)!=9 || !EBML_ElementNeedsDataSizeUpdate(Top,0))
+        ++Errors;
+    if (EBML_ElementUpdateSize(Top,0,1)!=5 || EBML_ElementDataSize((ebml_element*)Sub,0)!=0)
+        ++Errors;
+
+    NodeDelete((node*)Top);
+}
+
+static void CRCStream(parsercontext *p)
+{
+    static uint8_t Data[1000];
+    uint8_t Buf[50];
+    stream *Input, *Check;
+    ebml_crc *Good, *Bad;
+    size_t i;
+
+    for (i=0;i<sizeof(Data);++i)
+        Data[i] = (uint8_t)(i*7);
+    Input = (stream*)NodeCreate(p,MEMSTREAM_CLASS);
+    Good = (ebml_crc*)EBML_ElementCreate(p,&EBML_ContextEbmlCrc32,0,NULL);
+    Bad = (ebml_crc*)EBML_ElementCreate(p,&EBML_ContextEbmlCrc32,0,NULL);
+    if (!Input || !Good || !Bad)
+    {
+        ++Errors;
+        goto failed;
+    }
+    Node_Set(Input,MEMSTREAM_DATA,Data,sizeof(Data));
+    EBML_CRCAddBuffer(Good,Data+100,800);
+    EBML_CRCFinalize(Good);
+    EBML_CRCAddBuffer(Bad,Data+100,799);
+    EBML_CRCFinalize(Bad);
+
+    for (i=0;i<2;++i)
+    {
+        // the data from 100 to 900 are covered, whatever is read, skipped or read again
+        Stream_Seek(Input,100,SEEK_SET);
+        Check = EBML_CRCStreamCreate(p,Input,900);
+        if (!Check)
+        {
+            ++Errors;
+            break;
+        }
+        if (Stream_Read(Check,Buf,50,NULL)!=ERR_NONE || memcmp(Buf,Data+100,50)!=0)
+            ++Errors;
+        if (Stream_Seek(Check,400,SEEK_SET)!=400 || Stream_Read(Check,Buf,10,NULL)!=ERR_NONE || memcmp(Buf,Data+400,10)!=0)
+            ++Errors;
+        if (Stream_Seek(Check,120,SEEK_SET)!=120 || Stream_Read(Check,Buf,50,NULL)!=ERR_NONE || memcmp(Buf,Data+120,50)!=0)
+            ++Errors;
+        if (Stream_Seek(Check,890,SEEK_SET)!=890 || Stream_Read(Check,Buf,20,NULL)!=ERR_NONE || Stream_Seek(Check,0,SEEK_CUR)!=910)
+            ++Errors;
+        if (EBML_CRCStreamMatches(Check,i?Bad:Good)!=!i || Stream_Seek(Input,0,SEEK_CUR)!=910)
+            ++Errors;
+        StreamClose(Check);
+    }
+
+failed:
+    if (Good)
+        NodeDelete((node*)Good);
+    if (Bad)
+        NodeDelete((node*)Bad);
+    if (Input)
+        StreamClose(Input);
+}
+
+#define CRC_HEADS  3
+
+static const ebml_semantic SemanticCRCTop[] = {
+    {0, 0, &EBML_ContextHead},
+    {0, 0, NULL} // end of the table
+};
+static const ebml_context ContextCRCTop = {0x1F534B4C, EBML_MASTER_CLASS, 0, 0, "CRCTop", SemanticCRCTop, EBML_SemanticGlobals};
+
+static void CRCSkeleton(parsercontext *p)
+{
+    static uint8_t Data[256];
+    static const tchar_t Path[] = T("mastertest.tmp");
+    ebml_parser_context Context;
+    ebml_master *Top, *Head;
+    ebml_element *Elt;
+    ebml_string *DocType;
+    stream *Output, *Input = NULL;
+    filepos_t Rendered = 0;
+    size_t Written, i, Count;
+
+    // a master with a CRC-32 holding masters, written to a file so it's not checked in memory
+    Top = (ebml_master*)EBML_ElementCreate(p,&ContextCRCTop,0,NULL);
+    Output = (stream*)NodeCreate(p,MEMSTREAM_CLASS);
+    if (!Top || !Output)
+    {
+        ++Errors;
+        goto failed;
+    }
+    for (i=0;i<CRC_HEADS;++i)
+    {
+        Head = (ebml_master*)EBML_MasterAddElt(Top,&EBML_ContextHead,0);
+        DocType = (ebml_string*)EBML_MasterAddElt(Head,&EBML_ContextDocType,0);
+        if (!DocType || EBML_StringSetValue(DocType,i?"webm":"mka")!=ERR_NONE)
+            ++Errors;
+        EBML_IntegerSetValue((ebml_integer*)EBML_MasterAddElt(Head,&EBML_ContextVersion,0),i+2); // not the default value
+    }
+    EBML_MasterUseChecksum(Top,1);
+    Node_Set(Output,MEMSTREAM_DATA,Data,sizeof(Data));
+    if (EBML_ElementRender((ebml_element*)Top,Output,0,0,1,&Rendered)!=ERR_NONE)
+        ++Errors;
+    StreamClose(Output);
+    NodeDelete((node*)Top);
+    Top = NULL;
+
+    Output = StreamOpen(p,Path,SFLAG_WRONLY|SFLAG_CREATE);
+    if (!Output || Stream_Write(Output,Data,(size_t)Rendered,&Written)!=ERR_NONE || Written!=(size_t)Rendered)
+        ++Errors;
+    if (Output)
+        StreamClose(Output);
+    Input = StreamOpen(p,Path,SFLAG_RDONLY);
+    if (!Input)
+    {
+        ++Errors;
+        goto failed;
+    }
+
+    Context.Context = &ContextCRCTop;
+    Context.UpContext = NULL;
+    Context.EndPosition = INVALID_FILEPOS_T;
+    Context.Profile = 0;
+    Top = (ebml_master*)EBML_FindNextId(Input,&ContextCRCTop,(size_t)-1);
+    if (!Top || EBML_ElementReadData(Top,Input,&Context,0,SCOPE_SKELETON,1)!=ERR_NONE || !EBML_MasterIsChecksumValid(Top))
+    {
+        ++Errors;
+        goto failed;
+    }
+    // the children of the Heads are read after the CRC stream is gone
+    Count = 0;
+    for (Elt=EBML_MasterChildren(Top);Elt;Elt=EBML_MasterNext(Elt))
+    {
+        DocType = (ebml_string*)EBML_MasterFindChild((ebml_master*)Elt,&EBML_ContextDocType);
+        if (!DocType || strcmp(DocType->Buffer,Count?"webm":"mka")!=0 || EBML_MasterCount((ebml_master*)Elt)!=2)
+            ++Errors;
+        ++Count;
+    }
+    if (Count!=CRC_HEADS)
+        ++Errors;
+
+failed:
+    if (Top)
+        NodeDelete((node*)Top);
+    if (Input)
+        StreamClose(Input);
+    FileErase((nodecontext*)p,Path,1,0);
+}
+
+static void Zeros(parsercontext *p)
+{
+    static uint8_t Out[3*1024*1024];
+    ebml_element *Void = EBML_ElementCreate(p,&EBML_ContextEbmlVoid,0,NULL);
+    stream *Output = (stream*)NodeCreate(p,MEMSTREAM_CLASS);
+    filepos_t Rendered = 0;
+    size_t i;
+
+    if (!Void || !Output)
+        ++Errors;
+    else
+    {
+        memset(Out,0xFF,sizeof(Out));
+        Node_Set(Output,MEMSTREAM_DATA,Out,sizeof(Out));
+        EBML_VoidSetFullSize(Void,sizeof(Out)-1);
+        if (EBML_ElementRender(Void,Output,0,0,1,&Rendered)!=ERR_NONE || Rendered!=sizeof(Out)-1 || Out[0]!=0xEC || Out[sizeof(Out)-1]!=0xFF)
+            ++Errors;
+        for (i=EBML_ElementPositionData(Void);i<sizeof(Out)-1 && !Out[i];++i) {}
+        if (i!=sizeof(Out)-1)
+            ++Errors;
+    }
+    if (Void)
+        NodeDelete((node*)Void);
+    if (Output)
+        StreamClose(Output);
+}
+
+int main(void)
+{
+    parsercontext p;
+
+    ParserContext_Init(&p,NULL,NULL,NULL);
+    StdAfx_Init((nodemodule*)&p);
+    EBML_Init((nodecontext*)&p);
+
+    Stress(&p);
+    Skeleton(&p);
+    Gather(&p);
+    Sizes(&p);
+    CRCStream(&p);
+    CRCSkeleton(&p);
+    Zeros(&p);
+    Bench(&p);
+    fprintf(stdout,"%d errors\r\n",Errors);
+
+    EBML_Done((nodecontext*)&p);
+    StdAfx_Done((nodemodule*)&p);
+    ParserContext_Done(&p);
+    return Errors!=0;
+}
@@ -0,0 +1,330 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+
+#include "ebml/ebml.h"
+#include "vinttest_stdafx.h"
+
+// checks the EBML coded size functions against the original loops and measures their speed
+
+// the decoder as it was before the count of leading zeros
+static filepos_t Ref_ReadCodedSizeValue(const uint8_t *InBuffer, size_t *BufferSize, filepos_t *SizeUnknown)
+{
+	uint8_t SizeBitMask = 1 << 7;
+	filepos_t Result = 0x7F;
+	unsigned int SizeIdx, PossibleSizeLength = 0;
+	uint8_t PossibleSize[8];
+    unsigned int i;
+
+	*SizeUnknown = 0x7F; // the last bit is discarded when computing the size
+	for (SizeIdx = 0; SizeIdx < *BufferSize && SizeIdx < 8; SizeIdx++) {
+		if (InBuffer[0] & (SizeBitMask >> SizeIdx)) {
+			PossibleSizeLength = SizeIdx + 1;
+			SizeBitMask >>= SizeIdx;
+			for (SizeIdx = 0; SizeIdx < PossibleSizeLength; SizeIdx++) {
+				PossibleSize[SizeIdx] = InBuffer[SizeIdx];
+			}
+			for (SizeIdx = 0; SizeIdx < PossibleSizeLength - 1; SizeIdx++) {
+				Result <<= 7;
+				Result |= 0xFF;
+			}
+
+			Result = 0;
+			Result |= PossibleSize[0] & ~SizeBitMask;
+			for (i = 1; i<PossibleSizeLength; i++) {
+				Result <<= 8;
+				Result |= PossibleSize[i];
+			}
+
+			*BufferSize = PossibleSizeLength;
+
+			return Result;
+		}
+		*SizeUnknown <<= 7;
+		*SizeUnknown |= 0xFF;
+	}
+
+	*BufferSize = 0;
+	return 0;
+}
+
+static filepos_t Ref_ReadCodedSizeSignedValue(const uint8_t *InBuffer, size_t *BufferSize, filepos_t *SizeUnknown)
+{
+	filepos_t Result = Ref_ReadCodedSizeValue(InBuffer, BufferSize, SizeUnknown);
+
+	switch (*BufferSize)
+	{
+	case 1: Result -= 63; break;
+	case 2: Result -= 8191; break;
+	case 3: Result -= 1048575L; break;
+	case 4: Result -= 134217727L; break;
+	}
+	return Result;
+}
+
+static uint8_t Ref_CodedSizeLength(filepos_t Length, uint8_t SizeLength, bool_t bSizeIsFinite)
+{
+	int CodedSize;
+	if (!bSizeIsFinite)
+		CodedSize = 1;
+	else
+    {
+		if (Length < 127) // 2^7 - 1
+			CodedSize = 1;
+		else if (Length < 16383) // 2^14 - 1
+			CodedSize = 2;
+		else if (Length < 2097151) // 2^21 - 1
+			CodedSize = 3;
+		else if (Length < 268435455) // 2^28 - 1
+			CodedSize = 4;
+		else CodedSize = 5;
+	}
+
+	if (SizeLength && CodedSize < SizeLength)
+		CodedSize = SizeLength;
+
+	return (uint8_t)CodedSize;
+}
+
+static uint8_t Ref_CodedValueLength(filepos_t Length, size_t CodedSize, uint8_t *OutBuffer, bool_t bSizeIsFinite)
+{
+	int _SizeMask = 0xFF;
+    size_t i;
+    if (!bSizeIsFinite)
+        Length=MAX_FILEPOS;
+	OutBuffer[0] = (uint8_t)(1 << (8 - CodedSize));
+	for (i=1; i<CodedSize; ++i)
+    {
+		OutBuffer[CodedSize-i] = (uint8_t)(Length & 0xFF);
+		Length >>= 8;
+		_SizeMask >>= 1;
+	}
+	OutBuffer[0] |= Length & 0xFF & _SizeMask;
+	return (uint8_t)CodedSize;
+}
+
+static uint32_t Random = 0x12345678;
+
+static uint32_t NextRandom(void)
+{
+    Random = Random * 1664525 + 1013904223;
+    return Random;
+}
+
+static int Errors = 0;
+
+static void CheckDecode(const uint8_t *Buffer, size_t BufferSize)
+{
+    size_t Size = BufferSize, RefSize = BufferSize;
+    filepos_t Unknown, RefUnknown;
+    filepos_t Value = EBML_ReadCodedSizeValue(Buffer, &Size, &Unknown);
+    filepos_t RefValue = Ref_ReadCodedSizeValue(Buffer, &RefSize, &RefUnknown);
+
+    if (Value!=RefValue || Size!=RefSize || Unknown!=RefUnknown)
+    {
+        if (++Errors < 10)
+            fprintf(stderr,"decode %02X/%d: %"PRId64"/%d/%"PRIx64" instead of %"PRId64"/%d/%"PRIx64"\r\n",Buffer[0],(int)BufferSize,
+                Value,(int)Size,Unknown,RefValue,(int)RefSize,RefUnknown);
+        return;
+    }
+
+    Size = RefSize = BufferSize;
+    Value = EBML_ReadCodedSizeSignedValue(Buffer, &Size, &Unknown);
+    RefValue = Ref_ReadCodedSizeSignedValue(Buffer, &RefSize, &RefUnknown);
+    if (Value!=RefValue || Size!=RefSize || Unknown!=RefUnknown)
+    {
+        if (++Errors < 10)
+            fprintf(stderr,"signed decode %02X/%d: %"PRId64" instead of %"PRId64"\r\n",Buffer[0],(int)BufferSize,Value,RefValue);
+    }
+}
+
+static void CheckEncode(filepos_t Length, bool_t bSizeIsFinite)
+{
+    uint8_t SizeLength;
+    uint8_t Out[8],RefOut[8];
+    size_t CodedSize;
+
+    for (SizeLength=0;SizeLength<=8;++SizeLength)
+    {
+        CodedSize = EBML_CodedSizeLength(Length,SizeLength,bSizeIsFinite);
+        if (CodedSize != Ref_CodedSizeLength(Length,SizeLength,bSizeIsFinite))
+        {
+            if (++Errors < 10)
+                fprintf(stderr,"size length of %"PRId64"/%d: %d instead of %d\r\n",Length,SizeLength,(int)CodedSize,Ref_CodedSizeLength(Length,SizeLength,bSizeIsFinite));
+        }
+    }
+
+    for (CodedSize=1;CodedSize<=8;++CodedSize)
+    {
+        memset(Out,0xAA,sizeof(Out));
+        memset(RefOut,0xAA,sizeof(RefOut));
+        EBML_CodedValueLength(Length,CodedSize,Out,bSizeIsFinite);
+        Ref_CodedValueLength(Length,CodedSize,RefOut,bSizeIsFinite);
+        if (memcmp(Out,RefOut,sizeof(Out))!=0)
+        {
+            if (++Errors < 10)
+                fprintf(stderr,"coding of %"PRId64" on %d octets differs\r\n",Length,(int)CodedSize);
+        }
+    }
+}
+
+#define BENCH_VALUES  4096
+#define BENCH_LOOPS   2000
+
+static void Bench(const char *Name, filepos_t (*Decode)(const uint8_t*, size_t*, filepos_t*), const uint8_t *Buffer, size_t BufferSize)
+{
+    systick_t Start, Duration;
+    filepos_t Sum = 0, Unknown;
+    size_t Pos, Size, Count = 0;
+    int Loop;
+
+    Start = GetTimeTick();
+    for (Loop=0;Loop<BENCH_LOOPS;++Loop)
+    {
+        for (Pos=0;Pos<BufferSize;Pos+=Size)
+        {
+            Size = BufferSize - Pos;
+            Sum += Decode(Buffer+Pos, &Size, &Unknown);
+            if (!Size)
+                break;
+            ++Count;
+        }
+    }
+    Duration = GetTimeTick() - Start;
+    if (Duration <= 0)
+        Duration = 1;
+    fprintf(stdout,"%-8s %u values in %d ms, %.1f Mvalues/s (checksum %"PRIx64")\r\n",Name,(unsigned)Count,(int)Duration,
+        (double)Count * GetTimeFreq() / Duration / 1000000,Sum);
+}
+
+// decode the sizes the way EBML_FindNextId() reads them from a stream
+static void BenchHead(const char *Name, bool_t Once, filepos_t (*Decode)(const uint8_t*, size_t*, filepos_t*), const uint8_t *Buffer, size_t BufferSize)
+{
+    systick_t Start, Duration;
+    filepos_t Sum = 0, Unknown;
+    uint8_t Head[8];
+    size_t Pos, Size, Length, Count = 0;
+    int Loop;
+
+    Start = GetTimeTick();
+    for (Loop=0;Loop<BENCH_LOOPS;++Loop)
+    {
+        for (Pos=0;Pos<BufferSize;Pos+=Size)
+        {
+            if (Once)
+            {
+                // the length from the first octet, one decode of the zero padded octets
+                for (Length=1;Length<8 && !(Buffer[Pos] & (0x100 >> Length));++Length) {}
+                memset(Head,0,sizeof(Head));
+                memcpy(Head,Buffer+Pos,Length);
+                Size = sizeof(Head);
+                Sum += Decode(Head, &Size, &Unknown);
+            }
+            else
+            {
+                // the original decode after each octet read until the size is complete
+                Length = 0;
+                do {
+                    if (Length == 8)
+                        break;
+                    Size = ++Length;
+                    Sum += Decode(Buffer+Pos, &Size, &Unknown);
+                } while (!Size);
+            }
+            if (!Size)
+                break;
+            ++Count;
+        }
+    }
+    Duration = GetTimeTick() - Start;
+    if (Duration <= 0)
+        Duration = 1;
+    fprintf(stdout,"%-8s %u heads in %d ms, %.1f Mheads/s (checksum %"PRIx64")\r\n",Name,(unsigned)Count,(int)Duration,
+        (double)Count * GetTimeFreq() / Duration / 1000000,Sum);
+}
+
+int main(void)
+{
+    uint8_t Buffer[16];
+    uint8_t *Values, *Out;
+    size_t Length, BufferSize, i;
+    int First, Bit;
+
+    // every length marker with every truncation of the buffer
+    for (First=0;First<256;++First)
+    {
+        for (i=0;i<1000;++i)
+        {
+            size_t j;
+            Buffer[0] = (uint8_t)First;
+            for (j=1;j<sizeof(Buffer);++j)
+                Buffer[j] = (uint8_t)NextRandom();
+            for (BufferSize=0;BufferSize<=sizeof(Buffer);++BufferSize)
+                CheckDecode(Buffer,BufferSize);
+        }
+        // all the bits set, the unknown size
+        memset(Buffer+1,0xFF,sizeof(Buffer)-1);
+        for (BufferSize=0;BufferSize<=sizeof(Buffer);++BufferSize)
+            CheckDecode(Buffer,BufferSize);
+    }
+
+    // values around each power of 2 for every length class
+    for (Bit=0;Bit<63;++Bit)
+    {
+        filepos_t Value = (filepos_t)1 << Bit;
+        CheckEncode(Value-1,1);
+        CheckEncode(Value,1);
+        CheckEncode(Value+1,1);
+        CheckEncode(Value-2,1);
+    }
+    CheckEncode(MAX_FILEPOS,1);
+    CheckEncode(0,0);
+    for (i=0;i<100000;++i)
+        CheckEncode((filepos_t)(NextRandom() >> (NextRandom() & 31)),1);
+
+    fprintf(stdout,"%d error(s)\r\n",Errors);
+
+    // the values in all length classes, coded with their optimal size
+    Values = malloc(BENCH_VALUES*8);
+    if (!Values)
+        return 1;
+    for (Out=Values,i=0;i<BENCH_VALUES;++i)
+    {
+        filepos_t Value = NextRandom() & ((1 << (7*(i%4+1))) - 2);
+        Length = EBML_CodedSizeLength(Value,(uint8_t)(i%8+1),1);
+        Out += EBML_CodedValueLength(Value,Length,Out,1);
+    }
+    Bench("original",Ref_ReadCodedSizeValue,Values,Out-Values);
+    Bench("current",EBML_ReadCodedSizeValue,Values,Out-Values);
+    BenchHead("original",0,Ref_ReadCodedSizeValue,Values,Out-Values);
+    BenchHead("current",1,EBML_ReadCodedSizeValue,Values,Out-Values);
+    free(Values);
+
+    return Errors!=0;
+}
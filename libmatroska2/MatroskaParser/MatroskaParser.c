@@ -27,13 +27,33 @@
  */
 
 #include "MatroskaParser.h"
+#include "matroska/matroska_sem.h"
+#include "matroska/matroska_internal.h"
+#include <stdio.h>
 
-#define MAX_TRACKS 32 // safety
+#define MAX_TRACKS 1024 // safety
+#define MAX_TRACK_NUMBER 0x3FFF // largest track number read in a Block
 
 #if defined(TARGET_WIN)
 #define snprintf _snprintf
 #endif
 
+#define BLOCK_HEAD_READ  64 // enough for the Block header and the sizes of small laces
+
+// sections read on first use
+#define LOAD_CUES        0x01
+#define LOAD_ATTACHMENTS 0x02
+#define LOAD_CHAPTERS    0x04
+#define LOAD_TAGS        0x08
+
+#define CLUSTER_SCAN_READ 4096 // bytes read at once when looking for a Cluster ID
+#define SEEK_MAX_PREV_CLUSTERS 16 // Clusters to go back to find a keyframe
+
+#define LACING_NONE  0
+#define LACING_XIPH  1
+#define LACING_FIXED 2
+#define LACING_EBML  3
+
 #define HAALI_STREAM_CLASS FOURCC('H','A','L','S')
 typedef struct haali_stream
 {
@@ -42,6 +62,22 @@ typedef struct haali_stream
 
 } haali_stream;
 
+// frame of the current Block
+typedef struct mkv_frame
+{
+	filepos_t Position;
+	uint32_t Size;
+
+} mkv_frame;
+
+// Cluster found when seeking without Cues
+typedef struct mkv_clusterpos
+{
+	filepos_t Position;
+	timecode_t Timecode;
+
+} mkv_clusterpos;
+
 struct MatroskaFile
 {
 	haali_stream *Input;
@@ -49,15 +85,29 @@ struct MatroskaFile
 	ebml_element *SegmentInfo;
 	ebml_element *TrackList;
 	ebml_element *CueList;
+	matroska_cueindex CueIndex;
+	array ClusterMap; // mkv_clusterpos of the Clusters found when seeking without Cues, sorted by position
 	SegmentInfo Seg;
 
 	ebml_parser_context L0Context;
 	ebml_parser_context L1Context;
 
 	ebml_element *CurrentCluster;
-	matroska_block *CurrentBlock;
+	filepos_t ClusterPos; // next element of the CurrentCluster
+	filepos_t ClusterEnd; // INVALID_FILEPOS_T for a Cluster with an unknown size
+	timecode_t ClusterTimecode;
+
+	// current Block, read from the file without creating its element
+	array Frames; // mkv_frame
 	size_t CurrentFrame;
-	ebml_parser_context ClusterContext;
+	unsigned int BlockTrack; // index in Tracks
+	timecode_t BlockTimecode;
+	filepos_t BlockPosition;
+	bool_t BlockKeyframe;
+	array BlockHead; // Block header and lace sizes read from the file
+	uint8_t ElementHead[16]; // last element head read and the start of its data
+	size_t ElementHeadLength;
+	size_t ElementHeadRead;
 
 	filepos_t pSegmentInfo;
 	filepos_t pTracks;
@@ -66,11 +116,17 @@ struct MatroskaFile
 	filepos_t pChapters;
 	filepos_t pTags;
 	filepos_t pFirstCluster;
+	filepos_t pResume; // where to look for the level 1 elements after the first Cluster, INVALID_FILEPOS_T when it's done
+	int Loaded; // LOAD_xxx sections already read
+	int LastSection; // LOAD_xxx section asked last
+	char err_msg[4][256]; // why each LOAD_xxx section could not be read completely, empty if it was
 
-	int trackMask;
+	uint32_t TrackMask[MAX_TRACKS/32]; // bit set for the tracks not to read
+	void (*Skipped)(InputStream *inf, filepos_t pos, filepos_t count); // set by mkv_SetSkipCallback(), may be NULL
 	int flags;
 
 	array Tracks;
+	array TrackIndex; // uint16_t index+1 in Tracks for each track number, 0 if none
 	array Tags;
 	array Chapters;
 	array Attachments;
@@ -78,24 +134,69 @@ struct MatroskaFile
 
 void mkv_SetTrackMask(MatroskaFile *File, int Mask)
 {
-	File->trackMask = Mask;
+	uint32_t Mask32 = (uint32_t)Mask;
+	mkv_SetTrackMaskEx(File,&Mask32,32);
+}
+
+void mkv_SetTrackMaskEx(MatroskaFile *File, const uint32_t *Mask, size_t Tracks)
+{
+	size_t i;
+	memset(File->TrackMask,0,sizeof(File->TrackMask));
+	for (i=0;i<Tracks && i<MAX_TRACKS;++i)
+		if (Mask[i>>5] & (1u << (i & 31)))
+			File->TrackMask[i>>5] |= 1u << (i & 31);
 	// TODO: the original code is handling a queue
 }
 
+void mkv_SetSkipCallback(MatroskaFile *File, void (*Skipped)(InputStream *inf, filepos_t pos, filepos_t count))
+{
+	File->Skipped = Skipped;
+}
+
+static bool_t IsTrackMasked(const MatroskaFile *File, size_t Track)
+{
+	return (File->TrackMask[Track>>5] & (1u << (Track & 31))) != 0;
+}
+
+static void loadSection(MatroskaFile *File, int Section);
+
+static char *sectionError(MatroskaFile *File, int Section)
+{
+	size_t i = 0;
+	while (Section > 1)
+	{
+		Section >>= 1;
+		++i;
+	}
+	return File->err_msg[i];
+}
+
+const char *mkv_GetLastError(MatroskaFile *File)
+{
+	const char *err_msg;
+	if (!File->LastSection)
+		return NULL;
+	err_msg = sectionError(File,File->LastSection);
+	return err_msg[0] ? err_msg : NULL;
+}
+
 void mkv_GetTags(MatroskaFile *File, Tag **pTags, unsigned *Count)
 {
+	loadSection(File, LOAD_TAGS);
 	*pTags = ARRAYBEGIN(File->Tags,Tag);
 	*Count = ARRAYCOUNT(File->Tags,Tag);
 }
 
 void mkv_GetAttachments(MatroskaFile *File, Attachment **pAttachements, unsigned *Count)
 {
+	loadSection(File, LOAD_ATTACHMENTS);
 	*pAttachements = ARRAYBEGIN(File->Attachments,Attachment);
 	*Count = ARRAYCOUNT(File->Attachments,Attachment);
 }
 
 void mkv_GetChapters(MatroskaFile *File, Chapter **pChapters, unsigned *Count)
 {
+	loadSection(File, LOAD_CHAPTERS);
 	*pChapters = ARRAYBEGIN(File->Chapters,Chapter);
 	*Count = ARRAYCOUNT(File->Chapters,Chapter);
 }
@@ -121,55 +222,55 @@ static bool_t CheckMatroskaHead(ebml_element *Head, char *err_msg, size_t err_ms
 {
 	tchar_t DocType[MAXPATH];
 	ebml_element *Elt;
-	Elt = EBML_MasterFindFirstElt(Head,&EBML_ContextReadVersion,1,1);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)Head,&EBML_ContextReadVersion,1,1);
 	if (!Elt)
 	{
 		strncpy(err_msg,"Out of memory",err_msgSize);
 		return 0;
 	}
-	if (EBML_IntegerValue(Elt) > EBML_MAX_VERSION)
+	if (EBML_IntegerValue((ebml_integer*)Elt) > EBML_MAX_VERSION)
 	{
-		snprintf(err_msg,err_msgSize,"File requires version %d EBML parser",(int)EBML_IntegerValue(Elt));
+		snprintf(err_msg,err_msgSize,"File requires version %d EBML parser",(int)EBML_IntegerValue((ebml_integer*)Elt));
 		return 0;
 	}
 
-	Elt = EBML_MasterFindFirstElt(Head,&EBML_ContextDocTypeReadVersion,1,1);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)Head,&EBML_ContextDocTypeReadVersion,1,1);
 	if (!Elt)
 	{
 		strncpy(err_msg,"Out of memory",err_msgSize);
 		return 0;
 	}
-	if (EBML_IntegerValue(Elt) > MATROSKA_VERSION)
+	if (EBML_IntegerValue((ebml_integer*)Elt) > MATROSKA_VERSION)
 	{
-		snprintf(err_msg,err_msgSize,"File requires version %d Matroska parser",(int)EBML_IntegerValue(Elt));
+		snprintf(err_msg,err_msgSize,"File requires version %d Matroska parser",(int)EBML_IntegerValue((ebml_integer*)Elt));
 		return 0;
 	}
 
-	Elt = EBML_MasterFindFirstElt(Head,&EBML_ContextMaxIdLength,1,1);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)Head,&EBML_ContextMaxIdLength,1,1);
 	if (!Elt)
 	{
 		strncpy(err_msg,"Out of memory",err_msgSize);
 		return 0;
 	}
-	if (EBML_IntegerValue(Elt) > EBML_MAX_ID)
+	if (EBML_IntegerValue((ebml_integer*)Elt) > EBML_MAX_ID)
 	{
-		snprintf(err_msg,err_msgSize,"File has identifiers longer than %d",(int)EBML_IntegerValue(Elt));
+		snprintf(err_msg,err_msgSize,"File has identifiers longer than %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 		return 0;
 	}
 
-	Elt = EBML_MasterFindFirstElt(Head,&EBML_ContextMaxSizeLength,1,1);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)Head,&EBML_ContextMaxSizeLength,1,1);
 	if (!Elt)
 	{
 		strncpy(err_msg,"Out of memory",err_msgSize);
 		return 0;
 	}
-	if (EBML_IntegerValue(Elt) > EBML_MAX_SIZE)
+	if (EBML_IntegerValue((ebml_integer*)Elt) > EBML_MAX_SIZE)
 	{
-		snprintf(err_msg,err_msgSize,"File has integers longer than %d",(int)EBML_IntegerValue(Elt));
+		snprintf(err_msg,err_msgSize,"File has integers longer than %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 		return 0;
 	}
 
-	Elt = EBML_MasterFindFirstElt(Head,&EBML_ContextDocType,1,1);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)Head,&EBML_ContextDocType,1,1);
 	if (!Elt)
 	{
 		strncpy(err_msg,"Out of memory",err_msgSize);
@@ -198,23 +299,23 @@ static bool_t parseSeekHead(ebml_element *SeekHead, MatroskaFile *File, char *er
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
 	RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(SeekHead,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(SeekHead,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the EBML head",err_msgSize);
 		return 0;
 	}
 
-	Elt = EBML_MasterFindFirstElt(SeekHead,&MATROSKA_ContextSeek,0,0);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)SeekHead,&MATROSKA_ContextSeek,0,0);
 	while (Elt)
 	{
-		EltId = EBML_MasterFindFirstElt(Elt,&MATROSKA_ContextSeekId,0,0);
+		EltId = EBML_MasterFindFirstElt((ebml_master*)Elt,&MATROSKA_ContextSeekID,0,0);
 		if (EltId && EltId->DataSize > EBML_MAX_ID)
 		{
 			snprintf(err_msg,err_msgSize,"Invalid ID size in parseSeekEntry: %d",(int)EltId->DataSize);
 			return 0;
 		}
 		EltID = MATROSKA_MetaSeekID((matroska_seekpoint *)Elt);
-		if (EltID == MATROSKA_ContextSegmentInfo.Id)
+		if (EltID == MATROSKA_ContextInfo.Id)
 			File->pSegmentInfo = MATROSKA_MetaSeekPosInSegment((matroska_seekpoint *)Elt) + SegStart;
 		else if (EltID == MATROSKA_ContextTracks.Id)
 			File->pTracks = MATROSKA_MetaSeekPosInSegment((matroska_seekpoint *)Elt) + SegStart;
@@ -226,7 +327,7 @@ static bool_t parseSeekHead(ebml_element *SeekHead, MatroskaFile *File, char *er
 			File->pChapters = MATROSKA_MetaSeekPosInSegment((matroska_seekpoint *)Elt) + SegStart;
 		else if (EltID == MATROSKA_ContextTags.Id)
 			File->pTags = MATROSKA_MetaSeekPosInSegment((matroska_seekpoint *)Elt) + SegStart;
-		Elt = EBML_MasterFindNextElt(SeekHead,Elt,0,0);
+		Elt = EBML_MasterFindNextElt((ebml_master*)SeekHead,Elt,0,0);
 	}
 
 	return 1;
@@ -244,7 +345,7 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
     RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(SegmentInfo,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(SegmentInfo,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the Segment Info",err_msgSize);
 		File->pSegmentInfo = INVALID_FILEPOS_T;
@@ -258,7 +359,7 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 	{
 		if (Elt->Context->Id == MATROSKA_ContextTimestampScale.Id)
 		{
-			File->Seg.TimecodeScale = EBML_IntegerValue(Elt);
+			File->Seg.TimecodeScale = EBML_IntegerValue((ebml_integer*)Elt);
 			if (File->Seg.TimecodeScale==0)
 			{
 				strncpy(err_msg,"Segment timecode scale is zero",err_msgSize);
@@ -269,11 +370,11 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 		{
 			duration = ((ebml_float*)Elt)->Value;
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextSegmentDate.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextDateUTC.Id)
 		{
 			File->Seg.DateUTC = EBML_DateTime((ebml_date*)Elt);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextSegmentTitle.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextTitle.Id)
 		{
 			File->Seg.Title = File->Input->io->memalloc(File->Input->io, (size_t)(Elt->DataSize+1));
 			strcpy(File->Seg.Title,((ebml_string*)Elt)->Buffer);
@@ -288,7 +389,7 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 			File->Seg.WritingApp = File->Input->io->memalloc(File->Input->io, (size_t)(Elt->DataSize+1));
 			strcpy(File->Seg.WritingApp,((ebml_string*)Elt)->Buffer);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextSegmentUid.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextSegmentUID.Id)
 		{
 			if (Elt->DataSize!=16)
 			{
@@ -297,7 +398,7 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 			}
 			memcpy(File->Seg.UID,EBML_BinaryGetData((ebml_binary*)Elt),sizeof(File->Seg.UID));
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextPrevUid.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextPrevUID.Id)
 		{
 			if (Elt->DataSize!=16)
 			{
@@ -306,7 +407,7 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 			}
 			memcpy(File->Seg.PrevUID,EBML_BinaryGetData((ebml_binary*)Elt),sizeof(File->Seg.PrevUID));
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextNextUid.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextNextUID.Id)
 		{
 			if (Elt->DataSize!=16)
 			{
@@ -340,6 +441,7 @@ static bool_t parseSegmentInfo(ebml_element *SegmentInfo, MatroskaFile *File, ch
 static void releaseTrackEntry(TrackInfo *track, InputStream *io)
 {
 	if (track->CodecPrivate) io->memfree(io, track->CodecPrivate);
+	if (track->CodecID) io->memfree(io, track->CodecID);
 	if (track->Name) io->memfree(io, track->Name);
 }
 
@@ -353,76 +455,76 @@ static bool_t parseTrackEntry(ebml_element *Track, MatroskaFile *File, char *err
 
 	memset(&track,0,sizeof(track));
 	track.DefaultDuration = INVALID_TIMECODE_T;
-	track.Enabled = MATROSKA_ContextTrackEnabled.DefaultValue;
-	track.Default = MATROSKA_ContextTrackDefault.DefaultValue;
-	track.Lacing = MATROSKA_ContextTrackLacing.DefaultValue;
-	track.DecodeAll = MATROSKA_ContextTrackCodecDecodeAll.DefaultValue;
+	track.Enabled = MATROSKA_ContextFlagEnabled.DefaultValue;
+	track.Default = MATROSKA_ContextFlagDefault.DefaultValue;
+	track.Lacing = MATROSKA_ContextFlagLacing.DefaultValue;
+	track.DecodeAll = MATROSKA_ContextCodecDecodeAll.DefaultValue;
 	track.TimecodeScale = (float)MATROSKA_ContextTrackTimestampScale.DefaultValue;
 	memcpy(track.Language, "eng", 4);
 
 	for (Elt = EBML_MasterChildren(Track);Elt;Elt = EBML_MasterNext(Elt))
 	{
 		if (Elt->Context->Id == MATROSKA_ContextTrackNumber.Id)
-			track.Number = (int)EBML_IntegerValue(Elt);
+			track.Number = (int)EBML_IntegerValue((ebml_integer*)Elt);
 		else if (Elt->Context->Id == MATROSKA_ContextTrackNumber.Id)
-			track.UID = EBML_IntegerValue(Elt);
+			track.UID = EBML_IntegerValue((ebml_integer*)Elt);
 		else if (Elt->Context->Id == MATROSKA_ContextTrackType.Id)
 		{
-			if (EBML_IntegerValue(Elt)==0 || EBML_IntegerValue(Elt)>254)
+			if (EBML_IntegerValue((ebml_integer*)Elt)==0 || EBML_IntegerValue((ebml_integer*)Elt)>254)
 			{
-				snprintf(err_msg,err_msgSize,"Invalid track type: %d",(int)EBML_IntegerValue(Elt));
+				snprintf(err_msg,err_msgSize,"Invalid track type: %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 				goto fail;
 			}
-			track.Type = (uint8_t)EBML_IntegerValue(Elt);
+			track.Type = (uint8_t)EBML_IntegerValue((ebml_integer*)Elt);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackEnabled.Id)
-			track.Enabled = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextTrackDefault.Id)
-			track.Default = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextTrackLacing.Id)
-			track.Lacing = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextTrackCodecDecodeAll.Id)
-			track.DecodeAll = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextTrackMinCache.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextFlagEnabled.Id)
+			track.Enabled = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextFlagDefault.Id)
+			track.Default = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextFlagLacing.Id)
+			track.Lacing = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextCodecDecodeAll.Id)
+			track.DecodeAll = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextMinCache.Id)
 		{
-			if (EBML_IntegerValue(Elt) > 0xFF)
+			if (EBML_IntegerValue((ebml_integer*)Elt) > 0xFF)
 			{
-				snprintf(err_msg,err_msgSize,"MinCache is too large: %d",(int)EBML_IntegerValue(Elt));
+				snprintf(err_msg,err_msgSize,"MinCache is too large: %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 				goto fail;
 			}
-			track.MinCache = (uint8_t)EBML_IntegerValue(Elt);
+			track.MinCache = (uint8_t)EBML_IntegerValue((ebml_integer*)Elt);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackMaxCache.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextMaxCache.Id)
 		{
-			if (EBML_IntegerValue(Elt) > 0x7FFFFFFF)
+			if (EBML_IntegerValue((ebml_integer*)Elt) > 0x7FFFFFFF)
 			{
-				snprintf(err_msg,err_msgSize,"MaxCache is too large: %d",(int)EBML_IntegerValue(Elt));
+				snprintf(err_msg,err_msgSize,"MaxCache is too large: %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 				goto fail;
 			}
-			track.MaxCache = (size_t)EBML_IntegerValue(Elt);
+			track.MaxCache = (size_t)EBML_IntegerValue((ebml_integer*)Elt);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackDefaultDuration.Id)
-			track.DefaultDuration = EBML_IntegerValue(Elt);
+		else if (Elt->Context->Id == MATROSKA_ContextDefaultDuration.Id)
+			track.DefaultDuration = EBML_IntegerValue((ebml_integer*)Elt);
 		else if (Elt->Context->Id == MATROSKA_ContextTrackTimestampScale.Id)
 			track.TimecodeScale = (float)((ebml_float*)Elt)->Value;
-		else if (Elt->Context->Id == MATROSKA_ContextTrackMaxBlockAdditionID.Id)
-			track.MaxBlockAdditionID = (size_t)EBML_IntegerValue(Elt);
-		else if (Elt->Context->Id == MATROSKA_ContextTrackLanguage.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextMaxBlockAdditionID.Id)
+			track.MaxBlockAdditionID = (size_t)EBML_IntegerValue((ebml_integer*)Elt);
+		else if (Elt->Context->Id == MATROSKA_ContextLanguage.Id)
 		{
 			size_t copy = (Elt->DataSize>3) ? 3 : (size_t)Elt->DataSize;
 			memcpy(track.Language,((ebml_string*)Elt)->Buffer,copy);
 			memset(track.Language + copy,0,4-copy);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackCodecID.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextCodecID.Id)
 		{
 			track.CodecID = File->Input->io->memalloc(File->Input->io, (size_t)(Elt->DataSize+1));
 			strcpy(track.CodecID,((ebml_string*)Elt)->Buffer);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackCodecPrivate.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextCodecPrivate.Id)
 		{
 			if (Elt->DataSize > 256*1024)
 			{
-				snprintf(err_msg,err_msgSize,"CodecPrivate is too large: %d",(int)EBML_IntegerValue(Elt));
+				snprintf(err_msg,err_msgSize,"CodecPrivate is too large: %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 				goto fail;
 			}
 			track.CodecPrivateSize = (size_t)(Elt->DataSize);
@@ -431,165 +533,165 @@ static bool_t parseTrackEntry(ebml_element *Track, MatroskaFile *File, char *err
 		}
 		else if (Elt->Context->Id == MATROSKA_ContextTrackOverlay.Id)
 		{
-			if (EBML_IntegerValue(Elt)==0 || EBML_IntegerValue(Elt)>254)
+			if (EBML_IntegerValue((ebml_integer*)Elt)==0 || EBML_IntegerValue((ebml_integer*)Elt)>254)
 			{
-				snprintf(err_msg,err_msgSize,"Track number in TrackOverlay is too large: %d",(int)EBML_IntegerValue(Elt));
+				snprintf(err_msg,err_msgSize,"Track number in TrackOverlay is too large: %d",(int)EBML_IntegerValue((ebml_integer*)Elt));
 				goto fail;
 			}
-			track.TrackOverlay = (uint8_t)EBML_IntegerValue(Elt);
+			track.TrackOverlay = (uint8_t)EBML_IntegerValue((ebml_integer*)Elt);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackVideo.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextVideo.Id)
 		{
 			for (TElt = EBML_MasterChildren(Elt);TElt;TElt = EBML_MasterNext(TElt))
 			{
-				if (TElt->Context->Id == MATROSKA_ContextTrackVideoInterlaced.Id)
-					track.AV.Video.Interlaced = EBML_IntegerValue(TElt)!=0;
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoStereo.Id)
+				if (TElt->Context->Id == MATROSKA_ContextFlagInterlaced.Id)
+					track.AV.Video.Interlaced = EBML_IntegerValue((ebml_integer*)TElt)!=0;
+				else if (TElt->Context->Id == MATROSKA_ContextStereoMode.Id)
 				{
 					if (TElt->DataSize > 3)
 					{
-						snprintf(err_msg,err_msgSize,"Invalid stereo mode: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"Invalid stereo mode: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.StereoMode = (uint8_t)EBML_IntegerValue(TElt);
+					track.AV.Video.StereoMode = (uint8_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoPixelWidth.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextPixelWidth.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"PixelWidth is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"PixelWidth is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.PixelWidth = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.PixelWidth = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 					if (!track.AV.Video.DisplayWidth)
 						track.AV.Video.DisplayWidth = track.AV.Video.PixelWidth;
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoPixelHeight.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextPixelHeight.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"PixelHeight is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"PixelHeight is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.PixelHeight = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.PixelHeight = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 					if (!track.AV.Video.DisplayHeight)
 						track.AV.Video.DisplayHeight = track.AV.Video.PixelHeight;
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoDisplayWidth.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextDisplayWidth.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"DisplayWidth is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"DisplayWidth is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.DisplayWidth = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.DisplayWidth = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoDisplayHeight.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextDisplayHeight.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"DisplayHeight is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"DisplayHeight is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.DisplayHeight = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.DisplayHeight = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoDisplayUnit.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextDisplayUnit.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 2)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 2)
 					{
-						snprintf(err_msg,err_msgSize,"DisplayUnit is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"DisplayUnit is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.DisplayUnit = (uint8_t)EBML_IntegerValue(TElt);
+					track.AV.Video.DisplayUnit = (uint8_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoDisplayUnit.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextDisplayUnit.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 2)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 2)
 					{
-						snprintf(err_msg,err_msgSize,"AspectRatioType is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"AspectRatioType is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.AspectRatioType = (uint8_t)EBML_IntegerValue(TElt);
+					track.AV.Video.AspectRatioType = (uint8_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoPixelCropBottom.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextPixelCropBottom.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"PixelCropBottom is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"PixelCropBottom is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.CropB = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.CropB = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoPixelCropTop.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextPixelCropTop.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"PixelCropTop is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"PixelCropTop is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.CropT = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.CropT = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoPixelCropLeft.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextPixelCropLeft.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"PixelCropLeft is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"PixelCropLeft is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.CropL = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.CropL = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoPixelCropRight.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextPixelCropRight.Id)
 				{
-					if (EBML_IntegerValue(TElt) > 0xFFFFFFFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt) > 0xFFFFFFFF)
 					{
-						snprintf(err_msg,err_msgSize,"PixelCropRight is too large: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"PixelCropRight is too large: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Video.CropR = (uint32_t)EBML_IntegerValue(TElt);
+					track.AV.Video.CropR = (uint32_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoColourSpace.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextColourSpace.Id)
 				{
 					if (TElt->DataSize != 4)
 					{
-						snprintf(err_msg,err_msgSize,"ColourSpace is too large: %d",TElt->DataSize);
+						snprintf(err_msg,err_msgSize,"ColourSpace is too large: %d",(int)TElt->DataSize);
 						goto fail;
 					}
 					track.AV.Video.ColourSpace = LOAD32LE(EBML_BinaryGetData((ebml_binary*)TElt));
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackVideoGammaValue.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextGammaValue.Id)
 					track.AV.Video.GammaValue = (float)((ebml_float*)TElt)->Value;
 			}
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTrackAudio.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextAudio.Id)
 		{
-			track.AV.Audio.Channels = (uint8_t)MATROSKA_ContextTrackAudioChannels.DefaultValue;
-			track.AV.Audio.SamplingFreq = (float)MATROSKA_ContextTrackAudioSamplingFreq.DefaultValue;
+			track.AV.Audio.Channels = (uint8_t)MATROSKA_ContextChannels.DefaultValue;
+			track.AV.Audio.SamplingFreq = (float)MATROSKA_ContextSamplingFrequency.DefaultValue;
 
 			for (TElt = EBML_MasterChildren(Elt);TElt;TElt = EBML_MasterNext(TElt))
 			{
-				if (TElt->Context->Id == MATROSKA_ContextTrackAudioSamplingFreq.Id)
+				if (TElt->Context->Id == MATROSKA_ContextSamplingFrequency.Id)
 				{
 					track.AV.Audio.SamplingFreq = (float)((ebml_float*)TElt)->Value;
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackAudioOutputSamplingFreq.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextOutputSamplingFrequency.Id)
 					track.AV.Audio.OutputSamplingFreq = (float)((ebml_float*)TElt)->Value;
-				else if (TElt->Context->Id == MATROSKA_ContextTrackAudioChannels.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextChannels.Id)
 				{
-					if (EBML_IntegerValue(TElt)==0 || EBML_IntegerValue(TElt)>0xFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt)==0 || EBML_IntegerValue((ebml_integer*)TElt)>0xFF)
 					{
-						snprintf(err_msg,err_msgSize,"Invalid Channels value: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"Invalid Channels value: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Audio.Channels = (uint8_t)EBML_IntegerValue(TElt);
+					track.AV.Audio.Channels = (uint8_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
-				else if (TElt->Context->Id == MATROSKA_ContextTrackAudioBitDepth.Id)
+				else if (TElt->Context->Id == MATROSKA_ContextBitDepth.Id)
 				{
-					if (EBML_IntegerValue(TElt)==0 || EBML_IntegerValue(TElt)>0xFF)
+					if (EBML_IntegerValue((ebml_integer*)TElt)==0 || EBML_IntegerValue((ebml_integer*)TElt)>0xFF)
 					{
-						snprintf(err_msg,err_msgSize,"Invalid BitDepth value: %d",(int)EBML_IntegerValue(TElt));
+						snprintf(err_msg,err_msgSize,"Invalid BitDepth value: %d",(int)EBML_IntegerValue((ebml_integer*)TElt));
 						goto fail;
 					}
-					track.AV.Audio.BitDepth = (uint8_t)EBML_IntegerValue(TElt);
+					track.AV.Audio.BitDepth = (uint8_t)EBML_IntegerValue((ebml_integer*)TElt);
 				}
 			}
 			if (!track.AV.Audio.OutputSamplingFreq)
@@ -611,7 +713,7 @@ static bool_t parseTrackEntry(ebml_element *Track, MatroskaFile *File, char *err
         {
             if (Tracks->UID == track.UID)
             {
-                snprintf(err_msg,err_msgSize,"A track with UID 0x" PRIx64 " already exists",track.UID);
+                snprintf(err_msg,err_msgSize,"A track with UID 0x%" PRIx64 " already exists",track.UID);
                 goto fail;
             }
         }
@@ -629,6 +731,8 @@ static bool_t parseTracks(ebml_element *Tracks, MatroskaFile *File, char *err_ms
 {
 	ebml_parser_context RContext;
 	ebml_element *Elt;
+	const TrackInfo *Track;
+	size_t Index, Count;
 
 	RContext.Context = Tracks->Context;
 	if (EBML_ElementIsFiniteSize(Tracks))
@@ -636,7 +740,7 @@ static bool_t parseTracks(ebml_element *Tracks, MatroskaFile *File, char *err_ms
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
     RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(Tracks,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(Tracks,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the Tracks",err_msgSize);
 		File->pTracks = INVALID_FILEPOS_T;
@@ -652,6 +756,23 @@ static bool_t parseTracks(ebml_element *Tracks, MatroskaFile *File, char *err_ms
 	}
 	File->TrackList = Tracks;
 
+	// direct lookup of the track index from the number in the Blocks
+	ArrayClear(&File->TrackIndex);
+	for (Index=0, Track=ARRAYBEGIN(File->Tracks,TrackInfo);Track!=ARRAYEND(File->Tracks,TrackInfo);++Track,++Index)
+	{
+		if (Track->Number <= 0 || Track->Number > MAX_TRACK_NUMBER)
+			continue;
+		Count = ARRAYCOUNT(File->TrackIndex,uint16_t);
+		if ((size_t)Track->Number >= Count)
+		{
+			if (!ArrayResize(&File->TrackIndex,(Track->Number+1)*sizeof(uint16_t),0))
+				break;
+			memset(ARRAYBEGIN(File->TrackIndex,uint16_t)+Count,0,(Track->Number+1-Count)*sizeof(uint16_t));
+		}
+		if (!ARRAYBEGIN(File->TrackIndex,uint16_t)[Track->Number])
+			ARRAYBEGIN(File->TrackIndex,uint16_t)[Track->Number] = (uint16_t)(Index+1);
+	}
+
 	return 1;
 }
 
@@ -665,13 +786,14 @@ static bool_t parseCues(ebml_element *Cues, MatroskaFile *File, char *err_msg, s
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
     RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(Cues,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(Cues,(stream*)File->Input,&RContext,1,SCOPE_PACKED_LEAVES,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the Cues",err_msgSize);
 		File->pCues = INVALID_FILEPOS_T;
 		return 0;
 	}
 	File->pCues = Cues->ElementPosition;
+	// the CueTime and CueTrackPositions leaves are created when the CuePoints are walked, even through const pointers
 	File->CueList = Cues;
 
 	return 1;
@@ -690,7 +812,7 @@ static bool_t parseAttachments(ebml_element *Attachments, MatroskaFile *File, ch
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
     RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(Attachments,(stream*)File->Input,&RContext,1,SCOPE_PARTIAL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(Attachments,(stream*)File->Input,&RContext,1,SCOPE_PARTIAL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the Attachments",err_msgSize);
 		File->pAttachments = INVALID_FILEPOS_T;
@@ -699,40 +821,40 @@ static bool_t parseAttachments(ebml_element *Attachments, MatroskaFile *File, ch
 	File->pAttachments = Attachments->ElementPosition;
 
     Count=0;
-    Elt = EBML_MasterFindFirstElt(Attachments, &MATROSKA_ContextAttachedFile, 0,0);
+    Elt = EBML_MasterFindFirstElt((ebml_master*)Attachments, &MATROSKA_ContextAttachedFile, 0,0);
     while (Elt)
     {
         ++Count;
-        Elt = EBML_MasterFindNextElt(Attachments, Elt, 0,0);
+        Elt = EBML_MasterFindNextElt((ebml_master*)Attachments, Elt, 0,0);
     }
     ArrayResize(&File->Attachments,Count*sizeof(Attachment),0);
     ArrayZero(&File->Attachments);
 
-    for (Elt = EBML_MasterFindFirstElt(Attachments, &MATROSKA_ContextAttachedFile, 0,0),At=ARRAYBEGIN(File->Attachments,Attachment);
-        At!=ARRAYEND(File->Attachments,Attachment); ++At, Elt = EBML_MasterFindNextElt(Attachments, Elt, 0,0))
+    for (Elt = EBML_MasterFindFirstElt((ebml_master*)Attachments, &MATROSKA_ContextAttachedFile, 0,0),At=ARRAYBEGIN(File->Attachments,Attachment);
+        At!=ARRAYEND(File->Attachments,Attachment); ++At, Elt = EBML_MasterFindNextElt((ebml_master*)Attachments, Elt, 0,0))
     {
         At->Length = INVALID_FILEPOS_T;
         At->Position = INVALID_FILEPOS_T;
         for (Elt2=EBML_MasterChildren(Elt);Elt2;Elt2=EBML_MasterNext(Elt2))
         {
-            if (Elt2->Context->Id == MATROSKA_ContextAttachedFileName.Id)
+            if (Elt2->Context->Id == MATROSKA_ContextFileName.Id)
             {
                 At->Name = File->Input->io->memalloc(File->Input->io, (size_t)(Elt2->DataSize+1));
 			    strcpy(At->Name,((ebml_string*)Elt2)->Buffer);
             }
-            else if (Elt2->Context->Id == MATROSKA_ContextAttachedFileData.Id)
+            else if (Elt2->Context->Id == MATROSKA_ContextFileData.Id)
             {
                 At->Position = EBML_ElementPositionData(Elt2);
                 At->Length = Elt2->DataSize;
             }
-            else if (Elt2->Context->Id == MATROSKA_ContextAttachedFileUID.Id)
-                At->UID = EBML_IntegerValue(Elt2);
-            else if (Elt2->Context->Id == MATROSKA_ContextAttachedFileMimeType.Id)
+            else if (Elt2->Context->Id == MATROSKA_ContextFileUID.Id)
+                At->UID = EBML_IntegerValue((ebml_integer*)Elt2);
+            else if (Elt2->Context->Id == MATROSKA_ContextFileMimeType.Id)
             {
                 At->MimeType = File->Input->io->memalloc(File->Input->io, (size_t)(Elt2->DataSize+1));
 			    strcpy(At->MimeType,((ebml_string*)Elt2)->Buffer);
             }
-            else if (Elt2->Context->Id == MATROSKA_ContextAttachedFileDescription.Id)
+            else if (Elt2->Context->Id == MATROSKA_ContextFileDescription.Id)
             {
                 At->Description = File->Input->io->memalloc(File->Input->io, (size_t)(Elt2->DataSize+1));
 			    strcpy(At->Description,((ebml_string*)Elt2)->Buffer);
@@ -752,22 +874,22 @@ static bool_t addChapterDisplay(ebml_element *ChapterDisplay, MatroskaFile *File
 		return 0;
 	pDisplay = ARRAYEND(Chapter->aDisplays,struct ChapterDisplay)-1;
 	memset(pDisplay,0,sizeof(*pDisplay));
-	memcpy(pDisplay->Language, (char*)MATROSKA_ContextChapterLanguage.DefaultValue, 4);
+	memcpy(pDisplay->Language, (char*)MATROSKA_ContextChapLanguage.DefaultValue, 4);
 
 	for (Elt=EBML_MasterChildren(ChapterDisplay); Elt; Elt=EBML_MasterNext(Elt))
 	{
-		if (Elt->Context->Id == MATROSKA_ContextChapterString.Id)
+		if (Elt->Context->Id == MATROSKA_ContextChapString.Id)
 		{
 			pDisplay->String = File->Input->io->memalloc(File->Input->io, (size_t)(Elt->DataSize+1));
 			strcpy(pDisplay->String,((ebml_string*)Elt)->Buffer);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextChapterLanguage.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextChapLanguage.Id)
 		{
 			size_t copy = (Elt->DataSize>3) ? 3 : (size_t)Elt->DataSize;
 			memcpy(pDisplay->Language,((ebml_string*)Elt)->Buffer,copy);
 			memset(pDisplay->Language + copy,0,4-copy);
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextChapterCountry.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextChapCountry.Id)
 		{
 			size_t copy = (Elt->DataSize>3) ? 3 : (size_t)Elt->DataSize;
 			memcpy(pDisplay->Country,((ebml_string*)Elt)->Buffer,copy);
@@ -798,26 +920,26 @@ static bool_t parseChapter(ebml_element *Chapter, MatroskaFile *File, char *err_
 		}
 		// Atom
 		else if (Elt->Context->Id == MATROSKA_ContextChapterUID.Id)
-			Parent->UID = EBML_IntegerValue(Elt);
+			Parent->UID = EBML_IntegerValue((ebml_integer*)Elt);
 		else if (Elt->Context->Id == MATROSKA_ContextChapterTimeStart.Id)
-			Parent->Start = EBML_IntegerValue(Elt);
+			Parent->Start = EBML_IntegerValue((ebml_integer*)Elt);
 		else if (Elt->Context->Id == MATROSKA_ContextChapterTimeEnd.Id)
-			Parent->End = EBML_IntegerValue(Elt);
-		else if (Elt->Context->Id == MATROSKA_ContextChapterHidden.Id)
-			Parent->Hidden = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextChapterEnabled.Id)
-			Parent->Enabled = EBML_IntegerValue(Elt)!=0;
+			Parent->End = EBML_IntegerValue((ebml_integer*)Elt);
+		else if (Elt->Context->Id == MATROSKA_ContextChapterFlagHidden.Id)
+			Parent->Hidden = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextChapterFlagEnabled.Id)
+			Parent->Enabled = EBML_IntegerValue((ebml_integer*)Elt)!=0;
 		else if (Elt->Context->Id == MATROSKA_ContextChapterDisplay.Id)
 			addChapterDisplay(Elt, File, Parent);
 		// Edition
 		else if (Elt->Context->Id == MATROSKA_ContextEditionUID.Id)
-			Parent->UID = EBML_IntegerValue(Elt);
-		else if (Elt->Context->Id == MATROSKA_ContextEditionHidden.Id)
-			Parent->Hidden = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextEditionDefault.Id)
-			Parent->Default = EBML_IntegerValue(Elt)!=0;
-		else if (Elt->Context->Id == MATROSKA_ContextEditionOrdered.Id)
-			Parent->Ordered = EBML_IntegerValue(Elt)!=0;
+			Parent->UID = EBML_IntegerValue((ebml_integer*)Elt);
+		else if (Elt->Context->Id == MATROSKA_ContextEditionFlagHidden.Id)
+			Parent->Hidden = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextEditionFlagDefault.Id)
+			Parent->Default = EBML_IntegerValue((ebml_integer*)Elt)!=0;
+		else if (Elt->Context->Id == MATROSKA_ContextEditionFlagOrdered.Id)
+			Parent->Ordered = EBML_IntegerValue((ebml_integer*)Elt)!=0;
 	}
 
 	Parent->nChildren = ARRAYCOUNT(Parent->aChildren,struct Chapter);
@@ -840,7 +962,7 @@ static bool_t parseChapters(ebml_element *Chapters, MatroskaFile *File, char *er
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
     RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(Chapters,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(Chapters,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the Chapters",err_msgSize);
 		File->pChapters = INVALID_FILEPOS_T;
@@ -851,12 +973,12 @@ static bool_t parseChapters(ebml_element *Chapters, MatroskaFile *File, char *er
 	pChapter = &Chap;
 	memset(pChapter,0,sizeof(*pChapter));
 	Chap.Start = INVALID_TIMECODE_T;
-	Chap.Ordered = MATROSKA_ContextEditionOrdered.DefaultValue;
-	Chap.Hidden = MATROSKA_ContextEditionHidden.DefaultValue;
-	Chap.Default = MATROSKA_ContextEditionDefault.DefaultValue;
+	Chap.Ordered = MATROSKA_ContextEditionFlagOrdered.DefaultValue;
+	Chap.Hidden = MATROSKA_ContextEditionFlagHidden.DefaultValue;
+	Chap.Default = MATROSKA_ContextEditionFlagDefault.DefaultValue;
 	for (Elt=EBML_MasterChildren(Chapters); Elt; Elt=EBML_MasterNext(Elt))
 	{
-		if (Elt->Context->Id == MATROSKA_ContextChapterEntry.Id)
+		if (Elt->Context->Id == MATROSKA_ContextEditionEntry.Id)
 		{
 			if (!ArrayAppend(&File->Chapters,&Chap,sizeof(Chap),512))
 				return 0;
@@ -875,50 +997,50 @@ static bool_t parseTargets(ebml_element *Targets, MatroskaFile *File, char *err_
 	uint8_t Level;
 	struct Target *pTarget,Target;
 
-	Elt = EBML_MasterFindFirstElt(Targets, &MATROSKA_ContextTagTargetTypeValue, 1, 1);
-	if (!Elt || EBML_IntegerValue(Elt) > 0xFF)
+	Elt = EBML_MasterFindFirstElt((ebml_master*)Targets, &MATROSKA_ContextTargetTypeValue, 1, 1);
+	if (!Elt || EBML_IntegerValue((ebml_integer*)Elt) > 0xFF)
 		return 0;
 
-	Level = (uint8_t)EBML_IntegerValue(Elt);
+	Level = (uint8_t)EBML_IntegerValue((ebml_integer*)Elt);
 
 	pTarget = &Target;
 	memset(pTarget,0,sizeof(*pTarget));
 	for (Elt=EBML_MasterChildren(Targets); Elt; Elt=EBML_MasterNext(Elt))
 	{
-		if (Elt->Context->Id == MATROSKA_ContextTagTargetTrackUID.Id)
+		if (Elt->Context->Id == MATROSKA_ContextTagTrackUID.Id)
 		{
 			if (!ArrayAppend(&Parent->aTargets,&Target,sizeof(Target),512))
 				return 0;
 			pTarget = ARRAYEND(Parent->aTargets,struct Target)-1;
 			pTarget->Type = TARGET_TRACK;
-			pTarget->UID = EBML_IntegerValue(Elt);
+			pTarget->UID = EBML_IntegerValue((ebml_integer*)Elt);
 			pTarget->Level = Level;
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTagTargetChapterUID.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextTagChapterUID.Id)
 		{
 			if (!ArrayAppend(&Parent->aTargets,&Target,sizeof(Target),512))
 				return 0;
 			pTarget = ARRAYEND(Parent->aTargets,struct Target)-1;
 			pTarget->Type = TARGET_CHAPTER;
-			pTarget->UID = EBML_IntegerValue(Elt);
+			pTarget->UID = EBML_IntegerValue((ebml_integer*)Elt);
 			pTarget->Level = Level;
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTagTargetAttachmentUID.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextTagAttachmentUID.Id)
 		{
 			if (!ArrayAppend(&Parent->aTargets,&Target,sizeof(Target),512))
 				return 0;
 			pTarget = ARRAYEND(Parent->aTargets,struct Target)-1;
 			pTarget->Type = TARGET_ATTACHMENT;
-			pTarget->UID = EBML_IntegerValue(Elt);
+			pTarget->UID = EBML_IntegerValue((ebml_integer*)Elt);
 			pTarget->Level = Level;
 		}
-		else if (Elt->Context->Id == MATROSKA_ContextTagTargetEditionUID.Id)
+		else if (Elt->Context->Id == MATROSKA_ContextTagEditionUID.Id)
 		{
 			if (!ArrayAppend(&Parent->aTargets,&Target,sizeof(Target),512))
 				return 0;
 			pTarget = ARRAYEND(Parent->aTargets,struct Target)-1;
 			pTarget->Type = TARGET_EDITION;
-			pTarget->UID = EBML_IntegerValue(Elt);
+			pTarget->UID = EBML_IntegerValue((ebml_integer*)Elt);
 			pTarget->Level = Level;
 		}
 	}
@@ -953,7 +1075,7 @@ static bool_t parseSimpleTag(ebml_element *SimpleTag, MatroskaFile *File, char *
 			memset(simpleTag.Language + copy,0,4-copy);
 		}
 		else if (Elt->Context->Id == MATROSKA_ContextTagString.Id)
-			simpleTag.Default = EBML_IntegerValue(Elt)!=0;
+			simpleTag.Default = EBML_IntegerValue((ebml_integer*)Elt)!=0;
 	}
 	
 	if (!simpleTag.Value || !simpleTag.Name || !ArrayAppend(&Parent->aSimpleTags,&simpleTag,sizeof(simpleTag),256))
@@ -963,11 +1085,11 @@ static bool_t parseSimpleTag(ebml_element *SimpleTag, MatroskaFile *File, char *
 		return 0;
 	}
 
-	Elt = EBML_MasterFindFirstElt(SimpleTag, &MATROSKA_ContextSimpleTag, 0, 0);
+	Elt = EBML_MasterFindFirstElt((ebml_master*)SimpleTag, &MATROSKA_ContextSimpleTag, 0, 0);
 	while (Elt)
 	{
 		parseSimpleTag(Elt, File, err_msg, err_msgSize, Parent);
-		Elt = EBML_MasterFindNextElt(SimpleTag, Elt, 0, 0);
+		Elt = EBML_MasterFindNextElt((ebml_master*)SimpleTag, Elt, 0, 0);
 	}
 
 	return 1;
@@ -979,7 +1101,7 @@ static bool_t parseTag(ebml_element *Tag, MatroskaFile *File, char *err_msg, siz
 
 	for (Elt=EBML_MasterChildren(Tag); Elt; Elt=EBML_MasterNext(Elt))
 	{
-		if (Elt->Context->Id == MATROSKA_ContextTagTargets.Id)
+		if (Elt->Context->Id == MATROSKA_ContextTargets.Id)
 			parseTargets(Elt,File,err_msg,err_msgSize,Parent);
 		else if (Elt->Context->Id == MATROSKA_ContextSimpleTag.Id)
 			parseSimpleTag(Elt,File,err_msg,err_msgSize,Parent);
@@ -1005,7 +1127,7 @@ static bool_t parseTags(ebml_element *Tags, MatroskaFile *File, char *err_msg, s
 	else
 		RContext.EndPosition = INVALID_FILEPOS_T;
     RContext.UpContext = &File->L1Context;
-	if (EBML_ElementReadData(Tags,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(Tags,(stream*)File->Input,&RContext,1,SCOPE_ALL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the Tags",err_msgSize);
 		File->pTags = INVALID_FILEPOS_T;
@@ -1031,6 +1153,115 @@ static bool_t parseTags(ebml_element *Tags, MatroskaFile *File, char *err_msg, s
 	return 1;
 }
 
+// remember where a section read on first use is
+static void locateSection(MatroskaFile *File, const ebml_element *Elt)
+{
+	if (Elt->Context->Id == MATROSKA_ContextCues.Id && File->pCues==INVALID_FILEPOS_T)
+		File->pCues = Elt->ElementPosition;
+	else if (Elt->Context->Id == MATROSKA_ContextAttachments.Id && File->pAttachments==INVALID_FILEPOS_T)
+		File->pAttachments = Elt->ElementPosition;
+	else if (Elt->Context->Id == MATROSKA_ContextChapters.Id && File->pChapters==INVALID_FILEPOS_T)
+		File->pChapters = Elt->ElementPosition;
+	else if (Elt->Context->Id == MATROSKA_ContextTags.Id && File->pTags==INVALID_FILEPOS_T)
+		File->pTags = Elt->ElementPosition;
+}
+
+// look for the sections after the first Cluster that the SeekHead doesn't list
+static void locateSections(MatroskaFile *File)
+{
+	ebml_element *Head, *Elt;
+	int UpperLevel = 0;
+
+	File->Input->io->ioseek(File->Input->io,File->pResume,SEEK_SET);
+	File->pResume = INVALID_FILEPOS_T;
+	Head = EBML_FindNextElement((stream*)File->Input,&File->L1Context,&UpperLevel,0);
+	while (Head && (!EBML_ElementIsFiniteSize(File->Segment) || EBML_ElementPositionEnd(File->Segment) >= EBML_ElementPositionEnd(Head)))
+	{
+		locateSection(File, Head);
+		Elt = EBML_ElementSkipData(Head,(stream*)File->Input,&File->L1Context,NULL,1);
+		NodeDelete((node*)Head);
+		Head = Elt ? Elt : EBML_FindNextElement((stream*)File->Input,&File->L1Context,&UpperLevel,0);
+	}
+	if (Head)
+		NodeDelete((node*)Head);
+}
+
+static void loadSection(MatroskaFile *File, int Section)
+{
+	ebml_element *Head, *Elt;
+	filepos_t Pos, Current;
+	fourcc_t Id;
+	char *err_msg = sectionError(File,Section);
+	int UpperLevel = 0;
+
+	File->LastSection = Section;
+	if (File->Loaded & Section)
+		return;
+	File->Loaded |= Section;
+
+	Current = File->Input->io->iotell(File->Input->io);
+	for (;;)
+	{
+		switch (Section)
+		{
+		case LOAD_CUES:        Pos = File->pCues;        Id = MATROSKA_ContextCues.Id; break;
+		case LOAD_ATTACHMENTS: Pos = File->pAttachments; Id = MATROSKA_ContextAttachments.Id; break;
+		case LOAD_CHAPTERS:    Pos = File->pChapters;    Id = MATROSKA_ContextChapters.Id; break;
+		default:               Pos = File->pTags;        Id = MATROSKA_ContextTags.Id; break;
+		}
+		if (Pos!=INVALID_FILEPOS_T || File->pResume==INVALID_FILEPOS_T)
+			break;
+		locateSections(File);
+	}
+
+	if (Pos!=INVALID_FILEPOS_T)
+	{
+		File->Input->io->ioseek(File->Input->io,Pos,SEEK_SET);
+		Head = EBML_FindNextElement((stream*)File->Input,&File->L1Context,&UpperLevel,0);
+		if (Head && Head->Context->Id != Id)
+		{
+			NodeDelete((node*)Head);
+			Head = NULL;
+		}
+		if (!Head)
+			snprintf(err_msg,sizeof(File->err_msg[0]),"No element 0x%X at position %" PRId64,(unsigned int)Id,(int64_t)Pos);
+		else
+		{
+			switch (Section)
+			{
+			case LOAD_CUES:
+				if (!parseCues(Head, File, err_msg, sizeof(File->err_msg[0])))
+					NodeDelete((node*)Head);
+				else if (File->SegmentInfo)
+				{
+					for (Elt = EBML_MasterChildren(File->CueList);Elt;Elt = EBML_MasterNext(Elt))
+					{
+						if (Elt->Context->Id == MATROSKA_ContextCuePoint.Id)
+							MATROSKA_LinkCueSegmentInfo((matroska_cuepoint*)Elt,(ebml_master*)File->SegmentInfo);
+					}
+
+					MATROSKA_CuesSort((ebml_master*)File->CueList);
+					MATROSKA_CueIndexBuild(&File->CueIndex,(ebml_master*)File->CueList);
+				}
+				break;
+			case LOAD_ATTACHMENTS:
+				parseAttachments(Head, File, err_msg, sizeof(File->err_msg[0]));
+				NodeDelete((node*)Head);
+				break;
+			case LOAD_CHAPTERS:
+				parseChapters(Head, File, err_msg, sizeof(File->err_msg[0]));
+				NodeDelete((node*)Head);
+				break;
+			default:
+				parseTags(Head, File, err_msg, sizeof(File->err_msg[0]));
+				NodeDelete((node*)Head);
+				break;
+			}
+		}
+	}
+	File->Input->io->ioseek(File->Input->io,Current,SEEK_SET);
+}
+
 MatroskaFile *mkv_Open(InputStream *io, char *err_msg, size_t err_msgSize)
 {
 	int UpperLevel;
@@ -1051,6 +1282,7 @@ MatroskaFile *mkv_Open(InputStream *io, char *err_msg, size_t err_msgSize)
 	File->pChapters = INVALID_FILEPOS_T;
 	File->pTags = INVALID_FILEPOS_T;
 	File->pFirstCluster = INVALID_FILEPOS_T;
+	File->pResume = INVALID_FILEPOS_T;
 
 	io->progress(io,0,0);
 	io->ioseek(io,0,SEEK_SET);
@@ -1081,7 +1313,7 @@ MatroskaFile *mkv_Open(InputStream *io, char *err_msg, size_t err_msgSize)
 		return NULL;
 	}
 
-	if (EBML_ElementReadData(Head,(stream*)File->Input,&File->L0Context,1,SCOPE_ALL_DATA)!=ERR_NONE)
+	if (EBML_ElementReadData(Head,(stream*)File->Input,&File->L0Context,1,SCOPE_ALL_DATA,0)!=ERR_NONE)
 	{
 		strncpy(err_msg,"Failed to read the EBML head",err_msgSize);
 		NodeDelete((node*)Head);
@@ -1117,31 +1349,25 @@ MatroskaFile *mkv_Open(InputStream *io, char *err_msg, size_t err_msgSize)
 			parseSeekHead(Head, File, err_msg, err_msgSize);
 			NodeDelete((node*)Head);
 		}
-		else if (Head->Context->Id == MATROSKA_ContextSegmentInfo.Id)
+		else if (Head->Context->Id == MATROSKA_ContextInfo.Id)
 			parseSegmentInfo(Head, File, err_msg, err_msgSize);
 		else if (Head->Context->Id == MATROSKA_ContextTracks.Id)
 			parseTracks(Head, File, err_msg, err_msgSize);
-		else if (Head->Context->Id == MATROSKA_ContextCues.Id)
-			parseCues(Head, File, err_msg, err_msgSize);
-		else if (Head->Context->Id == MATROSKA_ContextAttachments.Id)
-        {
-			parseAttachments(Head, File, err_msg, err_msgSize);
-			NodeDelete((node*)Head);
-		}
-		else if (Head->Context->Id == MATROSKA_ContextChapters.Id)
+		else if (Head->Context->Id==MATROSKA_ContextCluster.Id && File->SegmentInfo && File->TrackList)
 		{
-			parseChapters(Head, File, err_msg, err_msgSize);
-			NodeDelete((node*)Head);
-		}
-		else if (Head->Context->Id == MATROSKA_ContextTags.Id)
-		{
-			parseTags(Head, File, err_msg, err_msgSize);
+			// the other sections are read when they are needed
+			File->pFirstCluster = Head->ElementPosition;
+			File->pResume = Head->ElementPosition;
 			NodeDelete((node*)Head);
+			File->Input->io->ioseek(File->Input->io,File->pFirstCluster,SEEK_SET);
+			break;
 		}
 		else
 		{
 			if (Head->Context->Id==MATROSKA_ContextCluster.Id && File->pFirstCluster==INVALID_FILEPOS_T)
 				File->pFirstCluster = Head->ElementPosition;
+			else
+				locateSection(File, Head);
 			Elt = EBML_ElementSkipData(Head,(stream*)File->Input,&File->L1Context,NULL,1);
 			NodeDelete((node*)Head);
 			if (Elt)
@@ -1153,17 +1379,6 @@ MatroskaFile *mkv_Open(InputStream *io, char *err_msg, size_t err_msgSize)
 		Head = EBML_FindNextElement((stream*)File->Input,&File->L1Context,&UpperLevel,0);
 	}
 
-	if (File->CueList && File->SegmentInfo)
-	{
-		for (Elt = EBML_MasterChildren(File->CueList);Elt;Elt = EBML_MasterNext(Elt))
-		{
-			if (Elt->Context->Id == MATROSKA_ContextCuePoint.Id)
-				MATROSKA_LinkCueSegmentInfo((matroska_cuepoint*)Elt, File->SegmentInfo);
-		}
-
-		MATROSKA_CuesSort(File->CueList);
-	}
-
 	return File;
 }
 
@@ -1227,6 +1442,9 @@ static void releaseTags(array *Tags, MatroskaFile *File)
 
 void mkv_Close(MatroskaFile *File)
 {
+	InputStream *io = File->Input->io;
+	TrackInfo *Track;
+
 	if (File->Seg.Filename) File->Input->io->memfree(File->Input->io, File->Seg.Filename);
 	if (File->Seg.PrevFilename) File->Input->io->memfree(File->Input->io, File->Seg.PrevFilename);
 	if (File->Seg.NextFilename) File->Input->io->memfree(File->Input->io, File->Seg.NextFilename);
@@ -1234,36 +1452,308 @@ void mkv_Close(MatroskaFile *File)
 	if (File->Seg.MuxingApp) File->Input->io->memfree(File->Input->io, File->Seg.MuxingApp);
 	if (File->Seg.WritingApp) File->Input->io->memfree(File->Input->io, File->Seg.WritingApp);
 
+	for (Track=ARRAYBEGIN(File->Tracks,TrackInfo);Track!=ARRAYEND(File->Tracks,TrackInfo);++Track)
+		releaseTrackEntry(Track, io);
 	ArrayClear(&File->Tracks);
+	ArrayClear(&File->TrackIndex);
+	ArrayClear(&File->ClusterMap);
+	ArrayClear(&File->Frames);
+	ArrayClear(&File->BlockHead);
     releaseAttachments(&File->Attachments, File);
 	releaseChapters(&File->Chapters, File);
 	releaseTags(&File->Tags, File);
 
+	if (File->CurrentCluster) NodeDelete((node*)File->CurrentCluster);
 	if (File->TrackList) NodeDelete((node*)File->TrackList);
+	MATROSKA_CueIndexClear(&File->CueIndex);
 	if (File->CueList) NodeDelete((node*)File->CueList);
 	if (File->SegmentInfo) NodeDelete((node*)File->SegmentInfo);
 	if (File->Segment) NodeDelete((node*)File->Segment);
 	if (File->Input) NodeDelete((node*)File->Input);
+	io->memfree(io, File);
+}
+
+// read the ID and size of the element at Pos without creating it
+static bool_t readElementHead(MatroskaFile *File, filepos_t Pos, fourcc_t *Id, filepos_t *DataSize, filepos_t *DataPos)
+{
+	uint8_t *Head = File->ElementHead; // 4 bytes for the ID and 8 for the size at most
+	size_t IdLength, SizeLength;
+	filepos_t SizeUnknown;
+	int Read;
+
+	File->ElementHeadLength = File->ElementHeadRead = 0;
+	File->Input->io->ioseek(File->Input->io,Pos,SEEK_SET);
+	Read = File->Input->io->ioread(File->Input->io,Head,sizeof(File->ElementHead));
+	if (Read <= 0)
+		return 0;
+	for (IdLength=1;IdLength<=4 && !(Head[0] & (0x100 >> IdLength));++IdLength) {}
+	if (IdLength > 4 || (int)IdLength >= Read)
+		return 0;
+	*Id = EBML_BufferToID(Head);
+	SizeLength = Read - IdLength;
+	*DataSize = EBML_ReadCodedSizeValue(Head + IdLength,&SizeLength,&SizeUnknown);
+	if (!SizeLength)
+		return 0;
+	if (*DataSize == SizeUnknown)
+		*DataSize = INVALID_FILEPOS_T;
+	*DataPos = Pos + IdLength + SizeLength;
+	File->ElementHeadLength = IdLength + SizeLength;
+	File->ElementHeadRead = Read;
+	return 1;
+}
+
+// find the track of the Block starting at DataPos, from the bytes read with its head when possible
+static bool_t readBlockTrack(MatroskaFile *File, filepos_t DataPos, unsigned int *Track)
+{
+	uint8_t Data[2];
+	const uint8_t *Cursor = Data;
+	int TrackNum;
+
+	if (File->ElementHeadRead >= File->ElementHeadLength + 2)
+		Cursor = File->ElementHead + File->ElementHeadLength;
+	else
+	{
+		File->Input->io->ioseek(File->Input->io,DataPos,SEEK_SET);
+		if (File->Input->io->ioread(File->Input->io,Data,sizeof(Data)) != sizeof(Data))
+			return 0;
+	}
+
+	if (Cursor[0] & 0x80)
+		TrackNum = Cursor[0] & 0x7F;
+	else if (Cursor[0] & 0x40)
+		TrackNum = ((Cursor[0] & 0x3F) << 8) | Cursor[1];
+	else
+		return 0; // we don't support track numbers that large
+
+	if ((size_t)TrackNum >= ARRAYCOUNT(File->TrackIndex,uint16_t) || !ARRAYBEGIN(File->TrackIndex,uint16_t)[TrackNum])
+		return 0;
+	*Track = ARRAYBEGIN(File->TrackIndex,uint16_t)[TrackNum] - 1;
+	return 1;
+}
+
+// tell the caller the data of a masked track will not be read
+static void skipElement(MatroskaFile *File, filepos_t Pos, filepos_t End)
+{
+	if (File->Skipped)
+		File->Skipped(File->Input->io,Pos,End-Pos);
+}
+
+static bool_t readUInteger(MatroskaFile *File, filepos_t DataPos, filepos_t DataSize, int64_t *Value)
+{
+	uint8_t Data[8];
+	size_t i;
+
+	if (DataSize > 8)
+		return 0;
+	File->Input->io->ioseek(File->Input->io,DataPos,SEEK_SET);
+	if (File->Input->io->ioread(File->Input->io,Data,(int)DataSize) != (int)DataSize)
+		return 0;
+	*Value = 0;
+	for (i=0;i<(size_t)DataSize;++i)
+		*Value = (*Value << 8) | Data[i];
+	return 1;
+}
+
+// read the header and the lace sizes of a Block into the frames of the current Block
+static bool_t readBlock(MatroskaFile *File, filepos_t DataPos, filepos_t DataSize)
+{
+	const uint8_t *Head, *Cursor, *End;
+	mkv_frame *Frame;
+	size_t Loaded, Size;
+	filepos_t Value, SizeUnknown;
+	int16_t LocalTimecode;
+	uint8_t Lacing, Count;
+	TrackInfo *tr;
+	int64_t Remaining, FrameSize;
+	int Read;
+	unsigned int i;
+
+	Loaded = (size_t)min(DataSize,BLOCK_HEAD_READ);
+	for (;;)
+	{
+		if (!ArrayResize(&File->BlockHead,Loaded,0))
+			return 0;
+		File->Input->io->ioseek(File->Input->io,DataPos,SEEK_SET);
+		Read = File->Input->io->ioread(File->Input->io,ARRAYBEGIN(File->BlockHead,uint8_t),(int)Loaded);
+		if (Read < 4)
+			return 0;
+		Head = ARRAYBEGIN(File->BlockHead,uint8_t);
+		End = Head + Read;
+
+		// timecode after the track number already read
+		Cursor = Head + ((Head[0] & 0x80) ? 1 : 2);
+		if (Cursor + 3 > End)
+			return 0;
+		LocalTimecode = (int16_t)LOAD16BE(Cursor);
+		Cursor += 2;
+		if (File->BlockKeyframe == 2)
+			File->BlockKeyframe = (*Cursor & 0x80) != 0; // SimpleBlock
+		Lacing = (*Cursor++ & 0x06) >> 1;
+
+		tr = ARRAYBEGIN(File->Tracks,TrackInfo) + File->BlockTrack;
+		if (File->ClusterTimecode == INVALID_TIMECODE_T)
+			File->BlockTimecode = INVALID_TIMECODE_T;
+		else
+			File->BlockTimecode = File->ClusterTimecode + (timecode_t)(LocalTimecode * File->Seg.TimecodeScale * (double)tr->TimecodeScale);
+
+		Count = 0;
+		if (Lacing != LACING_NONE)
+		{
+			if (Cursor == End)
+				goto more;
+			Count = *Cursor++; // number of frames in the lace - 1
+		}
+		if (!ArrayResize(&File->Frames,(Count+1)*sizeof(mkv_frame),0))
+			return 0;
+		Frame = ARRAYBEGIN(File->Frames,mkv_frame);
+
+		// sizes of the laced frames, the last one gets what remains
+		switch (Lacing)
+		{
+		case LACING_XIPH:
+			for (i=0;i<Count;++i)
+			{
+				Frame[i].Size = 0;
+				do {
+					if (Cursor == End)
+						goto more;
+					Frame[i].Size += *Cursor;
+				} while (*Cursor++ == 0xFF);
+			}
+			break;
+		case LACING_EBML:
+			for (i=0;i<Count;++i)
+			{
+				Size = End - Cursor;
+				if (i==0)
+				{
+					Value = EBML_ReadCodedSizeValue(Cursor,&Size,&SizeUnknown);
+					FrameSize = Value;
+				}
+				else
+				{
+					Value = EBML_ReadCodedSizeSignedValue(Cursor,&Size,&SizeUnknown);
+					FrameSize = (int64_t)Frame[i-1].Size + Value;
+				}
+				if (!Size)
+					goto more;
+				if (FrameSize < 0 || FrameSize > DataSize)
+					return 0;
+				Frame[i].Size = (uint32_t)FrameSize;
+				Cursor += Size;
+			}
+			break;
+		case LACING_FIXED:
+			for (i=0;i<Count;++i)
+				Frame[i].Size = (uint32_t)((DataSize - (Cursor - Head)) / (Count + 1));
+			break;
+		}
+
+		Remaining = DataSize - (Cursor - Head);
+		for (i=0;i<Count;++i)
+		{
+			Frame[i].Position = DataPos + (Cursor - Head) + (DataSize - (Cursor - Head) - Remaining);
+			Remaining -= Frame[i].Size;
+		}
+		if (Remaining < 0)
+			return 0;
+		Frame[Count].Position = DataPos + DataSize - Remaining;
+		Frame[Count].Size = (uint32_t)Remaining;
+		File->CurrentFrame = 0;
+		return 1;
+
+more:
+		// the lace sizes don't fit in what was read
+		if (Loaded == (size_t)DataSize)
+			return 0;
+		Loaded = (size_t)min(DataSize,(filepos_t)Loaded*4);
+	}
+}
+
+// read the elements of the current Cluster until a Block of a selected track is found
+static bool_t readNextBlock(MatroskaFile *File)
+{
+	fourcc_t Id, SubId;
+	filepos_t DataPos, DataSize, SubPos, SubDataPos, SubDataSize, BlockDataPos, BlockDataSize;
+	int64_t Value;
+
+	ArrayDrop(&File->Frames);
+	File->CurrentFrame = 0;
+	while (File->ClusterEnd == INVALID_FILEPOS_T || File->ClusterPos < File->ClusterEnd)
+	{
+		if (!readElementHead(File,File->ClusterPos,&Id,&DataSize,&DataPos) || DataSize == INVALID_FILEPOS_T)
+			return 0;
+		if (File->ClusterEnd == INVALID_FILEPOS_T && (Id == MATROSKA_ContextCluster.Id || Id == MATROSKA_ContextCues.Id ||
+			Id == MATROSKA_ContextTags.Id || Id == MATROSKA_ContextChapters.Id || Id == MATROSKA_ContextAttachments.Id ||
+			Id == MATROSKA_ContextSeekHead.Id || Id == MATROSKA_ContextInfo.Id || Id == MATROSKA_ContextTracks.Id))
+			return 0; // end of a Cluster with an unknown size
+		File->BlockPosition = File->ClusterPos;
+		File->ClusterPos = DataPos + DataSize;
+
+		if (Id == MATROSKA_ContextTimestamp.Id)
+		{
+			if (readUInteger(File,DataPos,DataSize,&Value))
+				File->ClusterTimecode = Value * File->Seg.TimecodeScale;
+		}
+		else if (Id == MATROSKA_ContextSimpleBlock.Id)
+		{
+			if (!readBlockTrack(File,DataPos,&File->BlockTrack))
+				continue;
+			if (IsTrackMasked(File,File->BlockTrack))
+			{
+				skipElement(File,File->BlockPosition,File->ClusterPos);
+				continue;
+			}
+			File->BlockKeyframe = 2; // from the SimpleBlock flags
+			if (readBlock(File,DataPos,DataSize))
+				return 1;
+		}
+		else if (Id == MATROSKA_ContextBlockGroup.Id)
+		{
+			// the Block and what tells if it's a keyframe
+			BlockDataSize = INVALID_FILEPOS_T;
+			File->BlockKeyframe = 1;
+			for (SubPos = DataPos;SubPos < DataPos + DataSize;SubPos = SubDataPos + SubDataSize)
+			{
+				if (!readElementHead(File,SubPos,&SubId,&SubDataSize,&SubDataPos) || SubDataSize == INVALID_FILEPOS_T)
+					break;
+				if (SubId == MATROSKA_ContextBlock.Id && BlockDataSize == INVALID_FILEPOS_T)
+				{
+					if (!readBlockTrack(File,SubDataPos,&File->BlockTrack))
+						break;
+					if (IsTrackMasked(File,File->BlockTrack))
+					{
+						// the rest of the BlockGroup is not needed
+						skipElement(File,File->BlockPosition,File->ClusterPos);
+						break;
+					}
+					File->BlockPosition = SubPos;
+					BlockDataPos = SubDataPos;
+					BlockDataSize = SubDataSize;
+				}
+				else if (SubId == MATROSKA_ContextReferenceBlock.Id)
+					File->BlockKeyframe = 0;
+				else if (SubId == MATROSKA_ContextBlockDuration.Id && readUInteger(File,SubDataPos,SubDataSize,&Value) && Value==0)
+					File->BlockKeyframe = 0;
+			}
+			if (BlockDataSize != INVALID_FILEPOS_T && readBlock(File,BlockDataPos,BlockDataSize))
+				return 1;
+		}
+	}
+	return 0;
 }
 
 int mkv_ReadFrame(MatroskaFile *File, int mask, unsigned int *track, ulonglong *StartTime, ulonglong *EndTime, ulonglong *FilePos, unsigned int *FrameSize,
                 void** FrameRef, unsigned int *FrameFlags)
 {
-	ebml_element *Elt = NULL,*Elt2;
-	TrackInfo *tr;
-	int16_t TrackNum;
-	matroska_frame Frame;
-	bool_t Skip;
-	unsigned int Track;
+	ebml_element *Elt = NULL;
+	const mkv_frame *Frame;
 	int UpperLevel = 0;
 
 	if (FrameFlags)
 		*FrameFlags = 0;
-	if (!track)
-		track = &Track;
-	*track = (unsigned int)-1;
 
-	for (;;)
+	while (File->CurrentFrame >= ARRAYCOUNT(File->Frames,mkv_frame))
 	{
 		if (!File->CurrentCluster)
 		{
@@ -1278,6 +1768,7 @@ int mkv_ReadFrame(MatroskaFile *File, int mask, unsigned int *track, ulonglong *
 				{
 					// TODO: changing segments not supported yet
 					NodeDelete((node*)File->CurrentCluster);
+					File->CurrentCluster = NULL;
 					return EOF;
 				}
 				if (File->CurrentCluster->Context->Id == MATROSKA_ContextCluster.Id)
@@ -1289,170 +1780,236 @@ int mkv_ReadFrame(MatroskaFile *File, int mask, unsigned int *track, ulonglong *
 				Elt = NULL;
 			}
 
-			MATROSKA_LinkClusterReadSegmentInfo((matroska_cluster*)File->CurrentCluster,File->SegmentInfo,1);
-			File->ClusterContext.Context = &MATROSKA_ContextCluster;
+			// the Blocks are read directly from the file
+			File->ClusterPos = EBML_ElementPositionData(File->CurrentCluster);
 			if (EBML_ElementIsFiniteSize(File->CurrentCluster))
-				File->ClusterContext.EndPosition = EBML_ElementPositionEnd(File->CurrentCluster);
+				File->ClusterEnd = EBML_ElementPositionEnd(File->CurrentCluster);
 			else
-				File->ClusterContext.EndPosition = INVALID_FILEPOS_T;
-			File->ClusterContext.UpContext = &File->L1Context;
-
-			File->CurrentBlock = NULL;
-			File->CurrentFrame = 0;
+				File->ClusterEnd = INVALID_FILEPOS_T;
+			File->ClusterTimecode = INVALID_TIMECODE_T;
 		}
 
-		Elt = NULL;
-		while (!File->CurrentBlock)
+		if (!readNextBlock(File))
 		{
-			if (!Elt)
-			{
-				UpperLevel = 0;
-				Elt = EBML_FindNextElement((stream*)File->Input,&File->ClusterContext,&UpperLevel,1);
-			}
-			if (!Elt || UpperLevel>0)
-			{
-				NodeDelete((node*)File->CurrentCluster);
-				File->CurrentCluster = NULL;
-				--UpperLevel;
-				break; // go to the next Cluster
-			}
+			// go to the next Cluster
+			File->Input->io->ioseek(File->Input->io,File->ClusterPos,SEEK_SET);
+			NodeDelete((node*)File->CurrentCluster);
+			File->CurrentCluster = NULL;
+			Elt = NULL;
+		}
+	}
 
-			Skip = 0;
-			if (Elt->Context->Id == MATROSKA_ContextClusterTimecode.Id)
-			{
-				if (EBML_ElementReadData(Elt,(stream*)File->Input,&File->ClusterContext,1, SCOPE_ALL_DATA)!=ERR_NONE)
-					return EOF; // TODO: memory leak
-				Elt2 = EBML_MasterFindFirstElt(File->CurrentCluster,&MATROSKA_ContextClusterTimecode,1,1);
-				if (!Elt2)
-					return EOF; // TODO: memory leak
-				EBML_IntegerSetValue((ebml_integer*)Elt2,EBML_IntegerValue(Elt));
-				NodeDelete((node*)Elt);
-				Elt = NULL;
-			}
-			else if (Elt->Context->Id == MATROSKA_ContextClusterSimpleBlock.Id)
-			{
-				if (EBML_ElementReadData(Elt,(stream*)File->Input,&File->ClusterContext,1, SCOPE_PARTIAL_DATA)!=ERR_NONE)
-					return EOF; // TODO: memory leak
+	Frame = ARRAYBEGIN(File->Frames,mkv_frame) + File->CurrentFrame;
+	if (track)
+		*track = File->BlockTrack;
 
-				TrackNum = MATROSKA_BlockTrackNum((matroska_block*)Elt);
-				for (*track=0, tr=ARRAYBEGIN(File->Tracks,TrackInfo);tr!=ARRAYEND(File->Tracks,TrackInfo);++tr,(*track)++)
-					if (TrackNum==tr->Number)
-						break;
-				if (tr==ARRAYEND(File->Tracks,TrackInfo) || (1<<*track & File->trackMask)!=0)
-					Skip = 1;
-				else
-				{
-					EBML_MasterAppend(File->CurrentCluster, Elt);
-					MATROSKA_LinkBlockWithReadTracks((matroska_block*)Elt,File->TrackList,1);
-					MATROSKA_LinkBlockReadSegmentInfo((matroska_block*)Elt,File->SegmentInfo,1);
-					File->CurrentBlock = (matroska_block*)Elt;
-				}
-			}
-			else if (Elt->Context->Id == MATROSKA_ContextClusterBlockGroup.Id)
-			{
-				if (EBML_ElementReadData(Elt,(stream*)File->Input,&File->ClusterContext,1, SCOPE_PARTIAL_DATA)!=ERR_NONE)
-					return EOF; // TODO: memory leak
+	// only the first frame of a lace has a known timecode
+	if (File->CurrentFrame==0 && File->BlockTimecode!=INVALID_TIMECODE_T)
+	{
+		if (StartTime)
+			*StartTime = File->BlockTimecode;
+	}
+	else if (FrameFlags)
+		*FrameFlags |= FRAME_UNKNOWN_START;
 
-				Elt2 = EBML_MasterFindFirstElt(Elt, &MATROSKA_ContextClusterBlock, 0, 0);
-				if (!Elt2)
-					Skip = 1;
-				else
-				{
-					TrackNum = MATROSKA_BlockTrackNum((matroska_block*)Elt2);
-					for (*track=0, tr=ARRAYBEGIN(File->Tracks,TrackInfo);tr!=ARRAYEND(File->Tracks,TrackInfo);++tr,(*track)++)
-						if (TrackNum==tr->Number)
-							break;
-
-					if (tr==ARRAYEND(File->Tracks,TrackInfo) || (1<<*track & File->trackMask)!=0)
-						Skip = 1;
-					else
-					{
-						EBML_MasterAppend(File->CurrentCluster, Elt);
-						MATROSKA_LinkBlockWithReadTracks((matroska_block*)Elt2,File->TrackList,1);
-						MATROSKA_LinkBlockReadSegmentInfo((matroska_block*)Elt2,File->SegmentInfo,1);
-						File->CurrentBlock = (matroska_block*)Elt2;
-					}
-				}
-			}
-			else Skip = 1;
+	if (FilePos)
+		*FilePos = File->BlockPosition;
+	if (FrameSize)
+		*FrameSize = Frame->Size;
+	if (FrameFlags)
+	{
+		*FrameFlags |= FRAME_UNKNOWN_END;
+		if (File->BlockKeyframe)
+			*FrameFlags |= FRAME_KF;
+	}
+	File->Input->io->ioseek(File->Input->io,Frame->Position,SEEK_SET);
+	*FrameRef = File->Input->io->makeref(File->Input->io,Frame->Size);
+	++File->CurrentFrame;
 
-			if (Skip)
-			{
-				Elt2 = Elt;
-				Elt = EBML_ElementSkipData(Elt2,(stream*)File->Input,&File->L1Context,NULL,1);
-				NodeDelete((node*)Elt2);
-			}
-		}
-		if (File->CurrentCluster && File->CurrentBlock)
-			break;
+	return 0;
+}
+
+static void SeekToPos(MatroskaFile *File, filepos_t SeekPos)
+{
+	ArrayDrop(&File->Frames);
+	File->CurrentFrame = 0;
+	if (File->CurrentCluster)
+	{
+		NodeDelete((node*)File->CurrentCluster);
+		File->CurrentCluster = NULL;
 	}
+	File->Input->io->ioseek(File->Input->io,SeekPos,SEEK_SET);
+}
 
-	assert(File->CurrentBlock!=NULL);
-	if (MATROSKA_BlockGetFrame(File->CurrentBlock,File->CurrentFrame,&Frame,0)!=ERR_NONE)
-		return -1; // TODO: memory leaks
+static int CmpClusterPos(const void* UNUSED_PARAM(Param), const mkv_clusterpos *a, const mkv_clusterpos *b)
+{
+	if (a->Position == b->Position)
+		return 0;
+	return a->Position > b->Position ? 1 : -1;
+}
 
-	if (*track==(unsigned int)-1)
+// check there's a Cluster with a Timestamp at Pos and remember it
+static bool_t readClusterAt(MatroskaFile *File, filepos_t Pos, filepos_t SegmentEnd, mkv_clusterpos *Cluster)
+{
+	fourcc_t Id;
+	filepos_t DataSize, DataPos, ClusterEnd;
+	int64_t Value;
+	bool_t Found;
+	intptr_t Index;
+	int Child;
+
+	Cluster->Position = Pos;
+	Index = ArrayFind(&File->ClusterMap,mkv_clusterpos,Cluster,(arraycmp)CmpClusterPos,NULL,&Found);
+	if (Found)
 	{
-		TrackNum = MATROSKA_BlockTrackNum(File->CurrentBlock);
-		for (*track=0, tr=ARRAYBEGIN(File->Tracks,TrackInfo);tr!=ARRAYEND(File->Tracks,TrackInfo);++tr,(*track)++)
-			if (TrackNum==tr->Number)
-				break;
+		*Cluster = ARRAYBEGIN(File->ClusterMap,mkv_clusterpos)[Index];
+		return 1;
 	}
 
-	if (Frame.Timecode!=INVALID_TIMECODE_T)
+	if (!readElementHead(File,Pos,&Id,&DataSize,&DataPos) || Id != MATROSKA_ContextCluster.Id)
+		return 0;
+	ClusterEnd = DataSize==INVALID_FILEPOS_T ? SegmentEnd : DataPos + DataSize;
+	if (ClusterEnd > SegmentEnd)
+		return 0;
+
+	// the Timestamp may come after a CRC-32 or a Void element
+	for (Child=0;Child<3 && DataPos<ClusterEnd;++Child,DataPos+=DataSize)
 	{
-		if (StartTime)
-			*StartTime = Frame.Timecode;
-		if (EndTime && Frame.Duration != INVALID_TIMECODE_T)
-			*EndTime = Frame.Timecode + Frame.Duration;
+		if (!readElementHead(File,DataPos,&Id,&DataSize,&DataPos) || DataSize==INVALID_FILEPOS_T)
+			return 0;
+		if (Id == MATROSKA_ContextTimestamp.Id)
+		{
+			if (!readUInteger(File,DataPos,DataSize,&Value))
+				return 0;
+			Cluster->Timecode = Value * File->Seg.TimecodeScale;
+			ArrayInsert(&File->ClusterMap,Index*sizeof(mkv_clusterpos),Cluster,sizeof(mkv_clusterpos),64*sizeof(mkv_clusterpos));
+			return 1;
+		}
 	}
+	return 0;
+}
 
-	if (FilePos)
-		*FilePos = ((ebml_element*)File->CurrentBlock)->ElementPosition;
-	if (FrameFlags)
+// find the first Cluster starting between Pos and End
+static bool_t findCluster(MatroskaFile *File, filepos_t Pos, filepos_t End, filepos_t SegmentEnd, mkv_clusterpos *Cluster)
+{
+	uint8_t Buffer[CLUSTER_SCAN_READ];
+	int Read, i;
+
+	while (Pos < End)
 	{
-		if (Frame.Timecode == INVALID_TIMECODE_T)
-			*FrameFlags |= FRAME_UNKNOWN_START;
-		if (Frame.Duration == INVALID_TIMECODE_T)
-			*FrameFlags |= FRAME_UNKNOWN_END;
-		if (MATROSKA_BlockKeyframe(File->CurrentBlock))
-			*FrameFlags |= FRAME_KF;
+		File->Input->io->ioseek(File->Input->io,Pos,SEEK_SET);
+		Read = File->Input->io->ioread(File->Input->io,Buffer,(int)min(sizeof(Buffer),End - Pos + 3));
+		if (Read < 4)
+			break;
+		for (i=0;i<Read-3;++i)
+			if (Buffer[i]==0x1F && Buffer[i+1]==0x43 && Buffer[i+2]==0xB6 && Buffer[i+3]==0x75 &&
+				readClusterAt(File,Pos+i,SegmentEnd,Cluster))
+				return 1;
+		Pos += Read - 3;
 	}
-	MATROSKA_BlockSkipToFrame(File->CurrentBlock, (stream*)File->Input, File->CurrentFrame);
-	*FrameRef = File->Input->io->makeref(File->Input->io,MATROSKA_BlockGetLength(File->CurrentBlock,File->CurrentFrame++));
+	return 0;
+}
+
+// last Cluster starting at or before Timecode (or the first one), bisecting on the file positions
+static bool_t bisectClusters(MatroskaFile *File, timecode_t Timecode, mkv_clusterpos *Cluster)
+{
+	const mkv_clusterpos *Known;
+	mkv_clusterpos Found;
+	filepos_t SegmentEnd, End, Middle;
+
+	SegmentEnd = EBML_ElementIsFiniteSize(File->Segment) ? EBML_ElementPositionEnd(File->Segment) : File->Input->io->getfilesize(File->Input->io);
+	if (!readClusterAt(File,File->pFirstCluster,SegmentEnd,Cluster))
+		return 0;
+	End = SegmentEnd;
 
-	if (File->CurrentFrame >= MATROSKA_BlockGetFrameCount(File->CurrentBlock))
+	// start from what the previous seeks found
+	for (Known=ARRAYBEGIN(File->ClusterMap,mkv_clusterpos);Known!=ARRAYEND(File->ClusterMap,mkv_clusterpos);++Known)
 	{
-		File->CurrentBlock = NULL;
-		File->CurrentFrame = 0;
+		if (Known->Timecode > Timecode)
+		{
+			End = Known->Position;
+			break;
+		}
+		if (Known->Position > Cluster->Position)
+			*Cluster = *Known;
 	}
 
+	while (End - Cluster->Position > CLUSTER_SCAN_READ)
+	{
+		Middle = Cluster->Position + (End - Cluster->Position) / 2;
+		if (!findCluster(File,Middle,End,SegmentEnd,&Found))
+			End = Middle; // no Cluster starts in the upper half
+		else if (Found.Timecode <= Timecode)
+			*Cluster = Found;
+		else
+			End = Found.Position;
+	}
+
+	// the last Clusters are close, check them one by one
+	while (findCluster(File,Cluster->Position+1,End,SegmentEnd,&Found) && Found.Timecode <= Timecode)
+		*Cluster = Found;
+	return 1;
+}
+
+// whether a keyframe of Track starts at or before Timecode in the Cluster
+static bool_t clusterHasKeyframe(MatroskaFile *File, const mkv_clusterpos *Cluster, size_t Track, timecode_t Timecode)
+{
+	fourcc_t Id;
+	filepos_t DataSize, DataPos;
+
+	if (!readElementHead(File,Cluster->Position,&Id,&DataSize,&DataPos))
+		return 0;
+	File->ClusterPos = DataPos;
+	File->ClusterEnd = DataSize==INVALID_FILEPOS_T ? INVALID_FILEPOS_T : DataPos + DataSize;
+	File->ClusterTimecode = Cluster->Timecode;
+	while (readNextBlock(File) && File->BlockTimecode <= Timecode)
+		if (File->BlockTrack == Track && File->BlockKeyframe)
+			return 1;
 	return 0;
 }
 
-static void SeekToPos(MatroskaFile *File, filepos_t SeekPos)
+// seek without Cues, to the Cluster with the keyframe before timecode of the first video track read
+static void SeekWithoutCues(MatroskaFile *File, timecode_t timecode)
 {
-	if (File->CurrentBlock)
+	mkv_clusterpos Cluster;
+	const TrackInfo *tr;
+	size_t Track = (size_t)-1, i;
+
+	if (!bisectClusters(File, timecode, &Cluster))
+		return;
+
+	for (i=0, tr=ARRAYBEGIN(File->Tracks,TrackInfo);tr!=ARRAYEND(File->Tracks,TrackInfo);++tr,++i)
 	{
-		NodeDelete((node*)File->CurrentBlock);
-		File->CurrentBlock = NULL;
+		if (IsTrackMasked(File,i))
+			continue;
+		if (Track==(size_t)-1 || tr->Type==TRACK_TYPE_VIDEO)
+			Track = i;
+		if (tr->Type==TRACK_TYPE_VIDEO)
+			break;
 	}
-	File->CurrentFrame = 0;
-	if (File->CurrentCluster && File->CurrentCluster->ElementPosition!=SeekPos)
+
+	if (Track!=(size_t)-1)
 	{
-		NodeDelete((node*)File->CurrentCluster);
-		File->CurrentCluster = NULL;
+		// go back until a Cluster has a keyframe for that track
+		for (i=0;i<SEEK_MAX_PREV_CLUSTERS && Cluster.Position!=File->pFirstCluster;++i)
+		{
+			if (clusterHasKeyframe(File,&Cluster,Track,timecode) || Cluster.Timecode==0 ||
+				!bisectClusters(File, Cluster.Timecode-1, &Cluster))
+				break;
+		}
+		ArrayDrop(&File->Frames);
 	}
-	File->Input->io->ioseek(File->Input->io,SeekPos,SEEK_SET);
+	SeekToPos(File, Cluster.Position);
 }
 
 void mkv_Seek(MatroskaFile *File, timecode_t timecode, int flags)
 {
-	matroska_cuepoint *CuePoint;
+	size_t Cue;
 	filepos_t SeekPos;
 
 	if (File->flags & MKVF_AVOID_SEEKS || File->pFirstCluster==INVALID_FILEPOS_T || timecode==INVALID_TIMECODE_T)
 		return;
+	loadSection(File, LOAD_CUES);
 
 	if (timecode==0)
 	{
@@ -1460,13 +2017,17 @@ void mkv_Seek(MatroskaFile *File, timecode_t timecode, int flags)
 		return;
 	}
 	if (!File->CueList)
+	{
+		SeekToPos(File, File->pFirstCluster);
+		SeekWithoutCues(File, timecode);
 		return;
+	}
 
-	CuePoint = MATROSKA_CuesGetTimecodeStart(File->CueList,timecode);
-	if (CuePoint==NULL)
+	Cue = MATROSKA_CueIndexFind(&File->CueIndex,0,timecode);
+	if (Cue==MATROSKA_CUEINDEX_NONE)
 		return;
 
-	SeekPos = MATROSKA_CuePosInSegment(CuePoint) + EBML_ElementPositionData(File->Segment);
+	SeekPos = ARRAYBEGIN(File->CueIndex.ClusterPosition,filepos_t)[Cue] + EBML_ElementPositionData(File->Segment);
 	SeekToPos(File, SeekPos);
 }
 
@@ -150,7 +150,7 @@ typedef struct Chapter
 
 } Chapter;
 
-typedef struct Target {
+struct Target {
   uint64_t UID;
   uint8_t  Type;
   uint8_t  Level;
@@ -213,6 +213,10 @@ SegmentInfo *mkv_GetFileInfo(MatroskaFile *File);
 size_t mkv_GetNumTracks(MatroskaFile *File);
 TrackInfo *mkv_GetTrackInfo(MatroskaFile *File, size_t n);
 void mkv_SetTrackMask(MatroskaFile *File, int Mask);
+/* bit (n%32) of Mask[n/32] set to skip track n, for files with more than 32 tracks */
+void mkv_SetTrackMaskEx(MatroskaFile *File, const uint32_t *Mask, size_t Tracks);
+/* called with the position and size of the Blocks of masked tracks that are skipped without reading them, may be NULL */
+void mkv_SetSkipCallback(MatroskaFile *File, void (*Skipped)(InputStream *inf, filepos_t pos, filepos_t count));
 
 #define FRAME_UNKNOWN_START  0x00000001
 #define FRAME_UNKNOWN_END    0x00000002
@@ -228,6 +232,8 @@ void mkv_Seek(MatroskaFile *File, timecode_t timecode, int flags);
 void mkv_GetTags(MatroskaFile *File, Tag **, unsigned *Count);
 void mkv_GetAttachments(MatroskaFile *File, Attachment **, unsigned *Count);
 void mkv_GetChapters(MatroskaFile *File, Chapter **, unsigned *Count);
+/* why the section of the last mkv_GetTags(), mkv_GetAttachments(), mkv_GetChapters() or the Cues of mkv_Seek() is empty or incomplete, NULL if it was read whole */
+const char *mkv_GetLastError(MatroskaFile *File);
 
 int mkv_TruncFloat(float f);
 
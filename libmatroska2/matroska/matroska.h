@@ -150,6 +150,10 @@ EBML_DLL bool_t MATROSKA_BlockKeyframe(const matroska_block *Block);
 EBML_DLL bool_t MATROSKA_BlockDiscardable(const matroska_block *Block);
 EBML_DLL bool_t MATROSKA_BlockLaced(const matroska_block *Block);
 EBML_DLL err_t MATROSKA_BlockReadData(matroska_block *Block, stream *Input);
+// read the data of all the Blocks of the Cluster, the compressed frames are decoded on Threads threads (0 for one per CPU)
+// only when built with CONFIG_MULTITHREAD, otherwise (the default config) they are decoded on the calling thread
+// the Blocks that could not be read are added to Failed (matroska_block*) when it's not NULL, the first error is returned
+EBML_DLL err_t MATROSKA_ClusterReadBlocksData(matroska_cluster *Cluster, stream *Input, size_t Threads, array *Failed);
 EBML_DLL err_t MATROSKA_BlockReleaseData(matroska_block *Block, bool_t IncludingNotRead);
 EBML_DLL int16_t MATROSKA_CueTrackNum(const matroska_cuepoint *Cue);
 EBML_DLL void MATROSKA_CuesSort(ebml_master *Cues);
@@ -161,6 +165,31 @@ EBML_DLL filepos_t MATROSKA_MetaSeekAbsolutePos(const matroska_seekpoint *MetaSe
 
 EBML_DLL matroska_cuepoint *MATROSKA_CuesGetTimecodeStart(const ebml_element *Cues, timecode_t Timecode);
 
+// CuePoints of a Cues in arrays, one entry per CueTrackPositions sorted by track then timecode
+typedef struct matroska_cueindex
+{
+    array Timecode; // timecode_t
+    array Track; // int16_t
+    array ClusterPosition; // filepos_t, in the Segment data
+    array RelativePosition; // filepos_t, INVALID_FILEPOS_T when not set
+    array BlockNumber; // int32_t, 0 when not set
+    array CuePoint; // matroska_cuepoint*, NULL when the index was not built from the Cues
+    array TrackStart; // size_t, first entry of each track followed by the number of entries
+
+} matroska_cueindex;
+
+#define MATROSKA_CUEINDEX_NONE  ((size_t)-1)
+
+EBML_DLL void MATROSKA_CueIndexInit(matroska_cueindex *Index);
+EBML_DLL void MATROSKA_CueIndexClear(matroska_cueindex *Index);
+EBML_DLL err_t MATROSKA_CueIndexBuild(matroska_cueindex *Index, const ebml_master *Cues); // the CuePoints must be linked to their SegmentInfo
+EBML_DLL size_t MATROSKA_CueIndexFind(const matroska_cueindex *Index, int16_t Track, timecode_t Timecode); // last entry at or before Timecode (or the first one) for Track, 0 for any track
+// index of the Cluster positions (track 0) and of the first keyframe of each track in a Cluster, for files without Cues
+EBML_DLL err_t MATROSKA_CueIndexScanClusters(matroska_cueindex *Index, ebml_master *Segment, stream *Input, const ebml_parser_context *Context, const ebml_master *SegmentInfo, bool_t Keyframes);
+// the saved index is only loaded for a source file of the same size and date
+EBML_DLL err_t MATROSKA_CueIndexSave(const matroska_cueindex *Index, stream *Output, filepos_t SourceSize, datetime_t SourceDate);
+EBML_DLL err_t MATROSKA_CueIndexLoad(matroska_cueindex *Index, stream *Input, filepos_t SourceSize, datetime_t SourceDate);
+
 #if defined(CONFIG_EBML_WRITING)
 EBML_DLL int MATROSKA_TrackGetBlockCompression(const matroska_trackentry *TrackEntry);
 EBML_DLL bool_t MATROSKA_TrackSetCompressionZlib(matroska_trackentry *TrackEntry, int Scope);
@@ -193,6 +222,8 @@ EBML_DLL err_t MATROSKA_BlockAppendFrame(matroska_block *Block, const matroska_f
 
 
 EBML_DLL matroska_block *MATROSKA_GetBlockForTimecode(matroska_cluster *Cluster, timecode_t Timecode, int16_t Track);
+// Clusters sorted by timecode, the last one starting before Timecode (or the first one), NULL if there are none
+EBML_DLL matroska_cluster **MATROSKA_ClusterForTimecode(const array *Clusters, timecode_t Timecode);
 EBML_DLL void MATROSKA_LinkClusterBlocks(matroska_cluster *Cluster, ebml_master *RSegmentInfo, ebml_master *Tracks, bool_t KeepUnmatched);
 
 extern const ebml_context MATROSKA_ContextStream;
@@ -50,6 +50,8 @@ struct matroska_block
     array SizeList; // int32_t
     array SizeListIn; // int32_t
     array Data; // uint8_t
+    const uint8_t *MappedData; // frames referenced in a mapped input instead of Data
+    size_t MappedSize;
     array Durations; // timecode_t
     ebml_master *ReadTrack;
     ebml_master *ReadSegInfo;
@@ -66,6 +68,25 @@ struct matroska_block
     char Lacing;
 };
 
+// values of a TrackEntry used to get the frame durations, see MATROSKA_BlockProcessFrameDurations()
+typedef struct matroska_trackcodec
+{
+    bool_t Resolved;
+    err_t Err;
+    int Codec;
+    timecode_t Duration[2]; // duration of a frame, of a short and long Vorbis block
+    int VorbisModes;
+    int VorbisModeBits;
+    uint8_t VorbisBlockFlag[64];
+
+} matroska_trackcodec;
+
+INTERNAL_C_API matroska_trackcodec *MATROSKA_TrackCodec(ebml_master *TrackEntry); // reset when the TrackEntry is read or changed
+
+// the frame data of a block, whether they are owned or referenced in a mapped input
+#define MATROSKA_BlockDataBegin(b)  ((b)->MappedData ? (b)->MappedData : ARRAYBEGIN((b)->Data,uint8_t))
+#define MATROSKA_BlockDataSize(b)   ((b)->MappedData ? (b)->MappedSize : ARRAYCOUNT((b)->Data,uint8_t))
+
 #define MATROSKA_BLOCK_CLASS      FOURCC('M','K','B','L')
 #define MATROSKA_BLOCKGROUP_CLASS FOURCC('M','K','B','G')
 #define MATROSKA_CUEPOINT_CLASS   FOURCC('M','K','C','P')
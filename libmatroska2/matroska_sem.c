@@ -40,13 +40,21 @@ const ebml_semantic EBML_SemanticSeek[] = {
     {1, 1, &MATROSKA_ContextSeekPosition, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextSeek = {0x4DBB, MATROSKA_SEEKPOINT_CLASS, 0, 0, "Seek", EBML_SemanticSeek, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsSeek[] = {
+    0, 2, 1, 0,
+};
+static const ebml_semantic_index EBML_IndexSeek = {0x9E3779B1, 30, EBML_IndexSlotsSeek};
+const ebml_context MATROSKA_ContextSeek = {0x4DBB, MATROSKA_SEEKPOINT_CLASS, 0, 0, "Seek", EBML_SemanticSeek, EBML_SemanticGlobals, NULL, &EBML_IndexSeek};
 
 const ebml_semantic EBML_SemanticSeekHead[] = {
     {1, 0, &MATROSKA_ContextSeek, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextSeekHead = {0x114D9B74, EBML_MASTER_CLASS, 0, 0, "SeekHead", EBML_SemanticSeekHead, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsSeekHead[] = {
+    1, 0,
+};
+static const ebml_semantic_index EBML_IndexSeekHead = {0x9E3779B1, 31, EBML_IndexSlotsSeekHead};
+const ebml_context MATROSKA_ContextSeekHead = {0x114D9B74, EBML_MASTER_CLASS, 0, 0, "SeekHead", EBML_SemanticSeekHead, EBML_SemanticGlobals, NULL, &EBML_IndexSeekHead};
 const ebml_context MATROSKA_ContextSegmentUID = {0x73A4, MATROSKA_SEGMENTUID_CLASS, 0, 0, "SegmentUID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextSegmentFilename = {0x7384, EBML_UNISTRING_CLASS, 0, 0, "SegmentFilename", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextPrevUID = {0x3CB923, MATROSKA_SEGMENTUID_CLASS, 0, 0, "PrevUID", NULL, EBML_SemanticGlobals, NULL};
@@ -64,7 +72,11 @@ const ebml_semantic EBML_SemanticChapterTranslate[] = {
     {1, 1, &MATROSKA_ContextChapterTranslateID, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapterTranslate = {0x6924, EBML_MASTER_CLASS, 0, 0, "ChapterTranslate", EBML_SemanticChapterTranslate, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapterTranslate[] = {
+    0, 0, 0, 1, 0, 3, 2, 0,
+};
+static const ebml_semantic_index EBML_IndexChapterTranslate = {0x9E3779B1, 29, EBML_IndexSlotsChapterTranslate};
+const ebml_context MATROSKA_ContextChapterTranslate = {0x6924, EBML_MASTER_CLASS, 0, 0, "ChapterTranslate", EBML_SemanticChapterTranslate, EBML_SemanticGlobals, NULL, &EBML_IndexChapterTranslate};
 const ebml_context MATROSKA_ContextTimestampScale = {0x2AD7B1, EBML_INTEGER_CLASS, 1, (intptr_t)1000000, "TimestampScale", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextDuration = {0x4489, EBML_FLOAT_CLASS, 0, 0, "Duration", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextDateUTC = {0x4461, EBML_DATE_CLASS, 0, 0, "DateUTC", NULL, EBML_SemanticGlobals, NULL};
@@ -89,7 +101,12 @@ const ebml_semantic EBML_SemanticInfo[] = {
     {1, 1, &MATROSKA_ContextWritingApp, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextInfo = {0x1549A966, EBML_MASTER_CLASS, 0, 0, "Info", EBML_SemanticInfo, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsInfo[] = {
+    0, 12, 0, 0, 11, 0, 0, 14, 0, 0, 9, 0, 0, 4, 0, 7,
+    0, 0, 10, 8, 5, 13, 3, 0, 2, 0, 0, 0, 1, 6, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexInfo = {0x292B7615, 27, EBML_IndexSlotsInfo};
+const ebml_context MATROSKA_ContextInfo = {0x1549A966, EBML_MASTER_CLASS, 0, 0, "Info", EBML_SemanticInfo, EBML_SemanticGlobals, NULL, &EBML_IndexInfo};
 const ebml_context MATROSKA_ContextTimestamp = {0xE7, EBML_INTEGER_CLASS, 0, 0, "Timestamp", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextSilentTrackNumber = {0x58D7, EBML_INTEGER_CLASS, 0, 0, "SilentTrackNumber", NULL, EBML_SemanticGlobals, NULL};
 
@@ -97,7 +114,11 @@ const ebml_semantic EBML_SemanticSilentTracks[] = {
     {0, 0, &MATROSKA_ContextSilentTrackNumber, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextSilentTracks = {0x5854, EBML_MASTER_CLASS, 0, 0, "SilentTracks", EBML_SemanticSilentTracks, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsSilentTracks[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexSilentTracks = {0x9E3779B1, 31, EBML_IndexSlotsSilentTracks};
+const ebml_context MATROSKA_ContextSilentTracks = {0x5854, EBML_MASTER_CLASS, 0, 0, "SilentTracks", EBML_SemanticSilentTracks, EBML_SemanticGlobals, NULL, &EBML_IndexSilentTracks};
 const ebml_context MATROSKA_ContextPosition = {0xA7, EBML_INTEGER_CLASS, 0, 0, "Position", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextPrevSize = {0xAB, EBML_INTEGER_CLASS, 0, 0, "PrevSize", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextSimpleBlock = {0xA3, MATROSKA_BLOCK_CLASS, 0, 0, "SimpleBlock", NULL, EBML_SemanticGlobals, NULL};
@@ -111,13 +132,21 @@ const ebml_semantic EBML_SemanticBlockMore[] = {
     {1, 1, &MATROSKA_ContextBlockAdditional, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextBlockMore = {0xA6, EBML_MASTER_CLASS, 0, 0, "BlockMore", EBML_SemanticBlockMore, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsBlockMore[] = {
+    1, 0, 0, 2,
+};
+static const ebml_semantic_index EBML_IndexBlockMore = {0x9E3779B1, 30, EBML_IndexSlotsBlockMore};
+const ebml_context MATROSKA_ContextBlockMore = {0xA6, EBML_MASTER_CLASS, 0, 0, "BlockMore", EBML_SemanticBlockMore, EBML_SemanticGlobals, NULL, &EBML_IndexBlockMore};
 
 const ebml_semantic EBML_SemanticBlockAdditions[] = {
     {1, 0, &MATROSKA_ContextBlockMore, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextBlockAdditions = {0x75A1, EBML_MASTER_CLASS, 0, 0, "BlockAdditions", EBML_SemanticBlockAdditions, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsBlockAdditions[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexBlockAdditions = {0x9E3779B1, 31, EBML_IndexSlotsBlockAdditions};
+const ebml_context MATROSKA_ContextBlockAdditions = {0x75A1, EBML_MASTER_CLASS, 0, 0, "BlockAdditions", EBML_SemanticBlockAdditions, EBML_SemanticGlobals, NULL, &EBML_IndexBlockAdditions};
 const ebml_context MATROSKA_ContextBlockDuration = {0x9B, EBML_INTEGER_CLASS, 0, 0, "BlockDuration", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextReferencePriority = {0xFA, EBML_INTEGER_CLASS, 1, (intptr_t)0, "ReferencePriority", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextReferenceBlock = {0xFB, EBML_SINTEGER_CLASS, 0, 0, "ReferenceBlock", NULL, EBML_SemanticGlobals, NULL};
@@ -138,13 +167,21 @@ const ebml_semantic EBML_SemanticTimeSlice[] = {
     {0, 1, &MATROSKA_ContextSliceDuration, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTimeSlice = {0xE8, EBML_MASTER_CLASS, 0, 0, "TimeSlice", EBML_SemanticTimeSlice, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTimeSlice[] = {
+    0, 1, 0, 0, 0, 4, 0, 3, 0, 0, 0, 2, 0, 0, 5, 0,
+};
+static const ebml_semantic_index EBML_IndexTimeSlice = {0x9E3779B1, 28, EBML_IndexSlotsTimeSlice};
+const ebml_context MATROSKA_ContextTimeSlice = {0xE8, EBML_MASTER_CLASS, 0, 0, "TimeSlice", EBML_SemanticTimeSlice, EBML_SemanticGlobals, NULL, &EBML_IndexTimeSlice};
 
 const ebml_semantic EBML_SemanticSlices[] = {
     {0, 0, &MATROSKA_ContextTimeSlice, PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_DIVX},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextSlices = {0x8E, EBML_MASTER_CLASS, 0, 0, "Slices", EBML_SemanticSlices, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsSlices[] = {
+    1, 0,
+};
+static const ebml_semantic_index EBML_IndexSlices = {0x9E3779B1, 31, EBML_IndexSlotsSlices};
+const ebml_context MATROSKA_ContextSlices = {0x8E, EBML_MASTER_CLASS, 0, 0, "Slices", EBML_SemanticSlices, EBML_SemanticGlobals, NULL, &EBML_IndexSlices};
 const ebml_context MATROSKA_ContextReferenceOffset = {0xC9, EBML_INTEGER_CLASS, 0, 0, "ReferenceOffset", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextReferenceTimestamp = {0xCA, EBML_INTEGER_CLASS, 0, 0, "ReferenceTimestamp", NULL, EBML_SemanticGlobals, NULL};
 
@@ -153,7 +190,11 @@ const ebml_semantic EBML_SemanticReferenceFrame[] = {
     {1, 1, &MATROSKA_ContextReferenceTimestamp, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextReferenceFrame = {0xC8, EBML_MASTER_CLASS, 0, 0, "ReferenceFrame", EBML_SemanticReferenceFrame, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsReferenceFrame[] = {
+    1, 0, 0, 2,
+};
+static const ebml_semantic_index EBML_IndexReferenceFrame = {0x9E3779B1, 30, EBML_IndexSlotsReferenceFrame};
+const ebml_context MATROSKA_ContextReferenceFrame = {0xC8, EBML_MASTER_CLASS, 0, 0, "ReferenceFrame", EBML_SemanticReferenceFrame, EBML_SemanticGlobals, NULL, &EBML_IndexReferenceFrame};
 
 const ebml_semantic EBML_SemanticBlockGroup[] = {
     {1, 1, &MATROSKA_ContextBlock, 0},
@@ -169,7 +210,12 @@ const ebml_semantic EBML_SemanticBlockGroup[] = {
     {0, 1, &MATROSKA_ContextReferenceFrame, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextBlockGroup = {0xA0, MATROSKA_BLOCKGROUP_CLASS, 0, 0, "BlockGroup", EBML_SemanticBlockGroup, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsBlockGroup[] = {
+    0, 0, 0, 3, 0, 0, 0, 7, 0, 8, 0, 9, 0, 0, 0, 5,
+    1, 0, 11, 10, 0, 0, 0, 6, 2, 0, 0, 0, 0, 0, 0, 4,
+};
+static const ebml_semantic_index EBML_IndexBlockGroup = {0x4205A75D, 27, EBML_IndexSlotsBlockGroup};
+const ebml_context MATROSKA_ContextBlockGroup = {0xA0, MATROSKA_BLOCKGROUP_CLASS, 0, 0, "BlockGroup", EBML_SemanticBlockGroup, EBML_SemanticGlobals, NULL, &EBML_IndexBlockGroup};
 const ebml_context MATROSKA_ContextEncryptedBlock = {0xAF, EBML_BINARY_CLASS, 0, 0, "EncryptedBlock", NULL, EBML_SemanticGlobals, NULL};
 
 const ebml_semantic EBML_SemanticCluster[] = {
@@ -182,7 +228,11 @@ const ebml_semantic EBML_SemanticCluster[] = {
     {0, 0, &MATROSKA_ContextEncryptedBlock, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextCluster = {0x1F43B675, MATROSKA_CLUSTER_CLASS, 0, 0, "Cluster", EBML_SemanticCluster, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsCluster[] = {
+    0, 0, 7, 3, 0, 0, 0, 0, 0, 0, 4, 5, 1, 0, 6, 2,
+};
+static const ebml_semantic_index EBML_IndexCluster = {0x9E3779B1, 28, EBML_IndexSlotsCluster};
+const ebml_context MATROSKA_ContextCluster = {0x1F43B675, MATROSKA_CLUSTER_CLASS, 0, 0, "Cluster", EBML_SemanticCluster, EBML_SemanticGlobals, NULL, &EBML_IndexCluster};
 const ebml_context MATROSKA_ContextTrackNumber = {0xD7, EBML_INTEGER_CLASS, 0, 0, "TrackNumber", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTrackUID = {0x73C5, EBML_INTEGER_CLASS, 0, 0, "TrackUID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTrackType = {0x83, EBML_INTEGER_CLASS, 0, 0, "TrackType", NULL, EBML_SemanticGlobals, NULL};
@@ -221,7 +271,11 @@ const ebml_semantic EBML_SemanticTrackTranslate[] = {
     {1, 1, &MATROSKA_ContextTrackTranslateTrackID, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTrackTranslate = {0x6624, EBML_MASTER_CLASS, 0, 0, "TrackTranslate", EBML_SemanticTrackTranslate, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTrackTranslate[] = {
+    3, 2, 0, 0, 0, 0, 1, 0,
+};
+static const ebml_semantic_index EBML_IndexTrackTranslate = {0x9E3779B1, 29, EBML_IndexSlotsTrackTranslate};
+const ebml_context MATROSKA_ContextTrackTranslate = {0x6624, EBML_MASTER_CLASS, 0, 0, "TrackTranslate", EBML_SemanticTrackTranslate, EBML_SemanticGlobals, NULL, &EBML_IndexTrackTranslate};
 const ebml_context MATROSKA_ContextFlagInterlaced = {0x9A, EBML_INTEGER_CLASS, 1, (intptr_t)0, "FlagInterlaced", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextFieldOrder = {0x9D, EBML_INTEGER_CLASS, 1, (intptr_t)2, "FieldOrder", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextStereoMode = {0x53B8, EBML_INTEGER_CLASS, 1, (intptr_t)0, "StereoMode", NULL, EBML_SemanticGlobals, NULL};
@@ -277,7 +331,12 @@ const ebml_semantic EBML_SemanticMasteringMetadata[] = {
     {0, 1, &MATROSKA_ContextLuminanceMin, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextMasteringMetadata = {0x55D0, EBML_MASTER_CLASS, 0, 0, "MasteringMetadata", EBML_SemanticMasteringMetadata, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsMasteringMetadata[] = {
+    0, 5, 0, 0, 10, 0, 2, 0, 0, 7, 0, 0, 0, 0, 4, 0,
+    0, 9, 1, 0, 0, 6, 0, 0, 0, 0, 3, 0, 0, 8, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexMasteringMetadata = {0x9E3779B1, 27, EBML_IndexSlotsMasteringMetadata};
+const ebml_context MATROSKA_ContextMasteringMetadata = {0x55D0, EBML_MASTER_CLASS, 0, 0, "MasteringMetadata", EBML_SemanticMasteringMetadata, EBML_SemanticGlobals, NULL, &EBML_IndexMasteringMetadata};
 
 const ebml_semantic EBML_SemanticColour[] = {
     {0, 1, &MATROSKA_ContextMatrixCoefficients, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_DIVX|PROFILE_WEBM},
@@ -296,7 +355,12 @@ const ebml_semantic EBML_SemanticColour[] = {
     {0, 1, &MATROSKA_ContextMasteringMetadata, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextColour = {0x55B0, EBML_MASTER_CLASS, 0, 0, "Colour", EBML_SemanticColour, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsColour[] = {
+    0, 0, 2, 7, 12, 0, 0, 0, 14, 4, 9, 0, 0, 0, 0, 1,
+    6, 11, 0, 0, 0, 3, 8, 13, 0, 0, 0, 0, 5, 10, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexColour = {0x9B2DB8D1, 27, EBML_IndexSlotsColour};
+const ebml_context MATROSKA_ContextColour = {0x55B0, EBML_MASTER_CLASS, 0, 0, "Colour", EBML_SemanticColour, EBML_SemanticGlobals, NULL, &EBML_IndexColour};
 const ebml_context MATROSKA_ContextProjectionType = {0x7671, EBML_INTEGER_CLASS, 1, (intptr_t)0, "ProjectionType", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextProjectionPrivate = {0x7672, EBML_BINARY_CLASS, 0, 0, "ProjectionPrivate", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextProjectionPoseYaw = {0x7673, EBML_FLOAT_CLASS, 1, (intptr_t)0.0, "ProjectionPoseYaw", NULL, EBML_SemanticGlobals, NULL};
@@ -311,7 +375,11 @@ const ebml_semantic EBML_SemanticProjection[] = {
     {1, 1, &MATROSKA_ContextProjectionPoseRoll, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_DIVX},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextProjection = {0x7670, EBML_MASTER_CLASS, 0, 0, "Projection", EBML_SemanticProjection, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsProjection[] = {
+    2, 0, 0, 0, 4, 0, 1, 0, 0, 0, 3, 0, 0, 0, 5, 0,
+};
+static const ebml_semantic_index EBML_IndexProjection = {0x9E3779B1, 28, EBML_IndexSlotsProjection};
+const ebml_context MATROSKA_ContextProjection = {0x7670, EBML_MASTER_CLASS, 0, 0, "Projection", EBML_SemanticProjection, EBML_SemanticGlobals, NULL, &EBML_IndexProjection};
 
 const ebml_semantic EBML_SemanticVideo[] = {
     {1, 1, &MATROSKA_ContextFlagInterlaced, PROFILE_MATROSKA_V1|PROFILE_DIVX},
@@ -336,7 +404,14 @@ const ebml_semantic EBML_SemanticVideo[] = {
     {0, 1, &MATROSKA_ContextProjection, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_DIVX},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextVideo = {0xE0, EBML_MASTER_CLASS, 0, 0, "Video", EBML_SemanticVideo, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsVideo[] = {
+    4, 0, 0, 7, 0, 0, 0, 0, 0, 16, 0, 0, 0, 0, 0, 6,
+    18, 0, 0, 0, 0, 5, 0, 0, 17, 10, 8, 0, 0, 0, 14, 0,
+    19, 13, 0, 20, 0, 0, 0, 0, 0, 0, 0, 0, 0, 12, 0, 0,
+    0, 0, 0, 0, 0, 1, 15, 0, 0, 11, 9, 0, 0, 3, 2, 0,
+};
+static const ebml_semantic_index EBML_IndexVideo = {0x61CD9BFD, 26, EBML_IndexSlotsVideo};
+const ebml_context MATROSKA_ContextVideo = {0xE0, EBML_MASTER_CLASS, 0, 0, "Video", EBML_SemanticVideo, EBML_SemanticGlobals, NULL, &EBML_IndexVideo};
 const ebml_context MATROSKA_ContextSamplingFrequency = {0xB5, EBML_FLOAT_CLASS, 1, (intptr_t)8000.0, "SamplingFrequency", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextOutputSamplingFrequency = {0x78B5, EBML_FLOAT_CLASS, 0, 0, "OutputSamplingFrequency", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextChannels = {0x9F, EBML_INTEGER_CLASS, 1, (intptr_t)1, "Channels", NULL, EBML_SemanticGlobals, NULL};
@@ -351,7 +426,11 @@ const ebml_semantic EBML_SemanticAudio[] = {
     {0, 1, &MATROSKA_ContextBitDepth, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextAudio = {0xE1, EBML_MASTER_CLASS, 0, 0, "Audio", EBML_SemanticAudio, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsAudio[] = {
+    3, 0, 0, 0, 0, 2, 0, 4, 0, 0, 1, 0, 0, 0, 0, 5,
+};
+static const ebml_semantic_index EBML_IndexAudio = {0x4205A75D, 28, EBML_IndexSlotsAudio};
+const ebml_context MATROSKA_ContextAudio = {0xE1, EBML_MASTER_CLASS, 0, 0, "Audio", EBML_SemanticAudio, EBML_SemanticGlobals, NULL, &EBML_IndexAudio};
 const ebml_context MATROSKA_ContextTrackPlaneUID = {0xE5, EBML_INTEGER_CLASS, 0, 0, "TrackPlaneUID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTrackPlaneType = {0xE6, EBML_INTEGER_CLASS, 0, 0, "TrackPlaneType", NULL, EBML_SemanticGlobals, NULL};
 
@@ -360,27 +439,43 @@ const ebml_semantic EBML_SemanticTrackPlane[] = {
     {1, 1, &MATROSKA_ContextTrackPlaneType, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTrackPlane = {0xE4, EBML_MASTER_CLASS, 0, 0, "TrackPlane", EBML_SemanticTrackPlane, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTrackPlane[] = {
+    2, 0, 1, 0,
+};
+static const ebml_semantic_index EBML_IndexTrackPlane = {0x9E3779B1, 30, EBML_IndexSlotsTrackPlane};
+const ebml_context MATROSKA_ContextTrackPlane = {0xE4, EBML_MASTER_CLASS, 0, 0, "TrackPlane", EBML_SemanticTrackPlane, EBML_SemanticGlobals, NULL, &EBML_IndexTrackPlane};
 
 const ebml_semantic EBML_SemanticTrackCombinePlanes[] = {
     {1, 0, &MATROSKA_ContextTrackPlane, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTrackCombinePlanes = {0xE3, EBML_MASTER_CLASS, 0, 0, "TrackCombinePlanes", EBML_SemanticTrackCombinePlanes, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTrackCombinePlanes[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexTrackCombinePlanes = {0x9E3779B1, 31, EBML_IndexSlotsTrackCombinePlanes};
+const ebml_context MATROSKA_ContextTrackCombinePlanes = {0xE3, EBML_MASTER_CLASS, 0, 0, "TrackCombinePlanes", EBML_SemanticTrackCombinePlanes, EBML_SemanticGlobals, NULL, &EBML_IndexTrackCombinePlanes};
 const ebml_context MATROSKA_ContextTrackJoinUID = {0xED, EBML_INTEGER_CLASS, 0, 0, "TrackJoinUID", NULL, EBML_SemanticGlobals, NULL};
 
 const ebml_semantic EBML_SemanticTrackJoinBlocks[] = {
     {1, 0, &MATROSKA_ContextTrackJoinUID, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTrackJoinBlocks = {0xE9, EBML_MASTER_CLASS, 0, 0, "TrackJoinBlocks", EBML_SemanticTrackJoinBlocks, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTrackJoinBlocks[] = {
+    1, 0,
+};
+static const ebml_semantic_index EBML_IndexTrackJoinBlocks = {0x9E3779B1, 31, EBML_IndexSlotsTrackJoinBlocks};
+const ebml_context MATROSKA_ContextTrackJoinBlocks = {0xE9, EBML_MASTER_CLASS, 0, 0, "TrackJoinBlocks", EBML_SemanticTrackJoinBlocks, EBML_SemanticGlobals, NULL, &EBML_IndexTrackJoinBlocks};
 
 const ebml_semantic EBML_SemanticTrackOperation[] = {
     {0, 1, &MATROSKA_ContextTrackCombinePlanes, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_DIVX|PROFILE_WEBM},
     {0, 1, &MATROSKA_ContextTrackJoinBlocks, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTrackOperation = {0xE2, EBML_MASTER_CLASS, 0, 0, "TrackOperation", EBML_SemanticTrackOperation, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTrackOperation[] = {
+    2, 1, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexTrackOperation = {0x9E3779B1, 30, EBML_IndexSlotsTrackOperation};
+const ebml_context MATROSKA_ContextTrackOperation = {0xE2, EBML_MASTER_CLASS, 0, 0, "TrackOperation", EBML_SemanticTrackOperation, EBML_SemanticGlobals, NULL, &EBML_IndexTrackOperation};
 const ebml_context MATROSKA_ContextTrickTrackUID = {0xC0, EBML_INTEGER_CLASS, 0, 0, "TrickTrackUID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTrickTrackSegmentUID = {0xC1, EBML_BINARY_CLASS, 0, 0, "TrickTrackSegmentUID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTrickTrackFlag = {0xC6, EBML_INTEGER_CLASS, 1, (intptr_t)0, "TrickTrackFlag", NULL, EBML_SemanticGlobals, NULL};
@@ -397,7 +492,11 @@ const ebml_semantic EBML_SemanticContentCompression[] = {
     {0, 1, &MATROSKA_ContextContentCompSettings, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextContentCompression = {0x5034, EBML_MASTER_CLASS, 0, 0, "ContentCompression", EBML_SemanticContentCompression, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsContentCompression[] = {
+    1, 0, 0, 2,
+};
+static const ebml_semantic_index EBML_IndexContentCompression = {0x9E3779B1, 30, EBML_IndexSlotsContentCompression};
+const ebml_context MATROSKA_ContextContentCompression = {0x5034, EBML_MASTER_CLASS, 0, 0, "ContentCompression", EBML_SemanticContentCompression, EBML_SemanticGlobals, NULL, &EBML_IndexContentCompression};
 const ebml_context MATROSKA_ContextContentEncAlgo = {0x47E1, EBML_INTEGER_CLASS, 1, (intptr_t)0, "ContentEncAlgo", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextContentEncKeyID = {0x47E2, EBML_BINARY_CLASS, 0, 0, "ContentEncKeyID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextAESSettingsCipherMode = {0x47E8, EBML_INTEGER_CLASS, 0, 0, "AESSettingsCipherMode", NULL, EBML_SemanticGlobals, NULL};
@@ -406,7 +505,11 @@ const ebml_semantic EBML_SemanticContentEncAESSettings[] = {
     {1, 1, &MATROSKA_ContextAESSettingsCipherMode, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_DIVX},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextContentEncAESSettings = {0x47E7, EBML_MASTER_CLASS, 0, 0, "ContentEncAESSettings", EBML_SemanticContentEncAESSettings, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsContentEncAESSettings[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexContentEncAESSettings = {0x9E3779B1, 31, EBML_IndexSlotsContentEncAESSettings};
+const ebml_context MATROSKA_ContextContentEncAESSettings = {0x47E7, EBML_MASTER_CLASS, 0, 0, "ContentEncAESSettings", EBML_SemanticContentEncAESSettings, EBML_SemanticGlobals, NULL, &EBML_IndexContentEncAESSettings};
 const ebml_context MATROSKA_ContextContentSignature = {0x47E3, EBML_BINARY_CLASS, 0, 0, "ContentSignature", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextContentSigKeyID = {0x47E4, EBML_BINARY_CLASS, 0, 0, "ContentSigKeyID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextContentSigAlgo = {0x47E5, EBML_INTEGER_CLASS, 1, (intptr_t)0, "ContentSigAlgo", NULL, EBML_SemanticGlobals, NULL};
@@ -422,7 +525,11 @@ const ebml_semantic EBML_SemanticContentEncryption[] = {
     {0, 1, &MATROSKA_ContextContentSigHashAlgo, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextContentEncryption = {0x5035, EBML_MASTER_CLASS, 0, 0, "ContentEncryption", EBML_SemanticContentEncryption, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsContentEncryption[] = {
+    2, 0, 3, 0, 5, 0, 0, 1, 7, 0, 4, 0, 0, 0, 6, 0,
+};
+static const ebml_semantic_index EBML_IndexContentEncryption = {0x9E3779B1, 28, EBML_IndexSlotsContentEncryption};
+const ebml_context MATROSKA_ContextContentEncryption = {0x5035, EBML_MASTER_CLASS, 0, 0, "ContentEncryption", EBML_SemanticContentEncryption, EBML_SemanticGlobals, NULL, &EBML_IndexContentEncryption};
 
 const ebml_semantic EBML_SemanticContentEncoding[] = {
     {1, 1, &MATROSKA_ContextContentEncodingOrder, 0},
@@ -432,13 +539,21 @@ const ebml_semantic EBML_SemanticContentEncoding[] = {
     {1, 1, &MATROSKA_ContextContentEncryption, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextContentEncoding = {0x6240, EBML_MASTER_CLASS, 0, 0, "ContentEncoding", EBML_SemanticContentEncoding, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsContentEncoding[] = {
+    0, 5, 0, 2, 0, 0, 0, 4, 0, 1, 0, 0, 0, 3, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexContentEncoding = {0x9E3779B1, 28, EBML_IndexSlotsContentEncoding};
+const ebml_context MATROSKA_ContextContentEncoding = {0x6240, EBML_MASTER_CLASS, 0, 0, "ContentEncoding", EBML_SemanticContentEncoding, EBML_SemanticGlobals, NULL, &EBML_IndexContentEncoding};
 
 const ebml_semantic EBML_SemanticContentEncodings[] = {
     {1, 0, &MATROSKA_ContextContentEncoding, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextContentEncodings = {0x6D80, EBML_MASTER_CLASS, 0, 0, "ContentEncodings", EBML_SemanticContentEncodings, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsContentEncodings[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexContentEncodings = {0x9E3779B1, 31, EBML_IndexSlotsContentEncodings};
+const ebml_context MATROSKA_ContextContentEncodings = {0x6D80, EBML_MASTER_CLASS, 0, 0, "ContentEncodings", EBML_SemanticContentEncodings, EBML_SemanticGlobals, NULL, &EBML_IndexContentEncodings};
 
 const ebml_semantic EBML_SemanticTrackEntry[] = {
     {1, 1, &MATROSKA_ContextTrackNumber, 0},
@@ -481,13 +596,28 @@ const ebml_semantic EBML_SemanticTrackEntry[] = {
     {0, 1, &MATROSKA_ContextContentEncodings, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTrackEntry = {0xAE, MATROSKA_TRACKENTRY_CLASS, 0, 0, "TrackEntry", EBML_SemanticTrackEntry, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTrackEntry[] = {
+    2, 0, 38, 37, 14, 0, 0, 0, 35, 0, 0, 36, 0, 0, 19, 0,
+    0, 8, 0, 0, 0, 0, 0, 0, 0, 0, 7, 0, 0, 13, 0, 28,
+    0, 0, 23, 0, 12, 0, 0, 29, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 1, 26, 0, 0, 0, 0, 0, 0, 0, 9, 25,
+    0, 0, 0, 0, 0, 0, 0, 0, 16, 0, 0, 17, 0, 30, 0, 31,
+    24, 6, 32, 21, 0, 0, 0, 0, 3, 0, 0, 10, 11, 0, 0, 0,
+    18, 0, 0, 22, 0, 5, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    15, 0, 27, 0, 0, 0, 0, 0, 0, 33, 20, 34, 0, 0, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexTrackEntry = {0x0542AEC9, 25, EBML_IndexSlotsTrackEntry};
+const ebml_context MATROSKA_ContextTrackEntry = {0xAE, MATROSKA_TRACKENTRY_CLASS, 0, 0, "TrackEntry", EBML_SemanticTrackEntry, EBML_SemanticGlobals, NULL, &EBML_IndexTrackEntry};
 
 const ebml_semantic EBML_SemanticTracks[] = {
     {1, 0, &MATROSKA_ContextTrackEntry, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTracks = {0x1654AE6B, EBML_MASTER_CLASS, 0, 0, "Tracks", EBML_SemanticTracks, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTracks[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexTracks = {0x9E3779B1, 31, EBML_IndexSlotsTracks};
+const ebml_context MATROSKA_ContextTracks = {0x1654AE6B, EBML_MASTER_CLASS, 0, 0, "Tracks", EBML_SemanticTracks, EBML_SemanticGlobals, NULL, &EBML_IndexTracks};
 const ebml_context MATROSKA_ContextCueTime = {0xB3, EBML_INTEGER_CLASS, 0, 0, "CueTime", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextCueTrack = {0xF7, EBML_INTEGER_CLASS, 0, 0, "CueTrack", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextCueClusterPosition = {0xF1, EBML_INTEGER_CLASS, 0, 0, "CueClusterPosition", NULL, EBML_SemanticGlobals, NULL};
@@ -507,7 +637,11 @@ const ebml_semantic EBML_SemanticCueReference[] = {
     {0, 1, &MATROSKA_ContextCueRefCodecState, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextCueReference = {0xDB, EBML_MASTER_CLASS, 0, 0, "CueReference", EBML_SemanticCueReference, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsCueReference[] = {
+    0, 0, 3, 0, 4, 1, 0, 2,
+};
+static const ebml_semantic_index EBML_IndexCueReference = {0x4205A75D, 29, EBML_IndexSlotsCueReference};
+const ebml_context MATROSKA_ContextCueReference = {0xDB, EBML_MASTER_CLASS, 0, 0, "CueReference", EBML_SemanticCueReference, EBML_SemanticGlobals, NULL, &EBML_IndexCueReference};
 
 const ebml_semantic EBML_SemanticCueTrackPositions[] = {
     {1, 1, &MATROSKA_ContextCueTrack, 0},
@@ -519,20 +653,32 @@ const ebml_semantic EBML_SemanticCueTrackPositions[] = {
     {0, 0, &MATROSKA_ContextCueReference, PROFILE_MATROSKA_V1|PROFILE_DIVX|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextCueTrackPositions = {0xB7, EBML_MASTER_CLASS, 0, 0, "CueTrackPositions", EBML_SemanticCueTrackPositions, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsCueTrackPositions[] = {
+    4, 0, 0, 0, 0, 0, 6, 0, 3, 7, 5, 2, 0, 1, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexCueTrackPositions = {0x2F7C8119, 28, EBML_IndexSlotsCueTrackPositions};
+const ebml_context MATROSKA_ContextCueTrackPositions = {0xB7, EBML_MASTER_CLASS, 0, 0, "CueTrackPositions", EBML_SemanticCueTrackPositions, EBML_SemanticGlobals, NULL, &EBML_IndexCueTrackPositions};
 
 const ebml_semantic EBML_SemanticCuePoint[] = {
     {1, 1, &MATROSKA_ContextCueTime, 0},
     {1, 0, &MATROSKA_ContextCueTrackPositions, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextCuePoint = {0xBB, MATROSKA_CUEPOINT_CLASS, 0, 0, "CuePoint", EBML_SemanticCuePoint, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsCuePoint[] = {
+    2, 0, 1, 0,
+};
+static const ebml_semantic_index EBML_IndexCuePoint = {0x9E3779B1, 30, EBML_IndexSlotsCuePoint};
+const ebml_context MATROSKA_ContextCuePoint = {0xBB, MATROSKA_CUEPOINT_CLASS, 0, 0, "CuePoint", EBML_SemanticCuePoint, EBML_SemanticGlobals, NULL, &EBML_IndexCuePoint};
 
 const ebml_semantic EBML_SemanticCues[] = {
     {1, 0, &MATROSKA_ContextCuePoint, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextCues = {0x1C53BB6B, EBML_MASTER_CLASS, 0, 0, "Cues", EBML_SemanticCues, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsCues[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexCues = {0x9E3779B1, 31, EBML_IndexSlotsCues};
+const ebml_context MATROSKA_ContextCues = {0x1C53BB6B, EBML_MASTER_CLASS, 0, 0, "Cues", EBML_SemanticCues, EBML_SemanticGlobals, NULL, &EBML_IndexCues};
 const ebml_context MATROSKA_ContextFileDescription = {0x467E, EBML_UNISTRING_CLASS, 0, 0, "FileDescription", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextFileName = {0x466E, EBML_UNISTRING_CLASS, 0, 0, "FileName", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextFileMimeType = {0x4660, EBML_STRING_CLASS, 0, 0, "FileMimeType", NULL, EBML_SemanticGlobals, NULL};
@@ -553,13 +699,21 @@ const ebml_semantic EBML_SemanticAttachedFile[] = {
     {0, 1, &MATROSKA_ContextFileUsedEndTime, PROFILE_MATROSKA_V1|PROFILE_MATROSKA_V2|PROFILE_MATROSKA_V3|PROFILE_MATROSKA_V4|PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextAttachedFile = {0x61A7, MATROSKA_ATTACHMENT_CLASS, 0, 0, "AttachedFile", EBML_SemanticAttachedFile, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsAttachedFile[] = {
+    7, 4, 0, 8, 0, 5, 1, 2, 0, 0, 0, 6, 0, 3, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexAttachedFile = {0x2F7C8119, 28, EBML_IndexSlotsAttachedFile};
+const ebml_context MATROSKA_ContextAttachedFile = {0x61A7, MATROSKA_ATTACHMENT_CLASS, 0, 0, "AttachedFile", EBML_SemanticAttachedFile, EBML_SemanticGlobals, NULL, &EBML_IndexAttachedFile};
 
 const ebml_semantic EBML_SemanticAttachments[] = {
     {1, 0, &MATROSKA_ContextAttachedFile, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextAttachments = {0x1941A469, EBML_MASTER_CLASS, 0, 0, "Attachments", EBML_SemanticAttachments, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsAttachments[] = {
+    1, 0,
+};
+static const ebml_semantic_index EBML_IndexAttachments = {0x9E3779B1, 31, EBML_IndexSlotsAttachments};
+const ebml_context MATROSKA_ContextAttachments = {0x1941A469, EBML_MASTER_CLASS, 0, 0, "Attachments", EBML_SemanticAttachments, EBML_SemanticGlobals, NULL, &EBML_IndexAttachments};
 const ebml_context MATROSKA_ContextEditionUID = {0x45BC, EBML_INTEGER_CLASS, 0, 0, "EditionUID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextEditionFlagHidden = {0x45BD, EBML_BOOLEAN_CLASS, 1, (intptr_t)0, "EditionFlagHidden", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextEditionFlagDefault = {0x45DB, EBML_BOOLEAN_CLASS, 1, (intptr_t)0, "EditionFlagDefault", NULL, EBML_SemanticGlobals, NULL};
@@ -579,7 +733,11 @@ const ebml_semantic EBML_SemanticChapterTrack[] = {
     {1, 0, &MATROSKA_ContextChapterTrackNumber, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapterTrack = {0x8F, EBML_MASTER_CLASS, 0, 0, "ChapterTrack", EBML_SemanticChapterTrack, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapterTrack[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexChapterTrack = {0x9E3779B1, 31, EBML_IndexSlotsChapterTrack};
+const ebml_context MATROSKA_ContextChapterTrack = {0x8F, EBML_MASTER_CLASS, 0, 0, "ChapterTrack", EBML_SemanticChapterTrack, EBML_SemanticGlobals, NULL, &EBML_IndexChapterTrack};
 const ebml_context MATROSKA_ContextChapString = {0x85, EBML_UNISTRING_CLASS, 0, 0, "ChapString", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextChapLanguage = {0x437C, EBML_STRING_CLASS, 1, (intptr_t)"eng", "ChapLanguage", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextChapLanguageIETF = {0x437D, EBML_STRING_CLASS, 0, 0, "ChapLanguageIETF", NULL, EBML_SemanticGlobals, NULL};
@@ -592,7 +750,11 @@ const ebml_semantic EBML_SemanticChapterDisplay[] = {
     {0, 0, &MATROSKA_ContextChapCountry, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapterDisplay = {0x80, EBML_MASTER_CLASS, 0, 0, "ChapterDisplay", EBML_SemanticChapterDisplay, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapterDisplay[] = {
+    0, 0, 1, 2, 0, 3, 0, 4,
+};
+static const ebml_semantic_index EBML_IndexChapterDisplay = {0x4205A75D, 29, EBML_IndexSlotsChapterDisplay};
+const ebml_context MATROSKA_ContextChapterDisplay = {0x80, EBML_MASTER_CLASS, 0, 0, "ChapterDisplay", EBML_SemanticChapterDisplay, EBML_SemanticGlobals, NULL, &EBML_IndexChapterDisplay};
 const ebml_context MATROSKA_ContextChapProcessCodecID = {0x6955, EBML_INTEGER_CLASS, 1, (intptr_t)0, "ChapProcessCodecID", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextChapProcessPrivate = {0x450D, EBML_BINARY_CLASS, 0, 0, "ChapProcessPrivate", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextChapProcessTime = {0x6922, EBML_INTEGER_CLASS, 0, 0, "ChapProcessTime", NULL, EBML_SemanticGlobals, NULL};
@@ -603,7 +765,11 @@ const ebml_semantic EBML_SemanticChapProcessCommand[] = {
     {1, 1, &MATROSKA_ContextChapProcessData, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapProcessCommand = {0x6911, EBML_MASTER_CLASS, 0, 0, "ChapProcessCommand", EBML_SemanticChapProcessCommand, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapProcessCommand[] = {
+    0, 2, 0, 1,
+};
+static const ebml_semantic_index EBML_IndexChapProcessCommand = {0x9E3779B1, 30, EBML_IndexSlotsChapProcessCommand};
+const ebml_context MATROSKA_ContextChapProcessCommand = {0x6911, EBML_MASTER_CLASS, 0, 0, "ChapProcessCommand", EBML_SemanticChapProcessCommand, EBML_SemanticGlobals, NULL, &EBML_IndexChapProcessCommand};
 
 const ebml_semantic EBML_SemanticChapProcess[] = {
     {1, 1, &MATROSKA_ContextChapProcessCodecID, PROFILE_WEBM},
@@ -611,7 +777,11 @@ const ebml_semantic EBML_SemanticChapProcess[] = {
     {0, 0, &MATROSKA_ContextChapProcessCommand, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapProcess = {0x6944, EBML_MASTER_CLASS, 0, 0, "ChapProcess", EBML_SemanticChapProcess, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapProcess[] = {
+    0, 1, 0, 0, 0, 3, 0, 2,
+};
+static const ebml_semantic_index EBML_IndexChapProcess = {0x4205A75D, 29, EBML_IndexSlotsChapProcess};
+const ebml_context MATROSKA_ContextChapProcess = {0x6944, EBML_MASTER_CLASS, 0, 0, "ChapProcess", EBML_SemanticChapProcess, EBML_SemanticGlobals, NULL, &EBML_IndexChapProcess};
 
 const ebml_semantic EBML_SemanticChapterAtom[] = {
     {0, 0, &MATROSKA_ContextChapterAtom, 0}, // recursive
@@ -629,7 +799,12 @@ const ebml_semantic EBML_SemanticChapterAtom[] = {
     {0, 0, &MATROSKA_ContextChapProcess, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapterAtom = {0xB6, EBML_MASTER_CLASS, 0, 0, "ChapterAtom", EBML_SemanticChapterAtom, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapterAtom[] = {
+    12, 0, 2, 0, 0, 0, 6, 0, 0, 0, 0, 0, 4, 0, 0, 10,
+    0, 0, 3, 0, 5, 0, 0, 7, 0, 0, 0, 13, 11, 9, 1, 8,
+};
+static const ebml_semantic_index EBML_IndexChapterAtom = {0x4205A75D, 27, EBML_IndexSlotsChapterAtom};
+const ebml_context MATROSKA_ContextChapterAtom = {0xB6, EBML_MASTER_CLASS, 0, 0, "ChapterAtom", EBML_SemanticChapterAtom, EBML_SemanticGlobals, NULL, &EBML_IndexChapterAtom};
 
 const ebml_semantic EBML_SemanticEditionEntry[] = {
     {0, 1, &MATROSKA_ContextEditionUID, PROFILE_WEBM},
@@ -639,13 +814,21 @@ const ebml_semantic EBML_SemanticEditionEntry[] = {
     {1, 0, &MATROSKA_ContextChapterAtom, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextEditionEntry = {0x45B9, EBML_MASTER_CLASS, 0, 0, "EditionEntry", EBML_SemanticEditionEntry, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsEditionEntry[] = {
+    0, 0, 1, 0, 3, 0, 0, 5, 4, 0, 0, 0, 2, 0, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexEditionEntry = {0x9E3779B1, 28, EBML_IndexSlotsEditionEntry};
+const ebml_context MATROSKA_ContextEditionEntry = {0x45B9, EBML_MASTER_CLASS, 0, 0, "EditionEntry", EBML_SemanticEditionEntry, EBML_SemanticGlobals, NULL, &EBML_IndexEditionEntry};
 
 const ebml_semantic EBML_SemanticChapters[] = {
     {1, 0, &MATROSKA_ContextEditionEntry, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextChapters = {0x1043A770, EBML_MASTER_CLASS, 0, 0, "Chapters", EBML_SemanticChapters, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsChapters[] = {
+    1, 0,
+};
+static const ebml_semantic_index EBML_IndexChapters = {0x9E3779B1, 31, EBML_IndexSlotsChapters};
+const ebml_context MATROSKA_ContextChapters = {0x1043A770, EBML_MASTER_CLASS, 0, 0, "Chapters", EBML_SemanticChapters, EBML_SemanticGlobals, NULL, &EBML_IndexChapters};
 const ebml_context MATROSKA_ContextTargetTypeValue = {0x68CA, EBML_INTEGER_CLASS, 1, (intptr_t)50, "TargetTypeValue", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTargetType = {0x63CA, EBML_STRING_CLASS, 0, 0, "TargetType", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTagTrackUID = {0x63C5, EBML_INTEGER_CLASS, 1, (intptr_t)0, "TagTrackUID", NULL, EBML_SemanticGlobals, NULL};
@@ -662,7 +845,11 @@ const ebml_semantic EBML_SemanticTargets[] = {
     {0, 0, &MATROSKA_ContextTagAttachmentUID, PROFILE_WEBM},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTargets = {0x63C0, EBML_MASTER_CLASS, 0, 0, "Targets", EBML_SemanticTargets, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTargets[] = {
+    0, 0, 0, 3, 2, 0, 1, 0, 0, 5, 4, 0, 0, 6, 0, 0,
+};
+static const ebml_semantic_index EBML_IndexTargets = {0x9E3779B1, 28, EBML_IndexSlotsTargets};
+const ebml_context MATROSKA_ContextTargets = {0x63C0, EBML_MASTER_CLASS, 0, 0, "Targets", EBML_SemanticTargets, EBML_SemanticGlobals, NULL, &EBML_IndexTargets};
 const ebml_context MATROSKA_ContextTagName = {0x45A3, EBML_UNISTRING_CLASS, 0, 0, "TagName", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTagLanguage = {0x447A, EBML_STRING_CLASS, 1, (intptr_t)"und", "TagLanguage", NULL, EBML_SemanticGlobals, NULL};
 const ebml_context MATROSKA_ContextTagLanguageIETF = {0x447B, EBML_STRING_CLASS, 0, 0, "TagLanguageIETF", NULL, EBML_SemanticGlobals, NULL};
@@ -680,20 +867,32 @@ const ebml_semantic EBML_SemanticSimpleTag[] = {
     {0, 1, &MATROSKA_ContextTagBinary, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextSimpleTag = {0x67C8, EBML_MASTER_CLASS, 0, 0, "SimpleTag", EBML_SemanticSimpleTag, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsSimpleTag[] = {
+    2, 0, 0, 0, 4, 0, 3, 0, 6, 0, 1, 0, 0, 7, 0, 5,
+};
+static const ebml_semantic_index EBML_IndexSimpleTag = {0xDB77C4C1, 28, EBML_IndexSlotsSimpleTag};
+const ebml_context MATROSKA_ContextSimpleTag = {0x67C8, EBML_MASTER_CLASS, 0, 0, "SimpleTag", EBML_SemanticSimpleTag, EBML_SemanticGlobals, NULL, &EBML_IndexSimpleTag};
 
 const ebml_semantic EBML_SemanticTag[] = {
     {1, 1, &MATROSKA_ContextTargets, 0},
     {1, 0, &MATROSKA_ContextSimpleTag, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTag = {0x7373, EBML_MASTER_CLASS, 0, 0, "Tag", EBML_SemanticTag, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTag[] = {
+    1, 0, 0, 2,
+};
+static const ebml_semantic_index EBML_IndexTag = {0x9E3779B1, 30, EBML_IndexSlotsTag};
+const ebml_context MATROSKA_ContextTag = {0x7373, EBML_MASTER_CLASS, 0, 0, "Tag", EBML_SemanticTag, EBML_SemanticGlobals, NULL, &EBML_IndexTag};
 
 const ebml_semantic EBML_SemanticTags[] = {
     {1, 0, &MATROSKA_ContextTag, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextTags = {0x1254C367, EBML_MASTER_CLASS, 0, 0, "Tags", EBML_SemanticTags, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsTags[] = {
+    0, 1,
+};
+static const ebml_semantic_index EBML_IndexTags = {0x9E3779B1, 31, EBML_IndexSlotsTags};
+const ebml_context MATROSKA_ContextTags = {0x1254C367, EBML_MASTER_CLASS, 0, 0, "Tags", EBML_SemanticTags, EBML_SemanticGlobals, NULL, &EBML_IndexTags};
 
 const ebml_semantic EBML_SemanticSegment[] = {
     {0, 0, &MATROSKA_ContextSeekHead, 0},
@@ -706,4 +905,8 @@ const ebml_semantic EBML_SemanticSegment[] = {
     {0, 0, &MATROSKA_ContextTags, 0},
     {0, 0, NULL ,0} // end of the table
 };
-const ebml_context MATROSKA_ContextSegment = {0x18538067, EBML_MASTER_CLASS, 0, 0, "Segment", EBML_SemanticSegment, EBML_SemanticGlobals, NULL};
+static const uint8_t EBML_IndexSlotsSegment[] = {
+    3, 0, 0, 0, 8, 7, 0, 5, 0, 6, 1, 0, 0, 0, 2, 4,
+};
+static const ebml_semantic_index EBML_IndexSegment = {0x9E3779B1, 28, EBML_IndexSlotsSegment};
+const ebml_context MATROSKA_ContextSegment = {0x18538067, EBML_MASTER_CLASS, 0, 0, "Segment", EBML_SemanticSegment, EBML_SemanticGlobals, NULL, &EBML_IndexSegment};
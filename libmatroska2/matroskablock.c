@@ -67,260 +67,296 @@ static const int A_DTS_freq[16] = {
 };
 
 
-err_t MATROSKA_BlockProcessFrameDurations(matroska_block *Block, stream *Input)
+#define TRACKCODEC_NONE     0 // the frame durations are not known
+#define TRACKCODEC_KEYFRAME 1 // only keyframes but the frame durations are not known
+#define TRACKCODEC_FIXED    2 // all the frames have the same duration
+#define TRACKCODEC_MPEG     3
+#define TRACKCODEC_AC3      4
+#define TRACKCODEC_EAC3     5
+#define TRACKCODEC_DTS      6
+#define TRACKCODEC_VORBIS   7
+
+#if defined(CONFIG_CODEC_HELPER)
+static err_t ReadVorbisSetup(matroska_trackcodec *Codec, ebml_binary *CodecPrivate)
 {
-    ebml_master *Track=NULL;
+    vorbis_info vi;
+    vorbis_comment vc;
+    ogg_packet OggPacket;
+    ogg_reference OggRef;
+    ogg_buffer OggBuffer;
+    int n,i,j;
+    codec_setup_info *ci;
+    err_t Err = ERR_INVALID_DATA;
+
+    if (CodecPrivate->Base.DataSize < 1)
+        return ERR_INVALID_DATA;
+
+    vorbis_info_init(&vi);
+    vorbis_comment_init(&vc);
+    memset(&OggPacket,0,sizeof(ogg_packet));
+
+    OggBuffer.data = (uint8_t*)EBML_BinaryGetData(CodecPrivate);
+    OggBuffer.size = (long)CodecPrivate->Base.DataSize;
+    OggBuffer.refcount = 1;
+
+    memset(&OggRef,0,sizeof(OggRef));
+    OggRef.buffer = &OggBuffer;
+    OggRef.next = NULL;
+
+    OggPacket.packet = &OggRef;
+    OggPacket.packetno = -1; 
+
+    n = OggBuffer.data[0];
+    i = 1+n;
+    j = 1;
+
+    while (OggPacket.packetno < 3 && n>=j)
+    {
+        OggRef.begin = i;
+        OggRef.length = 0;
+        do
+        {
+            OggRef.length += OggBuffer.data[j];
+        }
+        while (OggBuffer.data[j++] == 255 && n>=j);
+        i += OggRef.length;
+
+        if (i > OggBuffer.size)
+            goto exit;
+
+        ++OggPacket.packetno;
+        OggPacket.b_o_s = OggPacket.packetno == 0;
+        OggPacket.bytes = OggPacket.packet->length;
+        if (!(vorbis_synthesis_headerin(&vi,&vc,&OggPacket) >= 0) && OggPacket.packetno==0)
+            goto exit;
+    }
+
+    if (OggPacket.packetno < 3)
+    {
+        OggRef.begin = i;
+        OggRef.length = OggBuffer.size - i; 
+
+        ++OggPacket.packetno;
+        OggPacket.b_o_s = OggPacket.packetno == 0;
+        OggPacket.bytes = OggPacket.packet->length;
+
+        if (!(vorbis_synthesis_headerin(&vi,&vc,&OggPacket) >= 0) && OggPacket.packetno==0)
+            goto exit;
+    }
+
+    // only keep what is needed to get the duration of a packet
+    ci = vi.codec_setup;
+    if (!ci || ci->modes <= 0 || ci->modes > (int)sizeof(Codec->VorbisBlockFlag) || vi.rate <= 0)
+        goto exit;
+    Codec->VorbisModes = ci->modes;
+    Codec->VorbisModeBits = _ilog(ci->modes-1);
+    for (n=0;n<ci->modes;++n)
+        Codec->VorbisBlockFlag[n] = (uint8_t)(ci->mode_param[n]->blockflag != 0);
+    Codec->Duration[0] = Scale64(1000000000,ci->blocksizes[0],vi.rate);
+    Codec->Duration[1] = Scale64(1000000000,ci->blocksizes[1],vi.rate);
+    Err = ERR_NONE;
+
+exit:
+    vorbis_comment_clear(&vc);
+    vorbis_info_clear(&vi);
+    return Err;
+}
+#endif
+
+static const matroska_trackcodec *TrackCodec(ebml_master *Track)
+{
+    // the track values needed for the frame durations, only read once per track
+    matroska_trackcodec *Codec = MATROSKA_TrackCodec(Track);
     ebml_element *Elt;
     tchar_t CodecID[MAXPATH];
+
+    if (Codec->Resolved)
+        return Codec;
+
+    Codec->Resolved = 1;
+    Codec->Err = ERR_NONE;
+    Codec->Codec = TRACKCODEC_NONE;
+    Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextTrackType);
+    if (!Elt || EBML_IntegerValue((ebml_integer*)Elt)!=TRACK_TYPE_AUDIO) // other track types not supported for now
+        Codec->Err = ERR_INVALID_DATA;
+    else
+    {
+        Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextCodecID);
+        if (!Elt) // missing codec ID
+            Codec->Err = ERR_INVALID_DATA;
+        else
+        {
+            EBML_StringGet((ebml_string*)Elt,CodecID,TSIZEOF(CodecID));
+            if (tcsisame_ascii(CodecID,T("A_MPEG/L3")) || tcsisame_ascii(CodecID,T("A_MPEG/L2")) || tcsisame_ascii(CodecID,T("A_MPEG/L1")))
+                Codec->Codec = TRACKCODEC_MPEG;
+            else if (tcsisame_ascii(CodecID,T("A_AC3")))
+                Codec->Codec = TRACKCODEC_AC3;
+            else if (tcsisame_ascii(CodecID,T("A_EAC3")))
+                Codec->Codec = TRACKCODEC_EAC3;
+            else if (tcsisame_ascii(CodecID,T("A_DTS")))
+                Codec->Codec = TRACKCODEC_DTS;
+            else if (tcsisame_ascii(CodecID,T("A_AAC")) || tcsncmp(CodecID,T("A_AAC/"),6)==0)
+            {
+                Codec->Codec = TRACKCODEC_KEYFRAME;
+                Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextAudio);
+                if (Elt)
+                {
+                    Elt = EBML_MasterFindChild((ebml_master*)Elt,&MATROSKA_ContextSamplingFrequency);
+                    if (Elt && (int)((ebml_float*)Elt)->Value > 0)
+                    {
+                        Codec->Codec = TRACKCODEC_FIXED;
+                        Codec->Duration[0] = Scale64(1000000000,1024,(int)((ebml_float*)Elt)->Value);
+                    }
+                }
+            }
+#if defined(CONFIG_CODEC_HELPER)
+            else if (tcsisame_ascii(CodecID,T("A_VORBIS")))
+            {
+                Codec->Codec = TRACKCODEC_KEYFRAME;
+                Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextCodecPrivate);
+                if (Elt)
+                {
+                    Codec->Err = ReadVorbisSetup(Codec,(ebml_binary*)Elt);
+                    if (Codec->Err==ERR_NONE)
+                        Codec->Codec = TRACKCODEC_VORBIS;
+                }
+            }
+#endif
+        }
+    }
+    return Codec;
+}
+
+err_t MATROSKA_BlockProcessFrameDurations(matroska_block *Block, stream *Input)
+{
+    ebml_master *Track=NULL;
+    const matroska_trackcodec *Codec;
     err_t Err;
     bool_t ReadData;
-    uint8_t *Cursor;
+    const uint8_t *Cursor;
     size_t Frame;
     int Version, Layer, SampleRate, Samples, fscod, fscod2;
 
     Err = Node_GET(Block,MATROSKA_BLOCK_READ_TRACK,&Track);
-    if (Err==ERR_NONE)
+    if (Err!=ERR_NONE)
+        return Err;
+    assert(Track!=NULL);
+    Codec = TrackCodec(Track);
+    if (Codec->Err!=ERR_NONE)
+        return Codec->Err;
+    if (Block->FirstFrameLocation==0)
+        return ERR_READ;
+    if (Codec->Codec==TRACKCODEC_NONE)
+        return ERR_NONE;
+
+    Block->IsKeyframe = 1; // safety
+    if (Codec->Codec==TRACKCODEC_KEYFRAME)
+        return ERR_NONE;
+
+    ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
+    if (Codec->Codec==TRACKCODEC_FIXED)
     {
-        assert(Track!=NULL);
-        Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextTrackType);
-        if (!Elt || EBML_IntegerValue((ebml_integer*)Elt)!=TRACK_TYPE_AUDIO) // other track types not supported for now
-            Err = ERR_INVALID_DATA;
-        else
+        for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
+            ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Codec->Duration[0];
+        return ERR_NONE;
+    }
+
+    // the other codecs need the frame data
+    ReadData = 0;
+    if (!MATROSKA_BlockDataSize(Block))
+    {
+        Err = MATROSKA_BlockReadData(Block,Input);
+        if (Err!=ERR_NONE)
+            return Err;
+        ReadData = 1;
+    }
+
+    Cursor = MATROSKA_BlockDataBegin(Block);
+    for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
+    {
+        switch (Codec->Codec)
         {
-            if (Block->FirstFrameLocation==0)
-                Err = ERR_READ;
+        case TRACKCODEC_MPEG:
+            Version = (Cursor[1] >> 3) & 3;
+            Layer = (Cursor[1] >> 1) & 3;
+            SampleRate = (Cursor[2] >> 2) & 3;
+
+            Samples = A_MPEG_samples[Layer][Version];
+            SampleRate = A_MPEG_freq[SampleRate][Version];
+            if (SampleRate!=0 && Samples!=0)
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
             else
             {
-                Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextCodecID);
-                if (!Elt) // missing codec ID
-                    Err = ERR_INVALID_DATA;
-                else
-                {
-                    EBML_StringGet((ebml_string*)Elt,CodecID,TSIZEOF(CodecID));
-                    ReadData = 0;
-                    if (!ArraySize(&Block->Data))
-                    {
-                        Err = MATROSKA_BlockReadData(Block,Input);
-                        if (Err!=ERR_NONE)
-                            goto exit;
-                        ReadData = 1;
-                    }
+                Err = ERR_INVALID_DATA;
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
+            }
+            break;
 
-                    if (tcsisame_ascii(CodecID,T("A_MPEG/L3")) || tcsisame_ascii(CodecID,T("A_MPEG/L2")) || tcsisame_ascii(CodecID,T("A_MPEG/L1")))
-                    {
-                        Block->IsKeyframe = 1; // safety
-                        ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
-                        Cursor = ARRAYBEGIN(Block->Data,uint8_t);
-                        for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
-                        {
-                            Version = (Cursor[1] >> 3) & 3;
-                            Layer = (Cursor[1] >> 1) & 3;
-                            SampleRate = (Cursor[2] >> 2) & 3;
-
-                            Samples = A_MPEG_samples[Layer][Version];
-                            SampleRate = A_MPEG_freq[SampleRate][Version];
-                            if (SampleRate!=0 && Samples!=0)
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
-                            else
-                            {
-                                Err = ERR_INVALID_DATA;
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
-                                //goto exit;
-                            }
-
-                            Cursor += ARRAYBEGIN(Block->SizeList,int32_t)[Frame];
-                        }
-                    }
-                    else if (tcsisame_ascii(CodecID,T("A_AC3")))
-                    {
-                        Block->IsKeyframe = 1; // safety
-                        ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
-                        Cursor = ARRAYBEGIN(Block->Data,uint8_t);
-                        for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
-                        {
-                            fscod =  Cursor[5] >> 3;
-                            SampleRate = Cursor[4] >> 6;
-                            if (fscod > 10 || fscod < 8)
-                            {
-                                Err = ERR_INVALID_DATA;
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
-                                //goto exit;
-                            }
-                            else
-                            {
-                                SampleRate = A_AC3_freq[fscod-8][SampleRate];
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,1536,SampleRate);
-                            }
-                            Cursor += ARRAYBEGIN(Block->SizeList,int32_t)[Frame];
-                        }
-                    }
-                    else if (tcsisame_ascii(CodecID,T("A_EAC3")))
-                    {
-                        Block->IsKeyframe = 1; // safety
-                        ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
-                        Cursor = ARRAYBEGIN(Block->Data,uint8_t);
-                        for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
-                        {
-                            fscod =  Cursor[4] >> 6;
-                            fscod2 = (Cursor[4] >> 4) & 0x03;
-                            if ((0x03 == fscod) && (0x03 == fscod2))
-                            {
-                                Err = ERR_INVALID_DATA;
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
-                                //goto exit;
-                            }
-                            else
-                            {
-                                SampleRate = A_EAC3_freq[0x03 == fscod ? 3 + fscod2 : fscod];
-                                Samples = (0x03 == fscod) ? 1536 : A_EAC3_samples[fscod2];
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
-                            }
-                            Cursor += ARRAYBEGIN(Block->SizeList,int32_t)[Frame];
-                        }
-                    }
-                    else if (tcsisame_ascii(CodecID,T("A_DTS")))
-                    {
-                        Block->IsKeyframe = 1; // safety
-                        ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
-                        Cursor = ARRAYBEGIN(Block->Data,uint8_t);
-                        for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
-                        {
-                            Samples = (((Cursor[4] & 1) << 7) + (Cursor[5] >> 2) + 1) * 32;
-                            // TODO: handle the frame termination
-                            SampleRate = A_DTS_freq[(Cursor[8] >> 2) & 0x0F];
-                            if (Samples==0 || SampleRate==0)
-                            {
-                                Err = ERR_INVALID_DATA;
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
-                                //goto exit;
-                            }
-                            else
-                                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
-                            Cursor += ARRAYBEGIN(Block->SizeList,int32_t)[Frame];
-                        }
-                    }
-                    else if (tcsisame_ascii(CodecID,T("A_AAC")) || tcsncmp(CodecID,T("A_AAC/"),6)==0)
-                    {
-                        Block->IsKeyframe = 1; // safety
-                        Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextAudio);
-                        if (Elt)
-                        {
-                            Elt = EBML_MasterFindChild((ebml_master*)Elt,&MATROSKA_ContextSamplingFrequency);
-                            if (Elt)
-                            {
-                                ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
-                                Samples = 1024;
-                                SampleRate = (int)((ebml_float*)Elt)->Value;
-                                for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
-                                    ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
-                            }
-                        }
-                    }
-#if defined(CONFIG_CODEC_HELPER)
-                    else if (tcsisame_ascii(CodecID,T("A_VORBIS")))
-                    {
-                        Block->IsKeyframe = 1; // safety
-                        Elt = EBML_MasterFindChild(Track,&MATROSKA_ContextCodecPrivate);
-                        if (Elt)
-                        {
-                            vorbis_info vi;
-                            vorbis_comment vc;
-                            ogg_packet OggPacket;
-                        	ogg_reference OggRef;
-                        	ogg_buffer OggBuffer;
-                            int n,i,j;
-                            codec_setup_info *ci;
-
-		                    vorbis_info_init(&vi);
-		                    vorbis_comment_init(&vc);
-                            memset(&OggPacket,0,sizeof(ogg_packet));
-
-		                    OggBuffer.data = (uint8_t*)EBML_BinaryGetData((ebml_binary*)Elt);
-		                    OggBuffer.size = (long)Elt->DataSize;
-		                    OggBuffer.refcount = 1;
-
-                            memset(&OggRef,0,sizeof(OggRef));
-		                    OggRef.buffer = &OggBuffer;
-		                    OggRef.next = NULL;
-
-		                    OggPacket.packet = &OggRef;
-		                    OggPacket.packetno = -1; 
-
-		                    n = OggBuffer.data[0];
-		                    i = 1+n;
-		                    j = 1;
-
-		                    while (OggPacket.packetno < 3 && n>=j)
-		                    {
-			                    OggRef.begin = i;
-			                    OggRef.length = 0;
-			                    do
-			                    {
-				                    OggRef.length += OggBuffer.data[j];
-			                    }
-			                    while (OggBuffer.data[j++] == 255 && n>=j);
-			                    i += OggRef.length;
-
-			                    if (i > OggBuffer.size)
-				                    return ERR_INVALID_DATA;
-
-	                            ++OggPacket.packetno;
-	                            OggPacket.b_o_s = OggPacket.packetno == 0;
-	                            OggPacket.bytes = OggPacket.packet->length;
-			                    if (!(vorbis_synthesis_headerin(&vi,&vc,&OggPacket) >= 0) && OggPacket.packetno==0)
-				                    return ERR_INVALID_DATA;
-		                    }
-
-		                    if (OggPacket.packetno < 3)
-		                    {
-			                    OggRef.begin = i;
-			                    OggRef.length = OggBuffer.size - i; 
-
-	                            ++OggPacket.packetno;
-	                            OggPacket.b_o_s = OggPacket.packetno == 0;
-	                            OggPacket.bytes = OggPacket.packet->length;
-
-                                if (!(vorbis_synthesis_headerin(&vi,&vc,&OggPacket) >= 0) && OggPacket.packetno==0)
-				                    return ERR_INVALID_DATA;
-                            }
-
-                            SampleRate = vi.rate;
-                            ArrayResize(&Block->Durations,sizeof(timecode_t)*ARRAYCOUNT(Block->SizeList,int32_t),0);
-                            Cursor = ARRAYBEGIN(Block->Data,uint8_t);
-                            ci = vi.codec_setup;
-                            for (Frame=0;Frame<ARRAYCOUNT(Block->SizeList,int32_t);++Frame)
-                            {
-                                fscod = _ilog(ci->modes-1);
-                                fscod = (Cursor[0] & 0x7F) >> (7-fscod);
-                                if (fscod > ci->modes)
-                                {
-                                    Err = ERR_INVALID_DATA;
-                                    ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
-                                    //goto exit;
-                                }
-                                else
-                                {
-                                    Samples = ci->blocksizes[ci->mode_param[fscod]->blockflag];
-                                    ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
-                                }
-                                Cursor += ARRAYBEGIN(Block->SizeList,int32_t)[Frame];
-                            }
-                            vorbis_comment_clear(&vc);
-                            vorbis_info_clear(&vi);
-                        }
-                    }
-#endif
+        case TRACKCODEC_AC3:
+            fscod =  Cursor[5] >> 3;
+            SampleRate = Cursor[4] >> 6;
+            if (fscod > 10 || fscod < 8)
+            {
+                Err = ERR_INVALID_DATA;
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
+            }
+            else
+            {
+                SampleRate = A_AC3_freq[fscod-8][SampleRate];
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,1536,SampleRate);
+            }
+            break;
 
-                    if (ReadData)
-                    {
-                        ArrayClear(&Block->Data);
-                        Block->Base.Base.bValueIsSet = 0;
-                    }
-                }
+        case TRACKCODEC_EAC3:
+            fscod =  Cursor[4] >> 6;
+            fscod2 = (Cursor[4] >> 4) & 0x03;
+            if ((0x03 == fscod) && (0x03 == fscod2))
+            {
+                Err = ERR_INVALID_DATA;
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
+            }
+            else
+            {
+                SampleRate = A_EAC3_freq[0x03 == fscod ? 3 + fscod2 : fscod];
+                Samples = (0x03 == fscod) ? 1536 : A_EAC3_samples[fscod2];
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
+            }
+            break;
+
+        case TRACKCODEC_DTS:
+            Samples = (((Cursor[4] & 1) << 7) + (Cursor[5] >> 2) + 1) * 32;
+            // TODO: handle the frame termination
+            SampleRate = A_DTS_freq[(Cursor[8] >> 2) & 0x0F];
+            if (Samples==0 || SampleRate==0)
+            {
+                Err = ERR_INVALID_DATA;
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
             }
+            else
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Scale64(1000000000,Samples,SampleRate);
+            break;
+
+        case TRACKCODEC_VORBIS:
+            fscod = (Cursor[0] & 0x7F) >> (7-Codec->VorbisModeBits);
+            if (fscod >= Codec->VorbisModes)
+            {
+                Err = ERR_INVALID_DATA;
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = INVALID_TIMECODE_T;
+            }
+            else
+                ARRAYBEGIN(Block->Durations,timecode_t)[Frame] = Codec->Duration[Codec->VorbisBlockFlag[fscod]];
+            break;
         }
+        Cursor += ARRAYBEGIN(Block->SizeList,int32_t)[Frame];
+    }
+
+    if (ReadData)
+    {
+        ArrayClear(&Block->Data);
+        Block->MappedData = NULL;
+        Block->MappedSize = 0;
+        Block->Base.Base.bValueIsSet = 0;
     }
-exit:
     return Err;
 }
 
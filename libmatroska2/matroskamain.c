@@ -93,12 +93,22 @@ struct matroska_cuepoint
     matroska_block *Block;
 };
 
+// Block of a Cluster found by MATROSKA_GetBlockForTimecode()
+typedef struct matroska_blockentry
+{
+    timecode_t Timecode;
+    matroska_block *Block;
+    int16_t Track;
+
+} matroska_blockentry;
+
 struct matroska_cluster
 {
     ebml_master Base;
     ebml_master *ReadSegInfo;
     ebml_master *WriteSegInfo;
     timecode_t GlobalTimecode;
+    array BlockIndex; // matroska_blockentry sorted by track and timecode, built on the first search and dropped when the Blocks change
 };
 
 struct matroska_seekpoint
@@ -107,15 +117,183 @@ struct matroska_seekpoint
     ebml_element *Link;
 };
 
+#define MATROSKA_POOL_MIN      14 // 16 KB, smaller buffers are allocated by the array as usual
+#define MATROSKA_POOL_CLASSES  11 // up to 16 MB
+#define MATROSKA_MAX_DECODE_THREADS  32 // decoding threads of MATROSKA_ClusterReadBlocksData()
+
+// state of the decompression libraries kept between frames, one per thread
+typedef struct matroska_decoder
+{
+    bool_t ZStreamInit;
+#if defined(CONFIG_ZLIB)
+    z_stream ZStream;
+#endif
+
+} matroska_decoder;
+
+// how the blocks of a track are read, resolved from its ContentEncodings when the first block is linked
+typedef struct matroska_trackdecoding
+{
+    bool_t Resolved;
+    bool_t HasEncodings;
+    err_t Err; // the blocks of the track can't be read
+    int Compression; // MATROSKA_BLOCK_COMPR_NONE when the frames are read as they are
+    ebml_binary *StrippedHeader; // with MATROSKA_BLOCK_COMPR_HEADER
+    matroska_decoder Decoder;
+    array Scratch; // compressed frames of the block being read
+    array Pool[MATROSKA_POOL_CLASSES]; // free frame buffers, at least 1<<(MATROSKA_POOL_MIN+n) octets each
+
+} matroska_trackdecoding;
+
 struct matroska_trackentry
 {
     ebml_master Base;
     bool_t CodecPrivateCompressed;
+    matroska_trackdecoding Decoding;
+    matroska_trackcodec Codec;
 };
 
+static err_t TrackDecoding(matroska_trackentry *Track)
+{
+    matroska_trackdecoding *Decoding = &Track->Decoding;
+    ebml_master *Elt;
+    ebml_element *Header, *Scope;
+    int Algo;
+
+    assert(Node_IsPartOf(Track, MATROSKA_TRACKENTRY_CLASS));
+    if (Decoding->Resolved)
+        return Decoding->Err;
+
+    Decoding->Resolved = 1;
+    Decoding->Err = ERR_NONE;
+    Decoding->Compression = MATROSKA_BLOCK_COMPR_NONE;
+    Decoding->StrippedHeader = NULL;
+    Elt = (ebml_master*)EBML_MasterFindChild(Track, &MATROSKA_ContextContentEncodings);
+    Decoding->HasEncodings = Elt!=NULL;
+    if (!Elt)
+        return ERR_NONE;
+
+    Elt = (ebml_master*)EBML_MasterFindChild(Elt, &MATROSKA_ContextContentEncoding);
+    if (!Elt || !EBML_MasterChildren(Elt))
+        return ERR_NONE;
+    if (EBML_MasterNext(Elt))
+        return Decoding->Err = ERR_NOT_SUPPORTED; // TODO support cascaded compression/encryption
+
+    Scope = EBML_MasterFindChild(Elt, &MATROSKA_ContextContentEncodingScope);
+    Elt = (ebml_master*)EBML_MasterFindChild(Elt, &MATROSKA_ContextContentCompression);
+    if (!Elt)
+        return Decoding->Err = ERR_NOT_SUPPORTED; // TODO: support encryption
+
+    Header = EBML_MasterGetChild(Elt, &MATROSKA_ContextContentCompAlgo);
+    Algo = (int)EBML_IntegerValue((ebml_integer*)Header);
+    if (Algo==MATROSKA_BLOCK_COMPR_HEADER)
+    {
+        // the header is added to each frame whatever the scope
+        Decoding->StrippedHeader = (ebml_binary*)EBML_MasterFindChild(Elt, &MATROSKA_ContextContentCompSettings);
+        if (Decoding->StrippedHeader)
+            Decoding->Compression = Algo;
+        return ERR_NONE;
+    }
+#if defined(CONFIG_ZLIB)
+    if (Algo==MATROSKA_BLOCK_COMPR_ZLIB) {} else
+#endif
+#if defined(CONFIG_LZO1X)
+    if (Algo==MATROSKA_BLOCK_COMPR_LZO1X)
+    {
+        if (lzo_init() != LZO_E_OK)
+            return Decoding->Err = ERR_INVALID_DATA;
+    }
+    else
+#endif
+#if defined(CONFIG_BZLIB)
+    if (Algo==MATROSKA_BLOCK_COMPR_BZLIB) {} else
+#endif
+        return Decoding->Err = ERR_INVALID_DATA;
+
+    if (!Scope || (EBML_IntegerValue((ebml_integer*)Scope) & MATROSKA_COMPR_SCOPE_BLOCK))
+        Decoding->Compression = Algo;
+    return ERR_NONE;
+}
+
+static void TrackChanged(matroska_trackentry *Track)
+{
+    Track->Decoding.Resolved = 0;
+    Track->Codec.Resolved = 0;
+}
+
+matroska_trackcodec *MATROSKA_TrackCodec(ebml_master *TrackEntry)
+{
+    assert(Node_IsPartOf(TrackEntry, MATROSKA_TRACKENTRY_CLASS));
+    return &((matroska_trackentry*)TrackEntry)->Codec;
+}
+
+static void DecoderDone(matroska_decoder *Decoder)
+{
+#if defined(CONFIG_ZLIB)
+    if (Decoder->ZStreamInit)
+        inflateEnd(&Decoder->ZStream);
+#endif
+    Decoder->ZStreamInit = 0;
+}
+
+static void DeleteTrackEntry(matroska_trackentry *Track)
+{
+    size_t i;
+    DecoderDone(&Track->Decoding.Decoder);
+    ArrayClear(&Track->Decoding.Scratch);
+    for (i=0;i<MATROSKA_POOL_CLASSES;++i)
+        ArrayClear(&Track->Decoding.Pool[i]);
+}
+
+static void TrackTakeBuffer(matroska_trackentry *Track, array *Buffer, size_t Size)
+{
+    // the smallest free buffer that is big enough, or a new one rounded to its class
+    size_t Class = 0;
+    if (Buffer->_Begin || Size < ((size_t)1<<(MATROSKA_POOL_MIN-1)))
+        return; // small buffers are allocated by the array as usual, that's cheap enough for them
+    while (Class<MATROSKA_POOL_CLASSES-1 && ((size_t)1<<(MATROSKA_POOL_MIN+Class)) < Size)
+        ++Class;
+    for (;Class<MATROSKA_POOL_CLASSES;++Class)
+        if (Track->Decoding.Pool[Class]._Begin)
+        {
+            *Buffer = Track->Decoding.Pool[Class];
+            ArrayInit(&Track->Decoding.Pool[Class]);
+            return;
+        }
+    if (Size <= ((size_t)1<<(MATROSKA_POOL_MIN+MATROSKA_POOL_CLASSES-1)))
+        ArrayAlloc(Buffer,Size,(size_t)1<<MATROSKA_POOL_MIN);
+}
+
+static void TrackReleaseBuffer(matroska_trackentry *Track, array *Buffer)
+{
+    size_t Class = 0, Size = Data_Size(Buffer->_Begin);
+    if (Size >= ((size_t)1<<MATROSKA_POOL_MIN))
+    {
+        while (Class<MATROSKA_POOL_CLASSES-1 && ((size_t)2<<(MATROSKA_POOL_MIN+Class)) <= Size)
+            ++Class;
+        if (!Track->Decoding.Pool[Class]._Begin)
+        {
+            ArrayDrop(Buffer);
+            Track->Decoding.Pool[Class] = *Buffer;
+            ArrayInit(Buffer);
+            return;
+        }
+    }
+    ArrayClear(Buffer);
+}
+
+static void ClusterBlocksChanged(ebml_element *Element)
+{
+    // the block index of the Cluster holding the Element is rebuilt on the next search
+    while (Element && !EBML_ElementIsType(Element, &MATROSKA_ContextCluster))
+        Element = EBML_ElementParent(Element);
+    if (Element)
+        ArrayClear(&((matroska_cluster*)Element)->BlockIndex);
+}
+
 static err_t BlockTrackChanged(matroska_block *Block)
 {
-	Block->Base.Base.bNeedDataSizeUpdate = 1;
+	EBML_ElementDataSizeChanged((ebml_element*)Block);
 	return ERR_NONE;
 }
 
@@ -127,7 +305,7 @@ static err_t ClusterTimeChanged(matroska_cluster *Cluster)
     ebml_element *Elt, *GBlock;
 #endif
 
-	Cluster->Base.Base.bNeedDataSizeUpdate = 1;
+	EBML_ElementDataSizeChanged((ebml_element*)Cluster);
     ClusterTimecode = MATROSKA_ClusterTimecode(Cluster);
     MATROSKA_ClusterSetTimecode(Cluster, ClusterTimecode);
 #if defined(CONFIG_EBML_WRITING)
@@ -159,51 +337,24 @@ static err_t ClusterTimeChanged(matroska_cluster *Cluster)
 
 static err_t CheckCompression(matroska_block *Block)
 {
-    ebml_master *Elt, *Header;
+    matroska_trackdecoding *Decoding;
+    err_t Err;
     assert(Block->ReadTrack!=NULL);
-    Elt = (ebml_master*)EBML_MasterFindChild(Block->ReadTrack, &MATROSKA_ContextContentEncodings);
-    if (Elt)
+    Err = TrackDecoding((matroska_trackentry*)Block->ReadTrack);
+    Decoding = &((matroska_trackentry*)Block->ReadTrack)->Decoding;
+    if (Decoding->HasEncodings)
     {
-        if (ARRAYCOUNT(Block->Data,uint8_t))
+        if (MATROSKA_BlockDataSize(Block))
             return ERR_INVALID_PARAM; // we cannot adjust sizes if the data are already read
 
-        Elt = (ebml_master*)EBML_MasterFindChild(Elt, &MATROSKA_ContextContentEncoding);
-        if (EBML_MasterChildren(Elt))
-        {
-            if (EBML_MasterNext(Elt))
-                return ERR_INVALID_DATA; // TODO support cascaded compression/encryption
-
-            Elt = (ebml_master*)EBML_MasterFindChild(Elt, &MATROSKA_ContextContentCompression);
-            if (!Elt)
-                return ERR_INVALID_DATA; // TODO: support encryption
-
-            Header = (ebml_master*)EBML_MasterGetChild(Elt, &MATROSKA_ContextContentCompAlgo);
-#if defined(CONFIG_ZLIB) || defined(CONFIG_LZO1X) || defined(CONFIG_BZLIB)
-            if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_HEADER)
-#if defined(CONFIG_ZLIB)
-                    if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_ZLIB)
-#endif
-#if defined(CONFIG_LZO1X)
-                    if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_LZO1X)
-#endif
-#if defined(CONFIG_BZLIB)
-                    if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_BZLIB)
-#endif
-#else
-            if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_HEADER)
-#endif
-                return ERR_INVALID_DATA;
+        if (Err != ERR_NONE)
+            return ERR_INVALID_DATA;
 
-            if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_HEADER)
-            {
-                Header = (ebml_master*)EBML_MasterFindChild(Elt, &MATROSKA_ContextContentCompSettings);
-                if (Header)
-                {
-                    uint32_t *i;
-        		    for (i=ARRAYBEGIN(Block->SizeList,uint32_t);i!=ARRAYEND(Block->SizeList,uint32_t);++i)
-                        *i += (uint32_t)Header->Base.DataSize;
-                }
-            }
+        if (Decoding->Compression==MATROSKA_BLOCK_COMPR_HEADER)
+        {
+            uint32_t *i;
+            for (i=ARRAYBEGIN(Block->SizeList,uint32_t);i!=ARRAYEND(Block->SizeList,uint32_t);++i)
+                *i += (uint32_t)Decoding->StrippedHeader->Base.DataSize;
         }
     }
     return ERR_NONE;
@@ -217,7 +368,7 @@ err_t MATROSKA_LinkBlockWithReadTracks(matroska_block *Block, ebml_master *Track
 
     assert(EBML_ElementIsType((ebml_element*)Tracks, &MATROSKA_ContextTracks));
     assert(Node_IsPartOf(Block,MATROSKA_BLOCK_CLASS));
-    for (Track=EBML_MasterChildren(Tracks);Track;Track=EBML_MasterNext(Track))
+    for (Track=EBML_MasterFindChild(Tracks,&MATROSKA_ContextTrackEntry);Track;Track=EBML_MasterNextChild(Tracks,Track))
     {
         TrackNum = (ebml_integer*)EBML_MasterFindChild((ebml_master*)Track,&MATROSKA_ContextTrackNumber);
         if (TrackNum && ((ebml_element*)TrackNum)->bValueIsSet && EBML_IntegerValue(TrackNum)==Block->TrackNumber)
@@ -245,6 +396,8 @@ err_t MATROSKA_LinkBlockReadTrack(matroska_block *Block, ebml_master *Track, boo
     TrackNum = (ebml_integer*)EBML_MasterFindChild(Track,&MATROSKA_ContextTrackNumber);
     if (TrackNum && ((ebml_element*)TrackNum)->bValueIsSet)
     {
+        if (Block->TrackNumber != (uint16_t)EBML_IntegerValue(TrackNum))
+            ClusterBlocksChanged((ebml_element*)Block);
         Block->TrackNumber = (uint16_t)EBML_IntegerValue(TrackNum);
         Node_SET(Block,MATROSKA_BLOCK_READ_TRACK,&Track);
 #if defined(CONFIG_EBML_WRITING)
@@ -267,7 +420,7 @@ err_t MATROSKA_LinkBlockWithWriteTracks(matroska_block *Block, ebml_master *Trac
 
     assert(EBML_ElementIsType((ebml_element*)Tracks, &MATROSKA_ContextTracks));
     assert(Node_IsPartOf(Block,MATROSKA_BLOCK_CLASS));
-    for (Track=(ebml_master*)EBML_MasterChildren(Tracks);Track;Track=(ebml_master*)EBML_MasterNext(Track))
+    for (Track=(ebml_master*)EBML_MasterFindChild(Tracks,&MATROSKA_ContextTrackEntry);Track;Track=(ebml_master*)EBML_MasterNextChild(Tracks,Track))
     {
         TrackNum = (ebml_integer*)EBML_MasterFindChild(Track,&MATROSKA_ContextTrackNumber);
         if (TrackNum && ((ebml_element*)TrackNum)->bValueIsSet && EBML_IntegerValue(TrackNum)==Block->TrackNumber)
@@ -291,6 +444,8 @@ err_t MATROSKA_LinkBlockWriteTrack(matroska_block *Block, ebml_master *Track)
     TrackNum = (ebml_integer*)EBML_MasterFindChild(Track,&MATROSKA_ContextTrackNumber);
     if (TrackNum && ((ebml_element*)TrackNum)->bValueIsSet)
     {
+        if (Block->TrackNumber != (uint16_t)EBML_IntegerValue(TrackNum))
+            ClusterBlocksChanged((ebml_element*)Block);
         Block->TrackNumber = (uint16_t)EBML_IntegerValue(TrackNum);
         Node_SET(Block,MATROSKA_BLOCK_WRITE_TRACK,&Track);
         if (WasLinked)
@@ -681,15 +836,12 @@ bool_t MATROSKA_BlockLaced(const matroska_block *Block)
 int16_t MATROSKA_CueTrackNum(const matroska_cuepoint *Cue)
 {
     ebml_master *Position;
-    ebml_integer *CueTrack;
+    int64_t CueTrack;
     assert(EBML_ElementIsType((ebml_element*)Cue, &MATROSKA_ContextCuePoint));
     Position = (ebml_master*)EBML_MasterFindChild((ebml_master*)Cue,&MATROSKA_ContextCueTrackPositions);
-    if (!Position)
-        return -1;
-    CueTrack = (ebml_integer*)EBML_MasterFindChild(Position,&MATROSKA_ContextCueTrack);
-    if (!CueTrack)
+    if (!Position || !EBML_MasterIntegerValue(Position,&MATROSKA_ContextCueTrack,&CueTrack))
         return -1;
-    return (int16_t)EBML_IntegerValue(CueTrack);
+    return (int16_t)CueTrack;
 }
 
 void MATROSKA_CuesSort(ebml_master *Cues)
@@ -729,53 +881,70 @@ double MATROSKA_TrackTimecodeScale(const ebml_master *Track)
 
 timecode_t MATROSKA_CueTimecode(const matroska_cuepoint *Cue)
 {
-    ebml_integer *TimeCode;
+    int64_t TimeCode;
     assert(EBML_ElementIsType((ebml_element*)Cue, &MATROSKA_ContextCuePoint));
-    TimeCode = (ebml_integer*) EBML_MasterFindChild((ebml_master*)Cue,&MATROSKA_ContextCueTime);
-    if (!TimeCode)
+    if (!EBML_MasterIntegerValue((ebml_master*)Cue,&MATROSKA_ContextCueTime,&TimeCode))
         return INVALID_TIMECODE_T;
-    return EBML_IntegerValue(TimeCode) * MATROSKA_SegmentInfoTimecodeScale(Cue->SegInfo);
+    return TimeCode * MATROSKA_SegmentInfoTimecodeScale(Cue->SegInfo);
 }
 
 filepos_t MATROSKA_CuePosInSegment(const matroska_cuepoint *Cue)
 {
-    ebml_element *TimeCode;
+    ebml_element *Position;
+    int64_t ClusterPosition;
     assert(EBML_ElementIsType((ebml_element*)Cue, &MATROSKA_ContextCuePoint));
-    TimeCode = EBML_MasterFindChild((ebml_master*)Cue,&MATROSKA_ContextCueTrackPositions);
-    if (!TimeCode)
+    Position = EBML_MasterFindChild((ebml_master*)Cue,&MATROSKA_ContextCueTrackPositions);
+    if (!Position || !EBML_MasterIntegerValue((ebml_master*)Position,&MATROSKA_ContextCueClusterPosition,&ClusterPosition))
         return INVALID_TIMECODE_T;
-    TimeCode = EBML_MasterFindChild((ebml_master*)TimeCode,&MATROSKA_ContextCueClusterPosition);
-    if (!TimeCode)
-        return INVALID_TIMECODE_T;
-    return EBML_IntegerValue((ebml_integer*)TimeCode);
+    return ClusterPosition;
+}
+
+// the CuePoint only has the children set by MATROSKA_CuePointUpdate()
+static bool_t CuePointIsUpdated(matroska_cuepoint *Cue, ebml_element **TimecodeElt, ebml_element **TrackNum, ebml_element **PosInCluster)
+{
+    ebml_element *Elt;
+    if (EBML_MasterCount((ebml_master*)Cue)!=2)
+        return 0;
+    *TimecodeElt = EBML_MasterChildren(Cue);
+    Elt = EBML_MasterNext(*TimecodeElt);
+    if (!EBML_ElementIsType(*TimecodeElt,&MATROSKA_ContextCueTime) || !EBML_ElementIsType(Elt,&MATROSKA_ContextCueTrackPositions) ||
+        EBML_MasterCount((ebml_master*)Elt)!=2)
+        return 0;
+    *TrackNum = EBML_MasterChildren(Elt);
+    *PosInCluster = EBML_MasterNext(*TrackNum);
+    return EBML_ElementIsType(*TrackNum,&MATROSKA_ContextCueTrack) && EBML_ElementIsType(*PosInCluster,&MATROSKA_ContextCueClusterPosition);
 }
 
 err_t MATROSKA_CuePointUpdate(matroska_cuepoint *Cue, ebml_element *Segment)
 {
-    ebml_element *TimecodeElt, *Elt, *PosInCluster;
-    ebml_integer *TrackNum;
+    ebml_element *TimecodeElt, *Elt, *PosInCluster, *TrackNum;
     assert(EBML_ElementIsType((ebml_element*)Cue, &MATROSKA_ContextCuePoint));
     assert(Cue->Block);
     assert(Cue->SegInfo);
     assert(Segment); // we need the segment location
-	EBML_MasterErase((ebml_master*)Cue);
-	EBML_MasterAddMandatory((ebml_master*)Cue,1);
-    TimecodeElt = EBML_MasterGetChild((ebml_master*)Cue,&MATROSKA_ContextCueTime);
-    if (!TimecodeElt)
-        return ERR_OUT_OF_MEMORY;
+    if (!CuePointIsUpdated(Cue,&TimecodeElt,&TrackNum,&PosInCluster))
+    {
+        // first update or the children were modified, otherwise only the values that change need a new size
+	    EBML_MasterErase((ebml_master*)Cue);
+	    EBML_MasterAddMandatory((ebml_master*)Cue,1);
+        TimecodeElt = EBML_MasterGetChild((ebml_master*)Cue,&MATROSKA_ContextCueTime);
+        if (!TimecodeElt)
+            return ERR_OUT_OF_MEMORY;
+
+        Elt = EBML_MasterGetChild((ebml_master*)Cue,&MATROSKA_ContextCueTrackPositions);
+        if (!Elt)
+            return ERR_OUT_OF_MEMORY;
+	    TrackNum = EBML_MasterGetChild((ebml_master*)Elt,&MATROSKA_ContextCueTrack);
+        if (!TrackNum)
+            return ERR_OUT_OF_MEMORY;
+	
+        PosInCluster = EBML_MasterGetChild((ebml_master*)Elt,&MATROSKA_ContextCueClusterPosition);
+        if (!PosInCluster)
+            return ERR_OUT_OF_MEMORY;
+    }
     EBML_IntegerSetValue((ebml_integer*)TimecodeElt, Scale64(MATROSKA_BlockTimecode(Cue->Block),1,MATROSKA_SegmentInfoTimecodeScale(Cue->SegInfo)));
+	EBML_IntegerSetValue((ebml_integer*)TrackNum, MATROSKA_BlockTrackNum(Cue->Block));
 
-    Elt = EBML_MasterGetChild((ebml_master*)Cue,&MATROSKA_ContextCueTrackPositions);
-    if (!Elt)
-        return ERR_OUT_OF_MEMORY;
-	TrackNum = (ebml_integer*)EBML_MasterGetChild((ebml_master*)Elt,&MATROSKA_ContextCueTrack);
-    if (!TrackNum)
-        return ERR_OUT_OF_MEMORY;
-	EBML_IntegerSetValue(TrackNum, MATROSKA_BlockTrackNum(Cue->Block));
-	
-    PosInCluster = EBML_MasterGetChild((ebml_master*)Elt,&MATROSKA_ContextCueClusterPosition);
-    if (!PosInCluster)
-        return ERR_OUT_OF_MEMORY;
     Elt = EBML_ElementParent(Cue->Block);
     while (Elt && !EBML_ElementIsType(Elt, &MATROSKA_ContextCluster))
         Elt = EBML_ElementParent(Elt);
@@ -789,7 +958,7 @@ err_t MATROSKA_CuePointUpdate(matroska_cuepoint *Cue, ebml_element *Segment)
     return ERR_NONE;
 }
 
-matroska_block *MATROSKA_GetBlockForTimecode(matroska_cluster *Cluster, timecode_t Timecode, int16_t Track)
+static matroska_block *FindBlockForTimecode(matroska_cluster *Cluster, timecode_t Timecode, int16_t Track)
 {
     ebml_element *Block, *GBlock;
     for (Block = EBML_MasterChildren(Cluster);Block;Block=EBML_MasterNext(Block))
@@ -820,6 +989,122 @@ matroska_block *MATROSKA_GetBlockForTimecode(matroska_cluster *Cluster, timecode
     return NULL;
 }
 
+static err_t AddBlockEntry(array *Entries, matroska_block *Block)
+{
+    matroska_blockentry Entry;
+    Entry.Block = Block;
+    Entry.Track = MATROSKA_BlockTrackNum(Block);
+    Entry.Timecode = MATROSKA_BlockTimecode(Block);
+    if (Entry.Timecode == INVALID_TIMECODE_T)
+        return ERR_INVALID_DATA; // not linked to its track yet
+    if (!ArrayAppend(Entries,&Entry,sizeof(Entry),256))
+        return ERR_OUT_OF_MEMORY;
+    return ERR_NONE;
+}
+
+static int CmpBlockEntry(const void *Param, const matroska_blockentry **pa, const matroska_blockentry **pb)
+{
+    if ((*pa)->Track != (*pb)->Track)
+        return (*pa)->Track < (*pb)->Track ? -1 : 1;
+    if ((*pa)->Timecode != (*pb)->Timecode)
+        return (*pa)->Timecode < (*pb)->Timecode ? -1 : 1;
+    // keep the Cluster order between Blocks with the same timecode
+    if (*pa != *pb)
+        return *pa < *pb ? -1 : 1;
+    return 0;
+}
+
+static err_t ClusterBuildBlockIndex(matroska_cluster *Cluster)
+{
+    array Entries, Sorted;
+    matroska_blockentry *i, **Entry;
+    ebml_element *Block, *GBlock;
+    size_t Count, n;
+    err_t Err = ERR_NONE;
+
+    ArrayInit(&Entries);
+    ArrayInit(&Sorted);
+    for (Block = EBML_MasterChildren(Cluster);Block && Err==ERR_NONE;Block=EBML_MasterNext(Block))
+    {
+        if (EBML_ElementIsType(Block, &MATROSKA_ContextBlockGroup))
+        {
+            for (GBlock = EBML_MasterChildren(Block);GBlock && Err==ERR_NONE;GBlock=EBML_MasterNext(GBlock))
+                if (EBML_ElementIsType(GBlock, &MATROSKA_ContextBlock))
+                    Err = AddBlockEntry(&Entries,(matroska_block*)GBlock);
+        }
+        else if (EBML_ElementIsType(Block, &MATROSKA_ContextSimpleBlock))
+            Err = AddBlockEntry(&Entries,(matroska_block*)Block);
+    }
+
+    // sort pointers to the entries, the array sort of larger items is quadratic
+    Count = ARRAYCOUNT(Entries,matroska_blockentry);
+    if (Err==ERR_NONE && Count)
+    {
+        if (!ArrayResize(&Sorted,Count*sizeof(matroska_blockentry*),0) ||
+            !ArrayResize(&Cluster->BlockIndex,Count*sizeof(matroska_blockentry),0))
+            Err = ERR_OUT_OF_MEMORY;
+        else
+        {
+            for (Entry=ARRAYBEGIN(Sorted,matroska_blockentry*),i=ARRAYBEGIN(Entries,matroska_blockentry);i!=ARRAYEND(Entries,matroska_blockentry);++i,++Entry)
+                *Entry = i;
+            ArraySort(&Sorted,matroska_blockentry*,(arraycmp)CmpBlockEntry,NULL,0);
+            for (n=0,Entry=ARRAYBEGIN(Sorted,matroska_blockentry*);Entry!=ARRAYEND(Sorted,matroska_blockentry*);++Entry,++n)
+                ARRAYBEGIN(Cluster->BlockIndex,matroska_blockentry)[n] = **Entry;
+        }
+    }
+    if (Err!=ERR_NONE)
+        ArrayClear(&Cluster->BlockIndex);
+    ArrayClear(&Sorted);
+    ArrayClear(&Entries);
+    return Err;
+}
+
+matroska_block *MATROSKA_GetBlockForTimecode(matroska_cluster *Cluster, timecode_t Timecode, int16_t Track)
+{
+    const matroska_blockentry *Index;
+    size_t Lo, Hi, Mid;
+
+    if (ARRAYEMPTY(Cluster->BlockIndex) && ClusterBuildBlockIndex(Cluster)!=ERR_NONE)
+        return FindBlockForTimecode(Cluster, Timecode, Track);
+
+    // first entry not before (Track,Timecode)
+    Index = ARRAYBEGIN(Cluster->BlockIndex,matroska_blockentry);
+    Lo = 0;
+    Hi = ARRAYCOUNT(Cluster->BlockIndex,matroska_blockentry);
+    while (Lo < Hi)
+    {
+        Mid = (Lo + Hi) / 2;
+        if (Index[Mid].Track < Track || (Index[Mid].Track == Track && Index[Mid].Timecode < Timecode))
+            Lo = Mid + 1;
+        else
+            Hi = Mid;
+    }
+    if (Lo < ARRAYCOUNT(Cluster->BlockIndex,matroska_blockentry) && Index[Lo].Track == Track && Index[Lo].Timecode == Timecode)
+        return Index[Lo].Block;
+    return NULL;
+}
+
+matroska_cluster **MATROSKA_ClusterForTimecode(const array *Clusters, timecode_t Timecode)
+{
+    matroska_cluster **Cluster = ARRAYBEGIN(*Clusters,matroska_cluster*);
+    size_t Lo, Hi, Mid;
+
+    if (ARRAYEMPTY(*Clusters))
+        return NULL;
+    // last Cluster starting at or before Timecode
+    Lo = 1;
+    Hi = ARRAYCOUNT(*Clusters,matroska_cluster*);
+    while (Lo < Hi)
+    {
+        Mid = (Lo + Hi) / 2;
+        if (MATROSKA_ClusterTimecode(Cluster[Mid]) <= Timecode)
+            Lo = Mid + 1;
+        else
+            Hi = Mid;
+    }
+    return Cluster + Lo - 1;
+}
+
 void MATROSKA_LinkClusterBlocks(matroska_cluster *Cluster, ebml_master *RSegmentInfo, ebml_master *Tracks, bool_t KeepUnmatched)
 {
     ebml_element *Block, *GBlock,*NextBlock;
@@ -871,7 +1156,12 @@ err_t MATROSKA_BlockReleaseData(matroska_block *Block, bool_t IncludingNotRead)
 {
     if (!IncludingNotRead && Block->GlobalTimecode==INVALID_TIMECODE_T)
         return ERR_NONE;
-    ArrayClear(&Block->Data);
+    if (Block->ReadTrack)
+        TrackReleaseBuffer((matroska_trackentry*)Block->ReadTrack,&Block->Data); // reused by the next block of the track
+    else
+        ArrayClear(&Block->Data);
+    Block->MappedData = NULL;
+    Block->MappedSize = 0;
     Block->Base.Base.bValueIsSet = 0;
     if (ARRAYCOUNT(Block->SizeListIn,int32_t))
     {
@@ -904,407 +1194,395 @@ err_t MATROSKA_BlockSkipToFrame(const matroska_block *Block, stream *Input, size
 	return ERR_NONE;
 }
 
-// TODO: support zero copy reading (read the frames directly into a buffer with a callback per frame)
-//       pass the Input stream and the amount to read per frame, give the timecode of the frame and get the end timecode in return, get an error code if reading failed
-err_t MATROSKA_BlockReadData(matroska_block *Element, stream *Input)
+static bool_t ReferenceMappedData(matroska_block *Element, stream *Input, size_t Size)
 {
-    size_t Read,BufSize;
-    size_t NumFrame;
-    err_t Err = ERR_NONE;
-    ebml_element *Elt, *Elt2, *Header = NULL;
-    uint8_t *InBuf;
-    int CompressionScope = MATROSKA_COMPR_SCOPE_BLOCK;
+    // the frames are used in place when the whole file is mapped in memory
+    const uint8_t *Mapped;
+    size_t Available;
+    if (!Node_IsPartOf(Input,MMAPSTREAM_CLASS))
+        return 0;
+    Mapped = MemStreamData(Input,Element->FirstFrameLocation,&Available);
+    if (!Mapped || Available < Size)
+        return 0;
+    ArrayClear(&Element->Data);
+    Element->MappedData = Mapped;
+    Element->MappedSize = Size;
+    Stream_Seek(Input,Element->FirstFrameLocation + Size,SEEK_SET);
+    return 1;
+}
 
-    if (!Element->Base.Base.bValueIsSet)
+static err_t DecodeFrame(int Compression, matroska_decoder *Decoder, const uint8_t *InBuf, size_t InSize, array *OutBuf, size_t Offset, size_t *FrameSize)
+{
+    // the frame is decoded at Offset in OutBuf, the buffer is grown as needed
+    *FrameSize = 0;
+#if defined(CONFIG_ZLIB)
+    if (Compression==MATROSKA_BLOCK_COMPR_ZLIB)
     {
-        // find out if compressed headers are used
-        assert(Element->ReadTrack!=NULL);
-        Elt = EBML_MasterFindChild(Element->ReadTrack, &MATROSKA_ContextContentEncodings);
-        if (Elt)
+        z_stream *stream = &Decoder->ZStream;
+        size_t Count;
+        int Res;
+        if (!Decoder->ZStreamInit)
         {
-            Elt = EBML_MasterFindChild((ebml_master*)Elt, &MATROSKA_ContextContentEncoding);
-            if (EBML_MasterChildren(Elt))
-            {
-                if (EBML_MasterNext(Elt))
-                    return ERR_NOT_SUPPORTED; // TODO support cascaded compression/encryption
-
-                Elt2 = EBML_MasterFindChild((ebml_master*)Elt, &MATROSKA_ContextContentEncodingScope);
-                if (Elt2)
-                    CompressionScope = (int)EBML_IntegerValue((ebml_integer*)Elt2);
-
-                Elt = EBML_MasterFindChild((ebml_master*)Elt, &MATROSKA_ContextContentCompression);
-                if (!Elt)
-                    return ERR_NOT_SUPPORTED; // TODO: support encryption
+            memset(stream,0,sizeof(*stream));
+            if (inflateInit(stream) != Z_OK)
+                return ERR_INVALID_DATA;
+            Decoder->ZStreamInit = 1;
+        }
+        else if (inflateReset(stream) != Z_OK)
+            return ERR_INVALID_DATA;
 
-                Header = EBML_MasterGetChild((ebml_master*)Elt, &MATROSKA_ContextContentCompAlgo);
-#if defined(CONFIG_ZLIB) || defined(CONFIG_LZO1X) || defined(CONFIG_BZLIB)
-                if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_HEADER)
-#if defined(CONFIG_ZLIB)
-                    if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_ZLIB)
+        stream->next_in = (Bytef*)InBuf;
+        stream->avail_in = (uInt)InSize;
+        do {
+            // fill all the memory already allocated before growing it
+            Count = Offset + stream->total_out;
+            if (!ArrayResize(OutBuf, max(Data_Size(OutBuf->_Begin), Count + 1024), 0))
+            {
+                Res = Z_MEM_ERROR;
+                break;
+            }
+            stream->avail_out = (uInt)(ARRAYCOUNT(*OutBuf,uint8_t) - Count);
+            stream->next_out = ARRAYBEGIN(*OutBuf,uint8_t) + Count;
+            Res = inflate(stream, Z_NO_FLUSH);
+        } while (Res==Z_OK && !stream->avail_out);
+        *FrameSize = stream->total_out;
+        ArrayResize(OutBuf, Offset + *FrameSize, 0);
+        return Res==Z_STREAM_END ? ERR_NONE : ERR_INVALID_DATA;
+    }
 #endif
 #if defined(CONFIG_LZO1X)
-                    if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_LZO1X)
+    if (Compression==MATROSKA_BLOCK_COMPR_LZO1X)
+    {
+        lzo_uint outSize = max(2048, InSize << 2);
+        if (!ArrayResize(OutBuf, Offset + outSize, 0))
+            return ERR_OUT_OF_MEMORY;
+        if (lzo1x_decompress_safe(InBuf, InSize, ARRAYBEGIN(*OutBuf,uint8_t) + Offset, &outSize, NULL) != LZO_E_OK)
+            return ERR_INVALID_DATA;
+        *FrameSize = outSize;
+        ArrayResize(OutBuf, Offset + outSize, 0);
+        return ERR_NONE;
+    }
 #endif
 #if defined(CONFIG_BZLIB)
-                    if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_BZLIB)
+    if (Compression==MATROSKA_BLOCK_COMPR_BZLIB)
+    {
+        // bzip2 has no way to reset a stream
+        bz_stream stream;
+        size_t Count;
+        int Res;
+        memset(&stream,0,sizeof(stream));
+        if (BZ2_bzDecompressInit(&stream, 0, 1) != BZ_OK)
+            return ERR_INVALID_DATA;
+        stream.next_in = (char*)InBuf;
+        stream.avail_in = (unsigned int)InSize;
+        do {
+            Count = Offset + stream.total_out_lo32;
+            if (!ArrayResize(OutBuf, max(Data_Size(OutBuf->_Begin), Count + 1024), 0))
+            {
+                Res = BZ_MEM_ERROR;
+                break;
+            }
+            stream.avail_out = (unsigned int)(ARRAYCOUNT(*OutBuf,uint8_t) - Count);
+            stream.next_out = ARRAYBEGIN(*OutBuf,char) + Count;
+            Res = BZ2_bzDecompress(&stream);
+        } while (Res==BZ_OK && !stream.avail_out);
+        *FrameSize = stream.total_out_lo32;
+        ArrayResize(OutBuf, Offset + *FrameSize, 0);
+        BZ2_bzDecompressEnd(&stream);
+        return Res==BZ_STREAM_END ? ERR_NONE : ERR_INVALID_DATA;
+    }
 #endif
-#else
-                if (EBML_IntegerValue((ebml_integer*)Header)!=MATROSKA_BLOCK_COMPR_HEADER)
+    return ERR_NOT_SUPPORTED;
+}
+
+static err_t DecodeFrames(int Compression, matroska_decoder *Decoder, const uint8_t *InBuf, matroska_block *Element, array *OutBuf)
+{
+    // decode each frame of InBuf in OutBuf and adjust Element->SizeList
+    size_t FrameSize, OutSize = 0;
+    int32_t *Size;
+    err_t Err;
+    for (Size=ARRAYBEGIN(Element->SizeList,int32_t);Size!=ARRAYEND(Element->SizeList,int32_t);++Size)
+    {
+        Err = DecodeFrame(Compression,Decoder,InBuf,*Size,OutBuf,OutSize,&FrameSize);
+        InBuf += *Size;
+        *Size = (int32_t)FrameSize;
+        OutSize += FrameSize;
+        if (Err != ERR_NONE)
+            return Err;
+    }
+    ArrayResize(OutBuf, OutSize, 0);
+    return ERR_NONE;
+}
+
+static err_t ReadFrames(matroska_block *Element, stream *Input, array *Compressed)
+{
+    // the data are set when the frames are not compressed, otherwise they are read in Compressed to be decoded
+    size_t Read,BufSize,FrameSize;
+    err_t Err;
+    matroska_trackdecoding *Decoding;
+    int32_t *Size;
+    uint8_t *InBuf;
+
+    assert(Element->ReadTrack!=NULL);
+    Err = TrackDecoding((matroska_trackentry*)Element->ReadTrack);
+    if (Err != ERR_NONE)
+        return Err;
+    Decoding = &((matroska_trackentry*)Element->ReadTrack)->Decoding;
+
+    switch (Element->Lacing)
+    {
+    case LACING_NONE:
+    case LACING_EBML:
+    case LACING_XIPH:
+    case LACING_FIXED:
+        break;
+    default:
+        assert(0); // we should support the other lacing modes
+        return ERR_NOT_SUPPORTED;
+    }
+
+    BufSize = 0;
+    for (Size=ARRAYBEGIN(Element->SizeList,int32_t);Size!=ARRAYEND(Element->SizeList,int32_t);++Size)
+        BufSize += *Size;
+
+    Stream_Seek(Input,Element->FirstFrameLocation,SEEK_SET);
+    if (Decoding->Compression == MATROSKA_BLOCK_COMPR_NONE)
+    {
+        if (!ReferenceMappedData(Element,Input,BufSize))
+        {
+            TrackTakeBuffer((matroska_trackentry*)Element->ReadTrack,&Element->Data,BufSize);
+            if (!ArrayResize(&Element->Data,BufSize,0))
+                return ERR_OUT_OF_MEMORY;
+            Err = Stream_Read(Input,ARRAYBEGIN(Element->Data,uint8_t),BufSize,&Read);
+            if (Err == ERR_NONE && Read != BufSize)
+                Err = ERR_READ;
+            if (Err != ERR_NONE)
+                return Err;
+        }
+        Element->Base.Base.bValueIsSet = 1;
+    }
+    else if (Decoding->Compression == MATROSKA_BLOCK_COMPR_HEADER)
+    {
+        size_t HeaderSize = (size_t)Decoding->StrippedHeader->Base.DataSize;
+        ArrayCopy(&Element->SizeListIn, &Element->SizeList);
+        TrackTakeBuffer((matroska_trackentry*)Element->ReadTrack,&Element->Data,BufSize);
+        if (!ArrayResize(&Element->Data,BufSize,0))
+            return ERR_OUT_OF_MEMORY;
+        InBuf = ARRAYBEGIN(Element->Data,uint8_t);
+        for (Size=ARRAYBEGIN(Element->SizeList,int32_t);Size!=ARRAYEND(Element->SizeList,int32_t);++Size)
+        {
+            memcpy(InBuf,ARRAYBEGIN(Decoding->StrippedHeader->Data,uint8_t),HeaderSize);
+            InBuf += HeaderSize;
+            FrameSize = *Size - HeaderSize;
+            Err = Stream_Read(Input,InBuf,FrameSize,&Read);
+            if (Err == ERR_NONE && Read != FrameSize)
+                Err = ERR_READ;
+            if (Err != ERR_NONE)
+                return Err;
+            InBuf += Read;
+        }
+        Element->Base.Base.bValueIsSet = 1;
+    }
+    else
+    {
+        ArrayCopy(&Element->SizeListIn, &Element->SizeList);
+        if (!ArrayResize(Compressed,BufSize,(size_t)1<<MATROSKA_POOL_MIN))
+            return ERR_OUT_OF_MEMORY;
+        Err = Stream_Read(Input,ARRAYBEGIN(*Compressed,uint8_t),BufSize,&Read);
+        if (Err == ERR_NONE && Read != BufSize)
+            Err = ERR_READ;
+    }
+    return Err;
+}
+
+static void BlockDataRead(matroska_block *Element)
+{
+#if defined(CONFIG_EBML_WRITING)
+	if (Element->ReadTrack != Element->WriteTrack || Element->ReadSegInfo != Element->WriteSegInfo)
+		// TODO: only if the track compression/timecode scale is different
+		EBML_ElementDataSizeChanged((ebml_element*)Element);
 #endif
-                    return ERR_INVALID_DATA;
+}
 
-                if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_HEADER)
-                    Header = EBML_MasterFindChild((ebml_master*)Elt, &MATROSKA_ContextContentCompSettings);
-            }
+// TODO: support zero copy reading (read the frames directly into a buffer with a callback per frame)
+//       pass the Input stream and the amount to read per frame, give the timecode of the frame and get the end timecode in return, get an error code if reading failed
+err_t MATROSKA_BlockReadData(matroska_block *Element, stream *Input)
+{
+    matroska_trackentry *Track;
+    err_t Err;
+
+    if (!Element->Base.Base.bValueIsSet)
+    {
+        // the compressed frames are read in the track buffer and decoded in Element->Data
+        Track = (matroska_trackentry*)Element->ReadTrack;
+        Err = ReadFrames(Element,Input,&Track->Decoding.Scratch);
+        if (Err != ERR_NONE)
+            return Err;
+        if (!Element->Base.Base.bValueIsSet)
+        {
+            TrackTakeBuffer(Track,&Element->Data,ARRAYCOUNT(Track->Decoding.Scratch,uint8_t));
+            Err = DecodeFrames(Track->Decoding.Compression,&Track->Decoding.Decoder,ARRAYBEGIN(Track->Decoding.Scratch,uint8_t),Element,&Element->Data);
+            if (Err != ERR_NONE)
+                return Err;
+            Element->Base.Base.bValueIsSet = 1;
         }
+    }
+    BlockDataRead(Element);
+    return ERR_NONE;
+}
 
-#if !defined(CONFIG_ZLIB) && !defined(CONFIG_LZO1X) && !defined(CONFIG_BZLIB)
-        if (Header && Header->Context==&MATROSKA_ContextContentCompAlgo)
-            return ERR_NOT_SUPPORTED;
+// a Block of a Cluster read with MATROSKA_ClusterReadBlocksData()
+typedef struct matroska_blockjob
+{
+    matroska_block *Block;
+    array Compressed; // empty when there is nothing to decode
+    array Data;
+    err_t Err;
+
+} matroska_blockjob;
+
+typedef struct matroska_blockjobs
+{
+    matroska_blockjob *Next;
+    matroska_blockjob *End;
+    void *Lock;
+
+} matroska_blockjobs;
+
+static int THREADCALL DecodeBlockJobs(matroska_blockjobs *Jobs)
+{
+    matroska_decoder Decoder;
+    matroska_blockjob *Job;
+    memset(&Decoder,0,sizeof(Decoder));
+    for (;;)
+    {
+        LockEnter(Jobs->Lock);
+        while (Jobs->Next!=Jobs->End && ARRAYEMPTY(Jobs->Next->Compressed))
+            ++Jobs->Next;
+        Job = Jobs->Next!=Jobs->End ? Jobs->Next++ : NULL;
+        LockLeave(Jobs->Lock);
+        if (!Job)
+            break;
+        Job->Err = DecodeFrames(((matroska_trackentry*)Job->Block->ReadTrack)->Decoding.Compression,&Decoder,
+                                ARRAYBEGIN(Job->Compressed,uint8_t),Job->Block,&Job->Data);
+    }
+    DecoderDone(&Decoder);
+    return 0;
+}
+
+// CONFIG_MULTITHREAD is not set in corec/default_config.h, the default build decodes serially
+#if defined(CONFIG_MULTITHREAD)
+static void DecodeBlockJobsThreaded(matroska_blockjobs *Jobs, size_t Threads, size_t Decode)
+{
+    void *Thread[MATROSKA_MAX_DECODE_THREADS];
+    size_t Count = 0, i;
+    if (Threads==0)
+    {
+        // as many threads as CPUs
+        uint32_t Mask;
+        for (Mask=ThreadCPUMask();Mask;Mask>>=1)
+            Threads += Mask & 1;
+    }
+    if (Threads > Decode)
+        Threads = Decode;
+    Jobs->Lock = LockCreate();
+    if (Jobs->Lock)
+    {
+        // the calling thread decodes too
+        while (Count+1<Threads && Count<MATROSKA_MAX_DECODE_THREADS && (Thread[Count] = ThreadCreate((threadfunc)DecodeBlockJobs,Jobs))!=NULL)
+            ++Count;
+    }
+    DecodeBlockJobs(Jobs);
+    for (i=0;i<Count;++i)
+        ThreadJoin(Thread[i],NULL);
+    if (Jobs->Lock)
+        LockDelete(Jobs->Lock);
+}
 #endif
 
-        if (Header && Header->Context==&MATROSKA_ContextContentCompAlgo && !(CompressionScope & MATROSKA_COMPR_SCOPE_BLOCK))
-            Header = NULL;
+err_t MATROSKA_ClusterReadBlocksData(matroska_cluster *Cluster, stream *Input, size_t Threads, array *Failed)
+{
+    array List;
+    matroska_blockjob Job, *i;
+    matroska_blockjobs Jobs;
+    ebml_element *Elt, *Block;
+    size_t Decode = 0;
+    err_t Err = ERR_NONE;
+
+    assert(Node_IsPartOf(Cluster,MATROSKA_CLUSTER_CLASS));
+    ArrayInit(&List);
+    memset(&Job,0,sizeof(Job));
 
-        Stream_Seek(Input,Element->FirstFrameLocation,SEEK_SET);
-        if (Header)
-            ArrayCopy(&Element->SizeListIn, &Element->SizeList);
-        switch (Element->Lacing)
+    // read all the Blocks in file order
+    for (Elt = EBML_MasterChildren(Cluster);Elt;Elt = EBML_MasterNext(Elt))
+    {
+        if (EBML_ElementIsType(Elt, &MATROSKA_ContextBlockGroup))
+            Block = EBML_MasterFindChild((ebml_master*)Elt, &MATROSKA_ContextBlock);
+        else if (EBML_ElementIsType(Elt, &MATROSKA_ContextSimpleBlock))
+            Block = Elt;
+        else
+            continue;
+        if (!Block)
+            continue;
+
+        Job.Block = (matroska_block*)Block;
+        Job.Err = ERR_NONE;
+        ArrayInit(&Job.Compressed);
+        ArrayInit(&Job.Data);
+        if (!Job.Block->Base.Base.bValueIsSet)
         {
-        case LACING_NONE:
-#if defined(CONFIG_ZLIB) || defined(CONFIG_LZO1X) || defined(CONFIG_BZLIB)
-            if (Header && Header->Context==&MATROSKA_ContextContentCompAlgo)
-            {
-                // zlib handling, read the buffer in temp memory
-                array TmpBuf;
-                ArrayInit(&TmpBuf);
-                if (!ArrayResize(&TmpBuf,(size_t)ARRAYBEGIN(Element->SizeList,int32_t)[0],0))
-                    Err = ERR_OUT_OF_MEMORY;
-                InBuf = ARRAYBEGIN(TmpBuf,uint8_t);
-                Err = Stream_Read(Input,InBuf,(size_t)ARRAYBEGIN(Element->SizeList,int32_t)[0],&Read);
-                if (Err==ERR_NONE)
-                {
-                    if (Read!=(size_t)ARRAYBEGIN(Element->SizeList,int32_t)[0])
-                        Err = ERR_READ;
-                    else
-                    {
-#if defined(CONFIG_ZLIB)
-                        if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_ZLIB)
-                        {
-                            // get the ouput size, adjust the Element->SizeList value, write in Element->Data
-                            z_stream stream;
-                            int Res;
-                            memset(&stream,0,sizeof(stream));
-                            Res = inflateInit(&stream);
-                            if (Res != Z_OK)
-                                Err = ERR_INVALID_DATA;
-                            else
-                            {
-                                size_t Count = 0;
-                                stream.next_in = InBuf;
-                                stream.avail_in = ARRAYBEGIN(Element->SizeList,int32_t)[0];
-                                stream.next_out = ARRAYBEGIN(Element->Data,uint8_t);
-                                do {
-                                    Count = stream.next_out - ARRAYBEGIN(Element->Data,uint8_t);
-                                    stream.avail_out = 1024;
-                                    if (!ArrayResize(&Element->Data, Count + stream.avail_out, 0))
-                                    {
-                                        Res = Z_MEM_ERROR;
-                                        break;
-                                    }
-                                    stream.next_out = ARRAYBEGIN(Element->Data,uint8_t) + Count;
-                                    Res = inflate(&stream, Z_NO_FLUSH);
-                                    if (Res!=Z_STREAM_END && Res!=Z_OK)
-                                        break;
-                                } while (Res!=Z_STREAM_END && stream.avail_in && !stream.avail_out);
-                                ArrayResize(&Element->Data, stream.total_out, 0);
-                                ARRAYBEGIN(Element->SizeList,int32_t)[0] = stream.total_out;
-                                inflateEnd(&stream);
-                                if (Res != Z_STREAM_END)
-                                    Err = ERR_INVALID_DATA;
-                            }
-                        }
-#endif
-#if defined(CONFIG_LZO1X)
-                        if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_LZO1X)
-                        {
-                            if (lzo_init() != LZO_E_OK)
-                                Err = ERR_INVALID_DATA;
-                            else
-                            {
-                                lzo_uint outSize = max(2048, ARRAYBEGIN(Element->SizeList,int32_t)[0] << 2);
-                                if (!ArrayResize(&Element->Data, outSize, 0))
-                                    Err = ERR_OUT_OF_MEMORY;
-                                else
-                                {
-                                    if (lzo1x_decompress_safe(InBuf, ARRAYBEGIN(Element->SizeList,int32_t)[0], ARRAYBEGIN(Element->Data,uint8_t), &outSize, NULL) != LZO_E_OK)
-                                        Err = ERR_INVALID_DATA;
-                                    else
-                                    {
-                                        ARRAYBEGIN(Element->SizeList,int32_t)[0] = outSize;
-                                        ArrayResize(&Element->Data,outSize,0);
-                                    }
-                                }
-                            }
-                        }
-#endif
-#if defined(CONFIG_BZLIB)
-                        if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_BZLIB)
-                        {
-                            unsigned int outSize = ARRAYBEGIN(Element->SizeList,int32_t)[0] << 2;
-                            bz_stream strm;
-                            int Res;
-
-                            if (!ArrayResize(&Element->Data, outSize, 0))
-                                Err = ERR_OUT_OF_MEMORY;
-                            else
-                            {
-                               strm.bzalloc = NULL;
-                               strm.bzfree = NULL;
-                               strm.opaque = NULL;
-                               if (BZ2_bzDecompressInit (&strm, 0, 1) != BZ_OK)
-                                   Err = ERR_INVALID_DATA;
-                               else
-                               {
-                                    size_t Count = 0;
-                                    strm.next_in = (char*)InBuf;
-                                    strm.avail_in = ARRAYBEGIN(Element->SizeList,int32_t)[0];
-                                    strm.next_out = ARRAYBEGIN(Element->Data,char);
-                                    strm.avail_out = 0;
-
-                                    do {
-                                        Count = strm.next_out - ARRAYBEGIN(Element->Data,char);
-                                        strm.avail_out = 1024;
-                                        if (!ArrayResize(&Element->Data, Count + strm.avail_out, 0))
-                                        {
-                                            Res = BZ_MEM_ERROR;
-                                            break;
-                                        }
-                                        strm.next_out = ARRAYBEGIN(Element->Data,char) + Count;
-                                        Res = BZ2_bzDecompress(&strm);
-                                        if (Res!=BZ_STREAM_END && Res!=BZ_OK)
-                                            break;
-                                    } while (Res!=BZ_STREAM_END && strm.avail_in && !strm.avail_out);
-                                    ArrayResize(&Element->Data, strm.total_out_lo32, 0);
-                                    ARRAYBEGIN(Element->SizeList,int32_t)[0] = strm.total_out_lo32;
-                                    BZ2_bzDecompressEnd(&strm);
-                                    if (Res != BZ_STREAM_END)
-                                        Err = ERR_INVALID_DATA;
-                                }
-                            }
-                        }
-#endif
-                    }
-                }
-                ArrayClear(&TmpBuf);
-            }
-            else
-#endif
-            {
-                if (!ArrayResize(&Element->Data,(size_t)ARRAYBEGIN(Element->SizeList,int32_t)[0],0))
-                {
-                    Err = ERR_OUT_OF_MEMORY;
-                    goto failed;
-                }
-                InBuf = ARRAYBEGIN(Element->Data,uint8_t);
-                if (Header)
-                {
-                    memcpy(InBuf,ARRAYBEGIN(((ebml_binary*)Header)->Data,uint8_t),(size_t)Header->DataSize);
-                    InBuf += (size_t)Header->DataSize;
-                }
-                Err = Stream_Read(Input,InBuf,(size_t)(ARRAYBEGIN(Element->SizeList,int32_t)[0] - (Header?Header->DataSize:0)),&Read);
-                if (Err != ERR_NONE)
-                    goto failed;
-                if (Read + (Header?Header->DataSize:0) != (size_t)ARRAYBEGIN(Element->SizeList,int32_t)[0])
-                {
-                    Err = ERR_READ;
-                    goto failed;
-                }
-            }
-            break;
-        case LACING_EBML:
-        case LACING_XIPH:
-        case LACING_FIXED:
-            Read = 0;
-            BufSize = 0;
-            for (NumFrame=0;NumFrame<ARRAYCOUNT(Element->SizeList,int32_t);++NumFrame)
-                BufSize += ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame];
-#if defined(CONFIG_ZLIB) || defined(CONFIG_LZO1X) || defined(CONFIG_BZLIB)
-            if (Header && Header->Context==&MATROSKA_ContextContentCompAlgo)
-            {
-                // zlib handling, read the buffer in temp memory
-                // get the ouput size, adjust the Element->SizeList value, write in Element->Data
-                array TmpBuf;
-                int32_t FrameSize;
-                size_t OutSize = 0;
-
-                ArrayInit(&TmpBuf);
-                if (!ArrayResize(&TmpBuf,BufSize,0))
-                {
-                    Err = ERR_OUT_OF_MEMORY;
-                    goto failed;
-                }
-                InBuf = ARRAYBEGIN(TmpBuf,uint8_t);
-                Err = Stream_Read(Input,InBuf,BufSize,&Read);
-                if (Err != ERR_NONE || Read!=BufSize)
-                {
-                    if (Err==ERR_NONE)
-                        Err = ERR_READ;
-                    ArrayClear(&TmpBuf);
-                    goto failed;
-                }
-                for (NumFrame=0;Err==ERR_NONE && NumFrame<ARRAYCOUNT(Element->SizeList,int32_t);++NumFrame)
-                {
-#if defined(CONFIG_ZLIB)
-                    if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_ZLIB)
-                    {
-                        z_stream stream;
-                        int Res;
-                        memset(&stream,0,sizeof(stream));
-                        Res = inflateInit(&stream);
-                        if (Res != Z_OK)
-                            Err = ERR_INVALID_DATA;
-                        else
-                        {
-                            size_t Count;
-                            stream.next_in = InBuf;
-                            stream.avail_in = FrameSize = ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame];
-                            stream.next_out = ARRAYBEGIN(Element->Data,uint8_t) + OutSize;
-                            do {
-                                Count = stream.next_out - ARRAYBEGIN(Element->Data,uint8_t);
-                                if (!ArrayResize(&Element->Data, Count + 1024, 0))
-                                {
-                                    Res = Z_MEM_ERROR;
-                                    break;
-                                }
-                                stream.avail_out = ARRAYCOUNT(Element->Data,uint8_t) - Count;
-                                stream.next_out = ARRAYBEGIN(Element->Data,uint8_t) + Count;
-                                Res = inflate(&stream, Z_NO_FLUSH);
-                                if (Res!=Z_STREAM_END && Res!=Z_OK)
-                                    break;
-                            } while (Res!=Z_STREAM_END && stream.avail_in && !stream.avail_out);
-                            ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame] = stream.total_out;
-                            OutSize += stream.total_out;
-                            inflateEnd(&stream);
-                            if (Res != Z_STREAM_END)
-                                Err = ERR_INVALID_DATA;
-                        }
-                    }
-#endif
-#if defined(CONFIG_LZO1X)
-                    if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_LZO1X)
-                    {
-                        if (lzo_init() != LZO_E_OK)
-                            Err = ERR_INVALID_DATA;
-                        else
-                        {
-                            lzo_uint outSize = max(2048, ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame] << 2);
-                            FrameSize = ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame];
-                            if (!ArrayResize(&Element->Data, OutSize + outSize, 0))
-                                Err = ERR_OUT_OF_MEMORY;
-                            else
-                            {
-                                if (lzo1x_decompress_safe(InBuf, ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame], ARRAYBEGIN(Element->Data,uint8_t) + OutSize, &outSize, NULL) != LZO_E_OK)
-                                    Err = ERR_INVALID_DATA;
-                                else
-                                {
-                                    OutSize += outSize;
-                                    ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame] = outSize;
-                                    ArrayResize(&Element->Data,OutSize,0);
-                                }
-                            }
-                        }
-                    }
-#endif
-#if defined(CONFIG_BZLIB)
-                    if (EBML_IntegerValue((ebml_integer*)Header)==MATROSKA_BLOCK_COMPR_BZLIB)
-                    {
-                        bz_stream stream;
-                        int Res;
-                        memset(&stream,0,sizeof(stream));
-                        Res = BZ2_bzDecompressInit (&stream, 0, 1);
-                        if (Res != BZ_OK)
-                            Err = ERR_INVALID_DATA;
-                        else
-                        {
-                            size_t Count;
-                            stream.next_in = (char*)InBuf;
-                            stream.avail_in = FrameSize = ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame];
-                            stream.next_out = ARRAYBEGIN(Element->Data,char) + OutSize;
-                            do {
-                                Count = stream.next_out - ARRAYBEGIN(Element->Data,char);
-                                if (!ArrayResize(&Element->Data, Count + 1024, 0))
-                                {
-                                    Res = BZ_MEM_ERROR;
-                                    break;
-                                }
-                                stream.avail_out = ARRAYCOUNT(Element->Data,uint8_t) - Count;
-                                stream.next_out = ARRAYBEGIN(Element->Data,char) + Count;
-                                Res = BZ2_bzDecompress(&stream);
-                                if (Res!=BZ_STREAM_END && Res!=BZ_OK)
-                                    break;
-                            } while (Res!=BZ_STREAM_END && stream.avail_in && !stream.avail_out);
-                            ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame] = stream.total_out_lo32;
-                            OutSize += stream.total_out_lo32;
-                            BZ2_bzDecompressEnd(&stream);
-                            if (Res != BZ_STREAM_END)
-                                Err = ERR_INVALID_DATA;
-                        }
-                    }
-#endif
-                    InBuf += FrameSize;
-                }
-                ArrayResize(&Element->Data, OutSize, 0); // shrink the buffer
-                ArrayClear(&TmpBuf);
-            }
+            Job.Err = ReadFrames(Job.Block,Input,&Job.Compressed);
+            if (Job.Err != ERR_NONE || Job.Block->Base.Base.bValueIsSet)
+                ArrayClear(&Job.Compressed);
             else
-#endif
             {
-                if (!ArrayResize(&Element->Data,BufSize,0))
-                {
-                    Err = ERR_OUT_OF_MEMORY;
-                    goto failed;
-                }
-                if (!Header)
-                {
-                    //assert(BufSize + Element->FirstFrameLocation == Element->Base.Base.DataSize);
-                    Err = Stream_Read(Input,ARRAYBEGIN(Element->Data,uint8_t),BufSize,&BufSize);
-                }
-                else
-                {
-                    InBuf = ARRAYBEGIN(Element->Data,uint8_t);
-                    for (NumFrame=0;NumFrame<ARRAYCOUNT(Element->SizeList,int32_t);++NumFrame)
-                    {
-                        memcpy(InBuf,ARRAYBEGIN(((ebml_binary*)Header)->Data,uint8_t),(size_t)Header->DataSize);
-                        InBuf += (size_t)Header->DataSize;
-                        Read = ARRAYBEGIN(Element->SizeList,int32_t)[NumFrame] - (int32_t)Header->DataSize;
-                        BufSize = Read;
-                        assert(InBuf + Read <= ARRAYEND(Element->Data,uint8_t));
-                        Err = Stream_Read(Input,InBuf,BufSize,&Read);
-                        if (Err != ERR_NONE || Read!=BufSize)
-                            goto failed;
-                        InBuf += Read;
-                    }
-                }
+                TrackTakeBuffer((matroska_trackentry*)Job.Block->ReadTrack,&Job.Data,ARRAYCOUNT(Job.Compressed,uint8_t));
+                ++Decode;
             }
-            if (Err != ERR_NONE)
-                goto failed;
+        }
+        if (!ArrayAppend(&List,&Job,sizeof(Job),64))
+        {
+            ArrayClear(&Job.Compressed);
+            ArrayClear(&Job.Data);
+            Err = ERR_OUT_OF_MEMORY;
             break;
-        default:
-            assert(0); // we should support the other lacing modes
-            Err = ERR_NOT_SUPPORTED;
-            goto failed;
         }
-        Element->Base.Base.bValueIsSet = 1;
     }
 
-#if defined(CONFIG_EBML_WRITING)
-	if (Element->ReadTrack != Element->WriteTrack || Element->ReadSegInfo != Element->WriteSegInfo)
-		// TODO: only if the track compression/timecode scale is different
-		Element->Base.Base.bNeedDataSizeUpdate = 1;
+    // decode the compressed frames, all the Blocks were read from the file
+    Jobs.Next = ARRAYBEGIN(List,matroska_blockjob);
+    Jobs.End = ARRAYEND(List,matroska_blockjob);
+    Jobs.Lock = NULL;
+#if defined(CONFIG_MULTITHREAD)
+    if (Decode > 1 && Threads != 1)
+        DecodeBlockJobsThreaded(&Jobs,Threads,Decode);
+    else
 #endif
+    if (Decode)
+        DecodeBlockJobs(&Jobs);
 
-failed:
+    // give the results in Block order, like MATROSKA_BlockReadData() on each Block
+    for (i=ARRAYBEGIN(List,matroska_blockjob);i!=ARRAYEND(List,matroska_blockjob);++i)
+    {
+        if (!ARRAYEMPTY(i->Compressed))
+        {
+            ArrayClear(&i->Block->Data);
+            i->Block->Data = i->Data;
+            ArrayClear(&i->Compressed);
+            if (i->Err == ERR_NONE)
+                i->Block->Base.Base.bValueIsSet = 1;
+        }
+        if (i->Err == ERR_NONE)
+            BlockDataRead(i->Block);
+        else
+        {
+            if (Err == ERR_NONE)
+                Err = i->Err;
+            if (Failed)
+                ArrayAppend(Failed,&i->Block,sizeof(i->Block),64);
+        }
+    }
+    ArrayClear(&List);
     return Err;
 }
 
@@ -1343,9 +1621,21 @@ static err_t SetBlockGroupParent(ebml_master *Element, void* Parent, void* Befor
 	return Result;
 }
 
+static err_t AddBlockGroupChild(ebml_master *Element, ebml_element *Child, ebml_element *Before)
+{
+    ClusterBlocksChanged((ebml_element*)Element);
+    return INHERITED(Element,nodetree_vmt,MATROSKA_BLOCKGROUP_CLASS)->AddChild(Element,Child,Before);
+}
+
+static void RemoveBlockGroupChild(ebml_master *Element, ebml_element *Child)
+{
+    ClusterBlocksChanged((ebml_element*)Element);
+    INHERITED(Element,nodetree_vmt,MATROSKA_BLOCKGROUP_CLASS)->RemoveChild(Element,Child);
+}
+
 static err_t ReadBigBinaryData(ebml_binary *Element, stream *Input, const ebml_parser_context *ParserContext, bool_t AllowDummyElt, int Scope, size_t DepthCheckCRC)
 {
-    if (Scope == SCOPE_PARTIAL_DATA)
+    if (Scope == SCOPE_PARTIAL_DATA || Scope == SCOPE_SKELETON || Scope == SCOPE_PACKED_LEAVES)
     {
         EBML_ElementSkipData((ebml_element*)Element,Input,ParserContext,NULL,AllowDummyElt);
         return ERR_NONE;
@@ -1454,7 +1744,7 @@ static err_t ReadBlockData(matroska_block *Element, stream *Input, const ebml_pa
 			ARRAYBEGIN(Element->SizeList,int32_t)[Index] = LastBufferSize;
 			break;
 		case LACING_EBML:
-			SizeRead = LastBufferSize;
+			SizeRead = min(LastBufferSize,FrameNum*4); // only the lace sizes are in the buffer
             _tmpBuf = malloc(FrameNum*4);
 			cursor = _tmpBuf; /// \warning assume the mean size will be coded in less than 4 bytes
 			Result += Stream_Read(Input,cursor, FrameNum*4,NULL);
@@ -1466,7 +1756,7 @@ static err_t ReadBlockData(matroska_block *Element, stream *Input, const ebml_pa
 			for (Index=1; Index<FrameNum; Index++)
             {
 				// get the size of the frame
-				SizeRead = LastBufferSize;
+				SizeRead = min(LastBufferSize,FrameNum*4 - (cursor - _tmpBuf));
 				FrameSize += (int32_t)EBML_ReadCodedSizeSignedValue(cursor, &SizeRead, &SizeUnknown);
 				ARRAYBEGIN(Element->SizeList,int32_t)[Index] = FrameSize;
 				cursor += SizeRead;
@@ -1488,7 +1778,7 @@ static err_t ReadBlockData(matroska_block *Element, stream *Input, const ebml_pa
 		}
 	}
 
-    if (Scope == SCOPE_PARTIAL_DATA)
+    if (Scope == SCOPE_PARTIAL_DATA || Scope == SCOPE_SKELETON || Scope == SCOPE_PACKED_LEAVES)
 	{
 		if (Stream_Seek(Input,Element->Lacing==LACING_NONE ? (EBML_ElementPositionData((ebml_element*)Element) + BlockHeadSize) : Element->FirstFrameLocation,SEEK_SET)==INVALID_FILEPOS_T)
 			Result = ERR_READ;
@@ -1507,12 +1797,12 @@ err_t MATROSKA_BlockGetFrame(const matroska_block *Block, size_t FrameNum, matro
     size_t i;
 
     assert(!WithData || Block->Base.Base.bValueIsSet);
-    if (WithData && !ARRAYCOUNT(Block->Data,uint8_t))
+    if (WithData && !MATROSKA_BlockDataSize(Block))
         return ERR_READ;
     if (FrameNum >= ARRAYCOUNT(Block->SizeList,uint32_t))
         return ERR_INVALID_PARAM;
 
-	Frame->Data = WithData ? ARRAYBEGIN(Block->Data,uint8_t) : NULL;
+	Frame->Data = WithData ? (uint8_t*)MATROSKA_BlockDataBegin(Block) : NULL;
     Frame->Timecode = MATROSKA_BlockTimecode((matroska_block*)Block);
     for (i=0;i<FrameNum;++i)
     {
@@ -1538,11 +1828,19 @@ err_t MATROSKA_BlockAppendFrame(matroska_block *Block, const matroska_frame *Fra
 {
     if (!Block->Base.Base.bValueIsSet && Frame->Timecode!=INVALID_TIMECODE_T)
         MATROSKA_BlockSetTimecode(Block,Frame->Timecode,ClusterTimecode);
+    if (Block->MappedData)
+    {
+        // the block is modified, own the frames read so far
+        if (!ArrayAppend(&Block->Data,Block->MappedData,Block->MappedSize,0))
+            return ERR_OUT_OF_MEMORY;
+        Block->MappedData = NULL;
+        Block->MappedSize = 0;
+    }
     ArrayAppend(&Block->Data,Frame->Data,Frame->Size,0);
     ArrayAppend(&Block->Durations,&Frame->Duration,sizeof(Frame->Duration),0);
     ArrayAppend(&Block->SizeList,&Frame->Size,sizeof(Frame->Size),0);
     Block->Base.Base.bValueIsSet = 1;
-    Block->Base.Base.bNeedDataSizeUpdate = 1;
+    EBML_ElementDataSizeChanged((ebml_element*)Block);
     Block->Lacing = LACING_AUTO;
     return ERR_NONE;
 }
@@ -1643,7 +1941,7 @@ static filepos_t GetBlockFrameSize(const matroska_block *Element, size_t Frame,
         // handle zlib
         size_t OutSize;
         const int32_t *Size = ARRAYBEGIN(Element->SizeList,int32_t);
-        const uint8_t *Data = ARRAYBEGIN(Element->Data,uint8_t);
+        const uint8_t *Data = MATROSKA_BlockDataBegin(Element);
         while (Frame)
         {
             Data += *Size;
@@ -1745,7 +2043,8 @@ static err_t RenderBlockData(matroska_block *Element, stream *Output, bool_t bFo
 {
     err_t Err = ERR_NONE;
     uint8_t BlockHead[5], *Cursor;
-    size_t ToWrite, Written, BlockHeadSize = 4;
+    size_t Written, BlockHeadSize = 4;
+    streamvec Frame;
     ebml_element *Elt, *Elt2, *Header = NULL;
     int32_t *i;
     int CompressionScope = MATROSKA_COMPR_SCOPE_BLOCK;
@@ -1885,13 +2184,14 @@ static err_t RenderBlockData(matroska_block *Element, stream *Output, bool_t bFo
     }
     Node_SET(Element,MATROSKA_BLOCK_READ_TRACK,&Element->WriteTrack); // now use the write track for consecutive read of the same element
 
-    Cursor = ARRAYBEGIN(Element->Data,uint8_t);
+    Cursor = (uint8_t*)MATROSKA_BlockDataBegin(Element);
     if (Header && (CompressionScope & MATROSKA_COMPR_SCOPE_BLOCK))
     {
         if (Header && Header->Context==&MATROSKA_ContextContentCompAlgo)
         {
 #if defined(CONFIG_ZLIB)
             uint8_t *OutBuf;
+            size_t ToWrite;
             array TmpBuf;
             ArrayInit(&TmpBuf);
             for (i=ARRAYBEGIN(Element->SizeList,int32_t);i!=ARRAYEND(Element->SizeList,int32_t);++i)
@@ -1933,8 +2233,9 @@ static err_t RenderBlockData(matroska_block *Element, stream *Output, bool_t bFo
                     goto failed;
                 }
                 Cursor += Header->DataSize;
-                ToWrite = *i - (size_t)Header->DataSize;
-                Err = Stream_Write(Output,Cursor,ToWrite,&Written);
+                Frame.Data = Cursor;
+                Frame.Size = *i - (size_t)Header->DataSize;
+                Err = Stream_WriteV(Output,&Frame,1,&Written);
                 if (Rendered)
                     *Rendered += Written;
                 Cursor += Written;
@@ -1943,8 +2244,10 @@ static err_t RenderBlockData(matroska_block *Element, stream *Output, bool_t bFo
     }
     else
     {
-        ToWrite = ARRAYCOUNT(Element->Data,uint8_t);
-        Err = Stream_Write(Output,Cursor,ToWrite,&Written);
+        // the frames stay in memory until the Block is released, a gathering Output doesn't need to copy them
+        Frame.Data = Cursor;
+        Frame.Size = MATROSKA_BlockDataSize(Element);
+        Err = Stream_WriteV(Output,&Frame,1,&Written);
         if (Rendered)
             *Rendered += Written;
     }
@@ -2233,6 +2536,445 @@ matroska_cuepoint *MATROSKA_CuesGetTimecodeStart(const ebml_element *Cues, timec
 	return Prev ? Prev : (matroska_cuepoint*)EBML_MasterChildren(Cues);
 }
 
+// a CueTrackPositions while the index is built
+typedef struct matroska_cueentry
+{
+    timecode_t Timecode;
+    filepos_t ClusterPosition;
+    filepos_t RelativePosition;
+    matroska_cuepoint *CuePoint;
+    size_t Order;
+    int32_t BlockNumber;
+    int16_t Track;
+
+} matroska_cueentry;
+
+static int CmpCueEntry(const void *Param, const matroska_cueentry **pa, const matroska_cueentry **pb)
+{
+    const matroska_cueentry *a = *pa, *b = *pb;
+    if (a->Track != b->Track)
+        return a->Track > b->Track ? 1 : -1;
+    if (a->Timecode != b->Timecode)
+        return a->Timecode > b->Timecode ? 1 : -1;
+    if (a->Order != b->Order)
+        return a->Order > b->Order ? 1 : -1;
+    return 0;
+}
+
+void MATROSKA_CueIndexInit(matroska_cueindex *Index)
+{
+    ArrayInit(&Index->Timecode);
+    ArrayInit(&Index->Track);
+    ArrayInit(&Index->ClusterPosition);
+    ArrayInit(&Index->RelativePosition);
+    ArrayInit(&Index->BlockNumber);
+    ArrayInit(&Index->CuePoint);
+    ArrayInit(&Index->TrackStart);
+}
+
+void MATROSKA_CueIndexClear(matroska_cueindex *Index)
+{
+    ArrayClear(&Index->Timecode);
+    ArrayClear(&Index->Track);
+    ArrayClear(&Index->ClusterPosition);
+    ArrayClear(&Index->RelativePosition);
+    ArrayClear(&Index->BlockNumber);
+    ArrayClear(&Index->CuePoint);
+    ArrayClear(&Index->TrackStart);
+}
+
+static err_t CueIndexTracks(matroska_cueindex *Index)
+{
+    // the start of each track in the sorted entries
+    const int16_t *Track = ARRAYBEGIN(Index->Track,int16_t);
+    size_t Count = ARRAYCOUNT(Index->Track,int16_t), n;
+    ArrayClear(&Index->TrackStart);
+    for (n=0;n<Count;++n)
+    {
+        if ((n==0 || Track[n]!=Track[n-1]) && !ArrayAppend(&Index->TrackStart,&n,sizeof(n),64))
+            return ERR_OUT_OF_MEMORY;
+    }
+    // the end of the last track
+    if (!ArrayAppend(&Index->TrackStart,&Count,sizeof(Count),64))
+        return ERR_OUT_OF_MEMORY;
+    return ERR_NONE;
+}
+
+static err_t CueIndexFill(matroska_cueindex *Index, array *Entries)
+{
+    array Sorted;
+    matroska_cueentry *i, **Entry;
+    size_t Count, n;
+    err_t Err = ERR_NONE;
+
+    // sort pointers to the entries, the array sort of larger items is quadratic
+    Count = ARRAYCOUNT(*Entries,matroska_cueentry);
+    ArrayInit(&Sorted);
+    if (!ArrayResize(&Sorted,Count*sizeof(matroska_cueentry*),0))
+        return ERR_OUT_OF_MEMORY;
+    for (Entry=ARRAYBEGIN(Sorted,matroska_cueentry*),i=ARRAYBEGIN(*Entries,matroska_cueentry);i!=ARRAYEND(*Entries,matroska_cueentry);++i,++Entry)
+        *Entry = i;
+    ArraySort(&Sorted,matroska_cueentry*,(arraycmp)CmpCueEntry,NULL,0);
+
+    if (!ArrayResize(&Index->Timecode,Count*sizeof(timecode_t),0) ||
+        !ArrayResize(&Index->Track,Count*sizeof(int16_t),0) ||
+        !ArrayResize(&Index->ClusterPosition,Count*sizeof(filepos_t),0) ||
+        !ArrayResize(&Index->RelativePosition,Count*sizeof(filepos_t),0) ||
+        !ArrayResize(&Index->BlockNumber,Count*sizeof(int32_t),0) ||
+        !ArrayResize(&Index->CuePoint,Count*sizeof(matroska_cuepoint*),0))
+        Err = ERR_OUT_OF_MEMORY;
+    else
+    {
+        for (n=0,Entry=ARRAYBEGIN(Sorted,matroska_cueentry*);Entry!=ARRAYEND(Sorted,matroska_cueentry*);++Entry,++n)
+        {
+            ARRAYBEGIN(Index->Timecode,timecode_t)[n] = (*Entry)->Timecode;
+            ARRAYBEGIN(Index->Track,int16_t)[n] = (*Entry)->Track;
+            ARRAYBEGIN(Index->ClusterPosition,filepos_t)[n] = (*Entry)->ClusterPosition;
+            ARRAYBEGIN(Index->RelativePosition,filepos_t)[n] = (*Entry)->RelativePosition;
+            ARRAYBEGIN(Index->BlockNumber,int32_t)[n] = (*Entry)->BlockNumber;
+            ARRAYBEGIN(Index->CuePoint,matroska_cuepoint*)[n] = (*Entry)->CuePoint;
+        }
+        Err = CueIndexTracks(Index);
+    }
+    ArrayClear(&Sorted);
+    return Err;
+}
+
+err_t MATROSKA_CueIndexBuild(matroska_cueindex *Index, const ebml_master *Cues)
+{
+    array Entries;
+    matroska_cueentry Entry;
+    ebml_element *Cue, *Position;
+    int64_t Value;
+    err_t Err = ERR_NONE;
+
+    assert(EBML_ElementIsType((ebml_element*)Cues, &MATROSKA_ContextCues));
+    MATROSKA_CueIndexClear(Index);
+    ArrayInit(&Entries);
+    Entry.Order = 0;
+    for (Cue = EBML_MasterFindChild(Cues, &MATROSKA_ContextCuePoint);Cue;Cue = EBML_MasterNextChild(Cues, Cue))
+    {
+        Entry.CuePoint = (matroska_cuepoint*)Cue;
+        Entry.Timecode = MATROSKA_CueTimecode(Entry.CuePoint);
+        if (Entry.Timecode == INVALID_TIMECODE_T)
+            continue;
+        // one entry per track of the CuePoint
+        for (Position = EBML_MasterFindChild(Cue, &MATROSKA_ContextCueTrackPositions);Position;Position = EBML_MasterNextChild(Cue, Position))
+        {
+            if (!EBML_MasterIntegerValue((ebml_master*)Position,&MATROSKA_ContextCueTrack,&Value) || Value <= 0 || Value > 0x7FFF)
+                continue;
+            Entry.Track = (int16_t)Value;
+            if (!EBML_MasterIntegerValue((ebml_master*)Position,&MATROSKA_ContextCueClusterPosition,&Value))
+                continue;
+            Entry.ClusterPosition = Value;
+            Entry.RelativePosition = EBML_MasterIntegerValue((ebml_master*)Position,&MATROSKA_ContextCueRelativePosition,&Value) ? Value : INVALID_FILEPOS_T;
+            Entry.BlockNumber = EBML_MasterIntegerValue((ebml_master*)Position,&MATROSKA_ContextCueBlockNumber,&Value) ? (int32_t)Value : 0;
+            if (!ArrayAppend(&Entries,&Entry,sizeof(Entry),4096))
+            {
+                Err = ERR_OUT_OF_MEMORY;
+                goto failed;
+            }
+            ++Entry.Order;
+        }
+    }
+
+    Err = CueIndexFill(Index,&Entries);
+
+failed:
+    ArrayClear(&Entries);
+    if (Err != ERR_NONE)
+        MATROSKA_CueIndexClear(Index);
+    return Err;
+}
+
+static bool_t ReadClusterTimestamp(ebml_element *Cluster, stream *Input, const ebml_parser_context *Context, int64_t *Timestamp)
+{
+    // the Timestamp is usually the first child, the children after it are not read
+    ebml_parser_context ClusterContext;
+    ebml_element *Elt;
+    int UpperElement = 0;
+    bool_t Found = 0;
+
+    ClusterContext.Context = &MATROSKA_ContextCluster;
+    ClusterContext.EndPosition = EBML_ElementPositionEnd(Cluster);
+    ClusterContext.UpContext = Context;
+    ClusterContext.Profile = Context->Profile;
+    Stream_Seek(Input,EBML_ElementPositionData(Cluster),SEEK_SET);
+    while (!Found && (Elt = EBML_FindNextElement(Input,&ClusterContext,&UpperElement,0))!=NULL)
+    {
+        if (UpperElement<=0 && EBML_ElementIsType(Elt,&MATROSKA_ContextTimestamp) &&
+            EBML_ElementReadData(Elt,Input,&ClusterContext,0,SCOPE_ALL_DATA,0)==ERR_NONE)
+        {
+            *Timestamp = EBML_IntegerValue((ebml_integer*)Elt);
+            Found = 1;
+        }
+        else if (UpperElement<=0)
+            EBML_ElementSkipData(Elt,Input,&ClusterContext,NULL,0);
+        NodeDelete((node*)Elt);
+        if (UpperElement>0)
+            break;
+    }
+    return Found;
+}
+
+static err_t ScanClusterKeyframes(ebml_master *Cluster, int64_t Timestamp, timecode_t Scale, matroska_cueentry *Entry, array *Entries)
+{
+    // the first keyframe of each track in the Cluster
+    ebml_element *Elt;
+    matroska_block *Block;
+    int16_t Tracks[64];
+    size_t TrackCount = 0, i;
+    int32_t BlockNumber = 0;
+
+    for (Elt = EBML_MasterChildren(Cluster);Elt;Elt = EBML_MasterNext(Elt))
+    {
+        if (EBML_ElementIsType(Elt, &MATROSKA_ContextSimpleBlock))
+            Block = (matroska_block*)Elt;
+        else if (EBML_ElementIsType(Elt, &MATROSKA_ContextBlockGroup))
+            Block = (matroska_block*)EBML_MasterFindChild(Elt, &MATROSKA_ContextBlock);
+        else
+            continue;
+        ++BlockNumber;
+        if (!Block || !Block->LocalTimecodeUsed || !MATROSKA_BlockKeyframe(Block))
+            continue;
+        for (i=0;i<TrackCount && Tracks[i]!=(int16_t)Block->TrackNumber;++i) {}
+        if (i<TrackCount || Block->TrackNumber==0 || Block->TrackNumber>0x7FFF)
+            continue;
+        if (TrackCount < sizeof(Tracks)/sizeof(Tracks[0]))
+            Tracks[TrackCount++] = (int16_t)Block->TrackNumber;
+        Entry->Track = (int16_t)Block->TrackNumber;
+        Entry->Timecode = (Timestamp + Block->LocalTimecode) * Scale;
+        Entry->RelativePosition = EBML_ElementPosition(Elt) - EBML_ElementPositionData((ebml_element*)Cluster);
+        Entry->BlockNumber = BlockNumber;
+        if (!ArrayAppend(Entries,Entry,sizeof(*Entry),4096))
+            return ERR_OUT_OF_MEMORY;
+        ++Entry->Order;
+    }
+    return ERR_NONE;
+}
+
+static size_t CueIndexFindInTrack(const matroska_cueindex *Index, size_t First, size_t End, timecode_t Timecode)
+{
+    // the last entry at or before Timecode, or First
+    const timecode_t *Timecodes = ARRAYBEGIN(Index->Timecode,timecode_t);
+    size_t Mid;
+    while (First + 1 < End)
+    {
+        Mid = (First + End) / 2;
+        if (Timecodes[Mid] > Timecode)
+            End = Mid;
+        else
+            First = Mid;
+    }
+    return First;
+}
+
+size_t MATROSKA_CueIndexFind(const matroska_cueindex *Index, int16_t Track, timecode_t Timecode)
+{
+    const size_t *Start;
+    const timecode_t *Timecodes = ARRAYBEGIN(Index->Timecode,timecode_t);
+    size_t Found = MATROSKA_CUEINDEX_NONE, n;
+
+    if (Timecode == INVALID_TIMECODE_T)
+        return MATROSKA_CUEINDEX_NONE;
+    for (Start=ARRAYBEGIN(Index->TrackStart,size_t);Start+1<ARRAYEND(Index->TrackStart,size_t);++Start)
+    {
+        if (Track!=0 && ARRAYBEGIN(Index->Track,int16_t)[*Start]!=Track)
+            continue;
+        n = CueIndexFindInTrack(Index,Start[0],Start[1],Timecode);
+        // the closest one before Timecode, or the earliest one when all the tracks start after it
+        if (Found == MATROSKA_CUEINDEX_NONE)
+            Found = n;
+        else if (Timecodes[n] <= Timecode)
+        {
+            if (Timecodes[Found] > Timecode || Timecodes[n] >= Timecodes[Found])
+                Found = n;
+        }
+        else if (Timecodes[Found] > Timecode && Timecodes[n] < Timecodes[Found])
+            Found = n;
+    }
+    return Found;
+}
+
+err_t MATROSKA_CueIndexScanClusters(matroska_cueindex *Index, ebml_master *Segment, stream *Input, const ebml_parser_context *Context, const ebml_master *SegmentInfo, bool_t Keyframes)
+{
+    array Entries;
+    matroska_cueentry Entry;
+    ebml_parser_context SegmentContext;
+    ebml_element *Elt, *Next;
+    timecode_t Scale = MATROSKA_SegmentInfoTimecodeScale(SegmentInfo);
+    int64_t Timestamp;
+    int UpperElement = 0;
+    bool_t Found;
+    err_t Err = ERR_NONE;
+
+    assert(EBML_ElementIsType((ebml_element*)Segment, &MATROSKA_ContextSegment));
+    MATROSKA_CueIndexClear(Index);
+    ArrayInit(&Entries);
+    memset(&Entry,0,sizeof(Entry));
+
+    SegmentContext.Context = &MATROSKA_ContextSegment;
+    SegmentContext.EndPosition = EBML_ElementIsFiniteSize((ebml_element*)Segment) ? EBML_ElementPositionEnd((ebml_element*)Segment) : INVALID_FILEPOS_T;
+    SegmentContext.UpContext = Context;
+    SegmentContext.Profile = Context->Profile;
+
+    // only the Cluster heads and their Timestamp are read, unless the keyframes are needed too
+    Stream_Seek(Input,EBML_ElementPositionData((ebml_element*)Segment),SEEK_SET);
+    Elt = EBML_FindNextElement(Input,&SegmentContext,&UpperElement,0);
+    while (Elt && UpperElement<=0)
+    {
+        if (EBML_ElementIsType(Elt, &MATROSKA_ContextCluster))
+        {
+            if (Keyframes || !EBML_ElementIsFiniteSize(Elt))
+            {
+                Found = 0;
+                // the skeleton reads the Timestamp into the Cluster when it's looked up
+                if (EBML_ElementReadData(Elt,Input,&SegmentContext,0,Keyframes?SCOPE_PARTIAL_DATA:SCOPE_SKELETON,0)==ERR_NONE)
+                    Found = EBML_MasterIntegerValue((ebml_master*)Elt,&MATROSKA_ContextTimestamp,&Timestamp);
+            }
+            else
+                Found = ReadClusterTimestamp(Elt,Input,&SegmentContext,&Timestamp);
+
+            if (Found)
+            {
+                Entry.Timecode = Timestamp * Scale;
+                Entry.ClusterPosition = EBML_ElementPosition(Elt) - EBML_ElementPositionData((ebml_element*)Segment);
+                Entry.Track = 0;
+                Entry.RelativePosition = INVALID_FILEPOS_T;
+                Entry.BlockNumber = 0;
+                if (!ArrayAppend(&Entries,&Entry,sizeof(Entry),4096))
+                    Err = ERR_OUT_OF_MEMORY;
+                ++Entry.Order;
+                if (Keyframes && Err==ERR_NONE)
+                    Err = ScanClusterKeyframes((ebml_master*)Elt,Timestamp,Scale,&Entry,&Entries);
+                if (Err!=ERR_NONE)
+                {
+                    NodeDelete((node*)Elt);
+                    goto failed;
+                }
+            }
+        }
+        Next = EBML_ElementSkipData(Elt,Input,&SegmentContext,NULL,0);
+        NodeDelete((node*)Elt);
+        Elt = Next ? Next : EBML_FindNextElement(Input,&SegmentContext,&UpperElement,0);
+    }
+    if (Elt)
+        NodeDelete((node*)Elt);
+
+    Err = CueIndexFill(Index,&Entries);
+
+failed:
+    ArrayClear(&Entries);
+    if (Err != ERR_NONE)
+        MATROSKA_CueIndexClear(Index);
+    return Err;
+}
+
+// sidecar of a matroska_cueindex: a header followed by the arrays in the native byte order, each one aligned on 8 octets
+#define CUEINDEX_MAGIC    FOURCC('M','K','C','I')
+#define CUEINDEX_VERSION  1
+
+typedef struct matroska_cueindexhead
+{
+    fourcc_t Magic;
+    uint32_t ByteOrder; // 0x01020304 as written by the host
+    uint32_t Version;
+    uint32_t Count;
+    int64_t SourceSize;
+    int64_t SourceDate;
+
+} matroska_cueindexhead;
+
+static err_t CueIndexWrite(stream *Output, const array *Array, size_t Size)
+{
+    static const uint8_t Padding[8] = {0};
+    size_t Written;
+    err_t Err = ERR_NONE;
+    if (Size)
+        Err = Stream_Write(Output,ARRAYBEGIN(*Array,uint8_t),Size,&Written);
+    if (Err==ERR_NONE && (Size & 7))
+        Err = Stream_Write(Output,Padding,8 - (Size & 7),&Written);
+    return Err;
+}
+
+static err_t CueIndexRead(stream *Input, array *Array, size_t Size)
+{
+    uint8_t Padding[8];
+    size_t Read;
+    err_t Err = ERR_NONE;
+    if (!ArrayResize(Array,Size,0))
+        return ERR_OUT_OF_MEMORY;
+    if (Size)
+    {
+        Err = Stream_Read(Input,ARRAYBEGIN(*Array,uint8_t),Size,&Read);
+        if (Err==ERR_NONE && Read!=Size)
+            Err = ERR_READ;
+    }
+    if (Err==ERR_NONE && (Size & 7))
+    {
+        Err = Stream_Read(Input,Padding,8 - (Size & 7),&Read);
+        if (Err==ERR_NONE && Read!=8 - (Size & 7))
+            Err = ERR_READ;
+    }
+    return Err;
+}
+
+err_t MATROSKA_CueIndexSave(const matroska_cueindex *Index, stream *Output, filepos_t SourceSize, datetime_t SourceDate)
+{
+    matroska_cueindexhead Head;
+    size_t Count = ARRAYCOUNT(Index->Timecode,timecode_t), Written;
+    err_t Err;
+
+    memset(&Head,0,sizeof(Head));
+    Head.Magic = CUEINDEX_MAGIC;
+    Head.ByteOrder = 0x01020304;
+    Head.Version = CUEINDEX_VERSION;
+    Head.Count = (uint32_t)Count;
+    Head.SourceSize = SourceSize;
+    Head.SourceDate = SourceDate;
+    Err = Stream_Write(Output,&Head,sizeof(Head),&Written);
+    if (Err==ERR_NONE) Err = CueIndexWrite(Output,&Index->Timecode,Count*sizeof(timecode_t));
+    if (Err==ERR_NONE) Err = CueIndexWrite(Output,&Index->ClusterPosition,Count*sizeof(filepos_t));
+    if (Err==ERR_NONE) Err = CueIndexWrite(Output,&Index->RelativePosition,Count*sizeof(filepos_t));
+    if (Err==ERR_NONE) Err = CueIndexWrite(Output,&Index->BlockNumber,Count*sizeof(int32_t));
+    if (Err==ERR_NONE) Err = CueIndexWrite(Output,&Index->Track,Count*sizeof(int16_t));
+    return Err;
+}
+
+err_t MATROSKA_CueIndexLoad(matroska_cueindex *Index, stream *Input, filepos_t SourceSize, datetime_t SourceDate)
+{
+    matroska_cueindexhead Head;
+    size_t Count, Read;
+    err_t Err;
+
+    MATROSKA_CueIndexClear(Index);
+    Err = Stream_Read(Input,&Head,sizeof(Head),&Read);
+    if (Err!=ERR_NONE)
+        return Err;
+    if (Read!=sizeof(Head) || Head.Magic!=CUEINDEX_MAGIC || Head.ByteOrder!=0x01020304 || Head.Version!=CUEINDEX_VERSION)
+        return ERR_INVALID_DATA;
+    if (Head.SourceSize!=SourceSize || Head.SourceDate!=SourceDate)
+        return ERR_INVALID_DATA; // the file changed since the index was saved
+
+    Count = Head.Count;
+    Err = CueIndexRead(Input,&Index->Timecode,Count*sizeof(timecode_t));
+    if (Err==ERR_NONE) Err = CueIndexRead(Input,&Index->ClusterPosition,Count*sizeof(filepos_t));
+    if (Err==ERR_NONE) Err = CueIndexRead(Input,&Index->RelativePosition,Count*sizeof(filepos_t));
+    if (Err==ERR_NONE) Err = CueIndexRead(Input,&Index->BlockNumber,Count*sizeof(int32_t));
+    if (Err==ERR_NONE) Err = CueIndexRead(Input,&Index->Track,Count*sizeof(int16_t));
+    if (Err==ERR_NONE && !ArrayResize(&Index->CuePoint,Count*sizeof(matroska_cuepoint*),0))
+        Err = ERR_OUT_OF_MEMORY;
+    if (Err==ERR_NONE)
+    {
+        if (Count)
+            memset(ARRAYBEGIN(Index->CuePoint,matroska_cuepoint*),0,Count*sizeof(matroska_cuepoint*));
+        Err = CueIndexTracks(Index);
+    }
+    if (Err!=ERR_NONE)
+        MATROSKA_CueIndexClear(Index);
+    return Err;
+}
+
 static bool_t ValidateSizeSegUID(const ebml_binary *p)
 {
     uint8_t test[16];
@@ -2256,9 +2998,27 @@ static err_t CreateCluster(matroska_cluster *p)
     return ERR_NONE;
 }
 
+static void DeleteCluster(matroska_cluster *p)
+{
+    ArrayClear(&p->BlockIndex);
+}
+
+static err_t AddClusterChild(matroska_cluster *Cluster, ebml_element *Child, ebml_element *Before)
+{
+    ArrayClear(&Cluster->BlockIndex);
+    return INHERITED(Cluster,nodetree_vmt,MATROSKA_CLUSTER_CLASS)->AddChild(Cluster,Child,Before);
+}
+
+static void RemoveClusterChild(matroska_cluster *Cluster, ebml_element *Child)
+{
+    ArrayClear(&Cluster->BlockIndex);
+    INHERITED(Cluster,nodetree_vmt,MATROSKA_CLUSTER_CLASS)->RemoveChild(Cluster,Child);
+}
+
 static err_t ReadTrackEntry(matroska_trackentry *Element, stream *Input, const ebml_parser_context *ParserContext, bool_t AllowDummyElt, int Scope, size_t DepthCheckCRC)
 {
     err_t Result = INHERITED(Element,ebml_element_vmt,MATROSKA_TRACKENTRY_CLASS)->ReadData(Element, Input, ParserContext, AllowDummyElt, Scope, DepthCheckCRC);
+    TrackChanged(Element);
     if (Result==ERR_NONE)
     {
         ebml_element *Encodings = EBML_MasterFindChild(Element,&MATROSKA_ContextContentEncodings);
@@ -2281,6 +3041,7 @@ static err_t ReadTrackEntry(matroska_trackentry *Element, stream *Input, const e
 
 static filepos_t UpdateDataSizeTrackEntry(matroska_trackentry *Element, bool_t bWithDefault, bool_t bForceWithoutMandatory)
 {
+    TrackChanged(Element); // the ContentEncodings may have been edited
 #if defined(CONFIG_ZLIB)
     bool_t CodecPrivateCompressed = 0;
     ebml_integer *Scope = NULL;
@@ -2382,6 +3143,7 @@ bool_t MATROSKA_TrackSetCompressionZlib(matroska_trackentry *TrackEntry, int Sco
     bool_t HadEncoding;
     ebml_element *Encodings, *Elt, *Elt2;
     assert(Node_IsPartOf(TrackEntry, MATROSKA_TRACKENTRY_CLASS));
+    TrackChanged(TrackEntry);
     // remove the previous compression and the new optimized one
     Encodings = EBML_MasterFindChild(TrackEntry,&MATROSKA_ContextContentEncodings);
     HadEncoding = Encodings!=NULL;
@@ -2408,6 +3170,7 @@ bool_t MATROSKA_TrackSetCompressionHeader(matroska_trackentry *TrackEntry, const
     bool_t HadEncoding;
     ebml_element *Encodings, *Elt, *Elt2;
     assert(Node_IsPartOf(TrackEntry, MATROSKA_TRACKENTRY_CLASS));
+    TrackChanged(TrackEntry);
     // remove the previous compression and the new optimized one
     Encodings = EBML_MasterFindChild(TrackEntry,&MATROSKA_ContextContentEncodings);
     HadEncoding = Encodings!=NULL;
@@ -2432,6 +3195,7 @@ bool_t MATROSKA_TrackSetCompressionNone(matroska_trackentry *TrackEntry)
 {
     ebml_element *Encodings = EBML_MasterFindChild(TrackEntry,&MATROSKA_ContextContentEncodings);
     assert(Node_IsPartOf(TrackEntry, MATROSKA_TRACKENTRY_CLASS));
+    TrackChanged(TrackEntry);
     if (!Encodings)
         return 0;
     NodeDelete((node*)Encodings);
@@ -2467,6 +3231,8 @@ META_END_CONTINUE(EBML_BINARY_CLASS)
 
 META_START_CONTINUE(MATROSKA_BLOCKGROUP_CLASS)
 META_VMT(TYPE_FUNC,nodetree_vmt,SetParent,SetBlockGroupParent)
+META_VMT(TYPE_FUNC,nodetree_vmt,AddChild,AddBlockGroupChild)
+META_VMT(TYPE_FUNC,nodetree_vmt,RemoveChild,RemoveBlockGroupChild)
 META_END_CONTINUE(EBML_MASTER_CLASS)
 
 META_START_CONTINUE(MATROSKA_BIGBINARY_CLASS)
@@ -2485,6 +3251,9 @@ META_END_CONTINUE(EBML_MASTER_CLASS)
 META_START_CONTINUE(MATROSKA_CLUSTER_CLASS)
 META_CLASS(SIZE,sizeof(matroska_cluster))
 META_CLASS(CREATE,CreateCluster)
+META_CLASS(DELETE,DeleteCluster)
+META_VMT(TYPE_FUNC,nodetree_vmt,AddChild,AddClusterChild)
+META_VMT(TYPE_FUNC,nodetree_vmt,RemoveChild,RemoveClusterChild)
 META_PARAM(TYPE,MATROSKA_CLUSTER_READ_SEGMENTINFO,TYPE_NODE)
 META_DATA(TYPE_NODE_REF,MATROSKA_CLUSTER_READ_SEGMENTINFO,matroska_cluster,ReadSegInfo)
 META_PARAM(TYPE,MATROSKA_CLUSTER_WRITE_SEGMENTINFO,TYPE_NODE)
@@ -2499,6 +3268,7 @@ META_END_CONTINUE(EBML_MASTER_CLASS)
 
 META_START_CONTINUE(MATROSKA_TRACKENTRY_CLASS)
 META_CLASS(SIZE,sizeof(matroska_trackentry))
+META_CLASS(DELETE,DeleteTrackEntry)
 META_VMT(TYPE_FUNC,ebml_element_vmt,ReadData,ReadTrackEntry)
 META_VMT(TYPE_FUNC,ebml_element_vmt,UpdateDataSize,UpdateDataSizeTrackEntry)
 META_VMT(TYPE_FUNC,ebml_element_vmt,Copy,CopyTrackEntry)
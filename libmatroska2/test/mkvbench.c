@@ -0,0 +1,219 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+
+#define CONFIG_EBML_UNICODE
+#include "matroska/matroska.h"
+#include "matroska/matroska_sem.h"
+#include "mkvbench_stdafx.h"
+
+// walks all the element heads of a file and reports how many per second are found
+
+static bool_t ReadClusters = 0;
+static bool_t ClusterArena = 0;
+static bool_t ClusterSkeleton = 0;
+static bool_t UseReader = 0;
+
+static size_t CountChildren(ebml_element *Element)
+{
+    size_t Count = 0;
+    ebml_element *i;
+    for (i=EBML_MasterChildren(Element);i;i=EBML_MasterNext(i))
+    {
+        ++Count;
+        if (Node_IsPartOf(i,EBML_MASTER_CLASS))
+            Count += CountChildren(i);
+    }
+    return Count;
+}
+
+static ebml_element *CountElement(ebml_element *Element, const ebml_parser_context *Context, stream *Input, size_t *Count)
+{
+    ++(*Count);
+    if (ReadClusters && EBML_ElementIsType(Element,&MATROSKA_ContextCluster))
+    {
+        // build the whole Cluster tree like the tools do
+        if (ClusterArena)
+            EBML_MasterUseArena((ebml_master*)Element,1);
+        if (ClusterSkeleton)
+        {
+            // only the Cluster timestamp is needed, like when seeking, the lookup reads it into the Cluster
+            if (EBML_ElementReadData(Element,Input,Context,1,SCOPE_SKELETON,0)==ERR_NONE &&
+                EBML_MasterFindChild(Element,&MATROSKA_ContextTimestamp))
+                ++(*Count);
+        }
+        else if (EBML_ElementReadData(Element,Input,Context,1,SCOPE_PARTIAL_DATA,0)==ERR_NONE)
+            *Count += CountChildren(Element);
+        EBML_ElementSkipData(Element, Input, Context, NULL, 0);
+        return NULL;
+    }
+    if (Node_IsPartOf(Element,EBML_MASTER_CLASS))
+    {
+        int UpperElement = 0;
+        ebml_element *SubElement,*NewElement;
+        ebml_parser_context SubContext;
+
+        SubContext.UpContext = Context;
+        SubContext.Context = EBML_ElementContext(Element);
+        SubContext.EndPosition = EBML_ElementPositionEnd(Element);
+        SubElement = EBML_FindNextElement(Input, &SubContext, &UpperElement, 1);
+        while (SubElement != NULL && UpperElement<=0 && (!EBML_ElementIsFiniteSize(Element) || EBML_ElementPosition(SubElement) <= EBML_ElementPositionEnd(Element)))
+        {
+            NewElement = CountElement(SubElement, &SubContext, Input, Count);
+            NodeDelete((node*)SubElement);
+            if (NewElement)
+                SubElement = NewElement;
+            else
+                SubElement = EBML_FindNextElement(Input, &SubContext, &UpperElement, 1);
+        }
+        return SubElement;
+    }
+    EBML_ElementSkipData(Element, Input, Context, NULL, 0);
+    return NULL;
+}
+
+static int CountEvent(void *Cookie, const ebml_reader_element *Element)
+{
+    ++(*(size_t*)Cookie);
+    return EBML_READER_CONTINUE;
+}
+
+static size_t CountEvents(stream *Input)
+{
+    size_t Count = 0;
+    ebml_reader Reader;
+    ebml_parser_context Context;
+
+    memset(&Reader,0,sizeof(Reader));
+    Reader.Start = CountEvent;
+    Reader.Value = CountEvent;
+    Reader.Cookie = &Count;
+    Context.Context = &MATROSKA_ContextStream;
+    Context.UpContext = NULL;
+    Context.EndPosition = INVALID_FILEPOS_T;
+    Context.Profile = 0;
+    Stream_Seek(Input,0,SEEK_SET);
+    EBML_ReaderParse(&Reader,Input,&Context);
+    return Count;
+}
+
+static size_t CountTree(stream *Input)
+{
+    size_t Count = 0;
+    ebml_element *Element = EBML_ElementCreate(Input,&MATROSKA_ContextStream,0,NULL);
+    if (Element)
+    {
+        ebml_element *Left;
+        Stream_Seek(Input,0,SEEK_SET);
+        EBML_ElementSetInfiniteSize(Element,1);
+        Left = CountElement(Element, NULL, Input, &Count);
+        if (Left)
+            NodeDelete((node*)Left);
+        NodeDelete((node*)Element);
+        --Count; // the stream itself is not an element
+    }
+    return Count;
+}
+
+int main(int argc, const char *argv[])
+{
+    parsercontext p;
+    ebml_memheap Heap;
+    stream *Input;
+    tchar_t Path[MAXPATHFULL];
+    int Flags = SFLAG_RDONLY;
+    int Loops = 10, Loop, i;
+    size_t Count = 0;
+    systick_t Start, Duration;
+
+    for (i=1;i<argc-1;++i)
+    {
+        if (strcmp(argv[i],"--mapped")==0)
+            Flags |= SFLAG_MAPPED;
+        else if (strcmp(argv[i],"--read")==0)
+            ReadClusters = 1;
+        else if (strcmp(argv[i],"--arena")==0)
+            ReadClusters = ClusterArena = 1;
+        else if (strcmp(argv[i],"--skeleton")==0)
+            ReadClusters = ClusterSkeleton = 1;
+        else if (strcmp(argv[i],"--reader")==0)
+            UseReader = 1;
+        else if (strcmp(argv[i],"--loops")==0 && i+1<argc-1)
+            Loops = atoi(argv[++i]);
+        else
+            break;
+    }
+    if (argc<2 || i!=argc-1 || Loops<=0)
+    {
+        fprintf(stderr, "Usage: mkvbench [options] [matroska_file]\r\n");
+        fprintf(stderr, "Options:\r\n");
+        fprintf(stderr, "  --mapped    read the file mapped in memory\r\n");
+        fprintf(stderr, "  --read      read the Cluster trees in memory\r\n");
+        fprintf(stderr, "  --arena     read the Cluster trees in memory, each from its own arena\r\n");
+        fprintf(stderr, "  --skeleton  only read the Cluster timestamps, the other children are skipped\r\n");
+        fprintf(stderr, "  --reader    report the elements with EBML_ReaderParse(), no element is created\r\n");
+        fprintf(stderr, "  --loops <n> number of times the file is parsed (default 10)\r\n");
+        return 1;
+    }
+
+    // Core-C init phase
+    EBML_MemHeapInit(&Heap,NULL);
+    ParserContext_Init(&p,NULL,ClusterArena?&Heap.Base:NULL,NULL);
+	StdAfx_Init((nodemodule*)&p);
+    // EBML & Matroska Init
+    MATROSKA_Init((nodecontext*)&p);
+
+    Node_FromStr(&p,Path,TSIZEOF(Path),argv[argc-1]);
+    Input = StreamOpen(&p,Path,Flags);
+    if (Input == NULL)
+        fprintf(stderr, "error: mkvbench cannot open file \"%s\"\r\n",argv[argc-1]);
+    else
+    {
+        Start = GetTimeTick();
+        for (Loop=0;Loop<Loops;++Loop)
+            Count = UseReader ? CountEvents(Input) : CountTree(Input);
+        Duration = GetTimeTick() - Start;
+        if (Duration <= 0)
+            Duration = 1;
+
+        fprintf(stdout,"%s%s: %u elements, %d loops in %d ms, %.0f elements/s\r\n",
+            Node_IsPartOf(Input,MMAPSTREAM_CLASS)?"mapped":"file", UseReader?" reader":ClusterSkeleton?" skeleton":ClusterArena?" arena":ReadClusters?" read":"",
+            (unsigned)Count, Loops, (int)Duration, (double)Count * Loops * GetTimeFreq() / Duration);
+
+        StreamClose(Input);
+    }
+
+    // EBML & Matroska ending
+    MATROSKA_Done((nodecontext*)&p);
+    // Core-C ending
+	StdAfx_Done((nodemodule*)&p);
+    ParserContext_Done(&p);
+
+    return Input ? 0 : 1;
+}
@@ -97,181 +97,97 @@ void DebugMessage(const tchar_t* Msg,...)
 }
 #endif
 
-static void EndLine(ebml_element *Element)
+static void EndLine(const ebml_reader_element *Element)
 {
-    if (ShowPos && EBML_ElementPosition(Element)!=INVALID_FILEPOS_T)
-        fprintf(stdout," at %"PRId64"\r\n",EBML_ElementPosition(Element));
+    if (ShowPos)
+        fprintf(stdout," at %"PRId64"\r\n",Element->ElementPosition);
     else
         fprintf(stdout,"\r\n");
 }
 
-static ebml_element *OutputElement(ebml_element *Element, const ebml_parser_context *Context, stream *Input, int *Level)
+static void OutputName(const ebml_reader_element *Element)
 {
     int LevelPrint;
-    for (LevelPrint=0;LevelPrint<*Level;++LevelPrint)
+    for (LevelPrint=0;LevelPrint<Element->Level;++LevelPrint)
         fprintf(stdout,"+ ");
-    fprintf(stdout,"%s: ", EBML_ElementGetClassName(Element));
-    if (Node_IsPartOf(Element,EBML_MASTER_CLASS))
-    {
-        int UpperElement = 0;
-        ebml_element *SubElement,*NewElement;
-        ebml_parser_context SubContext;
+    fprintf(stdout,"%s: ", Element->Name);
+}
 
-        if (EBML_ElementDataSize(Element, 1) == INVALID_FILEPOS_T)
-            fprintf(stdout,"(master)");
-        else if (!EBML_ElementIsFiniteSize(Element))
-            fprintf(stdout,"(master) [unknown size]",EBML_ElementDataSize(Element, 1));
-        else
-            fprintf(stdout,"(master) [%"PRId64" bytes]",EBML_ElementDataSize(Element, 1));
-        EndLine(Element);
-        SubContext.UpContext = Context;
-        SubContext.Context = EBML_ElementContext(Element);
-        SubContext.EndPosition = EBML_ElementPositionEnd(Element);
-        SubElement = EBML_FindNextElement(Input, &SubContext, &UpperElement, 1);
-		while (SubElement != NULL && UpperElement<=0 && (!EBML_ElementIsFiniteSize(Element) || EBML_ElementPosition(SubElement) <= EBML_ElementPositionEnd(Element)))
-        {
-            // a sub element == not higher level and contained inside the current element
-            (*Level)++;
-            NewElement = OutputElement(SubElement, &SubContext, Input, Level);
-            NodeDelete((node*)SubElement);
-            if (NewElement)
-                SubElement = NewElement;
-            else
-                SubElement = EBML_FindNextElement(Input, &SubContext, &UpperElement, 1);
-            (*Level)--;
+static int OutputMaster(void *Cookie, const ebml_reader_element *Element)
+{
+    OutputName(Element);
+    if (Element->DataSize == INVALID_FILEPOS_T)
+        fprintf(stdout,"(master) [unknown size]");
+    else
+        fprintf(stdout,"(master) [%"PRId64" bytes]",Element->DataSize);
+    EndLine(Element);
+    return EBML_READER_CONTINUE;
+}
 
-			if (UpperElement < 0)
-				*Level += UpperElement;
-			else if (UpperElement != 0 && *Level>0)
-				*Level -= UpperElement-1;
-        }
-        return SubElement;
-        //EBML_ElementSkipData(Element, Input, Element->Context, NULL, 0);
-    }
-    else if (Node_IsPartOf(Element,EBML_STRING_CLASS) || Node_IsPartOf(Element,EBML_UNISTRING_CLASS))
-    {
-        //tchar_t UnicodeString[MAXDATA];
-        //EBML_StringRead((ebml_string*)Element,Input,UnicodeString,TSIZEOF(UnicodeString));
-        if (EBML_ElementReadData(Element,Input,NULL,0,SCOPE_ALL_DATA,0)==ERR_NONE)
-        {
-            tchar_t String[MAXDATA];
-            char cString[MAXDATA];
-            EBML_StringGet((ebml_string*)Element, String, TSIZEOF(String));
-            Node_ToUTF8(Element, cString, sizeof(cString), String);
-            fprintf(stdout,"'%s'",cString);
-        } else
-            fprintf(stdout,"<error reading>");
-        EndLine(Element);
-    }
-    else if (Node_IsPartOf(Element,EBML_DATE_CLASS))
-    {
-        if (EBML_ElementReadData(Element,Input,NULL,0,SCOPE_ALL_DATA,0)==ERR_NONE)
-        {
-            datepack_t Date;
-            datetime_t DateTime = EBML_DateTime((ebml_date*)Element);
-            GetDatePacked(DateTime,&Date,1);
-            fprintf(stdout,"%04d-%02d-%02d %02d:%02d:%02d UTC",Date.Year,Date.Month,Date.Day,Date.Hour,Date.Minute,Date.Second);
-        }
-        else
-            fprintf(stdout,"<error reading>");
-        EndLine(Element);
-    }
-    else if (Node_IsPartOf(Element,EBML_INTEGER_CLASS) || Node_IsPartOf(Element,EBML_SINTEGER_CLASS))
-    {
-        if (EBML_ElementReadData(Element,Input,NULL,0,SCOPE_ALL_DATA,0)==ERR_NONE)
-        {
-            if (Node_IsPartOf(Element,EBML_SINTEGER_CLASS))
-                fprintf(stdout,"%"PRId64,EBML_IntegerValue((ebml_integer*)Element));
-            else
-                fprintf(stdout,"%"PRIu64,EBML_IntegerValue((ebml_integer*)Element));
-        }
-        else
-            fprintf(stdout,"<error reading>");
-        EndLine(Element);
-    }
-    else if (Node_IsPartOf(Element,EBML_FLOAT_CLASS))
+static int OutputValue(void *Cookie, const ebml_reader_element *Element)
+{
+    OutputName(Element);
+    if (Element->ValueResult != ERR_NONE)
+        fprintf(stdout,"<error reading>");
+    else if (!Element->Context)
+        fprintf(stdout,"[%X] [%"PRId64" bytes]",Element->Id,Element->DataSize);
+    else if (Element->Context==&EBML_ContextEbmlVoid || Element->Context==&EBML_ContextEbmlCrc32)
+        fprintf(stdout,"[%"PRId64" bytes]",Element->DataSize); // TODO: handle crc32
+    else if (Element->Type==EBML_READER_STRING)
     {
-        if (EBML_ElementReadData(Element,Input,NULL,0,SCOPE_ALL_DATA,0)==ERR_NONE)
-            fprintf(stdout,"%f",EBML_FloatValue((ebml_float*)Element));
-        else
-            fprintf(stdout,"<error reading>");
-        EndLine(Element);
+        const uint8_t *Zero = Element->Data ? memchr(Element->Data,0,(size_t)Element->DataSize) : NULL;
+        fprintf(stdout,"'%.*s'",(int)(Zero ? Zero-Element->Data : Element->DataSize),Element->Data ? (const char*)Element->Data : "");
     }
-    else if (EBML_ElementIsDummy(Element))
+    else if (Element->Type==EBML_READER_DATE)
     {
-        fprintf(stdout,"[%X] [%"PRId64" bytes]",EBML_ElementClassID(Element),EBML_ElementDataSize(Element, 1));
-        EBML_ElementSkipData(Element, Input, Context, NULL, 0);
-        EndLine(Element);
+        datepack_t Date;
+        GetDatePacked((datetime_t)Scale32(Element->Integer,1,1000000000),&Date,1);
+        fprintf(stdout,"%04d-%02d-%02d %02d:%02d:%02d UTC",Date.Year,Date.Month,Date.Day,Date.Hour,Date.Minute,Date.Second);
     }
-    else if (Node_IsPartOf(Element,EBML_BINARY_CLASS))
+    else if (Element->Type==EBML_READER_SINTEGER)
+        fprintf(stdout,"%"PRId64,Element->Integer);
+    else if (Element->Type==EBML_READER_INTEGER)
+        fprintf(stdout,"%"PRIu64,Element->Integer);
+    else if (Element->Type==EBML_READER_FLOAT)
+        fprintf(stdout,"%f",Element->Float);
+    else if (Element->DataSize != 0)
     {
-        if (EBML_ElementReadData(Element,Input,NULL,0,SCOPE_PARTIAL_DATA,0)==ERR_NONE)
-        {
-            const uint8_t *Data = EBML_BinaryGetData((ebml_binary*)Element);
-            if (EBML_ElementDataSize(Element, 1) != 0)
-            {
-                if (Data==NULL)
-                    fprintf(stdout,"[data too large] (%"PRId64")",EBML_ElementDataSize(Element, 1));
-                else if (EBML_ElementDataSize(Element, 1) == 1)
-                    fprintf(stdout,"%02X (%"PRId64")",Data[0],EBML_ElementDataSize(Element, 1));
-                else if (EBML_ElementDataSize(Element, 1) == 2)
-                    fprintf(stdout,"%02X %02X (%"PRId64")",Data[0],Data[1],EBML_ElementDataSize(Element, 1));
-                else if (EBML_ElementDataSize(Element, 1) == 3)
-                    fprintf(stdout,"%02X %02X %02X (%"PRId64")",Data[0],Data[1],Data[2],EBML_ElementDataSize(Element, 1));
-                else if (EBML_ElementDataSize(Element, 1) == 4)
-                    fprintf(stdout,"%02X %02X %02X %02X (%"PRId64")",Data[0],Data[1],Data[2],Data[3],EBML_ElementDataSize(Element, 1));
-                else
-                    fprintf(stdout,"%02X %02X %02X %02X.. (%"PRId64")",Data[0],Data[1],Data[2],Data[3],EBML_ElementDataSize(Element, 1));
-            }
-        }
+        const uint8_t *Data = Element->Data;
+        if (Data==NULL)
+            fprintf(stdout,"[data too large] (%"PRId64")",Element->DataSize);
+        else if (Element->DataSize == 1)
+            fprintf(stdout,"%02X (%"PRId64")",Data[0],Element->DataSize);
+        else if (Element->DataSize == 2)
+            fprintf(stdout,"%02X %02X (%"PRId64")",Data[0],Data[1],Element->DataSize);
+        else if (Element->DataSize == 3)
+            fprintf(stdout,"%02X %02X %02X (%"PRId64")",Data[0],Data[1],Data[2],Element->DataSize);
+        else if (Element->DataSize == 4)
+            fprintf(stdout,"%02X %02X %02X %02X (%"PRId64")",Data[0],Data[1],Data[2],Data[3],Element->DataSize);
         else
-            fprintf(stdout,"<error reading>");
-		EBML_ElementSkipData(Element, Input, Context, NULL, 0);
-        EndLine(Element);
+            fprintf(stdout,"%02X %02X %02X %02X.. (%"PRId64")",Data[0],Data[1],Data[2],Data[3],Element->DataSize);
     }
-    else if (Node_IsPartOf(Element,EBML_VOID_CLASS))
-    {
-        fprintf(stdout,"[%"PRId64" bytes]",EBML_ElementDataSize(Element, 1));
-        EBML_ElementSkipData(Element, Input, Context, NULL, 0);
-        EndLine(Element);
-	}
-    else if (Node_IsPartOf(Element,EBML_CRC_CLASS))
-    {
-        // TODO: handle crc32
-        fprintf(stdout,"[%"PRId64" bytes]",EBML_ElementDataSize(Element, 1));
-        EBML_ElementSkipData(Element, Input, Context, NULL, 0);
-        EndLine(Element);
-	}
-    else
-    {
-#ifdef IS_BIG_ENDIAN
-        fprintf(stdout,"<unsupported element %x>\r\n",Element->Context->Id);
-#else
-        fourcc_t Id = EBML_ElementClassID(Element);
-        fprintf(stdout,"<unsupported element ");
-        while (Id & 0xFF)
-        {
-            fprintf(stdout,"[%x]",Id & 0xFF);
-            Id >>= 8;
-        }
-        fprintf(stdout,">",EBML_ElementClassID(Element));
-#endif
-        EBML_ElementSkipData(Element, Input, Context, NULL, 0);
-        EndLine(Element);
-    }
-    return NULL;
+    EndLine(Element);
+    return EBML_READER_CONTINUE;
 }
 
 static void OutputTree(stream *Input)
 {
-    ebml_element *Element = EBML_ElementCreate(Input,&MATROSKA_ContextStream,0,NULL);
-    if (Element)
-    {
-		int Level = -1;
-        EBML_ElementSetInfiniteSize(Element,1);
-        OutputElement(Element, NULL, Input, &Level);
-        NodeDelete((node*)Element);
-    }
+    ebml_reader Reader;
+    ebml_parser_context Context;
+
+    // the elements are printed as they are found, no element tree is built
+    memset(&Reader,0,sizeof(Reader));
+    Reader.Start = OutputMaster;
+    Reader.Value = OutputValue;
+    Reader.MaxDataSize = 256; // the Blocks don't need to be loaded
+    Context.Context = &MATROSKA_ContextStream;
+    Context.UpContext = NULL;
+    Context.EndPosition = INVALID_FILEPOS_T;
+    Context.Profile = 0;
+
+    fprintf(stdout,"Matroska Stream: (master)\r\n");
+    Stream_Seek(Input,0,SEEK_SET);
+    EBML_ReaderParse(&Reader,Input,&Context);
 }
 
 int main(int argc, const char *argv[])
@@ -0,0 +1,872 @@
+/*
+ * $Id$
+ * Copyright (c) 2010, Matroska (non-profit organisation)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Matroska assocation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY the Matroska association ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL The Matroska Foundation BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+
+#include "MatroskaParser.h"
+#include "matroska/matroska_sem.h"
+#include "parsertest_stdafx.h"
+
+// reads files built in memory with MatroskaParser and checks
+// the frames of the Blocks, with each kind of lacing, against the ones written
+// the frames left when masking tracks, including the ones after the 32nd
+// the Cluster found when seeking, with the Cues and by bisecting the Clusters without them
+// the Tags, Chapters and Attachments, read only when they are asked for
+// the cue index scanned from the Clusters of a file without Cues, saved and loaded again
+
+#define TRACKS            40
+#define CLUSTERS          24
+#define CLUSTER_DURATION  1000 // in TimecodeScale units
+#define TIMECODE_SCALE    1000000
+#define ATTACHMENT_SIZE   100
+
+#define LACING_NONE  0
+#define LACING_XIPH  1
+#define LACING_FIXED 2
+#define LACING_EBML  3
+
+// the Blocks written in each Cluster
+static const struct
+{
+    uint8_t Track; // index in the Tracks
+    uint8_t Lacing;
+    uint8_t Frames;
+    bool_t Group; // in a BlockGroup rather than a SimpleBlock
+    int16_t Timecode;
+
+} Blocks[] = {
+    { 0, LACING_NONE,  1, 0,  0}, // keyframe in every other Cluster
+    { 1, LACING_XIPH,  3, 0, 10},
+    { 2, LACING_EBML,  4, 0, 20},
+    { 3, LACING_FIXED, 2, 0, 30},
+    {34, LACING_NONE,  1, 1, 40}, // with a ReferenceBlock in every third Cluster
+    {39, LACING_XIPH,  2, 0, 50},
+};
+
+typedef struct expected_frame
+{
+    size_t Track;
+    size_t Cluster;
+    size_t Frame;
+    size_t Size;
+    timecode_t Timecode; // INVALID_TIMECODE_T for the frames of a lace after the first
+    bool_t Keyframe;
+
+} expected_frame;
+
+typedef struct memory_input
+{
+    InputStream Base;
+    const uint8_t *Data;
+    size_t Size;
+    filepos_t Pos;
+    filepos_t ReadEnd; // end of the furthest data read
+    size_t Skipped; // Blocks skipped by the parser
+    bool_t SkippedError;
+
+} memory_input;
+
+static int Errors = 0;
+
+static void Error(const char *Step, const char *Msg)
+{
+    fprintf(stderr,"%s: %s\r\n",Step,Msg);
+    ++Errors;
+}
+
+static size_t FrameSize(size_t Track, size_t Cluster, size_t Frame)
+{
+    return 1 + (Track*5 + Cluster*13 + Frame*101) % 600;
+}
+
+static uint8_t FrameByte(size_t Track, size_t Cluster, size_t Frame, size_t i)
+{
+    return (uint8_t)(Track*31 + Cluster*7 + Frame*3 + i);
+}
+
+static bool_t IsKeyframe(size_t Block, size_t Cluster)
+{
+    if (Blocks[Block].Track == 0)
+        return (Cluster & 1) == 0;
+    if (Blocks[Block].Group)
+        return (Cluster % 3) != 1;
+    return 1;
+}
+
+static void PutId(array *Out, fourcc_t Id)
+{
+    uint8_t Head[4];
+    size_t Length = Id>0xFFFFFF ? 4 : Id>0xFFFF ? 3 : Id>0xFF ? 2 : 1, i;
+    for (i=0;i<Length;++i)
+        Head[i] = (uint8_t)(Id >> (8*(Length-1-i)));
+    ArrayAppend(Out,Head,Length,256);
+}
+
+static void PutSize(array *Out, filepos_t Size)
+{
+    uint8_t Head[8];
+    size_t Length = EBML_CodedSizeLength(Size,0,1);
+    EBML_CodedValueLength(Size,Length,Head,1);
+    ArrayAppend(Out,Head,Length,256);
+}
+
+static void PutElement(array *Out, const ebml_context *Context, const void *Data, size_t Size)
+{
+    PutId(Out,Context->Id);
+    PutSize(Out,Size);
+    ArrayAppend(Out,Data,Size,256);
+}
+
+// Length 0 for the shortest integer
+static void PutUInt(array *Out, const ebml_context *Context, uint64_t Value, size_t Length)
+{
+    uint8_t Data[8];
+    size_t i;
+    if (!Length)
+        for (Length=1;Length<8 && (Value >> (8*Length));++Length) {}
+    for (i=0;i<Length;++i)
+        Data[i] = (uint8_t)(Value >> (8*(Length-1-i)));
+    PutElement(Out,Context,Data,Length);
+}
+
+static void PutString(array *Out, const ebml_context *Context, const char *Value)
+{
+    PutElement(Out,Context,Value,strlen(Value));
+}
+
+// the children are cleared once written in their master
+static void PutMaster(array *Out, const ebml_context *Context, array *Children)
+{
+    PutElement(Out,Context,ARRAYBEGIN(*Children,uint8_t),ARRAYCOUNT(*Children,uint8_t));
+    ArrayClear(Children);
+}
+
+static void PutBlock(array *Cluster, size_t Block, size_t ClusterNum, array *Expected)
+{
+    array Data, Group;
+    expected_frame Frame;
+    uint8_t Head[8];
+    size_t Track = Blocks[Block].Track, i, j, Size;
+    bool_t Keyframe = IsKeyframe(Block,ClusterNum);
+
+    ArrayInit(&Data);
+    ArrayInit(&Group);
+    Head[0] = (uint8_t)(0x80 | (Track+1));
+    Head[1] = (uint8_t)(Blocks[Block].Timecode >> 8);
+    Head[2] = (uint8_t)(Blocks[Block].Timecode);
+    Head[3] = (uint8_t)(Blocks[Block].Lacing << 1);
+    if (Keyframe && !Blocks[Block].Group)
+        Head[3] |= 0x80;
+    Head[4] = (uint8_t)(Blocks[Block].Frames - 1);
+    ArrayAppend(&Data,Head,Blocks[Block].Lacing==LACING_NONE ? 4 : 5,256);
+
+    // the lace sizes of all the frames but the last one
+    for (i=0;i+1<Blocks[Block].Frames;++i)
+    {
+        Size = FrameSize(Track,ClusterNum,i);
+        if (Blocks[Block].Lacing == LACING_XIPH)
+        {
+            for (;Size>=0xFF;Size-=0xFF)
+            {
+                Head[0] = 0xFF;
+                ArrayAppend(&Data,Head,1,256);
+            }
+            Head[0] = (uint8_t)Size;
+            ArrayAppend(&Data,Head,1,256);
+        }
+        else if (Blocks[Block].Lacing == LACING_EBML && i==0)
+            PutSize(&Data,Size);
+        else if (Blocks[Block].Lacing == LACING_EBML)
+        {
+            filepos_t Diff = (filepos_t)Size - (filepos_t)FrameSize(Track,ClusterNum,i-1);
+            j = EBML_CodedSizeLengthSigned(Diff,0);
+            EBML_CodedValueLengthSigned(Diff,j,Head);
+            ArrayAppend(&Data,Head,j,256);
+        }
+    }
+
+    for (i=0;i<Blocks[Block].Frames;++i)
+    {
+        Frame.Track = Track;
+        Frame.Cluster = ClusterNum;
+        Frame.Frame = Blocks[Block].Lacing==LACING_FIXED ? 0 : i;
+        Frame.Size = FrameSize(Track,ClusterNum,Frame.Frame);
+        Frame.Timecode = i ? INVALID_TIMECODE_T : (timecode_t)(ClusterNum*CLUSTER_DURATION + Blocks[Block].Timecode) * TIMECODE_SCALE;
+        Frame.Keyframe = Keyframe;
+        ArrayAppend(Expected,&Frame,sizeof(Frame),256);
+        for (j=0;j<Frame.Size;++j)
+        {
+            Head[0] = FrameByte(Track,ClusterNum,Frame.Frame,j);
+            ArrayAppend(&Data,Head,1,4096);
+        }
+    }
+
+    if (!Blocks[Block].Group)
+        PutMaster(Cluster,&MATROSKA_ContextSimpleBlock,&Data);
+    else
+    {
+        PutMaster(&Group,&MATROSKA_ContextBlock,&Data);
+        if (!Keyframe)
+            PutUInt(&Group,&MATROSKA_ContextReferenceBlock,0xFC18,2); // -1000
+        PutMaster(Cluster,&MATROSKA_ContextBlockGroup,&Group);
+    }
+}
+
+static void PutSeek(array *SeekHead, const ebml_context *Context, filepos_t Pos)
+{
+    array Seek;
+    uint8_t Id[4];
+    ArrayInit(&Seek);
+    Id[0] = (uint8_t)(Context->Id >> 24);
+    Id[1] = (uint8_t)(Context->Id >> 16);
+    Id[2] = (uint8_t)(Context->Id >> 8);
+    Id[3] = (uint8_t)(Context->Id);
+    PutElement(&Seek,&MATROSKA_ContextSeekID,Id,4);
+    PutUInt(&Seek,&MATROSKA_ContextSeekPosition,Pos,4); // same size for any position
+    PutMaster(SeekHead,&MATROSKA_ContextSeek,&Seek);
+}
+
+// Clusters from the second second of the file, with Cues on the keyframes of the first track when WithCues is set
+static void BuildFile(array *File, bool_t WithCues, array *Expected, filepos_t *ClustersPos, filepos_t *ClustersEnd, filepos_t *AttachmentPos)
+{
+    array Head, Info, Tracks, Clusters, Cues, Tags, Chapters, Attachments, SeekHead, Children, Sub, Sub2;
+    filepos_t ClusterPos[CLUSTERS], Pos, SegmentSize, SeekHeadSize;
+    uint8_t AttachmentData[ATTACHMENT_SIZE];
+    size_t i, j;
+
+    ArrayInit(&Head); ArrayInit(&Info); ArrayInit(&Tracks); ArrayInit(&Clusters); ArrayInit(&Cues);
+    ArrayInit(&Tags); ArrayInit(&Chapters); ArrayInit(&Attachments); ArrayInit(&SeekHead);
+    ArrayInit(&Children); ArrayInit(&Sub); ArrayInit(&Sub2);
+    ArrayClear(File);
+    ArrayClear(Expected);
+
+    PutUInt(&Children,&EBML_ContextVersion,1,0);
+    PutUInt(&Children,&EBML_ContextReadVersion,1,0);
+    PutUInt(&Children,&EBML_ContextMaxIdLength,4,0);
+    PutUInt(&Children,&EBML_ContextMaxSizeLength,8,0);
+    PutString(&Children,&EBML_ContextDocType,"matroska");
+    PutUInt(&Children,&EBML_ContextDocTypeVersion,2,0);
+    PutUInt(&Children,&EBML_ContextDocTypeReadVersion,2,0);
+    PutMaster(&Head,&EBML_ContextHead,&Children);
+
+    PutUInt(&Children,&MATROSKA_ContextTimestampScale,TIMECODE_SCALE,0);
+    PutString(&Children,&MATROSKA_ContextMuxingApp,"parsertest");
+    PutString(&Children,&MATROSKA_ContextWritingApp,"parsertest");
+    PutMaster(&Info,&MATROSKA_ContextInfo,&Children);
+
+    for (i=0;i<TRACKS;++i)
+    {
+        PutUInt(&Children,&MATROSKA_ContextTrackNumber,i+1,0);
+        PutUInt(&Children,&MATROSKA_ContextTrackUID,1000+i,0);
+        PutUInt(&Children,&MATROSKA_ContextTrackType,i ? TRACK_TYPE_AUDIO : TRACK_TYPE_VIDEO,0);
+        PutString(&Children,&MATROSKA_ContextCodecID,i ? "A_PARSERTEST" : "V_PARSERTEST");
+        PutMaster(&Tracks,&MATROSKA_ContextTrackEntry,&Children);
+    }
+    PutMaster(&Sub,&MATROSKA_ContextTracks,&Tracks);
+    ArrayAppend(&Tracks,ARRAYBEGIN(Sub,uint8_t),ARRAYCOUNT(Sub,uint8_t),256);
+    ArrayClear(&Sub);
+
+    for (i=0;i<CLUSTERS;++i)
+    {
+        ClusterPos[i] = ARRAYCOUNT(Clusters,uint8_t);
+        PutUInt(&Children,&MATROSKA_ContextTimestamp,i*CLUSTER_DURATION,0);
+        for (j=0;j<sizeof(Blocks)/sizeof(Blocks[0]);++j)
+            PutBlock(&Children,j,i,Expected);
+        PutMaster(&Clusters,&MATROSKA_ContextCluster,&Children);
+    }
+
+    // the size of the SeekHead doesn't depend on the positions
+    PutSeek(&SeekHead,&MATROSKA_ContextInfo,0);
+    PutSeek(&SeekHead,&MATROSKA_ContextTracks,0);
+    if (WithCues)
+        PutSeek(&SeekHead,&MATROSKA_ContextCues,0);
+    PutSeek(&SeekHead,&MATROSKA_ContextTags,0);
+    PutSeek(&SeekHead,&MATROSKA_ContextChapters,0);
+    PutSeek(&SeekHead,&MATROSKA_ContextAttachments,0);
+    PutMaster(&Sub,&MATROSKA_ContextSeekHead,&SeekHead);
+    SeekHeadSize = ARRAYCOUNT(Sub,uint8_t);
+    Pos = SeekHeadSize + ARRAYCOUNT(Info,uint8_t) + ARRAYCOUNT(Tracks,uint8_t);
+    ArrayClear(&Sub);
+
+    if (WithCues)
+    {
+        for (i=0;i<CLUSTERS;i+=2)
+        {
+            PutUInt(&Sub,&MATROSKA_ContextCueTrack,1,0);
+            PutUInt(&Sub,&MATROSKA_ContextCueClusterPosition,Pos+ClusterPos[i],0);
+            PutUInt(&Children,&MATROSKA_ContextCueTime,i*CLUSTER_DURATION,0);
+            PutMaster(&Children,&MATROSKA_ContextCueTrackPositions,&Sub);
+            PutMaster(&Cues,&MATROSKA_ContextCuePoint,&Children);
+        }
+        PutMaster(&Sub,&MATROSKA_ContextCues,&Cues);
+        ArrayAppend(&Cues,ARRAYBEGIN(Sub,uint8_t),ARRAYCOUNT(Sub,uint8_t),256);
+        ArrayClear(&Sub);
+    }
+
+    PutUInt(&Sub,&MATROSKA_ContextTargetTypeValue,50,0);
+    PutMaster(&Children,&MATROSKA_ContextTargets,&Sub);
+    PutString(&Sub,&MATROSKA_ContextTagName,"TITLE");
+    PutString(&Sub,&MATROSKA_ContextTagString,"parser test");
+    PutMaster(&Children,&MATROSKA_ContextSimpleTag,&Sub);
+    PutMaster(&Tags,&MATROSKA_ContextTag,&Children);
+    PutMaster(&Sub,&MATROSKA_ContextTags,&Tags);
+    ArrayAppend(&Tags,ARRAYBEGIN(Sub,uint8_t),ARRAYCOUNT(Sub,uint8_t),256);
+    ArrayClear(&Sub);
+
+    PutUInt(&Children,&MATROSKA_ContextEditionUID,1,0);
+    for (i=0;i<2;++i)
+    {
+        PutUInt(&Sub,&MATROSKA_ContextChapterUID,i+1,0);
+        PutUInt(&Sub,&MATROSKA_ContextChapterTimeStart,(uint64_t)i*5000000000,0);
+        PutUInt(&Sub,&MATROSKA_ContextChapterTimeEnd,(uint64_t)(i+1)*5000000000,0);
+        PutString(&Sub2,&MATROSKA_ContextChapString,i ? "second" : "first");
+        PutMaster(&Sub,&MATROSKA_ContextChapterDisplay,&Sub2);
+        PutMaster(&Children,&MATROSKA_ContextChapterAtom,&Sub);
+    }
+    PutMaster(&Chapters,&MATROSKA_ContextEditionEntry,&Children);
+    PutMaster(&Sub,&MATROSKA_ContextChapters,&Chapters);
+    ArrayAppend(&Chapters,ARRAYBEGIN(Sub,uint8_t),ARRAYCOUNT(Sub,uint8_t),256);
+    ArrayClear(&Sub);
+
+    for (i=0;i<ATTACHMENT_SIZE;++i)
+        AttachmentData[i] = (uint8_t)(i*7);
+    PutString(&Children,&MATROSKA_ContextFileName,"parsertest.bin");
+    PutString(&Children,&MATROSKA_ContextFileMimeType,"application/octet-stream");
+    PutUInt(&Children,&MATROSKA_ContextFileUID,42,0);
+    PutElement(&Children,&MATROSKA_ContextFileData,AttachmentData,ATTACHMENT_SIZE);
+    PutMaster(&Attachments,&MATROSKA_ContextAttachedFile,&Children);
+    PutMaster(&Sub,&MATROSKA_ContextAttachments,&Attachments);
+    ArrayAppend(&Attachments,ARRAYBEGIN(Sub,uint8_t),ARRAYCOUNT(Sub,uint8_t),256);
+    ArrayClear(&Sub);
+
+    // the SeekHead with the positions in the Segment
+    Pos = SeekHeadSize + ARRAYCOUNT(Info,uint8_t) + ARRAYCOUNT(Tracks,uint8_t) + ARRAYCOUNT(Clusters,uint8_t);
+    PutSeek(&Sub,&MATROSKA_ContextInfo,SeekHeadSize);
+    PutSeek(&Sub,&MATROSKA_ContextTracks,SeekHeadSize + ARRAYCOUNT(Info,uint8_t));
+    if (WithCues)
+        PutSeek(&Sub,&MATROSKA_ContextCues,Pos);
+    Pos += ARRAYCOUNT(Cues,uint8_t);
+    PutSeek(&Sub,&MATROSKA_ContextTags,Pos);
+    Pos += ARRAYCOUNT(Tags,uint8_t);
+    PutSeek(&Sub,&MATROSKA_ContextChapters,Pos);
+    Pos += ARRAYCOUNT(Chapters,uint8_t);
+    PutSeek(&Sub,&MATROSKA_ContextAttachments,Pos);
+    PutMaster(&SeekHead,&MATROSKA_ContextSeekHead,&Sub);
+
+    SegmentSize = Pos + ARRAYCOUNT(Attachments,uint8_t);
+    ArrayAppend(File,ARRAYBEGIN(Head,uint8_t),ARRAYCOUNT(Head,uint8_t),4096);
+    PutId(File,MATROSKA_ContextSegment.Id);
+    PutSize(File,SegmentSize);
+    Pos = ARRAYCOUNT(*File,uint8_t);
+    *ClustersPos = Pos + ARRAYCOUNT(SeekHead,uint8_t) + ARRAYCOUNT(Info,uint8_t) + ARRAYCOUNT(Tracks,uint8_t);
+    *ClustersEnd = *ClustersPos + ARRAYCOUNT(Clusters,uint8_t);
+    *AttachmentPos = Pos + SegmentSize - ATTACHMENT_SIZE;
+    ArrayAppend(File,ARRAYBEGIN(SeekHead,uint8_t),ARRAYCOUNT(SeekHead,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Info,uint8_t),ARRAYCOUNT(Info,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Tracks,uint8_t),ARRAYCOUNT(Tracks,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Clusters,uint8_t),ARRAYCOUNT(Clusters,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Cues,uint8_t),ARRAYCOUNT(Cues,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Tags,uint8_t),ARRAYCOUNT(Tags,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Chapters,uint8_t),ARRAYCOUNT(Chapters,uint8_t),4096);
+    ArrayAppend(File,ARRAYBEGIN(Attachments,uint8_t),ARRAYCOUNT(Attachments,uint8_t),4096);
+
+    ArrayClear(&Head); ArrayClear(&Info); ArrayClear(&Tracks); ArrayClear(&Clusters); ArrayClear(&Cues);
+    ArrayClear(&Tags); ArrayClear(&Chapters); ArrayClear(&Attachments); ArrayClear(&SeekHead);
+}
+
+static int MemRead(InputStream *p, void *Buffer, int Count)
+{
+    memory_input *Input = (memory_input*)p;
+    if (Input->Pos >= (filepos_t)Input->Size)
+        return 0;
+    if (Count > (filepos_t)Input->Size - Input->Pos)
+        Count = (int)((filepos_t)Input->Size - Input->Pos);
+    memcpy(Buffer,Input->Data + Input->Pos,Count);
+    Input->Pos += Count;
+    if (Input->ReadEnd < Input->Pos)
+        Input->ReadEnd = Input->Pos;
+    return Count;
+}
+
+static void MemSeek(InputStream *p, longlong Where, int How)
+{
+    memory_input *Input = (memory_input*)p;
+    if (How == SEEK_CUR)
+        Where += Input->Pos;
+    else if (How == SEEK_END)
+        Where += Input->Size;
+    Input->Pos = Where;
+}
+
+static filepos_t MemTell(InputStream *p)
+{
+    return ((memory_input*)p)->Pos;
+}
+
+static filepos_t MemFileSize(InputStream *p)
+{
+    return ((memory_input*)p)->Size;
+}
+
+static void *MemMakeRef(InputStream *p, int Count)
+{
+    void *Ref = malloc(Count ? Count : 1);
+    if (Ref && MemRead(p,Ref,Count) != Count)
+    {
+        free(Ref);
+        Ref = NULL;
+    }
+    return Ref;
+}
+
+static void MemReleaseRef(InputStream *UNUSED_PARAM(p), void *Ref)
+{
+    free(Ref);
+}
+
+static int MemProgress(InputStream *UNUSED_PARAM(p), filepos_t UNUSED_PARAM(Cur), filepos_t UNUSED_PARAM(Max))
+{
+    return 1;
+}
+
+static void *MemAlloc(InputStream *UNUSED_PARAM(p), size_t Size)
+{
+    return malloc(Size);
+}
+
+static void *MemRealloc(InputStream *UNUSED_PARAM(p), void *Mem, size_t Size)
+{
+    return realloc(Mem,Size);
+}
+
+static void MemFree(InputStream *UNUSED_PARAM(p), void *Mem)
+{
+    free(Mem);
+}
+
+static void MemSkipped(InputStream *p, filepos_t Pos, filepos_t Count)
+{
+    memory_input *Input = (memory_input*)p;
+    // a whole SimpleBlock or BlockGroup
+    if (Pos < 0 || Count <= 0 || Pos + Count > (filepos_t)Input->Size ||
+        (Input->Data[Pos] != (uint8_t)MATROSKA_ContextSimpleBlock.Id && Input->Data[Pos] != (uint8_t)MATROSKA_ContextBlockGroup.Id))
+        Input->SkippedError = 1;
+    ++Input->Skipped;
+}
+
+static MatroskaFile *Open(memory_input *Input, anynode *AnyNode, const array *File, const char *Step)
+{
+    MatroskaFile *Result;
+    char Msg[256];
+
+    memset(Input,0,sizeof(*Input));
+    Input->Base.ioread = MemRead;
+    Input->Base.ioseek = MemSeek;
+    Input->Base.iotell = MemTell;
+    Input->Base.getfilesize = MemFileSize;
+    Input->Base.makeref = MemMakeRef;
+    Input->Base.releaseref = MemReleaseRef;
+    Input->Base.progress = MemProgress;
+    Input->Base.memalloc = MemAlloc;
+    Input->Base.memrealloc = MemRealloc;
+    Input->Base.memfree = MemFree;
+    Input->Base.AnyNode = AnyNode;
+    Input->Data = ARRAYBEGIN(*File,uint8_t);
+    Input->Size = ARRAYCOUNT(*File,uint8_t);
+
+    Msg[0] = 0;
+    Result = mkv_Open(&Input->Base,Msg,sizeof(Msg));
+    if (!Result)
+        Error(Step,Msg);
+    else if (mkv_GetNumTracks(Result) != TRACKS)
+        Error(Step,"wrong number of tracks");
+    else
+        mkv_SetSkipCallback(Result,MemSkipped);
+    return Result;
+}
+
+static bool_t IsMasked(const uint32_t *Mask, size_t Track)
+{
+    return Mask && (Mask[Track>>5] & (1u << (Track & 31)));
+}
+
+static bool_t SameFrame(const expected_frame *Expected, unsigned int Track, ulonglong Start, unsigned int Size, const uint8_t *Data, unsigned int Flags)
+{
+    size_t i;
+    if (Track != Expected->Track || Size != Expected->Size || !Data)
+        return 0;
+    if (((Flags & FRAME_KF)!=0) != Expected->Keyframe)
+        return 0;
+    if (Expected->Timecode == INVALID_TIMECODE_T ? !(Flags & FRAME_UNKNOWN_START) : ((Flags & FRAME_UNKNOWN_START) || Start != (ulonglong)Expected->Timecode))
+        return 0;
+    for (i=0;i<Size;++i)
+        if (Data[i] != FrameByte(Expected->Track,Expected->Cluster,Expected->Frame,i))
+            return 0;
+    return 1;
+}
+
+// read the frames to the end of the file, they must be the expected ones of the tracks not masked
+// and the Blocks of the masked tracks must be skipped
+static void ReadFrames(MatroskaFile *File, memory_input *Input, const array *Expected, const uint32_t *Mask, const char *Step)
+{
+    const expected_frame *i = ARRAYBEGIN(*Expected,expected_frame);
+    unsigned int Track, Size, Flags;
+    ulonglong Start, End, Pos;
+    size_t Skipped = 0, j;
+    void *Ref;
+
+    for (j=0;j<sizeof(Blocks)/sizeof(Blocks[0]);++j)
+        if (IsMasked(Mask,Blocks[j].Track))
+            Skipped += CLUSTERS;
+    Input->Skipped = 0;
+    Input->SkippedError = 0;
+
+    for (;;)
+    {
+        while (i!=ARRAYEND(*Expected,expected_frame) && IsMasked(Mask,i->Track))
+            ++i;
+        if (mkv_ReadFrame(File,0,&Track,&Start,&End,&Pos,&Size,&Ref,&Flags) != 0)
+            break;
+        if (i==ARRAYEND(*Expected,expected_frame) || !SameFrame(i,Track,Start,Size,Ref,Flags))
+        {
+            Error(Step,"unexpected frame");
+            Input->Base.releaseref(&Input->Base,Ref);
+            return;
+        }
+        Input->Base.releaseref(&Input->Base,Ref);
+        ++i;
+    }
+    if (i!=ARRAYEND(*Expected,expected_frame))
+        Error(Step,"missing frames");
+    if (Input->Skipped != Skipped || Input->SkippedError)
+        Error(Step,"wrong Blocks skipped");
+}
+
+// the first frame read after a seek to each time in the file
+static void Seek(MatroskaFile *File, memory_input *Input, const array *Expected, const uint32_t *Mask, bool_t WithCues, const char *Step)
+{
+    const expected_frame *i;
+    timecode_t Timecode;
+    size_t Cluster, SeekTrack;
+    unsigned int Track, Size, Flags;
+    ulonglong Start, End, Pos;
+    void *Ref;
+
+    for (Timecode=0;Timecode<(timecode_t)CLUSTERS*CLUSTER_DURATION*TIMECODE_SCALE;Timecode+=(timecode_t)CLUSTER_DURATION*TIMECODE_SCALE/3)
+    {
+        if (WithCues)
+            Cluster = (size_t)(Timecode / ((timecode_t)CLUSTER_DURATION*TIMECODE_SCALE)) & ~1; // the CuePoints of the first track
+        else
+        {
+            // the Cluster with the last keyframe before the time of the video track, or the first track not masked
+            for (SeekTrack=0;IsMasked(Mask,SeekTrack);++SeekTrack) {}
+            Cluster = 0;
+            for (i=ARRAYBEGIN(*Expected,expected_frame);i!=ARRAYEND(*Expected,expected_frame);++i)
+                if (i->Track==SeekTrack && i->Keyframe && i->Timecode!=INVALID_TIMECODE_T && i->Timecode<=Timecode)
+                    Cluster = i->Cluster;
+        }
+        for (i=ARRAYBEGIN(*Expected,expected_frame);i->Cluster!=Cluster || IsMasked(Mask,i->Track);++i) {}
+
+        mkv_Seek(File,Timecode,MKVF_SEEK_TO_PREV_KEYFRAME);
+        if (mkv_ReadFrame(File,0,&Track,&Start,&End,&Pos,&Size,&Ref,&Flags) != 0)
+        {
+            Error(Step,"no frame after seeking");
+            continue;
+        }
+        if (!SameFrame(i,Track,Start,Size,Ref,Flags))
+            Error(Step,"wrong frame after seeking");
+        Input->Base.releaseref(&Input->Base,Ref);
+    }
+
+    // read everything again from the start
+    mkv_Seek(File,0,0);
+    ReadFrames(File,Input,Expected,Mask,Step);
+}
+
+static void Sections(MatroskaFile *File, memory_input *Input, filepos_t AttachmentPos, const char *Step)
+{
+    Tag *Tags;
+    Chapter *Chapters;
+    Attachment *Attachments;
+    unsigned Count;
+
+    mkv_GetTags(File,&Tags,&Count);
+    if (Count!=1 || Tags[0].nSimpleTags!=1 || strcmp(Tags[0].SimpleTags[0].Name,"TITLE")!=0 || strcmp(Tags[0].SimpleTags[0].Value,"parser test")!=0)
+        Error(Step,"wrong Tags");
+    if (mkv_GetLastError(File))
+        Error(Step,"error reading the Tags");
+
+    mkv_GetChapters(File,&Chapters,&Count);
+    if (mkv_GetLastError(File) || Count!=1 || Chapters[0].nChildren!=2 || Chapters[0].Children[1].Start!=5000000000 || Chapters[0].Children[1].End!=10000000000 ||
+        Chapters[0].Children[1].nDisplay!=1 || strcmp(Chapters[0].Children[1].Display[0].String,"second")!=0)
+        Error(Step,"wrong Chapters");
+
+    mkv_GetAttachments(File,&Attachments,&Count);
+    if (mkv_GetLastError(File) || Count!=1 || Attachments[0].UID!=42 || strcmp(Attachments[0].Name,"parsertest.bin")!=0 ||
+        Attachments[0].Position!=AttachmentPos || Attachments[0].Length!=ATTACHMENT_SIZE || Attachments[0].Position+ATTACHMENT_SIZE!=(filepos_t)Input->Size)
+        Error(Step,"wrong Attachments");
+}
+
+static void Parse(anynode *AnyNode, bool_t WithCues)
+{
+    const char *Step = WithCues ? "with Cues" : "without Cues";
+    array File, Expected;
+    memory_input Input;
+    MatroskaFile *Matroska;
+    filepos_t ClustersPos, ClustersEnd, AttachmentPos;
+    uint32_t Mask[(TRACKS+31)/32];
+
+    ArrayInit(&File);
+    ArrayInit(&Expected);
+    BuildFile(&File,WithCues,&Expected,&ClustersPos,&ClustersEnd,&AttachmentPos);
+
+    Matroska = Open(&Input,AnyNode,&File,Step);
+    if (Matroska)
+    {
+        // the sections after the Clusters are read when they are asked for
+        if (Input.ReadEnd > ClustersEnd)
+            Error(Step,"read past the Clusters to open the file");
+        Sections(Matroska,&Input,AttachmentPos,Step);
+
+        ReadFrames(Matroska,&Input,&Expected,NULL,Step);
+
+        // the first video track and one track after the 32nd, the other one is masked
+        memset(Mask,0xFF,sizeof(Mask));
+        Mask[0] &= ~1;
+        Mask[34>>5] &= ~(1u << (34 & 31));
+        mkv_SetTrackMaskEx(Matroska,Mask,TRACKS);
+        Seek(Matroska,&Input,&Expected,Mask,WithCues,Step);
+
+        // the old mask only has the first 32 tracks
+        mkv_SetTrackMask(Matroska,~2);
+        memset(Mask,0,sizeof(Mask));
+        Mask[0] = ~2u;
+        Seek(Matroska,&Input,&Expected,Mask,WithCues,Step);
+
+        // the video track is masked, the seek uses the keyframes of the next one
+        memset(Mask,0,sizeof(Mask));
+        Mask[0] = 1;
+        mkv_SetTrackMaskEx(Matroska,Mask,TRACKS);
+        Seek(Matroska,&Input,&Expected,Mask,WithCues,Step);
+
+        mkv_Close(Matroska);
+    }
+
+    ArrayClear(&Expected);
+    ArrayClear(&File);
+}
+
+// a section that is not where the SeekHead says is reported, not read as empty
+static void BadSection(anynode *AnyNode)
+{
+    const char *Step = "bad Tags";
+    array File, Expected;
+    memory_input Input;
+    MatroskaFile *Matroska;
+    filepos_t ClustersPos, ClustersEnd, AttachmentPos;
+    Tag *Tags;
+    Attachment *Attachments;
+    unsigned Count;
+    uint8_t *i;
+
+    ArrayInit(&File);
+    ArrayInit(&Expected);
+    BuildFile(&File,1,&Expected,&ClustersPos,&ClustersEnd,&AttachmentPos);
+    for (i=ARRAYBEGIN(File,uint8_t)+ClustersEnd;i+4<=ARRAYEND(File,uint8_t);++i)
+        if (i[0]==0x12 && i[1]==0x54 && i[2]==0xC3 && i[3]==0x67)
+        {
+            i[1] = 0x55; // Tags ID changed to an unknown one
+            break;
+        }
+
+    Matroska = Open(&Input,AnyNode,&File,Step);
+    if (Matroska)
+    {
+        mkv_GetTags(Matroska,&Tags,&Count);
+        if (Count!=0 || !mkv_GetLastError(Matroska))
+            Error(Step,"missing Tags not reported");
+        mkv_GetAttachments(Matroska,&Attachments,&Count);
+        if (Count!=1 || mkv_GetLastError(Matroska))
+            Error(Step,"the Attachments are not read");
+        mkv_GetTags(Matroska,&Tags,&Count);
+        if (Count!=0 || !mkv_GetLastError(Matroska))
+            Error(Step,"missing Tags not reported again");
+        mkv_Close(Matroska);
+    }
+
+    ArrayClear(&Expected);
+    ArrayClear(&File);
+}
+
+static bool_t SameArray(const array *a, const array *b)
+{
+    return ARRAYCOUNT(*a,uint8_t)==ARRAYCOUNT(*b,uint8_t) && memcmp(ARRAYBEGIN(*a,uint8_t),ARRAYBEGIN(*b,uint8_t),ARRAYCOUNT(*a,uint8_t))==0;
+}
+
+static void CueIndex(anynode *AnyNode)
+{
+    static uint8_t Sidecar[16384];
+    const char *Step = "cue index";
+    array File, Expected;
+    filepos_t ClustersPos, ClustersEnd, AttachmentPos, SegmentData, SidecarSize;
+    ebml_parser_context Context;
+    ebml_element *Head, *Segment = NULL, *Info = NULL;
+    matroska_cueindex Index, Loaded;
+    stream *Input, *Output = NULL;
+    size_t Keyframes = 0, Found, c, j;
+    const filepos_t *Position;
+
+    ArrayInit(&File);
+    ArrayInit(&Expected);
+    MATROSKA_CueIndexInit(&Index);
+    MATROSKA_CueIndexInit(&Loaded);
+    BuildFile(&File,0,&Expected,&ClustersPos,&ClustersEnd,&AttachmentPos);
+    Input = (stream*)NodeCreate(AnyNode,MEMSTREAM_CLASS);
+    if (!Input)
+    {
+        Error(Step,"no memory stream");
+        goto failed;
+    }
+    Node_Set(Input,MEMSTREAM_DATA,ARRAYBEGIN(File,uint8_t),ARRAYCOUNT(File,uint8_t));
+
+    Context.Context = &MATROSKA_ContextStream;
+    Context.UpContext = NULL;
+    Context.EndPosition = INVALID_FILEPOS_T;
+    Context.Profile = 0;
+    Head = EBML_FindNextId(Input,&EBML_ContextHead,(size_t)-1);
+    if (Head)
+    {
+        Stream_Seek(Input,EBML_ElementPositionEnd(Head),SEEK_SET);
+        NodeDelete((node*)Head);
+        Segment = EBML_FindNextId(Input,&MATROSKA_ContextSegment,(size_t)-1);
+    }
+    Info = EBML_ElementCreate(AnyNode,&MATROSKA_ContextInfo,1,NULL); // the default TimestampScale is the one written
+    if (!Segment || !Info)
+    {
+        Error(Step,"no Segment");
+        goto failed;
+    }
+    SegmentData = EBML_ElementPositionData(Segment);
+
+    // only the Clusters
+    if (MATROSKA_CueIndexScanClusters(&Index,(ebml_master*)Segment,Input,&Context,(ebml_master*)Info,0)!=ERR_NONE ||
+        ARRAYCOUNT(Index.Track,int16_t)!=CLUSTERS || ARRAYCOUNT(Index.TrackStart,size_t)!=2)
+        Error(Step,"wrong Clusters scanned");
+    else
+    {
+        Position = ARRAYBEGIN(Index.ClusterPosition,filepos_t);
+        for (c=0;c<CLUSTERS;++c)
+            if (ARRAYBEGIN(Index.Timecode,timecode_t)[c]!=(timecode_t)c*CLUSTER_DURATION*TIMECODE_SCALE ||
+                ARRAYBEGIN(File,uint8_t)[SegmentData+Position[c]]!=0x1F || (c ? Position[c]<=Position[c-1] : Position[c]!=ClustersPos-SegmentData))
+            {
+                Error(Step,"wrong Cluster position");
+                break;
+            }
+    }
+
+    // and the first keyframe of each track in each Cluster
+    if (MATROSKA_CueIndexScanClusters(&Index,(ebml_master*)Segment,Input,&Context,(ebml_master*)Info,1)!=ERR_NONE)
+        Error(Step,"keyframes not scanned");
+    Position = ARRAYBEGIN(Index.ClusterPosition,filepos_t); // the Clusters come first with track 0
+    for (c=0;c<CLUSTERS;++c)
+        for (j=0;j<sizeof(Blocks)/sizeof(Blocks[0]);++j)
+        {
+            if (!IsKeyframe(j,c))
+                continue;
+            ++Keyframes;
+            Found = MATROSKA_CueIndexFind(&Index,Blocks[j].Track+1,((timecode_t)c*CLUSTER_DURATION+Blocks[j].Timecode)*TIMECODE_SCALE);
+            if (Found==MATROSKA_CUEINDEX_NONE || ARRAYBEGIN(Index.Track,int16_t)[Found]!=Blocks[j].Track+1 ||
+                ARRAYBEGIN(Index.Timecode,timecode_t)[Found]!=((timecode_t)c*CLUSTER_DURATION+Blocks[j].Timecode)*TIMECODE_SCALE ||
+                ARRAYBEGIN(Index.ClusterPosition,filepos_t)[Found]!=Position[c] || ARRAYBEGIN(Index.BlockNumber,int32_t)[Found]!=(int32_t)j+1)
+            {
+                Error(Step,"wrong keyframe");
+                c = CLUSTERS;
+                break;
+            }
+        }
+    if (ARRAYCOUNT(Index.Track,int16_t)!=CLUSTERS+Keyframes)
+        Error(Step,"wrong number of keyframes");
+
+    // the sidecar is only loaded for the same source file
+    Output = (stream*)NodeCreate(AnyNode,MEMSTREAM_CLASS);
+    if (!Output)
+    {
+        Error(Step,"no memory stream");
+        goto failed;
+    }
+    Node_Set(Output,MEMSTREAM_DATA,Sidecar,sizeof(Sidecar));
+    if (MATROSKA_CueIndexSave(&Index,Output,ARRAYCOUNT(File,uint8_t),1234)!=ERR_NONE)
+        Error(Step,"index not saved");
+    SidecarSize = Stream_Seek(Output,0,SEEK_CUR);
+    Node_Set(Output,MEMSTREAM_DATA,Sidecar,(size_t)SidecarSize);
+    if (MATROSKA_CueIndexLoad(&Loaded,Output,ARRAYCOUNT(File,uint8_t),1234)!=ERR_NONE ||
+        !SameArray(&Index.Timecode,&Loaded.Timecode) || !SameArray(&Index.Track,&Loaded.Track) ||
+        !SameArray(&Index.ClusterPosition,&Loaded.ClusterPosition) || !SameArray(&Index.RelativePosition,&Loaded.RelativePosition) ||
+        !SameArray(&Index.BlockNumber,&Loaded.BlockNumber) || !SameArray(&Index.TrackStart,&Loaded.TrackStart))
+        Error(Step,"the loaded index differs");
+    Stream_Seek(Output,0,SEEK_SET);
+    if (MATROSKA_CueIndexLoad(&Loaded,Output,ARRAYCOUNT(File,uint8_t),1235)!=ERR_INVALID_DATA || !ARRAYEMPTY(Loaded.Timecode))
+        Error(Step,"index loaded for another date");
+    Stream_Seek(Output,0,SEEK_SET);
+    if (MATROSKA_CueIndexLoad(&Loaded,Output,ARRAYCOUNT(File,uint8_t)+1,1234)!=ERR_INVALID_DATA || !ARRAYEMPTY(Loaded.Timecode))
+        Error(Step,"index loaded for another size");
+
+failed:
+    if (Output)
+        StreamClose(Output);
+    if (Input)
+        StreamClose(Input);
+    if (Segment)
+        NodeDelete((node*)Segment);
+    if (Info)
+        NodeDelete((node*)Info);
+    MATROSKA_CueIndexClear(&Index);
+    MATROSKA_CueIndexClear(&Loaded);
+    ArrayClear(&Expected);
+    ArrayClear(&File);
+}
+
+int main(void)
+{
+    parsercontext p;
+
+    ParserContext_Init(&p,NULL,NULL,NULL);
+    StdAfx_Init((nodemodule*)&p);
+    MATROSKA_Init((nodecontext*)&p);
+
+    Parse((anynode*)&p,1);
+    Parse((anynode*)&p,0);
+    BadSection((anynode*)&p);
+    CueIndex((anynode*)&p);
+    fprintf(stdout,"%d errors\r\n",Errors);
+
+    MATROSKA_Done((nodecontext*)&p);
+    StdAfx_Done((nodemodule*)&p);
+    ParserContext_Done(&p);
+    return Errors!=0;
+}
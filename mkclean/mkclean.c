@@ -252,36 +252,23 @@ static void ReduceSize(ebml_element *Element)
 static bool_t ReadClusterData(ebml_master *Cluster, stream *Input)
 {
     bool_t Changed = 0;
-    err_t Result = ERR_NONE;
-    ebml_element *Block, *GBlock, *NextBlock;
-    // read all the Block/SimpleBlock data
-    for (Block = EBML_MasterChildren(Cluster);Block;Block=NextBlock)
+    array Failed;
+    matroska_block **Block;
+    ebml_element *Elt;
+    // read all the Block/SimpleBlock data, the compressed ones are decoded on all the CPUs with CONFIG_MULTITHREAD
+    ArrayInit(&Failed);
+    if (MATROSKA_ClusterReadBlocksData((matroska_cluster*)Cluster, Input, 0, &Failed)!=ERR_NONE)
     {
-        NextBlock = EBML_MasterNext(Block);
-        if (EBML_ElementIsType(Block, &MATROSKA_ContextBlockGroup))
-        {
-            for (GBlock = EBML_MasterChildren(Block);GBlock;GBlock=EBML_MasterNext(GBlock))
-            {
-                if (EBML_ElementIsType(GBlock, &MATROSKA_ContextBlock))
-                {
-                    if ((Result = MATROSKA_BlockReadData((matroska_block*)GBlock, Input))!=ERR_NONE)
-                    {
-                        Changed = 1;
-                        NodeDelete((node*)Block);
-                    }
-                    break;
-                }
-            }
-        }
-        else if (EBML_ElementIsType(Block, &MATROSKA_ContextSimpleBlock))
+        for (Block=ARRAYBEGIN(Failed,matroska_block*);Block!=ARRAYEND(Failed,matroska_block*);++Block)
         {
-            if ((Result = MATROSKA_BlockReadData((matroska_block*)Block, Input))!=ERR_NONE)
-            {
-                Changed = 1;
-                NodeDelete((node*)Block);
-            }
+            Elt = (ebml_element*)*Block;
+            if (EBML_ElementIsType(Elt, &MATROSKA_ContextBlock))
+                Elt = EBML_ElementParent(Elt);
+            Changed = 1;
+            NodeDelete((node*)Elt);
         }
     }
+    ArrayClear(&Failed);
     return Changed;
 }
 
@@ -696,7 +683,7 @@ static bool_t WriteCluster(ebml_master *Cluster, stream *Output, stream *Input,
     }
     *PrevTimecode = MATROSKA_ClusterTimecode((matroska_cluster*)Cluster);
 
-    EBML_ElementRender((ebml_element*)Cluster,Output,0,0,1,NULL);
+    EBML_ElementRenderGathered((ebml_element*)Cluster,Output,0,0,1,NULL);
 
     UnReadClusterData(Cluster, 1);
 
@@ -1399,9 +1386,15 @@ static void ClearCommonHeader(array *TrackHeader)
 
 static void WriteJunk(stream *Output, size_t Amount)
 {
-	char Val = 0x0A;
-	while (Amount--)
-		Stream_Write(Output,&Val,1,NULL);
+	uint8_t Val[256];
+	size_t Size;
+	memset(Val,0x0A,sizeof(Val));
+	while (Amount)
+	{
+		Size = min(Amount,sizeof(Val));
+		Stream_Write(Output,Val,Size,NULL);
+		Amount -= Size;
+	}
 }
 
 #if defined(TARGET_WIN) && defined(UNICODE)
@@ -1414,6 +1407,7 @@ int main(int argc, const char *argv[])
     int ShowUsage = 0;
     int ShowVersion = 0;
     parsercontext p;
+    ebml_memheap Heap;
     textwriter _StdErr;
     stream *Input = NULL,*Output = NULL;
     tchar_t Path[MAXPATHFULL];
@@ -1442,7 +1436,8 @@ int main(int argc, const char *argv[])
     array Alternate3DTracks;
 
     // Core-C init phase
-    ParserContext_Init(&p,NULL,NULL,NULL);
+    EBML_MemHeapInit(&Heap,NULL);
+    ParserContext_Init(&p,NULL,&Heap.Base,NULL);
 	StdAfx_Init((nodemodule*)&p);
     ProjectSettings((nodecontext*)&p);
 
@@ -1586,7 +1581,7 @@ int main(int argc, const char *argv[])
 #else
     Node_FromStr(&p,Path,TSIZEOF(Path),argv[InputPathIndex]);
 #endif
-    Input = StreamOpen(&p,Path,SFLAG_RDONLY/*|SFLAG_BUFFERED*/);
+    Input = StreamOpen(&p,Path,SFLAG_RDONLY|SFLAG_MAPPED/*|SFLAG_BUFFERED*/);
     if (!Input)
     {
         TextPrintf(StdErr,T("Could not open file \"%s\" for reading\r\n"),Path);
@@ -1719,6 +1714,7 @@ int main(int argc, const char *argv[])
         }
         else if (EBML_ElementIsType((ebml_element*)RLevel1, &MATROSKA_ContextCluster))
         {
+            EBML_MasterUseArena(RLevel1,1); // all the Cluster children are allocated at once
 			// only partially read the Cluster data (not the data inside the blocks)
             if (EBML_ElementReadData((ebml_element*)RLevel1,Input,&RSegmentContext,!Remux,SCOPE_PARTIAL_DATA,0)==ERR_NONE)
 			{
@@ -1839,6 +1835,8 @@ int main(int argc, const char *argv[])
 		i = -1;
 		for (Elt = EBML_MasterChildren(WTrackInfo);Elt;Elt=EBML_MasterNext(Elt))
 		{
+			if (!EBML_ElementIsType(Elt, &MATROSKA_ContextTrackEntry))
+				continue;
 			Elt2 = EBML_MasterFindChild((ebml_master*)Elt,&MATROSKA_ContextTrackNumber);
             if (Elt2)
 			    i = max(i,(int)EBML_IntegerValue((ebml_integer*)Elt2));
@@ -856,14 +856,14 @@ static int CheckCueEntries(ebml_master *Cues)
 			if (TimecodeEntry < PrevTimecode && PrevTimecode != INVALID_TIMECODE_T)
 				OutputWarning(0x311,T("The Cues entry for timecode %") TPRId64 T(" ms is listed after entry %") TPRId64 T(" ms"),Scale64(TimecodeEntry,1,1000000),Scale64(PrevTimecode,1,1000000));
 
-			// find a matching Block
-			for (Cluster = ARRAYBEGIN(RClusters,matroska_cluster*);Cluster != ARRAYEND(RClusters,matroska_cluster*); ++Cluster)
-			{
+			// find a matching Block, first in the Clusters around the timecode
+			Cluster = MATROSKA_ClusterForTimecode(&RClusters, TimecodeEntry);
+			Block = MATROSKA_GetBlockForTimecode(*Cluster, TimecodeEntry, TrackNumEntry);
+			if (!Block && Cluster+1 != ARRAYEND(RClusters,matroska_cluster*))
+				Block = MATROSKA_GetBlockForTimecode(Cluster[1], TimecodeEntry, TrackNumEntry);
+			for (Cluster = ARRAYBEGIN(RClusters,matroska_cluster*);!Block && Cluster != ARRAYEND(RClusters,matroska_cluster*); ++Cluster)
 				Block = MATROSKA_GetBlockForTimecode(*Cluster, TimecodeEntry, TrackNumEntry);
-				if (Block)
-					break;
-			}
-			if (Cluster == ARRAYEND(RClusters,matroska_cluster*))
+			if (!Block)
 				Result |= OutputError(0x312,T("CueEntry Track #%d and timecode %") TPRId64 T(" ms not found"),(int)TrackNumEntry,Scale64(TimecodeEntry,1,1000000));
 			PrevTimecode = TimecodeEntry;
 			CuePoint = (matroska_cuepoint*)EBML_MasterFindNextElt(Cues, (ebml_element*)CuePoint, 0, 0);
@@ -882,6 +882,7 @@ int main(int argc, const char *argv[])
     int ShowUsage = 0;
     int ShowVersion = 0;
     parsercontext p;
+    ebml_memheap Heap;
     textwriter _StdErr;
     stream *Input = NULL;
     tchar_t Path[MAXPATHFULL];
@@ -899,7 +900,8 @@ int main(int argc, const char *argv[])
 	filepos_t VoidAmount = 0;
 
     // Core-C init phase
-    ParserContext_Init(&p,NULL,NULL,NULL);
+    EBML_MemHeapInit(&Heap,NULL);
+    ParserContext_Init(&p,NULL,&Heap.Base,NULL);
 	StdAfx_Init((nodemodule*)&p);
     ProjectSettings((nodecontext*)&p);
 
@@ -956,7 +958,7 @@ int main(int argc, const char *argv[])
 #else
 	Node_FromStr(&p,Path,TSIZEOF(Path),argv[argc-1]);
 #endif
-    Input = StreamOpen(&p,Path,SFLAG_RDONLY/*|SFLAG_BUFFERED*/);
+    Input = StreamOpen(&p,Path,SFLAG_RDONLY|SFLAG_MAPPED/*|SFLAG_BUFFERED*/);
     if (!Input)
     {
         TextPrintf(StdErr,T("Could not open file \"%s\" for reading\r\n"),Path);
@@ -1060,6 +1062,7 @@ int main(int argc, const char *argv[])
         RLevelX = NULL;
         if (EL_Type(RLevel1, &MATROSKA_ContextCluster))
         {
+            EBML_MasterUseArena(RLevel1,1); // all the Cluster children are allocated at once
             if (EBML_ElementReadData(RLevel1,Input,&RSegmentContext,0,SCOPE_PARTIAL_DATA,4)==ERR_NONE)
 			{
                 ArrayAppend(&RClusters,&RLevel1,sizeof(RLevel1),256);
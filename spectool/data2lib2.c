@@ -97,6 +97,87 @@ static void AddElementSemantic(textwriter *CFile, const SpecElement *elt, bool_t
         TextWrite(CFile, T("},\n"));
 }
 
+#define MAX_INDEX_BITS  12
+
+// find a multiplier that gives a different slot to each ID, in the smallest table possible
+static bool_t FindSemanticIndex(const fourcc_t *Ids, size_t Count, uint32_t *Multiplier, int *Bits)
+{
+    uint8_t Used[1<<MAX_INDEX_BITS];
+    size_t i, Try;
+
+    for (*Bits=1; ((size_t)1<<*Bits) < 2*Count; ++*Bits) {}
+    for (; *Bits<=MAX_INDEX_BITS; ++*Bits)
+    {
+        *Multiplier = 0x9E3779B1; // golden ratio
+        for (Try=0; Try<10000; ++Try)
+        {
+            memset(Used,0,(size_t)1<<*Bits);
+            for (i=0; i<Count; ++i)
+            {
+                uint32_t Slot = (uint32_t)(Ids[i] * *Multiplier) >> (32 - *Bits);
+                if (Used[Slot])
+                    break;
+                Used[Slot] = 1;
+            }
+            if (i==Count)
+                return 1;
+            *Multiplier = (*Multiplier * 1664525 + 1013904223) | 1;
+        }
+    }
+    return 0;
+}
+
+static bool_t OutputSemanticIndex(textwriter *CFile, const SpecElement *elt)
+{
+    fourcc_t Ids[255], Unique[255];
+    uint8_t Slots[1<<MAX_INDEX_BITS];
+    size_t Count = 0, UniqueCount = 0, i, j;
+    uint32_t Multiplier;
+    int Bits;
+    nodetree* sub;
+
+    // same order as the semantic table
+    if (elt->Recursive)
+        Ids[Count++] = elt->Id;
+    for (sub = NodeTree_Children(elt); sub; sub = NodeTree_Next(sub))
+    {
+        if (Count == sizeof(Ids)/sizeof(Ids[0]))
+            return 0;
+        Ids[Count++] = ((SpecElement*)sub)->Id;
+    }
+    if (!Count)
+        return 0;
+
+    for (i=0; i<Count; ++i)
+    {
+        for (j=0; j<UniqueCount && Unique[j]!=Ids[i]; ++j) {}
+        if (j==UniqueCount)
+            Unique[UniqueCount++] = Ids[i];
+    }
+    if (!FindSemanticIndex(Unique, UniqueCount, &Multiplier, &Bits))
+        return 0;
+
+    // duplicated IDs keep the first position, like the linear search
+    memset(Slots,0,sizeof(Slots));
+    for (i=0; i<Count; ++i)
+    {
+        j = (uint32_t)(Ids[i] * Multiplier) >> (32 - Bits);
+        if (!Slots[j])
+            Slots[j] = (uint8_t)(i+1);
+    }
+
+    TextPrintf(CFile, T("static const uint8_t EBML_IndexSlots%s[] = {"), elt->Name);
+    for (i=0; i<((size_t)1<<Bits); ++i)
+    {
+        if ((i & 15)==0)
+            TextWrite(CFile, T("\n   "));
+        TextPrintf(CFile, T(" %d,"), Slots[i]);
+    }
+    TextWrite(CFile, T("\n};\n"));
+    TextPrintf(CFile, T("static const ebml_semantic_index EBML_Index%s = {0x%08X, %d, EBML_IndexSlots%s};\n"), elt->Name, Multiplier, 32 - Bits, elt->Name);
+    return 1;
+}
+
 static void OutputElementDefinition(const SpecElement **pElt, const SpecElement **EltEnd, textwriter *CFile, table_extras *Extras)
 {
     const SpecElement *elt = *pElt;
@@ -137,6 +218,7 @@ static void OutputElementDefinition(const SpecElement **pElt, const SpecElement
         {
             const tchar_t *s;
             intptr_t value;
+            bool_t HasIndex = 0;
 
             if (elt->Type==EBML_MASTER)
             {
@@ -151,6 +233,7 @@ static void OutputElementDefinition(const SpecElement **pElt, const SpecElement
                     AddElementSemantic(CFile, (SpecElement*)i, 0);
                 }
                 TextWrite(CFile, T("    {0, 0, NULL ,0} // end of the table\n};\n"));
+                HasIndex = OutputSemanticIndex(CFile, elt);
             }
 
             TextPrintf(CFile, T("const ebml_context MATROSKA_Context%s = {0x%X, "), elt->Name, elt->Id);
@@ -245,7 +328,10 @@ static void OutputElementDefinition(const SpecElement **pElt, const SpecElement
             else
                 TextPrintf(CFile, T("EBML_Semantic%s, "), elt->Name);
             TextWrite(CFile, T("EBML_SemanticGlobals, "));
-            TextWrite(CFile, T("NULL};\n"));
+            if (HasIndex)
+                TextPrintf(CFile, T("NULL, &EBML_Index%s};\n"), elt->Name);
+            else
+                TextWrite(CFile, T("NULL};\n"));
         }
     }
 }